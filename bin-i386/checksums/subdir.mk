@@ -6,24 +6,36 @@
 C_SRCS += \
 ../checksums/crc32.c \
 ../checksums/crc32driver.c \
+../checksums/csumpool.c \
+../checksums/csumpooldriver.c \
 ../checksums/md5.c \
 ../checksums/md5driver.c \
+../checksums/md5mb.c \
+../checksums/md5mbdriver.c \
 ../checksums/sha1.c \
 ../checksums/sha1driver.c 
 
 OBJS += \
 ./checksums/crc32.o \
 ./checksums/crc32driver.o \
+./checksums/csumpool.o \
+./checksums/csumpooldriver.o \
 ./checksums/md5.o \
 ./checksums/md5driver.o \
+./checksums/md5mb.o \
+./checksums/md5mbdriver.o \
 ./checksums/sha1.o \
 ./checksums/sha1driver.o 
 
 C_DEPS += \
 ./checksums/crc32.d \
 ./checksums/crc32driver.d \
+./checksums/csumpool.d \
+./checksums/csumpooldriver.d \
 ./checksums/md5.d \
 ./checksums/md5driver.d \
+./checksums/md5mb.d \
+./checksums/md5mbdriver.d \
 ./checksums/sha1.d \
 ./checksums/sha1driver.d 
 
@@ -7,27 +7,37 @@ CPP_SRCS += \
 ../beacon.cpp \
 ../checksum.cpp \
 ../cli.cpp \
+../compress.cpp \
 ../data.cpp \
+../delta.cpp \
 ../dirent.cpp \
 ../dirflags.cpp \
 ../execute.cpp \
+../fec.cpp \
 ../fileio.cpp \
 ../flags.cpp \
+../fountain.cpp \
 ../frame.cpp \
+../frameview.cpp \
 ../globals.cpp \
 ../holes.cpp \
 ../htonll.cpp \
 ../htonlll.cpp \
 ../ip.cpp \
+../kiss.cpp \
+../link.cpp \
 ../metadata.cpp \
 ../offsetstr.cpp \
 ../peerinfo.cpp \
 ../readconf.cpp \
+../repair.cpp \
 ../request.cpp \
 ../saratoga.cpp \
 ../sarflags.cpp \
 ../screen.cpp \
+../signature.cpp \
 ../status.cpp \
+../symbol.cpp \
 ../sysinfo.cpp \
 ../test.cpp \
 ../test1.cpp \
@@ -41,27 +51,37 @@ OBJS += \
 ./beacon.o \
 ./checksum.o \
 ./cli.o \
+./compress.o \
 ./data.o \
+./delta.o \
 ./dirent.o \
 ./dirflags.o \
 ./execute.o \
+./fec.o \
 ./fileio.o \
 ./flags.o \
+./fountain.o \
 ./frame.o \
+./frameview.o \
 ./globals.o \
 ./holes.o \
 ./htonll.o \
 ./htonlll.o \
 ./ip.o \
+./kiss.o \
+./link.o \
 ./metadata.o \
 ./offsetstr.o \
 ./peerinfo.o \
 ./readconf.o \
+./repair.o \
 ./request.o \
 ./saratoga.o \
 ./sarflags.o \
 ./screen.o \
+./signature.o \
 ./status.o \
+./symbol.o \
 ./sysinfo.o \
 ./test.o \
 ./test1.o \
@@ -75,27 +95,37 @@ CPP_DEPS += \
 ./beacon.d \
 ./checksum.d \
 ./cli.d \
+./compress.d \
 ./data.d \
+./delta.d \
 ./dirent.d \
 ./dirflags.d \
 ./execute.d \
+./fec.d \
 ./fileio.d \
 ./flags.d \
+./fountain.d \
 ./frame.d \
+./frameview.d \
 ./globals.d \
 ./holes.d \
 ./htonll.d \
 ./htonlll.d \
 ./ip.d \
+./kiss.d \
+./link.d \
 ./metadata.d \
 ./offsetstr.d \
 ./peerinfo.d \
 ./readconf.d \
+./repair.d \
 ./request.d \
 ./saratoga.d \
 ./sarflags.d \
 ./screen.d \
+./signature.d \
 ./status.d \
+./symbol.d \
 ./sysinfo.d \
 ./test.d \
 ./test1.d \
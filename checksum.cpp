@@ -40,12 +40,16 @@
 #include "screen.h"
 #include <algorithm>
 #include <cctype>
+#include <cstring>
+#include <errno.h>
+#include <fcntl.h>
 #include <fstream>
 #include <inttypes.h>
 #include <iostream>
 #include <stdio.h>
 #include <string>
 #include <unistd.h>
+#include <vector>
 
 namespace checksums {
 
@@ -164,6 +168,21 @@ checksum::print()
   }
 }
 
+string
+checksum::strval()
+{
+  switch (_csumtype) {
+    case CSUM_CRC32:
+      return (_crc32.strval());
+    case CSUM_MD5:
+      return (_md5.strval());
+    case CSUM_SHA1:
+      return (_sha1.strval());
+    default:
+      return (_none.strval());
+  }
+}
+
 // ************************************************************************************
 // No Checksum
 // ************************************************************************************
@@ -206,10 +225,16 @@ crc32::print()
 
 crc32::crc32(string fname)
 {
-  const size_t buflen = 1024;
-  char buf[buflen];
+  const size_t buflen = csum_buflen;
+  csumbuf cbuf;
+  char* buf = cbuf.buf();
   unsigned long csum = 0;
 
+  if (!cbuf.ok()) {
+    scr.error("crc32: No memory to read file: %s", fname.c_str());
+    _crc32 = 0;
+    return;
+  }
   ifstream fs(fname.c_str(), ios::binary);
   if (!fs.is_open()) {
     scr.error("crc32: Can't open file: %s", fname.c_str());
@@ -259,7 +284,7 @@ md5::strval()
 
   string s("");
   for (size_t i = 0; i < CSUMLEN_MD5 * 4; i++) {
-    sprintf(tmp, "%02" PRIX8 "", (uint8_t)_md5[i]);
+    sprintf(tmp, "%02" PRIX8 "", (uint8_t)_md5char[i]);
     s += tmp;
     if (i == 3 || i == 7 || i == 11)
       s += " ";
@@ -286,7 +311,7 @@ md5::md5(uint32_t* i)
 {
   uint32_t* j = i;
 
-  for (size_t x = 0; x < CSUMLEN_MD5 * 4; x++) {
+  for (size_t x = 0; x < CSUMLEN_MD5; x++) {
     _md5char[x * 4 + 0] = ((*i) >> 24);
     _md5char[x * 4 + 1] = ((*i) >> 16) & 0xFF;
     _md5char[x * 4 + 2] = ((*i) >> 8) & 0xFF;
@@ -299,10 +324,18 @@ md5::md5(uint32_t* i)
 
 md5::md5(string fname)
 {
-  const size_t buflen = 1024;
-  char buf[buflen];
+  const size_t buflen = csum_buflen;
+  csumbuf cbuf;
+  char* buf = cbuf.buf();
   ::MD5_CTX context;
 
+  if (!cbuf.ok()) {
+    scr.error("MD5: No memory to read file: %s", fname.c_str());
+    this->clear();
+    for (size_t i = 0; i < CSUMLEN_MD5 * 4; i++)
+      _md5char[i] = (uchar_t)0;
+    return;
+  }
   ifstream fs(fname.c_str(), ios::binary);
   if (!fs.is_open()) {
     scr.error("MD5: Can't open file: %s", fname.c_str());
@@ -329,15 +362,164 @@ md5::md5(string fname)
   // Handle the last buffer < buflen
   if (fs.gcount() > 0)
     ::MD5Update(&context, (unsigned char*)&buf[0], fs.gcount());
-  ::MD5Final(_md5char, &context);
+  uchar_t digest[CSUMLEN_MD5 * 4];
+  ::MD5Final(digest, &context);
   fs.close();
+  this->setdigest(digest);
+  return;
+}
+
+md5::md5(const uchar_t* digest)
+{
+  this->setdigest(digest);
+}
+
+// Take the 16 byte digest and keep it as bytes and as big endian words
+void
+md5::setdigest(const uchar_t* digest)
+{
+  for (size_t i = 0; i < CSUMLEN_MD5 * 4; i++)
+    _md5char[i] = digest[i];
   for (size_t i = 0; i < CSUMLEN_MD5; i++) {
-    _md5[i] = _md5char[i * 4] << 24;
-    _md5[i] &= (_md5char[i * 4 + 1] << 16);
-    _md5[i] &= (_md5char[i * 4 + 2] << 8);
-    _md5[i] &= (_md5char[i * 4 + 3]);
+    _md5[i] = (uint32_t)_md5char[i * 4] << 24;
+    _md5[i] |= (uint32_t)_md5char[i * 4 + 1] << 16;
+    _md5[i] |= (uint32_t)_md5char[i * 4 + 2] << 8;
+    _md5[i] |= (uint32_t)_md5char[i * 4 + 3];
+  }
+}
+
+// One stream of an md5batch(), a file being read into its own slice of
+// the shared read buffer
+struct md5lane
+{
+  size_t idx;         // Which name in the batch
+  int fd;             // -1 when the lane is idle
+  ::MD5_CTX ctx;      // Running hash
+  unsigned char* buf; // This lane's slice of the read buffer
+  size_t len;         // Bytes in buf
+  size_t off;         // Bytes of buf already hashed
+  bool eof;           // Short read seen, buf holds the end of the file
+};
+
+// Fill buf from the file; a short count only ever means end of file
+static ssize_t
+md5fill(int fd, unsigned char* buf, size_t len)
+{
+  size_t got = 0;
+
+  while (got < len) {
+    ssize_t n = ::read(fd, buf + got, len - got);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      return -1;
+    if (n == 0)
+      break;
+    got += n;
+  }
+  return (ssize_t)got;
+}
+
+// Get the lane to where it has at least one whole block to hash,
+// finishing files and starting the next ones on the way. Returns false
+// once the lane has nothing more to do.
+static bool
+md5ready(md5lane& l, const vector<string>& names, size_t& next,
+         vector<md5>& res, size_t chunk)
+{
+  for (;;) {
+    if (l.fd < 0) {
+      if (next >= names.size())
+        return false;
+      l.idx = next++;
+      l.fd = ::open(names[l.idx].c_str(), O_RDONLY | O_LARGEFILE);
+      if (l.fd < 0) {
+        scr.error("MD5: Can't open file: %s", names[l.idx].c_str());
+        continue;
+      }
+      ::posix_fadvise(l.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+      ::MD5Init(&l.ctx);
+      l.len = l.off = 0;
+      l.eof = false;
+    }
+    if (l.len - l.off >= 64)
+      return true;
+    if (!l.eof) {
+      ssize_t n = md5fill(l.fd, l.buf, chunk);
+      if (n < 0) {
+        scr.error("Error reading MD5 checksum file:%s",
+                  names[l.idx].c_str());
+        ::close(l.fd);
+        l.fd = -1;
+        continue;
+      }
+      l.len = n;
+      l.off = 0;
+      l.eof = ((size_t)n < chunk);
+      continue;
+    }
+    // End of file, the tail is less than a block
+    uchar_t digest[CSUMLEN_MD5 * 4];
+    ::MD5Update(&l.ctx, l.buf + l.off, l.len - l.off);
+    ::MD5Final(digest, &l.ctx);
+    res[l.idx] = md5(digest);
+    ::close(l.fd);
+    l.fd = -1;
   }
-  return;
+}
+
+std::list<md5>
+md5batch(const std::list<string>& fnames)
+{
+  vector<string> names(fnames.begin(), fnames.end());
+  vector<md5> res(names.size());
+  std::list<md5> ret;
+  csumbuf cbuf;
+
+  size_t lanes = std::min((size_t)MD5MB_Lanes(), names.size());
+  if (lanes <= 1 || !cbuf.ok()) {
+    // Nothing to run side by side, the plain path is as fast
+    for (size_t i = 0; i < names.size(); i++)
+      ret.push_back(md5(names[i]));
+    return ret;
+  }
+
+  // Every lane gets an equal, block aligned, slice of the read buffer
+  size_t chunk = (csum_buflen / lanes) & ~(size_t)63;
+  md5lane lane[MD5MB_MAXLANES];
+  size_t next = 0;
+  for (size_t i = 0; i < lanes; i++) {
+    lane[i].fd = -1;
+    lane[i].buf = (unsigned char*)cbuf.buf() + i * chunk;
+  }
+
+  for (;;) {
+    ::MD5_CTX* ctx[MD5MB_MAXLANES];
+    const unsigned char* in[MD5MB_MAXLANES];
+    md5lane* active[MD5MB_MAXLANES];
+    size_t n = 0;
+    size_t blocks = 0;
+
+    for (size_t i = 0; i < lanes; i++) {
+      if (!md5ready(lane[i], names, next, res, chunk))
+        continue;
+      size_t b = (lane[i].len - lane[i].off) / 64;
+      if (n == 0 || b < blocks)
+        blocks = b;
+      active[n] = &lane[i];
+      ctx[n] = &lane[i].ctx;
+      in[n++] = lane[i].buf + lane[i].off;
+    }
+    if (n == 0)
+      break;
+    // Hash in lockstep as far as the shortest lane goes
+    ::MD5MB_Update(ctx, in, (int)n, blocks);
+    for (size_t i = 0; i < n; i++)
+      active[i]->off += blocks * 64;
+  }
+  for (size_t i = 0; i < res.size(); i++)
+    ret.push_back(res[i]);
+  return ret;
 }
 
 // ************************************************************************************
@@ -384,9 +566,14 @@ sha1::sha1(uint32_t* i)
 sha1::sha1(string fname)
 {
   ::SHA1Context sha;
-  const size_t buflen = 1024;
-  char buf[buflen];
+  const size_t buflen = csum_buflen;
+  csumbuf cbuf;
+  char* buf = cbuf.buf();
 
+  if (!cbuf.ok()) {
+    scr.error("SHA1: No memory to read file: %s", fname.c_str());
+    return;
+  }
   ifstream fs(fname.c_str(), ios::binary);
   if (!fs.is_open()) {
     scr.error("SHA1: Can't open file: %s", fname.c_str());
@@ -399,14 +586,11 @@ sha1::sha1(string fname)
       scr.error("Error reading SHA1 checksum file:%s", fname.c_str());
       return;
     }
-    for (unsigned int i = 0; i < buflen; i++)
-      SHA1Input(&sha, (unsigned char*)&buf[i], 1);
+    ::SHA1Input(&sha, (unsigned char*)buf, buflen);
   }
   // Handle the last buffer < buflen
-  if (fs.gcount() > 0) {
-    for (unsigned int i = 0; i < fs.gcount(); i++)
-      ::SHA1Input(&sha, (unsigned char*)&buf[i], 1);
-  }
+  if (fs.gcount() > 0)
+    ::SHA1Input(&sha, (unsigned char*)buf, fs.gcount());
   if (!::SHA1Result(&sha)) {
     scr.error("Could not compute SHA1 message digest for %s\n", fname.c_str());
     return;
@@ -417,4 +601,309 @@ sha1::sha1(string fname)
   return;
 }
 
+// ************************************************************************************
+// Streaming checksum
+// ************************************************************************************
+
+void
+csumstream::reset(const enum csum_type t)
+{
+  _csumtype = t;
+  _fed = 0;
+  _crc32 = 0;
+  ::MD5Init(&_md5);
+  ::SHA1Reset(&_sha1);
+}
+
+size_t
+csumstream::update(const char* buf, size_t len, uint64_t off)
+{
+  if (_csumtype == CSUM_NONE || off > _fed || off + len <= _fed)
+    return 0;
+  size_t skip = (size_t)(_fed - off);
+  char* p = (char*)buf + skip;
+  size_t n = len - skip;
+
+  switch (_csumtype) {
+    case CSUM_CRC32:
+      _crc32 = ::Crc32_ComputeBuf(_crc32, p, n);
+      break;
+    case CSUM_MD5:
+      ::MD5Update(&_md5, (unsigned char*)p, n);
+      break;
+    case CSUM_SHA1:
+      // SHA1Input takes an unsigned length
+      for (size_t i = 0; i < n; i += csum_buflen)
+        ::SHA1Input(&_sha1, (const unsigned char*)p + i,
+                    (unsigned)min(csum_buflen, n - i));
+      break;
+    default:
+      return 0;
+  }
+  _fed += n;
+  return n;
+}
+
+checksum
+csumstream::result()
+{
+  switch (_csumtype) {
+    case CSUM_CRC32: {
+      uint32_t crc = (uint32_t)_crc32;
+      return checksum(CSUM_CRC32, &crc);
+    }
+    case CSUM_MD5: {
+      ::MD5_CTX ctx = _md5;
+      uchar_t digest[CSUMLEN_MD5 * 4];
+      uint32_t words[CSUMLEN_MD5];
+      ::MD5Final(digest, &ctx);
+      for (size_t i = 0; i < CSUMLEN_MD5; i++)
+        words[i] = (uint32_t)digest[i * 4] << 24 |
+                   (uint32_t)digest[i * 4 + 1] << 16 |
+                   (uint32_t)digest[i * 4 + 2] << 8 |
+                   (uint32_t)digest[i * 4 + 3];
+      return checksum(CSUM_MD5, words);
+    }
+    case CSUM_SHA1: {
+      ::SHA1Context ctx = _sha1;
+      uint32_t words[CSUMLEN_SHA1];
+      if (!::SHA1Result(&ctx)) {
+        scr.error("csumstream: Could not compute SHA1 message digest");
+        return checksum();
+      }
+      for (size_t i = 0; i < CSUMLEN_SHA1; i++)
+        words[i] = (uint32_t)ctx.Message_Digest[i];
+      return checksum(CSUM_SHA1, words);
+    }
+    default:
+      return checksum();
+  }
+}
+
+// ************************************************************************************
+// Checksum cache
+// ************************************************************************************
+
+static const char csumcache_magic[8] = { 'S', 'A', 'R', 'C', 'S', 'U', 'M', '1' };
+
+void
+csumcache::key(const struct stat& st, enum csum_type t, entry* e)
+{
+  memset(e, 0, sizeof(entry));
+  e->dev = (uint64_t)st.st_dev;
+  e->ino = (uint64_t)st.st_ino;
+  e->size = (uint64_t)st.st_size;
+  e->mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+  e->type = (uint32_t)t;
+}
+
+bool
+csumcache::match(const entry& a, const entry& b)
+{
+  return (a.dev == b.dev && a.ino == b.ino && a.size == b.size &&
+          a.mtime == b.mtime && a.type == b.type);
+}
+
+bool
+csumcache::find(const struct stat& st, enum csum_type t, checksum& c)
+{
+  entry want;
+
+  if (t == CSUM_NONE)
+    return false;
+  csumcache::key(st, t, &want);
+  for (std::list<entry>::iterator i = _entries.begin(); i != _entries.end();
+       i++) {
+    if (!csumcache::match(*i, want))
+      continue;
+    c = checksum(t, i->value);
+    // Keep the busy ones at the front
+    if (i != _entries.begin())
+      _entries.splice(_entries.begin(), _entries, i);
+    return true;
+  }
+  return false;
+}
+
+void
+csumcache::add(const struct stat& st, checksum& c)
+{
+  entry e;
+
+  if (c.csumtype() == CSUM_NONE)
+    return;
+  csumcache::key(st, c.csumtype(), &e);
+  this->keep(e, c);
+}
+
+void
+csumcache::add(const CSUMPOOL_Result& r, checksum& c)
+{
+  entry e;
+
+  if (c.csumtype() == CSUM_NONE)
+    return;
+  memset(&e, 0, sizeof(entry));
+  e.dev = r.dev;
+  e.ino = r.ino;
+  e.size = r.size;
+  e.mtime = r.mtime;
+  e.type = (uint32_t)c.csumtype();
+  this->keep(e, c);
+}
+
+void
+csumcache::keep(entry& e, checksum& c)
+{
+  for (size_t i = 0; i < c.size(); i++)
+    e.value[i] = c.value(i);
+  // Anything held for an older version of the file is now stale
+  for (std::list<entry>::iterator i = _entries.begin(); i != _entries.end();) {
+    if (i->dev == e.dev && i->ino == e.ino && i->type == e.type)
+      i = _entries.erase(i);
+    else
+      i++;
+  }
+  _entries.push_front(e);
+  if (_entries.size() > _max)
+    _entries.pop_back();
+  _dirty = true;
+}
+
+void
+csumcache::pack(const entry& e, unsigned char* rec)
+{
+  uint64_t u64;
+  uint32_t u32;
+
+  u64 = htonll(e.dev);
+  memcpy(rec, &u64, 8);
+  u64 = htonll(e.ino);
+  memcpy(rec + 8, &u64, 8);
+  u64 = htonll(e.size);
+  memcpy(rec + 16, &u64, 8);
+  u64 = htonll((uint64_t)e.mtime);
+  memcpy(rec + 24, &u64, 8);
+  u32 = htonl(e.type);
+  memcpy(rec + 32, &u32, 4);
+  for (size_t i = 0; i < CSUMLEN_SHA1; i++) {
+    u32 = htonl(e.value[i]);
+    memcpy(rec + 36 + 4 * i, &u32, 4);
+  }
+}
+
+void
+csumcache::unpack(const unsigned char* rec, entry* e)
+{
+  uint64_t u64;
+  uint32_t u32;
+
+  memset(e, 0, sizeof(entry));
+  memcpy(&u64, rec, 8);
+  e->dev = ntohll(u64);
+  memcpy(&u64, rec + 8, 8);
+  e->ino = ntohll(u64);
+  memcpy(&u64, rec + 16, 8);
+  e->size = ntohll(u64);
+  memcpy(&u64, rec + 24, 8);
+  e->mtime = (int64_t)ntohll(u64);
+  memcpy(&u32, rec + 32, 4);
+  e->type = ntohl(u32);
+  for (size_t i = 0; i < CSUMLEN_SHA1; i++) {
+    memcpy(&u32, rec + 36 + 4 * i, 4);
+    e->value[i] = ntohl(u32);
+  }
+}
+
+// Written to a temporary and renamed so a crash never leaves half a
+// cache. A failure is tried again after _saveevery like any other change
+bool
+csumcache::save()
+{
+  unsigned char rec[_recsize];
+
+  _saved = time(NULL);
+  if (_fname == "") {
+    _dirty = false;
+    return true;
+  }
+  string tmpname = _fname + ".tmp";
+  FILE* fp = fopen(tmpname.c_str(), "w");
+  if (fp == NULL) {
+    scr.perror(errno, "csumcache: Cannot create %s", tmpname.c_str());
+    return false;
+  }
+  bool ok = fwrite(csumcache_magic, sizeof(csumcache_magic), 1, fp) == 1;
+  for (std::list<entry>::reverse_iterator i = _entries.rbegin();
+       ok && i != _entries.rend(); i++) {
+    csumcache::pack(*i, rec);
+    ok = fwrite(rec, sizeof(rec), 1, fp) == 1;
+  }
+  if (fclose(fp) != 0)
+    ok = false;
+  if (!ok || rename(tmpname.c_str(), _fname.c_str()) != 0) {
+    scr.perror(errno, "csumcache: Cannot write %s", _fname.c_str());
+    unlink(tmpname.c_str());
+    return false;
+  }
+  _dirty = false;
+  return true;
+}
+
+bool
+csumcache::load(const string& fname)
+{
+  char magic[sizeof(csumcache_magic)];
+  unsigned char rec[_recsize];
+  entry e;
+
+  // What has changed goes to the old one first
+  this->flush();
+  _fname = fname;
+  FILE* fp = fopen(fname.c_str(), "r");
+  if (fp == NULL) {
+    // A new cache
+    if (errno == ENOENT)
+      return this->save();
+    scr.perror(errno, "csumcache: Cannot open %s", fname.c_str());
+    return false;
+  }
+  if (fread(magic, sizeof(magic), 1, fp) != 1 ||
+      memcmp(magic, csumcache_magic, sizeof(magic)) != 0) {
+    scr.error("csumcache: %s is not a checksum cache", fname.c_str());
+    _fname = "";
+    fclose(fp);
+    return false;
+  }
+  _entries.clear();
+  // Saved oldest first so the newest end up at the front
+  while (fread(rec, sizeof(rec), 1, fp) == 1) {
+    csumcache::unpack(rec, &e);
+    if (e.type != CSUM_CRC32 && e.type != CSUM_MD5 && e.type != CSUM_SHA1)
+      continue;
+    _entries.push_front(e);
+    if (_entries.size() > _max)
+      _entries.pop_back();
+  }
+  fclose(fp);
+  _dirty = false;
+  scr.debug(3, "csumcache: Loaded %zu checksums from %s", _entries.size(),
+            fname.c_str());
+  return true;
+}
+
+string
+csumcache::print()
+{
+  char tmp[64];
+
+  sprintf(tmp, "Checksum cache %zu entries", _entries.size());
+  string s = tmp;
+  if (_fname == "")
+    s += " in memory";
+  else
+    s += " in " + _fname;
+  return s;
+}
+
 }; // Namespace checksums
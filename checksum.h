@@ -39,13 +39,17 @@
 #ifndef _CHECKSUM_H
 #define _CHECKSUM_H
 
+#include "checksums/csumpool.h"
 #include "checksums/md5.h"
 #include "checksums/sha1.h"
 #include "screen.h"
 #include <cctype>
 #include <inttypes.h>
+#include <list>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string>
+#include <sys/stat.h>
 #include <unistd.h>
 
 // Functions used within the checksums library
@@ -54,9 +58,16 @@ unsigned long Crc32_ComputeBuf(unsigned long, char*, size_t);
 void MD5Init(MD5_CTX*);
 void MD5Update(MD5_CTX*, unsigned char*, ssize_t);
 void MD5Final(unsigned char*, MD5_CTX*);
+int MD5MB_Lanes(void);
+void MD5MB_Update(MD5_CTX*[], const unsigned char*[], int, size_t);
 void SHA1Reset(SHA1Context*);
 int SHA1Result(SHA1Context*);
-void SHA1Input(SHA1Context*, unsigned char*, unsigned);
+void SHA1Input(SHA1Context*, const unsigned char*, unsigned);
+int CSUMPOOL_Start(int);
+void CSUMPOOL_Stop(void);
+int CSUMPOOL_Threads(void);
+int CSUMPOOL_Submit(const char*, int, unsigned long);
+int CSUMPOOL_Collect(CSUMPOOL_Result*);
 }
 
 using namespace std;
@@ -81,6 +92,30 @@ enum csum_len
 
 typedef unsigned char uchar_t;
 
+// Read size used when checksumming a file. Large reads keep the
+// hashing kernels fed instead of bouncing through small ifstream reads.
+static const size_t csum_buflen = 1024 * 1024;
+
+// Page aligned read buffer of csum_buflen bytes. Aligned so the
+// vector kernels never straddle a page or cache line on their loads.
+class csumbuf
+{
+private:
+  char* _buf;
+
+public:
+  csumbuf()
+  {
+    if (posix_memalign((void**)&_buf, 4096, csum_buflen) != 0)
+      _buf = nullptr;
+  };
+  ~csumbuf() { free(_buf); };
+  csumbuf(const csumbuf&) = delete;
+  csumbuf& operator=(const csumbuf&) = delete;
+  char* buf() { return _buf; };
+  bool ok() { return _buf != nullptr; };
+};
+
 // Remove white space and punctuation from checksum strings
 extern string strip(string);
 
@@ -201,10 +236,13 @@ private:
   static const enum csum_len _csumlen = CSUMLEN_MD5;
   uint32_t _md5[CSUMLEN_MD5];        // How we store and report
   uchar_t _md5char[CSUMLEN_MD5 * 4]; // Char array used in calc
+  void setdigest(const uchar_t*);
+
 public:
   md5() { this->clear(); };
   md5(string);
   md5(uint32_t*);
+  md5(const uchar_t*); // The 16 bytes MD5Final() produces
 
   ~md5() { this->clear(); };
 
@@ -212,6 +250,8 @@ public:
   {
     for (size_t i = 0; i < CSUMLEN_MD5; i++)
       _md5[i] = 0;
+    for (size_t i = 0; i < CSUMLEN_MD5 * 4; i++)
+      _md5char[i] = 0;
   }
 
   // Copy Constructor
@@ -219,12 +259,16 @@ public:
   {
     for (size_t i = 0; i < CSUMLEN_MD5; i++)
       _md5[i] = old._md5[i];
+    for (size_t i = 0; i < CSUMLEN_MD5 * 4; i++)
+      _md5char[i] = old._md5char[i];
   }
 
   md5& operator=(const md5& old)
   {
     for (size_t i = 0; i < CSUMLEN_MD5; i++)
       _md5[i] = old._md5[i];
+    for (size_t i = 0; i < CSUMLEN_MD5 * 4; i++)
+      _md5char[i] = old._md5char[i];
     return (*this);
   }
 
@@ -274,6 +318,11 @@ public:
   string strval();
 };
 
+// MD5 a batch of files, several at once in parallel SIMD lanes
+// (checksums/md5mb.c). Returns one md5 per name in the same order; a
+// file that cannot be read gets a zero md5 as md5(string) gives it.
+extern std::list<md5> md5batch(const std::list<string>&);
+
 // Handle SHA1's
 class sha1
 {
@@ -506,6 +555,135 @@ public:
   string print();
 };
 
+// A checksum built up while a file streams past rather than by reading
+// the file again. Bytes must be fed in order; anything before the fed
+// offset is skipped so retransmitted or overlapping buffers are harmless,
+// and a buffer starting beyond it is ignored until the gap is filled.
+class csumstream
+{
+private:
+  enum csum_type _csumtype;
+  uint64_t _fed;          // Bytes hashed so far
+  unsigned long _crc32;   // Running CRC-32
+  ::MD5_CTX _md5;         // Running MD5
+  ::SHA1Context _sha1;    // Running SHA-1
+
+public:
+  csumstream() { this->reset(CSUM_NONE); };
+
+  csumstream(const enum csum_type t) { this->reset(t); };
+
+  ~csumstream(){};
+
+  // Start again from byte 0 with the given type
+  void reset(const enum csum_type);
+
+  csumstream(const csumstream& old)
+  {
+    _csumtype = old._csumtype;
+    _fed = old._fed;
+    _crc32 = old._crc32;
+    _md5 = old._md5;
+    _sha1 = old._sha1;
+  };
+
+  csumstream& operator=(const csumstream& old)
+  {
+    _csumtype = old._csumtype;
+    _fed = old._fed;
+    _crc32 = old._crc32;
+    _md5 = old._md5;
+    _sha1 = old._sha1;
+    return (*this);
+  };
+
+  enum csum_type csumtype() { return _csumtype; };
+
+  // Offset of the next byte wanted
+  uint64_t fed() { return _fed; };
+
+  // Hash the part of buf (which holds the file from offset off) that
+  // continues on from fed(). Returns the number of bytes taken.
+  size_t update(const char* buf, size_t len, uint64_t off);
+
+  // The checksum of the bytes fed so far, the stream carries on
+  checksum result();
+};
+
+// Checksums of local files already worked out so sending the same
+// unchanged file again, or to another peer, does not hash it again.
+// A file is unchanged while its device, inode, size and modification
+// time are. Held in memory and, once given a file name, kept on disk.
+class csumcache
+{
+private:
+  struct entry
+  {
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t mtime; // Nanoseconds
+    uint32_t type; // enum csum_type
+    uint32_t value[CSUMLEN_SHA1];
+  };
+  static const size_t _max = 4096;     // Least recently used drop off
+  static const time_t _saveevery = 60; // Seconds between writes
+  // An entry on disk, each field big endian one after the other
+  static const size_t _recsize = 4 * 8 + 4 + 4 * CSUMLEN_SHA1;
+  std::list<entry> _entries; // Most recently used first
+  string _fname;             // Where it is kept, "" memory only
+  bool _dirty;               // Changed since it was written out
+  time_t _saved;             // When it was last written out
+
+  static void key(const struct stat&, enum csum_type, entry*);
+  static bool match(const entry&, const entry&);
+  static void pack(const entry&, unsigned char*);
+  static void unpack(const unsigned char*, entry*);
+  void keep(entry&, checksum&);
+  bool save();
+
+public:
+  csumcache()
+  {
+    _fname = "";
+    _dirty = false;
+    _saved = 0;
+  };
+  ~csumcache() { _entries.clear(); };
+  csumcache(const csumcache&) = delete;
+  csumcache& operator=(const csumcache&) = delete;
+
+  // Is there a checksum of this type for the file, if so set it
+  bool find(const struct stat&, enum csum_type, checksum&);
+  // Remember the files checksum
+  void add(const struct stat&, checksum&);
+  // Remember one the checksum threads worked out
+  void add(const CSUMPOOL_Result&, checksum&);
+
+  // Read the cache from a file and keep it there from now on
+  bool load(const string&);
+  // Write it out if it has changed, tick() only every _saveevery
+  bool flush() { return (_dirty ? this->save() : true); };
+  void tick()
+  {
+    if (_dirty && time(NULL) >= _saved + _saveevery)
+      this->save();
+  };
+  // Stop keeping it on disk
+  void memonly()
+  {
+    this->flush();
+    _fname = "";
+  };
+  void clear()
+  {
+    _entries.clear();
+    this->save();
+  };
+  size_t count() { return _entries.size(); };
+  string print();
+};
+
 }; // Namespace checksums
 
 #endif // _CHECKSUM_H
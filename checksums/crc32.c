@@ -21,6 +21,13 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CRC32_HAVE_PCLMUL 1
+#include <immintrin.h>
+#endif
 
 /*----------------------------------------------------------------------------*\
  *  Local functions
@@ -33,9 +40,22 @@ unsigned long Crc32_ComputeBuf( unsigned long inCrc32,
 			const void *buf,
                         size_t bufLen );
 
+unsigned long Crc32_ComputeBuf_Table( unsigned long inCrc32,
+                        const void *buf,
+                        size_t bufLen );
+
+unsigned long Crc32_ComputeBuf_Slice8( unsigned long inCrc32,
+                        const void *buf,
+                        size_t bufLen );
+
+const char *Crc32_Implementation( void );
+
+unsigned long Crc32_Combine( unsigned long crcA, unsigned long crcB,
+                        size_t lenB );
+
 /*----------------------------------------------------------------------------*\
  *  NAME:
- *     Crc32_ComputeBuf() - computes the CRC-32 value of a memory buffer
+ *     Crc32_ComputeBuf_Table() - byte-at-a-time CRC-32 of a memory buffer
  *  DESCRIPTION:
  *     Computes or accumulates the CRC-32 value for a memory buffer.
  *     The 'inCrc32' gives a previously accumulated CRC-32 value to allow
@@ -49,9 +69,12 @@ unsigned long Crc32_ComputeBuf( unsigned long inCrc32,
  *     crc32 - computed CRC-32 value
  *  ERRORS:
  *     (no errors are possible)
+ *  NOTES:
+ *     This is the original v2.0.0 routine. It is kept as the reference
+ *     the faster kernels below are checked and benchmarked against.
 \*----------------------------------------------------------------------------*/
 
-unsigned long Crc32_ComputeBuf( unsigned long inCrc32, const void *buf,
+unsigned long Crc32_ComputeBuf_Table( unsigned long inCrc32, const void *buf,
                                        size_t bufLen )
 {
     static const unsigned long crcTable[256] = {
@@ -105,6 +128,342 @@ unsigned long Crc32_ComputeBuf( unsigned long inCrc32, const void *buf,
     return( crc32 ^ 0xFFFFFFFF );
 }
 
+/*----------------------------------------------------------------------------*\
+ *  Slicing-by-8
+ *
+ *  Eight 256-entry tables let the loop consume 8 bytes per iteration with
+ *  independent lookups instead of a serial dependency on every byte.
+ *  crcSlice[0] is the classic table; crcSlice[k][n] is crcSlice[k-1][n]
+ *  advanced by one more zero byte. Tables are built once at load time.
+\*----------------------------------------------------------------------------*/
+
+static uint32_t crcSlice[8][256];
+
+static void Crc32_InitSlice( void )
+{
+    uint32_t c;
+    int n, k;
+
+    for (n=0; n < 256; n++) {
+        c = (uint32_t) n;
+        for (k=0; k < 8; k++)
+            c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : (c >> 1);
+        crcSlice[0][n] = c;
+    }
+    for (n=0; n < 256; n++) {
+        c = crcSlice[0][n];
+        for (k=1; k < 8; k++) {
+            c = crcSlice[0][c & 0xFF] ^ (c >> 8);
+            crcSlice[k][n] = c;
+        }
+    }
+}
+
+/* Works on the inverted running value; caller does the pre/post xor */
+static uint32_t Crc32_Slice8( uint32_t crc, const unsigned char *p,
+                              size_t len )
+{
+    while (len && ((uintptr_t) p & 7)) {
+        crc = crcSlice[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+        len--;
+    }
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (len >= 8) {
+        uint32_t lo, hi;
+
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = crcSlice[7][lo & 0xFF] ^
+              crcSlice[6][(lo >> 8) & 0xFF] ^
+              crcSlice[5][(lo >> 16) & 0xFF] ^
+              crcSlice[4][lo >> 24] ^
+              crcSlice[3][hi & 0xFF] ^
+              crcSlice[2][(hi >> 8) & 0xFF] ^
+              crcSlice[1][(hi >> 16) & 0xFF] ^
+              crcSlice[0][hi >> 24];
+        p += 8;
+        len -= 8;
+    }
+#endif
+    while (len--)
+        crc = crcSlice[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    return( crc );
+}
+
+#ifdef CRC32_HAVE_PCLMUL
+/*----------------------------------------------------------------------------*\
+ *  PCLMULQDQ folding
+ *
+ *  Carry-less multiply folding as described in Intel's "Fast CRC
+ *  Computation for Generic Polynomials Using PCLMULQDQ Instruction"
+ *  (Gopal et al, 2009), using the bit-reflected constants for the gzip
+ *  polynomial. Four 128-bit lanes are folded 64 bytes at a time, then
+ *  reduced to 128, 64 and finally 32 bits with a Barrett reduction.
+ *
+ *  Requires len >= 64 and len a multiple of 16. Works on the inverted
+ *  running value like Crc32_Slice8().
+\*----------------------------------------------------------------------------*/
+
+static const uint64_t crcK1K2[2] __attribute__((aligned(16))) =
+    { 0x0154442bd4ULL, 0x01c6e41596ULL };
+static const uint64_t crcK3K4[2] __attribute__((aligned(16))) =
+    { 0x01751997d0ULL, 0x00ccaa009eULL };
+static const uint64_t crcK5K0[2] __attribute__((aligned(16))) =
+    { 0x0163cd6124ULL, 0x0000000000ULL };
+static const uint64_t crcPoly[2] __attribute__((aligned(16))) =
+    { 0x01db710641ULL, 0x01f7011641ULL };
+
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t Crc32_Pclmul( uint32_t crc, const unsigned char *p,
+                              size_t len )
+{
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+    x1 = _mm_loadu_si128((const __m128i *) (p + 0x00));
+    x2 = _mm_loadu_si128((const __m128i *) (p + 0x10));
+    x3 = _mm_loadu_si128((const __m128i *) (p + 0x20));
+    x4 = _mm_loadu_si128((const __m128i *) (p + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int) crc));
+    x0 = _mm_load_si128((const __m128i *) crcK1K2);
+    p += 64;
+    len -= 64;
+
+    /** fold 4 x 128 bits in parallel **/
+    while (len >= 64) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+        y5 = _mm_loadu_si128((const __m128i *) (p + 0x00));
+        y6 = _mm_loadu_si128((const __m128i *) (p + 0x10));
+        y7 = _mm_loadu_si128((const __m128i *) (p + 0x20));
+        y8 = _mm_loadu_si128((const __m128i *) (p + 0x30));
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+        p += 64;
+        len -= 64;
+    }
+
+    /** fold the four lanes into one **/
+    x0 = _mm_load_si128((const __m128i *) crcK3K4);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    /** remaining 16 byte blocks **/
+    while (len >= 16) {
+        x2 = _mm_loadu_si128((const __m128i *) p);
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+        p += 16;
+        len -= 16;
+    }
+
+    /** 128 -> 64 bits **/
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+    x0 = _mm_loadl_epi64((const __m128i *) crcK5K0);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    /** Barrett reduction to 32 bits **/
+    x0 = _mm_load_si128((const __m128i *) crcPoly);
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+    return( (uint32_t) _mm_extract_epi32(x1, 1) );
+}
+#endif
+
+/*----------------------------------------------------------------------------*\
+ *  NAME:
+ *     Crc32_ComputeBuf_Slice8() - portable kernel, bypassing dispatch
+ *  DESCRIPTION:
+ *     As Crc32_ComputeBuf() but always slicing-by-8. For benchmarks.
+\*----------------------------------------------------------------------------*/
+
+unsigned long Crc32_ComputeBuf_Slice8( unsigned long inCrc32, const void *buf,
+                                       size_t bufLen )
+{
+    uint32_t crc = (uint32_t) inCrc32 ^ 0xFFFFFFFF;
+
+    crc = Crc32_Slice8(crc, (const unsigned char *) buf, bufLen);
+    return( (unsigned long) (crc ^ 0xFFFFFFFF) );
+}
+
+/*----------------------------------------------------------------------------*\
+ *  Dispatch
+ *
+ *  The kernel is chosen once, when the library is loaded, so the check
+ *  never sits in the per-buffer path and the tables are built before any
+ *  thread can call in.
+\*----------------------------------------------------------------------------*/
+
+static int crcUsePclmul = 0;
+
+__attribute__((constructor))
+static void Crc32_Init( void )
+{
+    Crc32_InitSlice();
+#ifdef CRC32_HAVE_PCLMUL
+    __builtin_cpu_init();
+    crcUsePclmul = __builtin_cpu_supports("pclmul") &&
+                   __builtin_cpu_supports("sse4.1") &&
+                   getenv("CRC32_NOPCLMUL") == NULL;
+#endif
+}
+
+/*----------------------------------------------------------------------------*\
+ *  NAME:
+ *     Crc32_Implementation() - name of the kernel Crc32_ComputeBuf() uses
+ *  RETURNS:
+ *     "pclmul" or "slice8"
+\*----------------------------------------------------------------------------*/
+
+const char *Crc32_Implementation( void )
+{
+    return( crcUsePclmul ? "pclmul" : "slice8" );
+}
+
+/*----------------------------------------------------------------------------*\
+ *  NAME:
+ *     Crc32_ComputeBuf() - computes the CRC-32 value of a memory buffer
+ *  DESCRIPTION:
+ *     Computes or accumulates the CRC-32 value for a memory buffer.
+ *     The 'inCrc32' gives a previously accumulated CRC-32 value to allow
+ *     a CRC to be generated for multiple sequential buffer-fuls of data.
+ *     The 'inCrc32' for the first buffer must be zero.
+ *     Uses the PCLMULQDQ kernel for the bulk of the buffer when the CPU
+ *     has it and slicing-by-8 otherwise; results are identical to
+ *     Crc32_ComputeBuf_Table().
+ *  ARGUMENTS:
+ *     inCrc32 - accumulated CRC-32 value, must be 0 on first call
+ *     buf     - buffer to compute CRC-32 value for
+ *     bufLen  - number of bytes in buffer
+ *  RETURNS:
+ *     crc32 - computed CRC-32 value
+ *  ERRORS:
+ *     (no errors are possible)
+\*----------------------------------------------------------------------------*/
+
+unsigned long Crc32_ComputeBuf( unsigned long inCrc32, const void *buf,
+                                       size_t bufLen )
+{
+    const unsigned char *p = (const unsigned char *) buf;
+    uint32_t crc = (uint32_t) inCrc32 ^ 0xFFFFFFFF;
+
+#ifdef CRC32_HAVE_PCLMUL
+    if (crcUsePclmul && bufLen >= 64) {
+        size_t bulk = bufLen & ~(size_t) 15;
+
+        crc = Crc32_Pclmul(crc, p, bulk);
+        p += bulk;
+        bufLen -= bulk;
+    }
+#endif
+    crc = Crc32_Slice8(crc, p, bufLen);
+    return( (unsigned long) (crc ^ 0xFFFFFFFF) );
+}
+
+/*----------------------------------------------------------------------------*\
+ *  NAME:
+ *     Crc32_Combine() - CRC-32 of two buffers end to end
+ *  DESCRIPTION:
+ *     Given the CRC-32 of buffer A and of buffer B, each computed from
+ *     zero, gives the CRC-32 of A followed by B without looking at the
+ *     data again, so pieces of a file can be hashed separately and in
+ *     parallel. Runs in O(log lenB) 32x32 GF(2) matrix squarings, the
+ *     method zlib uses for crc32_combine().
+ *  ARGUMENTS:
+ *     crcA - CRC-32 of the first buffer
+ *     crcB - CRC-32 of the second buffer
+ *     lenB - length of the second buffer in bytes
+ *  RETURNS:
+ *     crc32 - CRC-32 of the two buffers concatenated
+ *  ERRORS:
+ *     (no errors are possible)
+\*----------------------------------------------------------------------------*/
+
+static uint32_t Crc32_Gf2Times( const uint32_t *mat, uint32_t vec )
+{
+    uint32_t sum = 0;
+
+    while (vec) {
+        if (vec & 1)
+            sum ^= *mat;
+        vec >>= 1;
+        mat++;
+    }
+    return( sum );
+}
+
+static void Crc32_Gf2Square( uint32_t *square, const uint32_t *mat )
+{
+    int n;
+
+    for (n = 0; n < 32; n++)
+        square[n] = Crc32_Gf2Times( mat, mat[n] );
+}
+
+unsigned long Crc32_Combine( unsigned long crcA, unsigned long crcB,
+                                    size_t lenB )
+{
+    uint32_t even[32];      /* even power-of-two zeros operator */
+    uint32_t odd[32];       /* odd power-of-two zeros operator */
+    uint32_t crc = (uint32_t) crcA;
+    uint32_t row;
+    int n;
+
+    if (lenB == 0)
+        return( crcA );
+
+    /** operator for one zero bit in odd **/
+    odd[0] = 0xEDB88320;
+    row = 1;
+    for (n = 1; n < 32; n++) {
+        odd[n] = row;
+        row <<= 1;
+    }
+    Crc32_Gf2Square( even, odd );   /* two zero bits */
+    Crc32_Gf2Square( odd, even );   /* four zero bits */
+
+    /** apply lenB zero bytes to crcA, squaring up through the bits of lenB **/
+    do {
+        Crc32_Gf2Square( even, odd );
+        if (lenB & 1)
+            crc = Crc32_Gf2Times( even, crc );
+        lenB >>= 1;
+        if (lenB == 0)
+            break;
+        Crc32_Gf2Square( odd, even );
+        if (lenB & 1)
+            crc = Crc32_Gf2Times( odd, crc );
+        lenB >>= 1;
+    } while (lenB != 0);
+
+    return( (unsigned long) (crc ^ (uint32_t) crcB) );
+}
+
 /*----------------------------------------------------------------------------*\
  *  NAME:
  *     Crc32_ComputeFile() - compute CRC-32 value for a file
@@ -121,10 +480,15 @@ unsigned long Crc32_ComputeBuf( unsigned long inCrc32, const void *buf,
 
 int Crc32_ComputeFile( FILE *file, unsigned long *outCrc32 )
 {
-#   define CRC_BUFFER_SIZE  8192
-    unsigned char buf[CRC_BUFFER_SIZE];
+#   define CRC_BUFFER_SIZE  (1024*1024)
+    unsigned char *buf;
     size_t bufLen;
 
+    buf = (unsigned char *) malloc( CRC_BUFFER_SIZE );
+    if (buf == NULL) {
+        fprintf( stderr, "out of memory\n" );
+        return( -1 );
+    }
     /** accumulate crc32 from file **/
     *outCrc32 = 0;
     while (1) {
@@ -138,10 +502,12 @@ int Crc32_ComputeFile( FILE *file, unsigned long *outCrc32 )
         }
         *outCrc32 = Crc32_ComputeBuf( *outCrc32, buf, bufLen );
     }
+    free( buf );
     return( 0 );
 
     /** error exit **/
 ERR_EXIT:
+    free( buf );
     return( -1 );
 }
 
@@ -0,0 +1,472 @@
+/* CSUMPOOL.C - whole file checksums worked out by a pool of threads
+
+   Each worker thread owns a deque of tasks. New tasks are dealt round
+   the deques; a worker takes from the back of its own deque and, once
+   that is empty, steals from the front of the others, so one big file
+   does not leave the rest of the pool idle behind a single worker.
+
+   CRC-32 files are cut into CSUMPOOL_CHUNK sized tasks hashed on their
+   own and joined afterwards with Crc32_Combine(). MD5 and SHA-1 are a
+   serial chain through the file so those are one task per file, and
+   the parallelism comes from hashing several files at once.
+
+   Finished checksums are queued and a byte written down a pipe, so a
+   select() loop sees them as just another readable file descriptor
+   and never waits on the hashing.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "md5.h"
+#include "sha1.h"
+#include "csumpool.h"
+
+extern unsigned long Crc32_ComputeBuf (unsigned long, const void *, size_t);
+extern unsigned long Crc32_Combine (unsigned long, unsigned long, size_t);
+
+#define CSUMPOOL_CHUNK (4 * 1024 * 1024)
+#define CSUMPOOL_BUFLEN (1024 * 1024)
+
+typedef struct CsumJob {
+  CSUMPOOL_Result res;
+  int fd;
+  int chunks;
+  int left;               /* Tasks not yet finished */
+  uint32_t *crcs;         /* CRC-32 of each chunk */
+  struct CsumJob *next;   /* On the finished list */
+} CsumJob;
+
+typedef struct CsumTask {
+  CsumJob *job;
+  int chunk;
+  struct CsumTask *prev;
+  struct CsumTask *next;
+} CsumTask;
+
+typedef struct {
+  pthread_t thread;
+  pthread_mutex_t lock;   /* Guards head and tail */
+  CsumTask *head;         /* Stolen from here */
+  CsumTask *tail;         /* Owner pushes and takes here */
+  unsigned char *buf;
+  int id;
+} CsumWorker;
+
+static CsumWorker *workers = NULL;
+static int nworkers = 0;
+static int nextworker = 0;
+
+static pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t poolWake = PTHREAD_COND_INITIALIZER;
+static int queued = 0;    /* Tasks on all the deques */
+static int stopping = 0;
+
+static pthread_mutex_t doneLock = PTHREAD_MUTEX_INITIALIZER;
+static CsumJob *doneHead = NULL;
+static CsumJob *doneTail = NULL;
+static int donePipe[2] = { -1, -1 };
+
+static void PushTail (CsumWorker *w, CsumTask *t)
+{
+  pthread_mutex_lock (&w->lock);
+  t->next = NULL;
+  t->prev = w->tail;
+  if (w->tail)
+    w->tail->next = t;
+  else
+    w->head = t;
+  w->tail = t;
+  pthread_mutex_unlock (&w->lock);
+}
+
+static CsumTask *TakeTail (CsumWorker *w)
+{
+  CsumTask *t;
+
+  pthread_mutex_lock (&w->lock);
+  if ((t = w->tail) != NULL) {
+    w->tail = t->prev;
+    if (w->tail)
+      w->tail->next = NULL;
+    else
+      w->head = NULL;
+  }
+  pthread_mutex_unlock (&w->lock);
+  return t;
+}
+
+static CsumTask *StealHead (CsumWorker *w)
+{
+  CsumTask *t;
+
+  pthread_mutex_lock (&w->lock);
+  if ((t = w->head) != NULL) {
+    w->head = t->next;
+    if (w->head)
+      w->head->prev = NULL;
+    else
+      w->tail = NULL;
+  }
+  pthread_mutex_unlock (&w->lock);
+  return t;
+}
+
+static size_t ChunkLen (CsumJob *job, int chunk)
+{
+  off_t off = (off_t)chunk * CSUMPOOL_CHUNK;
+  off_t left = (off_t)job->res.size - off;
+
+  return (size_t)(left < CSUMPOOL_CHUNK ? left : CSUMPOOL_CHUNK);
+}
+
+/* Read len bytes at off, 0 or an errno */
+static int ReadAt (int fd, unsigned char *buf, size_t len, off_t off)
+{
+  ssize_t n;
+
+  while (len > 0) {
+    n = pread (fd, buf, len, off);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      return errno;
+    if (n == 0)
+      return EIO;  /* File shrank under us */
+    buf += n;
+    len -= n;
+    off += n;
+  }
+  return 0;
+}
+
+static void Finish (CsumJob *job)
+{
+  uint32_t crc;
+  int i;
+  char c = 0;
+
+  if (job->res.type == CSUMPOOL_CRC32 && job->res.error == 0) {
+    crc = job->crcs[0];
+    for (i = 1; i < job->chunks; i++)
+      crc = Crc32_Combine (crc, job->crcs[i], ChunkLen (job, i));
+    job->res.value[0] = crc;
+  }
+  close (job->fd);
+  free (job->crcs);
+  job->crcs = NULL;
+
+  pthread_mutex_lock (&doneLock);
+  job->next = NULL;
+  if (doneTail)
+    doneTail->next = job;
+  else
+    doneHead = job;
+  doneTail = job;
+  pthread_mutex_unlock (&doneLock);
+  /* A full pipe still has bytes waiting to be read so nothing is lost */
+  if (write (donePipe[1], &c, 1) < 0)
+    return;
+}
+
+static void RunTask (CsumWorker *w, CsumTask *t)
+{
+  CsumJob *job = t->job;
+  off_t off, size = (off_t)job->res.size;
+  size_t len, n;
+  unsigned long crc = 0;
+  unsigned char digest[16];
+  MD5_CTX md5;
+  SHA1Context sha1;
+  int err = 0, i;
+
+  switch (job->res.type) {
+  case CSUMPOOL_CRC32:
+    off = (off_t)t->chunk * CSUMPOOL_CHUNK;
+    for (len = ChunkLen (job, t->chunk); len > 0 && !err; len -= n) {
+      n = len < CSUMPOOL_BUFLEN ? len : CSUMPOOL_BUFLEN;
+      if ((err = ReadAt (job->fd, w->buf, n, off)) == 0)
+        crc = Crc32_ComputeBuf (crc, w->buf, n);
+      off += n;
+    }
+    job->crcs[t->chunk] = (uint32_t)crc;
+    break;
+  case CSUMPOOL_MD5:
+    MD5Init (&md5);
+    for (off = 0; off < size && !err; off += n) {
+      n = size - off < CSUMPOOL_BUFLEN ? size - off : CSUMPOOL_BUFLEN;
+      if ((err = ReadAt (job->fd, w->buf, n, off)) == 0)
+        MD5Update (&md5, w->buf, n);
+    }
+    MD5Final (digest, &md5);
+    for (i = 0; i < 4; i++)
+      job->res.value[i] = (uint32_t)digest[i * 4] << 24 |
+                          (uint32_t)digest[i * 4 + 1] << 16 |
+                          (uint32_t)digest[i * 4 + 2] << 8 |
+                          (uint32_t)digest[i * 4 + 3];
+    break;
+  case CSUMPOOL_SHA1:
+    SHA1Reset (&sha1);
+    for (off = 0; off < size && !err; off += n) {
+      n = size - off < CSUMPOOL_BUFLEN ? size - off : CSUMPOOL_BUFLEN;
+      if ((err = ReadAt (job->fd, w->buf, n, off)) == 0)
+        SHA1Input (&sha1, w->buf, n);
+    }
+    if (!err && !SHA1Result (&sha1))
+      err = EINVAL;
+    for (i = 0; i < 5; i++)
+      job->res.value[i] = (uint32_t)sha1.Message_Digest[i];
+    break;
+  }
+  if (err)
+    __atomic_store_n (&job->res.error, err, __ATOMIC_RELAXED);
+  free (t);
+  if (__atomic_sub_fetch (&job->left, 1, __ATOMIC_ACQ_REL) == 0)
+    Finish (job);
+}
+
+static void *Worker (void *arg)
+{
+  CsumWorker *w = (CsumWorker *)arg;
+  CsumTask *t;
+  int i;
+
+  for (;;) {
+    t = TakeTail (w);
+    for (i = 1; t == NULL && i < nworkers; i++)
+      t = StealHead (&workers[(w->id + i) % nworkers]);
+    pthread_mutex_lock (&poolLock);
+    if (t != NULL) {
+      queued--;
+      pthread_mutex_unlock (&poolLock);
+      RunTask (w, t);
+      continue;
+    }
+    while (queued == 0 && !stopping)
+      pthread_cond_wait (&poolWake, &poolLock);
+    if (stopping) {
+      pthread_mutex_unlock (&poolLock);
+      return NULL;
+    }
+    pthread_mutex_unlock (&poolLock);
+  }
+}
+
+/* Start n worker threads, 0 means one per CPU or CSUMPOOL_THREADS from
+   the environment. Returns the descriptor that becomes readable when
+   checksums are ready, -1 if no threads could be started.
+ */
+int CSUMPOOL_Start (int n)
+{
+  const char *env = getenv ("CSUMPOOL_THREADS");
+  sigset_t all, old;
+  int i;
+
+  if (nworkers > 0)
+    return donePipe[0];
+  if (n <= 0 && env != NULL)
+    n = atoi (env);
+  if (n <= 0)
+    n = (int)sysconf (_SC_NPROCESSORS_ONLN);
+  if (n <= 0)
+    n = 1;
+  if (n > CSUMPOOL_MAXTHREADS)
+    n = CSUMPOOL_MAXTHREADS;
+
+  if (pipe (donePipe) < 0)
+    return -1;
+  for (i = 0; i < 2; i++) {
+    fcntl (donePipe[i], F_SETFL, fcntl (donePipe[i], F_GETFL) | O_NONBLOCK);
+    fcntl (donePipe[i], F_SETFD, FD_CLOEXEC);
+  }
+  if ((workers = calloc (n, sizeof (CsumWorker))) == NULL)
+    goto fail;
+
+  /* Signals stay with the threads that handle them */
+  sigfillset (&all);
+  pthread_sigmask (SIG_SETMASK, &all, &old);
+  stopping = 0;
+  for (i = 0; i < n; i++) {
+    CsumWorker *w = &workers[i];
+
+    w->id = i;
+    pthread_mutex_init (&w->lock, NULL);
+    if ((w->buf = malloc (CSUMPOOL_BUFLEN)) == NULL)
+      break;
+    if (pthread_create (&w->thread, NULL, Worker, w) != 0) {
+      free (w->buf);
+      break;
+    }
+    nworkers++;
+  }
+  pthread_sigmask (SIG_SETMASK, &old, NULL);
+  if (nworkers > 0)
+    return donePipe[0];
+  free (workers);
+  workers = NULL;
+
+fail:
+  close (donePipe[0]);
+  close (donePipe[1]);
+  donePipe[0] = donePipe[1] = -1;
+  return -1;
+}
+
+/* Stop the threads, dropping anything not yet hashed or collected */
+void CSUMPOOL_Stop (void)
+{
+  CsumTask *t;
+  CsumJob *job;
+  int i;
+
+  if (nworkers == 0)
+    return;
+  pthread_mutex_lock (&poolLock);
+  stopping = 1;
+  pthread_cond_broadcast (&poolWake);
+  pthread_mutex_unlock (&poolLock);
+  for (i = 0; i < nworkers; i++)
+    pthread_join (workers[i].thread, NULL);
+
+  for (i = 0; i < nworkers; i++) {
+    while ((t = TakeTail (&workers[i])) != NULL) {
+      job = t->job;
+      free (t);
+      if (--job->left == 0) {
+        close (job->fd);
+        free (job->crcs);
+        free (job->res.fname);
+        free (job);
+      }
+    }
+    free (workers[i].buf);
+    pthread_mutex_destroy (&workers[i].lock);
+  }
+  while ((job = doneHead) != NULL) {
+    doneHead = job->next;
+    free (job->res.fname);
+    free (job);
+  }
+  doneTail = NULL;
+  free (workers);
+  workers = NULL;
+  nworkers = 0;
+  queued = 0;
+  close (donePipe[0]);
+  close (donePipe[1]);
+  donePipe[0] = donePipe[1] = -1;
+}
+
+int CSUMPOOL_Threads (void)
+{
+  return nworkers;
+}
+
+/* Queue a file to be checksummed. tag comes back in the result.
+   Returns 0, or -1 with errno set.
+ */
+int CSUMPOOL_Submit (const char *fname, int type, unsigned long tag)
+{
+  CsumJob *job = NULL;
+  CsumTask **tasks;
+  struct stat st;
+  int i, fd;
+
+  if (nworkers == 0) {
+    errno = ENOSYS;
+    return -1;
+  }
+  if (type != CSUMPOOL_CRC32 && type != CSUMPOOL_MD5 &&
+      type != CSUMPOOL_SHA1) {
+    errno = EINVAL;
+    return -1;
+  }
+  if ((fd = open (fname, O_RDONLY | O_CLOEXEC)) < 0)
+    return -1;
+  if ((job = calloc (1, sizeof (CsumJob))) == NULL)
+    goto fail;
+  if (fstat (fd, &st) < 0)
+    goto fail;
+  if (!S_ISREG (st.st_mode)) {
+    errno = EINVAL;
+    goto fail;
+  }
+  job->res.dev = (uint64_t)st.st_dev;
+  job->res.ino = (uint64_t)st.st_ino;
+  job->res.size = (uint64_t)st.st_size;
+  job->res.mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 +
+                   st.st_mtim.tv_nsec;
+  job->fd = fd;
+  job->res.tag = tag;
+  job->res.type = type;
+  job->chunks = 1;
+  if (type == CSUMPOOL_CRC32 && job->res.size > CSUMPOOL_CHUNK)
+    job->chunks = (job->res.size + CSUMPOOL_CHUNK - 1) / CSUMPOOL_CHUNK;
+  job->left = job->chunks;
+  if ((job->res.fname = strdup (fname)) == NULL ||
+      (job->crcs = calloc (job->chunks, sizeof (uint32_t))) == NULL)
+    goto fail;
+
+  /* Build every task first so a failure leaves nothing queued */
+  tasks = malloc (job->chunks * sizeof (CsumTask *));
+  if (tasks == NULL)
+    goto fail;
+  for (i = 0; i < job->chunks; i++) {
+    if ((tasks[i] = malloc (sizeof (CsumTask))) == NULL) {
+      while (i-- > 0)
+        free (tasks[i]);
+      free (tasks);
+      goto fail;
+    }
+    tasks[i]->job = job;
+    tasks[i]->chunk = i;
+  }
+  for (i = 0; i < job->chunks; i++) {
+    PushTail (&workers[nextworker], tasks[i]);
+    nextworker = (nextworker + 1) % nworkers;
+  }
+  free (tasks);
+  pthread_mutex_lock (&poolLock);
+  queued += job->chunks;
+  pthread_cond_broadcast (&poolWake);
+  pthread_mutex_unlock (&poolLock);
+  return 0;
+
+fail:
+  i = errno;
+  close (fd);
+  if (job) {
+    free (job->res.fname);
+    free (job->crcs);
+    free (job);
+  }
+  errno = i;
+  return -1;
+}
+
+/* Take the next finished checksum, 1 if there was one else 0 */
+int CSUMPOOL_Collect (CSUMPOOL_Result *res)
+{
+  CsumJob *job;
+  char c;
+
+  pthread_mutex_lock (&doneLock);
+  if ((job = doneHead) != NULL) {
+    doneHead = job->next;
+    if (doneHead == NULL)
+      doneTail = NULL;
+  }
+  pthread_mutex_unlock (&doneLock);
+  if (job == NULL)
+    return 0;
+  /* One byte per result, it may already have been read */
+  if (read (donePipe[0], &c, 1) < 0)
+    c = 0;
+  *res = job->res;
+  free (job);
+  return 1;
+}
@@ -0,0 +1,44 @@
+/* CSUMPOOL.H - header file for CSUMPOOL.C, whole file checksums worked
+   out by a pool of threads
+ */
+
+#ifndef _CSUMPOOL_H
+#define _CSUMPOOL_H
+
+#include <stdint.h>
+#include <sys/stat.h>
+
+/* Checksum types, the same values as checksums::csum_type */
+#define CSUMPOOL_CRC32 1
+#define CSUMPOOL_MD5 3
+#define CSUMPOOL_SHA1 4
+
+#define CSUMPOOL_MAXTHREADS 64
+
+/* A finished checksum. value[] holds the words of the checksum in the
+   order the METADATA carries them: 1 for CRC-32, 4 for MD5, 5 for SHA-1.
+   fname is malloc()ed and belongs to whoever collects the result.
+   The file is described in fixed width fields, not a struct stat, as
+   this library and its callers may be built with different off_t sizes.
+ */
+typedef struct {
+  unsigned long tag;  /* As given to CSUMPOOL_Submit() */
+  char *fname;
+  int type;
+  int error;          /* errno of a failed read, else 0 */
+  uint64_t dev;       /* The file as it was when submitted */
+  uint64_t ino;
+  uint64_t size;
+  int64_t mtime;      /* Nanoseconds */
+  uint32_t value[5];
+} CSUMPOOL_Result;
+
+#ifndef __cplusplus
+extern int CSUMPOOL_Start (int);
+extern void CSUMPOOL_Stop (void);
+extern int CSUMPOOL_Threads (void);
+extern int CSUMPOOL_Submit (const char *, int, unsigned long);
+extern int CSUMPOOL_Collect (CSUMPOOL_Result *);
+#endif
+
+#endif // _CSUMPOOL_H
@@ -0,0 +1,178 @@
+/* CSUMPOOLDRIVER.C - check and benchmark for the checksum thread pool
+   (csumpool.c)
+
+   Checks Crc32_Combine() against CRC-32 over joined buffers, then
+   writes a scratch file and compares the pool's CRC-32, MD5 and SHA-1
+   of it with a single threaded pass, timing both.
+
+   Arguments: scratch file name (default csumpool.tmp), MB to write
+   (default 256) and number of threads (default one per CPU).
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "md5.h"
+#include "sha1.h"
+#include "csumpool.h"
+
+#ifdef CSUMPOOLBENCH
+extern unsigned long Crc32_ComputeBuf (unsigned long, const void *, size_t);
+extern unsigned long Crc32_Combine (unsigned long, unsigned long, size_t);
+
+static double Seconds (void)
+{
+  struct timespec t;
+
+  clock_gettime (CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/* Single threaded reference, value[] laid out as the pool does */
+static void Reference (unsigned char *buf, size_t len, int type,
+                       uint32_t value[5])
+{
+  unsigned char digest[16];
+  MD5_CTX md5;
+  SHA1Context sha1;
+  size_t off, n;
+  int i;
+
+  switch (type) {
+  case CSUMPOOL_CRC32:
+    value[0] = (uint32_t)Crc32_ComputeBuf (0, buf, len);
+    break;
+  case CSUMPOOL_MD5:
+    MD5Init (&md5);
+    MD5Update (&md5, buf, len);
+    MD5Final (digest, &md5);
+    for (i = 0; i < 4; i++)
+      value[i] = (uint32_t)digest[i * 4] << 24 |
+                 (uint32_t)digest[i * 4 + 1] << 16 |
+                 (uint32_t)digest[i * 4 + 2] << 8 | (uint32_t)digest[i * 4 + 3];
+    break;
+  case CSUMPOOL_SHA1:
+    SHA1Reset (&sha1);
+    for (off = 0; off < len; off += n) {
+      n = len - off < (1 << 20) ? len - off : (1 << 20);
+      SHA1Input (&sha1, buf + off, n);
+    }
+    SHA1Result (&sha1);
+    for (i = 0; i < 5; i++)
+      value[i] = sha1.Message_Digest[i];
+    break;
+  }
+}
+
+/* Wait for n results the way a select() loop would */
+static int Gather (int fd, int n, CSUMPOOL_Result res[])
+{
+  struct pollfd p;
+  int got = 0;
+
+  p.fd = fd;
+  p.events = POLLIN;
+  while (got < n) {
+    if (poll (&p, 1, 60000) <= 0)
+      return got;
+    while (got < n && CSUMPOOL_Collect (&res[got]))
+      got++;
+  }
+  return got;
+}
+
+int main (int argc, char *argv[])
+{
+  const char *fname = argc > 1 ? argv[1] : "csumpool.tmp";
+  size_t size = (argc > 2 ? strtoul (argv[2], NULL, 10) : 256) << 20;
+  int types[3] = { CSUMPOOL_CRC32, CSUMPOOL_MD5, CSUMPOOL_SHA1 };
+  const char *names[3] = { "crc32", "md5", "sha1" };
+  CSUMPOOL_Result res[3];
+  uint32_t ref[3][5];
+  unsigned char *buf;
+  size_t i, a, b;
+  double t, ts, tp;
+  int fd, k, bad = 0;
+  FILE *fp;
+
+  if ((buf = malloc (size)) == NULL) {
+    fprintf (stderr, "csumpoolbench: out of memory\n");
+    return 2;
+  }
+  srand (1);
+  for (i = 0; i < size; i++)
+    buf[i] = (unsigned char)rand ();
+
+  /* Combining must agree with hashing the joined buffer */
+  for (k = 0; k < 1000; k++) {
+    a = (size_t)rand () % 70000;
+    b = (size_t)rand () % 70000;
+    if (Crc32_Combine (Crc32_ComputeBuf (0, buf, a),
+                       Crc32_ComputeBuf (0, buf + a, b), b) !=
+        Crc32_ComputeBuf (0, buf, a + b)) {
+      fprintf (stderr, "combine mismatch %zu + %zu\n", a, b);
+      bad = 1;
+      break;
+    }
+  }
+  printf ("combine %s\n", bad ? "FAILED" : "ok");
+
+  if ((fp = fopen (fname, "w")) == NULL ||
+      fwrite (buf, 1, size, fp) != size || fclose (fp) != 0) {
+    fprintf (stderr, "csumpoolbench: cannot write %s\n", fname);
+    return 2;
+  }
+  if ((fd = CSUMPOOL_Start (argc > 3 ? atoi (argv[3]) : 0)) < 0) {
+    fprintf (stderr, "csumpoolbench: cannot start threads\n");
+    return 2;
+  }
+  printf ("%d threads, %zu MB\n", CSUMPOOL_Threads (), size >> 20);
+
+  for (k = 0; k < 3; k++) {
+    t = Seconds ();
+    Reference (buf, size, types[k], ref[k]);
+    ts = Seconds () - t;
+    t = Seconds ();
+    if (CSUMPOOL_Submit (fname, types[k], k) < 0 || Gather (fd, 1, res) != 1) {
+      fprintf (stderr, "%s: pool failed %s\n", names[k], strerror (errno));
+      bad = 1;
+      continue;
+    }
+    tp = Seconds () - t;
+    free (res[0].fname);
+    if (res[0].error || memcmp (res[0].value, ref[k],
+                                (types[k] == CSUMPOOL_CRC32 ? 1 :
+                                 types[k] == CSUMPOOL_MD5 ? 4 : 5) * 4)) {
+      fprintf (stderr, "%s: mismatch\n", names[k]);
+      bad = 1;
+    }
+    printf ("%-6s single %6.2f GB/s  pool %6.2f GB/s\n", names[k],
+            size / ts / 1e9, size / tp / 1e9);
+  }
+
+  /* All three at once, the serial ones each get a thread */
+  t = Seconds ();
+  for (k = 0; k < 3; k++)
+    CSUMPOOL_Submit (fname, types[k], k);
+  if (Gather (fd, 3, res) != 3)
+    bad = 1;
+  tp = Seconds () - t;
+  for (k = 0; k < 3; k++) {
+    if (res[k].error || memcmp (res[k].value, ref[res[k].tag],
+                                res[k].type == CSUMPOOL_CRC32 ? 4 :
+                                res[k].type == CSUMPOOL_MD5 ? 16 : 20))
+      bad = 1;
+    free (res[k].fname);
+  }
+  printf ("all three together %6.2f s, check %s\n", tp, bad ? "FAILED" : "ok");
+
+  CSUMPOOL_Stop ();
+  unlink (fname);
+  free (buf);
+  return bad;
+}
+#endif
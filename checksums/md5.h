@@ -47,6 +47,7 @@ If using PROTOTYPES, then PROTO_LIST returns the list, otherwise it
 #endif
 
 #include <inttypes.h>
+#include <stddef.h>
 
 /* MD5 context. */
 typedef struct {
@@ -60,6 +61,16 @@ void MD5Update PROTO_LIST
   ((MD5_CTX *, unsigned char *, unsigned int));
 extern void MD5Final PROTO_LIST ((unsigned char [16], MD5_CTX *));
 
+/* Multi-buffer MD5 (md5mb.c)
+ */
+#define MD5MB_MAXLANES 16
+
+#ifndef __cplusplus
+extern int MD5MB_Lanes (void);
+extern const char *MD5MB_Implementation (void);
+extern void MD5MB_Update (MD5_CTX *[], const unsigned char *[], int, size_t);
+#endif
+
 #endif // _MD5_H
 
 /*
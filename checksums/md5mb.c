@@ -0,0 +1,341 @@
+/* MD5MB.C - multi-buffer MD5, derived from the RSA Data Security, Inc.
+   MD5 Message-Digest Algorithm (md5.c)
+ */
+
+/* Copyright (C) 1991-2, RSA Data Security, Inc. Created 1991. All
+rights reserved.
+
+License to copy and use this software is granted provided that it
+is identified as the "RSA Data Security, Inc. MD5 Message-Digest
+Algorithm" in all material mentioning or referencing this software
+or this function.
+
+License is also granted to make and use derivative works provided
+that such works are identified as "derived from the RSA Data
+Security, Inc. MD5 Message-Digest Algorithm" in all material
+mentioning or referencing the derived work.
+
+RSA Data Security, Inc. makes no representations concerning either
+the merchantability of this software or the suitability of this
+software for any particular purpose. It is provided "as is"
+without express or implied warranty of any kind.
+
+These notices must be retained in any copies of any part of this
+documentation and/or software.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "md5.h"
+
+/* Multi-buffer MD5: hashes up to MD5MB_MAXLANES independent streams
+   at once, one stream per 32 bit SIMD lane. MD5 itself is a serial
+   chain within a stream, so the parallelism has to come from running
+   several streams side by side. The kernels use GCC vector extensions
+   and are built for 4 lanes (SSE2, or NEON on ARM), 8 lanes (AVX2) and
+   16 lanes (AVX-512); the widest one the CPU supports is picked at load
+   time. The scalar MD5Transform() in md5.c stays the reference and the
+   fallback.
+ */
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MD5MB_HAVE_X86 1
+#endif
+
+typedef uint32_t md5v4 __attribute__((vector_size(16)));
+typedef uint32_t md5v8 __attribute__((vector_size(32)));
+typedef uint32_t md5v16 __attribute__((vector_size(64)));
+
+#define S11 7
+#define S12 12
+#define S13 17
+#define S14 22
+#define S21 5
+#define S22 9
+#define S23 14
+#define S24 20
+#define S31 4
+#define S32 11
+#define S33 16
+#define S34 23
+#define S41 6
+#define S42 10
+#define S43 15
+#define S44 21
+
+/* F, G, H and I are basic MD5 functions, as in md5.c.
+ */
+#define F(x, y, z) (((x) & (y)) | ((~x) & (z)))
+#define G(x, y, z) (((x) & (z)) | ((y) & (~z)))
+#define H(x, y, z) ((x) ^ (y) ^ (z))
+#define I(x, y, z) ((y) ^ ((x) | (~z)))
+
+#define ROTATE_LEFT(x, n) (((x) << (n)) | ((x) >> (32-(n))))
+
+#define FF(a, b, c, d, x, s, ac) { \
+ (a) += F ((b), (c), (d)) + (x) + (uint32_t)(ac); \
+ (a) = ROTATE_LEFT ((a), (s)); \
+ (a) += (b); \
+  }
+#define GG(a, b, c, d, x, s, ac) { \
+ (a) += G ((b), (c), (d)) + (x) + (uint32_t)(ac); \
+ (a) = ROTATE_LEFT ((a), (s)); \
+ (a) += (b); \
+  }
+#define HH(a, b, c, d, x, s, ac) { \
+ (a) += H ((b), (c), (d)) + (x) + (uint32_t)(ac); \
+ (a) = ROTATE_LEFT ((a), (s)); \
+ (a) += (b); \
+  }
+#define II(a, b, c, d, x, s, ac) { \
+ (a) += I ((b), (c), (d)) + (x) + (uint32_t)(ac); \
+ (a) = ROTATE_LEFT ((a), (s)); \
+ (a) += (b); \
+  }
+
+#define MD5MB_LE32(p) ((uint32_t)(p)[0] | ((uint32_t)(p)[1] << 8) | \
+                       ((uint32_t)(p)[2] << 16) | ((uint32_t)(p)[3] << 24))
+
+#define MD5MB_ROUNDS \
+  /* Round 1 */ \
+  FF (a, b, c, d, x[ 0], S11, 0xd76aa478); \
+  FF (d, a, b, c, x[ 1], S12, 0xe8c7b756); \
+  FF (c, d, a, b, x[ 2], S13, 0x242070db); \
+  FF (b, c, d, a, x[ 3], S14, 0xc1bdceee); \
+  FF (a, b, c, d, x[ 4], S11, 0xf57c0faf); \
+  FF (d, a, b, c, x[ 5], S12, 0x4787c62a); \
+  FF (c, d, a, b, x[ 6], S13, 0xa8304613); \
+  FF (b, c, d, a, x[ 7], S14, 0xfd469501); \
+  FF (a, b, c, d, x[ 8], S11, 0x698098d8); \
+  FF (d, a, b, c, x[ 9], S12, 0x8b44f7af); \
+  FF (c, d, a, b, x[10], S13, 0xffff5bb1); \
+  FF (b, c, d, a, x[11], S14, 0x895cd7be); \
+  FF (a, b, c, d, x[12], S11, 0x6b901122); \
+  FF (d, a, b, c, x[13], S12, 0xfd987193); \
+  FF (c, d, a, b, x[14], S13, 0xa679438e); \
+  FF (b, c, d, a, x[15], S14, 0x49b40821); \
+  /* Round 2 */ \
+  GG (a, b, c, d, x[ 1], S21, 0xf61e2562); \
+  GG (d, a, b, c, x[ 6], S22, 0xc040b340); \
+  GG (c, d, a, b, x[11], S23, 0x265e5a51); \
+  GG (b, c, d, a, x[ 0], S24, 0xe9b6c7aa); \
+  GG (a, b, c, d, x[ 5], S21, 0xd62f105d); \
+  GG (d, a, b, c, x[10], S22, 0x02441453); \
+  GG (c, d, a, b, x[15], S23, 0xd8a1e681); \
+  GG (b, c, d, a, x[ 4], S24, 0xe7d3fbc8); \
+  GG (a, b, c, d, x[ 9], S21, 0x21e1cde6); \
+  GG (d, a, b, c, x[14], S22, 0xc33707d6); \
+  GG (c, d, a, b, x[ 3], S23, 0xf4d50d87); \
+  GG (b, c, d, a, x[ 8], S24, 0x455a14ed); \
+  GG (a, b, c, d, x[13], S21, 0xa9e3e905); \
+  GG (d, a, b, c, x[ 2], S22, 0xfcefa3f8); \
+  GG (c, d, a, b, x[ 7], S23, 0x676f02d9); \
+  GG (b, c, d, a, x[12], S24, 0x8d2a4c8a); \
+  /* Round 3 */ \
+  HH (a, b, c, d, x[ 5], S31, 0xfffa3942); \
+  HH (d, a, b, c, x[ 8], S32, 0x8771f681); \
+  HH (c, d, a, b, x[11], S33, 0x6d9d6122); \
+  HH (b, c, d, a, x[14], S34, 0xfde5380c); \
+  HH (a, b, c, d, x[ 1], S31, 0xa4beea44); \
+  HH (d, a, b, c, x[ 4], S32, 0x4bdecfa9); \
+  HH (c, d, a, b, x[ 7], S33, 0xf6bb4b60); \
+  HH (b, c, d, a, x[10], S34, 0xbebfbc70); \
+  HH (a, b, c, d, x[13], S31, 0x289b7ec6); \
+  HH (d, a, b, c, x[ 0], S32, 0xeaa127fa); \
+  HH (c, d, a, b, x[ 3], S33, 0xd4ef3085); \
+  HH (b, c, d, a, x[ 6], S34, 0x04881d05); \
+  HH (a, b, c, d, x[ 9], S31, 0xd9d4d039); \
+  HH (d, a, b, c, x[12], S32, 0xe6db99e5); \
+  HH (c, d, a, b, x[15], S33, 0x1fa27cf8); \
+  HH (b, c, d, a, x[ 2], S34, 0xc4ac5665); \
+  /* Round 4 */ \
+  II (a, b, c, d, x[ 0], S41, 0xf4292244); \
+  II (d, a, b, c, x[ 7], S42, 0x432aff97); \
+  II (c, d, a, b, x[14], S43, 0xab9423a7); \
+  II (b, c, d, a, x[ 5], S44, 0xfc93a039); \
+  II (a, b, c, d, x[12], S41, 0x655b59c3); \
+  II (d, a, b, c, x[ 3], S42, 0x8f0ccc92); \
+  II (c, d, a, b, x[10], S43, 0xffeff47d); \
+  II (b, c, d, a, x[ 1], S44, 0x85845dd1); \
+  II (a, b, c, d, x[ 8], S41, 0x6fa87e4f); \
+  II (d, a, b, c, x[15], S42, 0xfe2ce6e0); \
+  II (c, d, a, b, x[ 6], S43, 0xa3014314); \
+  II (b, c, d, a, x[13], S44, 0x4e0811a1); \
+  II (a, b, c, d, x[ 4], S41, 0xf7537e82); \
+  II (d, a, b, c, x[11], S42, 0xbd3af235); \
+  II (c, d, a, b, x[ 2], S43, 0x2ad7d2bb); \
+  II (b, c, d, a, x[ 9], S44, 0xeb86d391);
+
+/* One kernel per lane count. Each lane's 64 byte block is transposed
+   so that word i of every lane sits in one vector, then the rounds run
+   on whole vectors exactly as MD5Transform() runs them on words.
+ */
+#define MD5MB_KERNEL(NAME, VEC, LANES, TARGET) \
+TARGET \
+static void NAME (uint32_t *state[], const unsigned char *data[], \
+                  size_t blocks) \
+{ \
+  VEC a, b, c, d, sa, sb, sc, sd, x[16]; \
+  uint32_t w[16][LANES] __attribute__((aligned(64))); \
+  size_t off; \
+  int i, l; \
+ \
+  for (l = 0; l < LANES; l++) { \
+    w[0][l] = state[l][0]; \
+    w[1][l] = state[l][1]; \
+    w[2][l] = state[l][2]; \
+    w[3][l] = state[l][3]; \
+  } \
+  memcpy (&a, w[0], sizeof (a)); \
+  memcpy (&b, w[1], sizeof (b)); \
+  memcpy (&c, w[2], sizeof (c)); \
+  memcpy (&d, w[3], sizeof (d)); \
+ \
+  for (off = 0; off < blocks * 64; off += 64) { \
+    for (l = 0; l < LANES; l++) \
+      for (i = 0; i < 16; i++) \
+        w[i][l] = MD5MB_LE32 (data[l] + off + 4 * i); \
+    for (i = 0; i < 16; i++) \
+      memcpy (&x[i], w[i], sizeof (x[i])); \
+    sa = a; sb = b; sc = c; sd = d; \
+    MD5MB_ROUNDS \
+    a += sa; b += sb; c += sc; d += sd; \
+  } \
+ \
+  memcpy (w[0], &a, sizeof (a)); \
+  memcpy (w[1], &b, sizeof (b)); \
+  memcpy (w[2], &c, sizeof (c)); \
+  memcpy (w[3], &d, sizeof (d)); \
+  for (l = 0; l < LANES; l++) { \
+    state[l][0] = w[0][l]; \
+    state[l][1] = w[1][l]; \
+    state[l][2] = w[2][l]; \
+    state[l][3] = w[3][l]; \
+  } \
+}
+
+MD5MB_KERNEL (MD5MB_Blocks4, md5v4, 4, )
+#ifdef MD5MB_HAVE_X86
+MD5MB_KERNEL (MD5MB_Blocks8, md5v8, 8, __attribute__((target("avx2"))))
+MD5MB_KERNEL (MD5MB_Blocks16, md5v16, 16,
+              __attribute__((target("avx512f"))))
+#endif
+
+typedef void (*MD5MB_BlockFunc) (uint32_t *[], const unsigned char *[],
+                                 size_t);
+
+static MD5MB_BlockFunc MD5MB_Blocks = MD5MB_Blocks4;
+static int MD5MB_Width = 4;
+static int MD5MB_Have8 = 0;
+static const char *MD5MB_Kernel = "vec4";
+
+/* Picks the widest kernel once, when the library is loaded.
+   MD5MB_LANES=n in the environment caps the width (1 means scalar).
+ */
+__attribute__((constructor))
+static void MD5MB_Init (void)
+{
+  const char *cap = getenv ("MD5MB_LANES");
+  int max = cap ? atoi (cap) : MD5MB_MAXLANES;
+
+  if (max < 4) {
+    MD5MB_Blocks = NULL;
+    MD5MB_Width = 1;
+    MD5MB_Kernel = "scalar";
+    return;
+  }
+#ifdef MD5MB_HAVE_X86
+  __builtin_cpu_init ();
+  MD5MB_Kernel = "sse2";
+  if (max >= 8 && __builtin_cpu_supports ("avx2")) {
+    MD5MB_Blocks = MD5MB_Blocks8;
+    MD5MB_Width = 8;
+    MD5MB_Have8 = 1;
+    MD5MB_Kernel = "avx2";
+  }
+  if (max >= 16 && __builtin_cpu_supports ("avx512f")) {
+    MD5MB_Blocks = MD5MB_Blocks16;
+    MD5MB_Width = 16;
+    MD5MB_Kernel = "avx512";
+  }
+#endif
+}
+
+/* Number of streams the selected kernel hashes per pass.
+ */
+int MD5MB_Lanes (void)
+{
+  return MD5MB_Width;
+}
+
+/* Name of the widest kernel in use: avx512, avx2, sse2, vec4 or scalar.
+ */
+const char *MD5MB_Implementation (void)
+{
+  return MD5MB_Kernel;
+}
+
+/* Multi-buffer update. Hashes 'blocks' whole 64 byte blocks from each
+   of data[0..n-1] into context[0..n-1]. Every context must be on a
+   block boundary (nothing buffered by MD5Update()), which is always
+   true straight after MD5Init() and stays true as long as a stream is
+   only fed whole blocks until its final MD5Update()/MD5Final(). Any
+   n is accepted; streams are run in groups of MD5MB_Lanes(), and the
+   idle lanes of a short group rehash the first stream's data into a
+   spare state that is thrown away.
+ */
+void MD5MB_Update (MD5_CTX *context[], const unsigned char *data[],
+                   int n, size_t blocks)
+{
+  uint32_t *state[MD5MB_MAXLANES];
+  const unsigned char *in[MD5MB_MAXLANES];
+  uint32_t spare[MD5MB_MAXLANES][4];
+  uint64_t bits = (uint64_t)blocks << 9;
+  MD5MB_BlockFunc fn;
+  size_t off, len;
+  int i, g, k, w;
+
+  if (n <= 0 || blocks == 0)
+    return;
+
+  if (MD5MB_Blocks == NULL) {
+    for (i = 0; i < n; i++)
+      for (off = 0; off < blocks * 64; off += len) {
+        len = blocks * 64 - off;
+        if (len > 0x10000000)
+          len = 0x10000000;
+        MD5Update (context[i], (unsigned char *)data[i] + off,
+                   (unsigned int)len);
+      }
+    return;
+  }
+
+  memset (spare, 0, sizeof (spare));
+  for (g = 0; g < n; g += w) {
+    /* A short last group runs on the narrowest kernel that holds it */
+    w = MD5MB_Width;
+    fn = MD5MB_Blocks;
+#ifdef MD5MB_HAVE_X86
+    if (n - g <= 8 && MD5MB_Have8) {
+      w = 8;
+      fn = MD5MB_Blocks8;
+    }
+#endif
+    if (n - g <= 4) {
+      w = 4;
+      fn = MD5MB_Blocks4;
+    }
+    for (k = 0; k < w; k++) {
+      state[k] = (g + k < n) ? context[g + k]->state : spare[k];
+      in[k] = (g + k < n) ? data[g + k] : data[g];
+    }
+    fn (state, in, blocks);
+  }
+
+  /* Bit count, as MD5Update() keeps it */
+  for (i = 0; i < n; i++) {
+    if ((context[i]->count[0] += (uint32_t)bits) < (uint32_t)bits)
+      context[i]->count[1]++;
+    context[i]->count[1] += (uint32_t)(bits >> 32);
+  }
+}
@@ -0,0 +1,132 @@
+/* MD5MBDRIVER.C - check and benchmark for multi-buffer MD5 (md5mb.c)
+
+   Hashes a set of streams of different lengths with MD5MB_Update() and
+   compares every digest with the scalar MD5Update() result, then times
+   both over equal length streams.
+
+   Arguments: number of streams (default 16) and MB per stream
+   (default 8).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "md5.h"
+
+#ifdef MD5MBBENCH
+#define MAXSTREAMS 64
+
+static double Seconds (void)
+{
+  struct timespec t;
+
+  clock_gettime (CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/* Whole blocks through the multi-buffer engine, tail and padding scalar
+ */
+static void MBDigest (unsigned char *buf[], size_t len[], int n,
+                      unsigned char digest[][16])
+{
+  MD5_CTX ctx[MAXSTREAMS], *cp[MAXSTREAMS];
+  const unsigned char *p[MAXSTREAMS];
+  size_t done[MAXSTREAMS], step, b;
+  int i, active;
+
+  for (i = 0; i < n; i++) {
+    MD5Init (&ctx[i]);
+    done[i] = 0;
+  }
+  for (;;) {
+    active = 0;
+    step = 0;
+    for (i = 0; i < n; i++) {
+      if (len[i] - done[i] < 64)
+        continue;
+      b = (len[i] - done[i]) / 64;
+      if (step == 0 || b < step)
+        step = b;
+      cp[active] = &ctx[i];
+      p[active++] = buf[i] + done[i];
+    }
+    if (active == 0)
+      break;
+    MD5MB_Update (cp, p, active, step);
+    for (i = 0; i < n; i++)
+      if (len[i] - done[i] >= 64)
+        done[i] += step * 64;
+  }
+  for (i = 0; i < n; i++) {
+    MD5Update (&ctx[i], buf[i] + done[i], len[i] - done[i]);
+    MD5Final (digest[i], &ctx[i]);
+  }
+}
+
+static void ScalarDigest (unsigned char *buf[], size_t len[], int n,
+                          unsigned char digest[][16])
+{
+  MD5_CTX ctx;
+  int i;
+
+  for (i = 0; i < n; i++) {
+    MD5Init (&ctx);
+    MD5Update (&ctx, buf[i], len[i]);
+    MD5Final (digest[i], &ctx);
+  }
+}
+
+int main (int argc, char *argv[])
+{
+  unsigned char *buf[MAXSTREAMS], mb[MAXSTREAMS][16], ref[MAXSTREAMS][16];
+  size_t len[MAXSTREAMS], size, i;
+  int n = 16, k, bad = 0;
+  double t, ts, tm;
+
+  if (argc > 1)
+    n = atoi (argv[1]);
+  if (n < 1 || n > MAXSTREAMS)
+    n = 16;
+  size = (argc > 2 ? strtoul (argv[2], NULL, 10) : 8) * 1024 * 1024;
+  srand (1);
+  for (k = 0; k < n; k++) {
+    if ((buf[k] = malloc (size)) == NULL) {
+      fprintf (stderr, "md5mbbench: out of memory\n");
+      return 2;
+    }
+    for (i = 0; i < size; i++)
+      buf[k][i] = (unsigned char)rand ();
+  }
+
+  /* Uneven lengths so streams drop out of the batch at different times */
+  for (k = 0; k < n; k++)
+    len[k] = (size_t)rand () % (size < 100000 ? size : 100000);
+  MBDigest (buf, len, n, mb);
+  ScalarDigest (buf, len, n, ref);
+  for (k = 0; k < n; k++)
+    if (memcmp (mb[k], ref[k], 16)) {
+      fprintf (stderr, "mismatch stream %d len %zu\n", k, len[k]);
+      bad = 1;
+    }
+  printf ("check %s (%s, %d lanes)\n", bad ? "FAILED" : "ok",
+          MD5MB_Implementation (), MD5MB_Lanes ());
+
+  for (k = 0; k < n; k++)
+    len[k] = size;
+  t = Seconds ();
+  ScalarDigest (buf, len, n, ref);
+  ts = Seconds () - t;
+  t = Seconds ();
+  MBDigest (buf, len, n, mb);
+  tm = Seconds () - t;
+  bad |= memcmp (mb, ref, n * 16) != 0;
+  printf ("scalar   %6.2f GB/s\n", n * size / ts / 1e9);
+  printf ("multibuf %6.2f GB/s  (%d streams of %zu MB)\n",
+          n * size / tm / 1e9, n, size >> 20);
+
+  for (k = 0; k < n; k++)
+    free (buf[k]);
+  return bad;
+}
+#endif
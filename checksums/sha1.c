@@ -38,8 +38,24 @@
  *
  */
 
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #include "sha1.h"
 
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SHA1_HAVE_SHANI 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) && defined(__linux__) && defined(__GNUC__)
+#define SHA1_HAVE_ARMV8 1
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
 /*
  *  Define the circular shift macro
  */
@@ -51,6 +67,20 @@
 void SHA1ProcessMessageBlock(SHA1Context *);
 void SHA1PadMessage(SHA1Context *);
 
+/*
+ *  Block compression kernels. Each consumes 'blocks' whole 64 byte
+ *  blocks from 'data' and updates the five word digest in place.
+ *  SHA1Blocks points at the best one this CPU supports.
+ */
+typedef void (*SHA1BlockFunc)(unsigned *, const unsigned char *, size_t);
+
+static void SHA1Blocks_Generic(unsigned *, const unsigned char *, size_t);
+
+static SHA1BlockFunc SHA1Blocks = SHA1Blocks_Generic;
+static const char *SHA1Kernel = "generic";
+static SHA1BlockFunc SHA1BlocksDetected = SHA1Blocks_Generic;
+static const char *SHA1KernelDetected = "generic";
+
 /*  
  *  SHA1Reset
  *
@@ -144,6 +174,10 @@ void SHA1Input(     SHA1Context         *context,
                     const unsigned char *message_array,
                     unsigned            length)
 {
+    unsigned    low;                /* New length in bits           */
+    unsigned    high;
+    size_t      n;
+
     if (!length)
     {
         return;
@@ -155,33 +189,56 @@ void SHA1Input(     SHA1Context         *context,
         return;
     }
 
-    while(length-- && !context->Corrupted)
+    /*
+     *  Account for the whole array at once
+     */
+    low = (context->Length_Low + (length << 3)) & 0xFFFFFFFF;
+    high = (context->Length_High + (length >> 29) +
+            (low < context->Length_Low)) & 0xFFFFFFFF;
+    if (high < context->Length_High)
     {
-        context->Message_Block[context->Message_Block_Index++] =
-                                                (*message_array & 0xFF);
+        /* Message is too long */
+        context->Corrupted = 1;
+        return;
+    }
+    context->Length_Low = low;
+    context->Length_High = high;
 
-        context->Length_Low += 8;
-        /* Force it to 32 bits */
-        context->Length_Low &= 0xFFFFFFFF;
-        if (context->Length_Low == 0)
+    /*
+     *  Top up a partially filled block first
+     */
+    if (context->Message_Block_Index)
+    {
+        n = 64 - context->Message_Block_Index;
+        if (n > length)
         {
-            context->Length_High++;
-            /* Force it to 32 bits */
-            context->Length_High &= 0xFFFFFFFF;
-            if (context->Length_High == 0)
-            {
-                /* Message is too long */
-                context->Corrupted = 1;
-            }
+            n = length;
         }
-
+        memcpy(&context->Message_Block[context->Message_Block_Index],
+               message_array, n);
+        context->Message_Block_Index += n;
+        message_array += n;
+        length -= n;
         if (context->Message_Block_Index == 64)
         {
             SHA1ProcessMessageBlock(context);
         }
+    }
 
-        message_array++;
+    /*
+     *  Whole blocks are hashed straight from the caller's buffer
+     */
+    n = length / 64;
+    if (n)
+    {
+        SHA1Blocks(context->Message_Digest, message_array, n);
+        message_array += n * 64;
+        length -= n * 64;
     }
+
+    memcpy(&context->Message_Block[context->Message_Block_Index],
+           message_array, length);
+    context->Message_Block_Index += length;
 }
 
 /*  
@@ -205,6 +262,21 @@ void SHA1Input(     SHA1Context         *context,
  *
  */
 void SHA1ProcessMessageBlock(SHA1Context *context)
+{
+    SHA1Blocks(context->Message_Digest, context->Message_Block, 1);
+    context->Message_Block_Index = 0;
+}
+
+/*
+ *  SHA1Blocks_Generic
+ *
+ *  Description:
+ *      Portable block compression, the original FIPS 180-1 rounds.
+ *
+ */
+static void SHA1Blocks_Generic(unsigned *digest,
+                               const unsigned char *data,
+                               size_t blocks)
 {
     const unsigned K[] =            /* Constants defined in SHA-1   */      
     {
@@ -218,86 +290,482 @@ void SHA1ProcessMessageBlock(SHA1Context *context)
     unsigned    W[80];              /* Word sequence                */
     unsigned    A, B, C, D, E;      /* Word buffers                 */
 
-    /*
-     *  Initialize the first 16 words in the array W
-     */
-    for(t = 0; t < 16; t++)
+    for (; blocks; blocks--, data += 64)
     {
-        W[t] = ((unsigned) context->Message_Block[t * 4]) << 24;
-        W[t] |= ((unsigned) context->Message_Block[t * 4 + 1]) << 16;
-        W[t] |= ((unsigned) context->Message_Block[t * 4 + 2]) << 8;
-        W[t] |= ((unsigned) context->Message_Block[t * 4 + 3]);
-    }
+        /*
+         *  Initialize the first 16 words in the array W
+         */
+        for(t = 0; t < 16; t++)
+        {
+            W[t] = ((unsigned) data[t * 4]) << 24;
+            W[t] |= ((unsigned) data[t * 4 + 1]) << 16;
+            W[t] |= ((unsigned) data[t * 4 + 2]) << 8;
+            W[t] |= ((unsigned) data[t * 4 + 3]);
+        }
 
-    for(t = 16; t < 80; t++)
-    {
-       W[t] = SHA1CircularShift(1,W[t-3] ^ W[t-8] ^ W[t-14] ^ W[t-16]);
+        for(t = 16; t < 80; t++)
+        {
+           W[t] = SHA1CircularShift(1,W[t-3] ^ W[t-8] ^ W[t-14] ^ W[t-16]);
+        }
+
+        A = digest[0];
+        B = digest[1];
+        C = digest[2];
+        D = digest[3];
+        E = digest[4];
+
+        for(t = 0; t < 20; t++)
+        {
+            temp =  SHA1CircularShift(5,A) +
+                    ((B & C) | ((~B) & D)) + E + W[t] + K[0];
+            temp &= 0xFFFFFFFF;
+            E = D;
+            D = C;
+            C = SHA1CircularShift(30,B);
+            B = A;
+            A = temp;
+        }
+
+        for(t = 20; t < 40; t++)
+        {
+            temp = SHA1CircularShift(5,A) + (B ^ C ^ D) + E + W[t] + K[1];
+            temp &= 0xFFFFFFFF;
+            E = D;
+            D = C;
+            C = SHA1CircularShift(30,B);
+            B = A;
+            A = temp;
+        }
+
+        for(t = 40; t < 60; t++)
+        {
+            temp = SHA1CircularShift(5,A) +
+                   ((B & C) | (B & D) | (C & D)) + E + W[t] + K[2];
+            temp &= 0xFFFFFFFF;
+            E = D;
+            D = C;
+            C = SHA1CircularShift(30,B);
+            B = A;
+            A = temp;
+        }
+
+        for(t = 60; t < 80; t++)
+        {
+            temp = SHA1CircularShift(5,A) + (B ^ C ^ D) + E + W[t] + K[3];
+            temp &= 0xFFFFFFFF;
+            E = D;
+            D = C;
+            C = SHA1CircularShift(30,B);
+            B = A;
+            A = temp;
+        }
+
+        digest[0] = (digest[0] + A) & 0xFFFFFFFF;
+        digest[1] = (digest[1] + B) & 0xFFFFFFFF;
+        digest[2] = (digest[2] + C) & 0xFFFFFFFF;
+        digest[3] = (digest[3] + D) & 0xFFFFFFFF;
+        digest[4] = (digest[4] + E) & 0xFFFFFFFF;
     }
+}
+
+#ifdef SHA1_HAVE_SHANI
+/*
+ *  SHA1Blocks_SHANI
+ *
+ *  Description:
+ *      Block compression using the x86 SHA extensions (sha1rnds4,
+ *      sha1nexte, sha1msg1/2). Four rounds per sha1rnds4, with the
+ *      message schedule computed three groups ahead.
+ *
+ */
+__attribute__((target("sha,ssse3,sse4.1")))
+static void SHA1Blocks_SHANI(unsigned *digest,
+                             const unsigned char *p,
+                             size_t blocks)
+{
+    __m128i ABCD, ABCD_SAVE, E0, E0_SAVE, E1;
+    __m128i MSG0, MSG1, MSG2, MSG3;
+    const __m128i MASK = _mm_set_epi64x(0x0001020304050607ULL,
+                                        0x08090a0b0c0d0e0fULL);
 
-    A = context->Message_Digest[0];
-    B = context->Message_Digest[1];
-    C = context->Message_Digest[2];
-    D = context->Message_Digest[3];
-    E = context->Message_Digest[4];
+    ABCD = _mm_loadu_si128((const __m128i *) digest);
+    ABCD = _mm_shuffle_epi32(ABCD, 0x1B);
+    E0 = _mm_set_epi32((int) digest[4], 0, 0, 0);
 
-    for(t = 0; t < 20; t++)
+    for (; blocks; blocks--, p += 64)
     {
-        temp =  SHA1CircularShift(5,A) +
-                ((B & C) | ((~B) & D)) + E + W[t] + K[0];
-        temp &= 0xFFFFFFFF;
-        E = D;
-        D = C;
-        C = SHA1CircularShift(30,B);
-        B = A;
-        A = temp;
+        ABCD_SAVE = ABCD;
+        E0_SAVE = E0;
+
+        /** rounds 0-3 **/
+        MSG0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (p + 0)), MASK);
+        E0 = _mm_add_epi32(E0, MSG0);
+        E1 = ABCD;
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+        /** rounds 4-7 **/
+        MSG1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (p + 16)), MASK);
+        E1 = _mm_sha1nexte_epu32(E1, MSG1);
+        E0 = ABCD;
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 0);
+        MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+        /** rounds 8-11 **/
+        MSG2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (p + 32)), MASK);
+        E0 = _mm_sha1nexte_epu32(E0, MSG2);
+        E1 = ABCD;
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+        MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+        MSG0 = _mm_xor_si128(MSG0, MSG2);
+        /** rounds 12-15 **/
+        MSG3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) (p + 48)), MASK);
+        E1 = _mm_sha1nexte_epu32(E1, MSG3);
+        E0 = ABCD;
+        MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 0);
+        MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+        MSG1 = _mm_xor_si128(MSG1, MSG3);
+        /** rounds 16-19 **/
+        E0 = _mm_sha1nexte_epu32(E0, MSG0);
+        E1 = ABCD;
+        MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 0);
+        MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+        MSG2 = _mm_xor_si128(MSG2, MSG0);
+        /** rounds 20-23 **/
+        E1 = _mm_sha1nexte_epu32(E1, MSG1);
+        E0 = ABCD;
+        MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+        MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+        MSG3 = _mm_xor_si128(MSG3, MSG1);
+        /** rounds 24-27 **/
+        E0 = _mm_sha1nexte_epu32(E0, MSG2);
+        E1 = ABCD;
+        MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 1);
+        MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+        MSG0 = _mm_xor_si128(MSG0, MSG2);
+        /** rounds 28-31 **/
+        E1 = _mm_sha1nexte_epu32(E1, MSG3);
+        E0 = ABCD;
+        MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+        MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+        MSG1 = _mm_xor_si128(MSG1, MSG3);
+        /** rounds 32-35 **/
+        E0 = _mm_sha1nexte_epu32(E0, MSG0);
+        E1 = ABCD;
+        MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 1);
+        MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+        MSG2 = _mm_xor_si128(MSG2, MSG0);
+        /** rounds 36-39 **/
+        E1 = _mm_sha1nexte_epu32(E1, MSG1);
+        E0 = ABCD;
+        MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 1);
+        MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+        MSG3 = _mm_xor_si128(MSG3, MSG1);
+        /** rounds 40-43 **/
+        E0 = _mm_sha1nexte_epu32(E0, MSG2);
+        E1 = ABCD;
+        MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+        MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+        MSG0 = _mm_xor_si128(MSG0, MSG2);
+        /** rounds 44-47 **/
+        E1 = _mm_sha1nexte_epu32(E1, MSG3);
+        E0 = ABCD;
+        MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 2);
+        MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+        MSG1 = _mm_xor_si128(MSG1, MSG3);
+        /** rounds 48-51 **/
+        E0 = _mm_sha1nexte_epu32(E0, MSG0);
+        E1 = ABCD;
+        MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+        MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+        MSG2 = _mm_xor_si128(MSG2, MSG0);
+        /** rounds 52-55 **/
+        E1 = _mm_sha1nexte_epu32(E1, MSG1);
+        E0 = ABCD;
+        MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 2);
+        MSG0 = _mm_sha1msg1_epu32(MSG0, MSG1);
+        MSG3 = _mm_xor_si128(MSG3, MSG1);
+        /** rounds 56-59 **/
+        E0 = _mm_sha1nexte_epu32(E0, MSG2);
+        E1 = ABCD;
+        MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 2);
+        MSG1 = _mm_sha1msg1_epu32(MSG1, MSG2);
+        MSG0 = _mm_xor_si128(MSG0, MSG2);
+        /** rounds 60-63 **/
+        E1 = _mm_sha1nexte_epu32(E1, MSG3);
+        E0 = ABCD;
+        MSG0 = _mm_sha1msg2_epu32(MSG0, MSG3);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+        MSG2 = _mm_sha1msg1_epu32(MSG2, MSG3);
+        MSG1 = _mm_xor_si128(MSG1, MSG3);
+        /** rounds 64-67 **/
+        E0 = _mm_sha1nexte_epu32(E0, MSG0);
+        E1 = ABCD;
+        MSG1 = _mm_sha1msg2_epu32(MSG1, MSG0);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 3);
+        MSG3 = _mm_sha1msg1_epu32(MSG3, MSG0);
+        MSG2 = _mm_xor_si128(MSG2, MSG0);
+        /** rounds 68-71 **/
+        E1 = _mm_sha1nexte_epu32(E1, MSG1);
+        E0 = ABCD;
+        MSG2 = _mm_sha1msg2_epu32(MSG2, MSG1);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+        MSG3 = _mm_xor_si128(MSG3, MSG1);
+        /** rounds 72-75 **/
+        E0 = _mm_sha1nexte_epu32(E0, MSG2);
+        E1 = ABCD;
+        MSG3 = _mm_sha1msg2_epu32(MSG3, MSG2);
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E0, 3);
+        /** rounds 76-79 **/
+        E1 = _mm_sha1nexte_epu32(E1, MSG3);
+        E0 = ABCD;
+        ABCD = _mm_sha1rnds4_epu32(ABCD, E1, 3);
+
+
+        E0 = _mm_sha1nexte_epu32(E0, E0_SAVE);
+        ABCD = _mm_add_epi32(ABCD, ABCD_SAVE);
     }
 
-    for(t = 20; t < 40; t++)
+    ABCD = _mm_shuffle_epi32(ABCD, 0x1B);
+    _mm_storeu_si128((__m128i *) digest, ABCD);
+    digest[4] = (unsigned) _mm_extract_epi32(E0, 3);
+}
+#endif
+
+#ifdef SHA1_HAVE_ARMV8
+/*
+ *  SHA1Blocks_ARMv8
+ *
+ *  Description:
+ *      Block compression using the ARMv8 Cryptography Extension
+ *      (sha1c/p/m, sha1h, sha1su0/1).
+ *
+ */
+__attribute__((target("+crypto")))
+static void SHA1Blocks_ARMv8(unsigned *digest,
+                             const unsigned char *p,
+                             size_t blocks)
+{
+    uint32x4_t ABCD, ABCD_SAVE;
+    uint32x4_t TMP0, TMP1;
+    uint32x4_t MSG0, MSG1, MSG2, MSG3;
+    uint32_t E0, E0_SAVE, E1;
+    const uint32x4_t K0 = vdupq_n_u32(0x5A827999);
+    const uint32x4_t K1 = vdupq_n_u32(0x6ED9EBA1);
+    const uint32x4_t K2 = vdupq_n_u32(0x8F1BBCDC);
+    const uint32x4_t K3 = vdupq_n_u32(0xCA62C1D6);
+
+    ABCD = vld1q_u32((const uint32_t *) digest);
+    E0 = digest[4];
+
+    for (; blocks; blocks--, p += 64)
     {
-        temp = SHA1CircularShift(5,A) + (B ^ C ^ D) + E + W[t] + K[1];
-        temp &= 0xFFFFFFFF;
-        E = D;
-        D = C;
-        C = SHA1CircularShift(30,B);
-        B = A;
-        A = temp;
+        ABCD_SAVE = ABCD;
+        E0_SAVE = E0;
+
+        MSG0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p + 0)));
+        MSG1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p + 16)));
+        MSG2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p + 32)));
+        MSG3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p + 48)));
+        TMP0 = vaddq_u32(MSG0, K0);
+        TMP1 = vaddq_u32(MSG1, K0);
+
+        /** rounds 0-3 **/
+        E1 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+        ABCD = vsha1cq_u32(ABCD, E0, TMP0);
+        TMP0 = vaddq_u32(MSG2, K0);
+        MSG0 = vsha1su0q_u32(MSG0, MSG1, MSG2);
+        /** rounds 4-7 **/
+        E0 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+        ABCD = vsha1cq_u32(ABCD, E1, TMP1);
+        TMP1 = vaddq_u32(MSG3, K0);
+        MSG0 = vsha1su1q_u32(MSG0, MSG3);
+        MSG1 = vsha1su0q_u32(MSG1, MSG2, MSG3);
+        /** rounds 8-11 **/
+        E1 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+        ABCD = vsha1cq_u32(ABCD, E0, TMP0);
+        TMP0 = vaddq_u32(MSG0, K0);
+        MSG1 = vsha1su1q_u32(MSG1, MSG0);
+        MSG2 = vsha1su0q_u32(MSG2, MSG3, MSG0);
+        /** rounds 12-15 **/
+        E0 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+        ABCD = vsha1cq_u32(ABCD, E1, TMP1);
+        TMP1 = vaddq_u32(MSG1, K1);
+        MSG2 = vsha1su1q_u32(MSG2, MSG1);
+        MSG3 = vsha1su0q_u32(MSG3, MSG0, MSG1);
+        /** rounds 16-19 **/
+        E1 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+        ABCD = vsha1cq_u32(ABCD, E0, TMP0);
+        TMP0 = vaddq_u32(MSG2, K1);
+        MSG3 = vsha1su1q_u32(MSG3, MSG2);
+        MSG0 = vsha1su0q_u32(MSG0, MSG1, MSG2);
+        /** rounds 20-23 **/
+        E0 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+        ABCD = vsha1pq_u32(ABCD, E1, TMP1);
+        TMP1 = vaddq_u32(MSG3, K1);
+        MSG0 = vsha1su1q_u32(MSG0, MSG3);
+        MSG1 = vsha1su0q_u32(MSG1, MSG2, MSG3);
+        /** rounds 24-27 **/
+        E1 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+        ABCD = vsha1pq_u32(ABCD, E0, TMP0);
+        TMP0 = vaddq_u32(MSG0, K1);
+        MSG1 = vsha1su1q_u32(MSG1, MSG0);
+        MSG2 = vsha1su0q_u32(MSG2, MSG3, MSG0);
+        /** rounds 28-31 **/
+        E0 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+        ABCD = vsha1pq_u32(ABCD, E1, TMP1);
+        TMP1 = vaddq_u32(MSG1, K1);
+        MSG2 = vsha1su1q_u32(MSG2, MSG1);
+        MSG3 = vsha1su0q_u32(MSG3, MSG0, MSG1);
+        /** rounds 32-35 **/
+        E1 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+        ABCD = vsha1pq_u32(ABCD, E0, TMP0);
+        TMP0 = vaddq_u32(MSG2, K2);
+        MSG3 = vsha1su1q_u32(MSG3, MSG2);
+        MSG0 = vsha1su0q_u32(MSG0, MSG1, MSG2);
+        /** rounds 36-39 **/
+        E0 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+        ABCD = vsha1pq_u32(ABCD, E1, TMP1);
+        TMP1 = vaddq_u32(MSG3, K2);
+        MSG0 = vsha1su1q_u32(MSG0, MSG3);
+        MSG1 = vsha1su0q_u32(MSG1, MSG2, MSG3);
+        /** rounds 40-43 **/
+        E1 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+        ABCD = vsha1mq_u32(ABCD, E0, TMP0);
+        TMP0 = vaddq_u32(MSG0, K2);
+        MSG1 = vsha1su1q_u32(MSG1, MSG0);
+        MSG2 = vsha1su0q_u32(MSG2, MSG3, MSG0);
+        /** rounds 44-47 **/
+        E0 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+        ABCD = vsha1mq_u32(ABCD, E1, TMP1);
+        TMP1 = vaddq_u32(MSG1, K2);
+        MSG2 = vsha1su1q_u32(MSG2, MSG1);
+        MSG3 = vsha1su0q_u32(MSG3, MSG0, MSG1);
+        /** rounds 48-51 **/
+        E1 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+        ABCD = vsha1mq_u32(ABCD, E0, TMP0);
+        TMP0 = vaddq_u32(MSG2, K2);
+        MSG3 = vsha1su1q_u32(MSG3, MSG2);
+        MSG0 = vsha1su0q_u32(MSG0, MSG1, MSG2);
+        /** rounds 52-55 **/
+        E0 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+        ABCD = vsha1mq_u32(ABCD, E1, TMP1);
+        TMP1 = vaddq_u32(MSG3, K3);
+        MSG0 = vsha1su1q_u32(MSG0, MSG3);
+        MSG1 = vsha1su0q_u32(MSG1, MSG2, MSG3);
+        /** rounds 56-59 **/
+        E1 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+        ABCD = vsha1mq_u32(ABCD, E0, TMP0);
+        TMP0 = vaddq_u32(MSG0, K3);
+        MSG1 = vsha1su1q_u32(MSG1, MSG0);
+        MSG2 = vsha1su0q_u32(MSG2, MSG3, MSG0);
+        /** rounds 60-63 **/
+        E0 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+        ABCD = vsha1pq_u32(ABCD, E1, TMP1);
+        TMP1 = vaddq_u32(MSG1, K3);
+        MSG2 = vsha1su1q_u32(MSG2, MSG1);
+        MSG3 = vsha1su0q_u32(MSG3, MSG0, MSG1);
+        /** rounds 64-67 **/
+        E1 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+        ABCD = vsha1pq_u32(ABCD, E0, TMP0);
+        TMP0 = vaddq_u32(MSG2, K3);
+        MSG3 = vsha1su1q_u32(MSG3, MSG2);
+        /** rounds 68-71 **/
+        E0 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+        ABCD = vsha1pq_u32(ABCD, E1, TMP1);
+        TMP1 = vaddq_u32(MSG3, K3);
+        /** rounds 72-75 **/
+        E1 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+        ABCD = vsha1pq_u32(ABCD, E0, TMP0);
+        /** rounds 76-79 **/
+        E0 = vsha1h_u32(vgetq_lane_u32(ABCD, 0));
+        ABCD = vsha1pq_u32(ABCD, E1, TMP1);
+
+
+        E0 += E0_SAVE;
+        ABCD = vaddq_u32(ABCD_SAVE, ABCD);
     }
 
-    for(t = 40; t < 60; t++)
+    vst1q_u32((uint32_t *) digest, ABCD);
+    digest[4] = E0;
+}
+#endif
+
+/*
+ *  SHA1Init
+ *
+ *  Description:
+ *      Picks the block kernel once, when the library is loaded, from
+ *      what cpuid (or the Linux hwcaps on ARM) says the CPU supports.
+ *      Setting SHA1_NOACCEL in the environment forces the portable code.
+ *
+ */
+__attribute__((constructor))
+static void SHA1Init(void)
+{
+    if (getenv("SHA1_NOACCEL") != NULL)
     {
-        temp = SHA1CircularShift(5,A) +
-               ((B & C) | (B & D) | (C & D)) + E + W[t] + K[2];
-        temp &= 0xFFFFFFFF;
-        E = D;
-        D = C;
-        C = SHA1CircularShift(30,B);
-        B = A;
-        A = temp;
+        return;
     }
+#ifdef SHA1_HAVE_SHANI
+    {
+        unsigned a, b, c, d;
 
-    for(t = 60; t < 80; t++)
+        if (__get_cpuid(1, &a, &b, &c, &d) &&
+            (c & bit_SSSE3) && (c & bit_SSE4_1) &&
+            __get_cpuid_count(7, 0, &a, &b, &c, &d) &&
+            (b & (1u << 29)))   /* CPUID.(EAX=7,ECX=0):EBX.SHA */
+        {
+            SHA1Blocks = SHA1Blocks_SHANI;
+            SHA1Kernel = "sha-ni";
+        }
+    }
+#endif
+#ifdef SHA1_HAVE_ARMV8
+    if (getauxval(AT_HWCAP) & HWCAP_SHA1)
     {
-        temp = SHA1CircularShift(5,A) + (B ^ C ^ D) + E + W[t] + K[3];
-        temp &= 0xFFFFFFFF;
-        E = D;
-        D = C;
-        C = SHA1CircularShift(30,B);
-        B = A;
-        A = temp;
+        SHA1Blocks = SHA1Blocks_ARMv8;
+        SHA1Kernel = "armv8";
     }
+#endif
+    SHA1BlocksDetected = SHA1Blocks;
+    SHA1KernelDetected = SHA1Kernel;
+}
 
-    context->Message_Digest[0] =
-                        (context->Message_Digest[0] + A) & 0xFFFFFFFF;
-    context->Message_Digest[1] =
-                        (context->Message_Digest[1] + B) & 0xFFFFFFFF;
-    context->Message_Digest[2] =
-                        (context->Message_Digest[2] + C) & 0xFFFFFFFF;
-    context->Message_Digest[3] =
-                        (context->Message_Digest[3] + D) & 0xFFFFFFFF;
-    context->Message_Digest[4] =
-                        (context->Message_Digest[4] + E) & 0xFFFFFFFF;
+/*
+ *  SHA1UseGeneric
+ *
+ *  Description:
+ *      Force the portable kernel (on != 0) or go back to the one picked
+ *      at load time (on == 0). Meant for benchmarks and cross checks;
+ *      not safe while another thread is hashing.
+ *
+ */
+void SHA1UseGeneric(int on)
+{
+    SHA1Blocks = on ? SHA1Blocks_Generic : SHA1BlocksDetected;
+    SHA1Kernel = on ? "generic" : SHA1KernelDetected;
+}
 
-    context->Message_Block_Index = 0;
+/*
+ *  SHA1Implementation
+ *
+ *  Description:
+ *      Name of the block kernel in use: "sha-ni", "armv8" or "generic".
+ *
+ */
+const char *SHA1Implementation(void)
+{
+    return SHA1Kernel;
 }
 
 /*  
@@ -50,6 +50,8 @@ typedef struct SHA1Context
 extern void SHA1Reset(SHA1Context *);
 extern int SHA1Result(SHA1Context *);
 extern void SHA1Input( SHA1Context *, const unsigned char *, unsigned);
+extern const char *SHA1Implementation(void);
+extern void SHA1UseGeneric(int);
 
 #endif // __cplusplus
 
@@ -23,8 +23,11 @@
 #include <io.h>
 #endif
 #include <fcntl.h>
+#include <stdlib.h>
 #include "sha1.h"
 
+#define SHA1_BUFFER_SIZE (1024 * 1024)
+
 /*
  *  Function prototype
  */
@@ -55,7 +58,8 @@ int main(int argc, char *argv[])
 {
     SHA1Context sha;                /* SHA-1 context                 */
     FILE        *fp;                /* File pointer for reading files*/
-    char        c;                  /* Character read from file      */
+    unsigned char *buf;             /* Read buffer                   */
+    size_t      n;                  /* Bytes read into buf           */
     int         i;                  /* Counter                       */
     int         reading_stdin;      /* Are we reading standard in?   */
     int         read_stdin = 0;     /* Have we read stdin?           */
@@ -71,6 +75,12 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    if (!(buf = malloc(SHA1_BUFFER_SIZE)))
+    {
+        fprintf(stderr, "sha: out of memory\n");
+        return 2;
+    }
+
     /*
      *  For each filename passed in on the command line, calculate the
      *  SHA-1 value and display it.
@@ -125,11 +135,9 @@ int main(int argc, char *argv[])
          */
         SHA1Reset(&sha);
 
-        c = fgetc(fp);
-        while(!feof(fp))
+        while((n = fread(buf, 1, SHA1_BUFFER_SIZE, fp)) > 0)
         {
-            SHA1Input(&sha, (const unsigned char *) &c, 1);
-            c = fgetc(fp);
+            SHA1Input(&sha, buf, (unsigned) n);
         }
 
         if (!reading_stdin)
@@ -155,10 +163,121 @@ int main(int argc, char *argv[])
         }
     }
 
+    free(buf);
     return 0;
 }
 #endif
 
+#ifdef SHA1BENCH
+/*
+ *  main
+ *
+ *  Description:
+ *      SHA-1 kernel check and throughput benchmark. Checks the FIPS
+ *      180-1 test vectors, cross checks the accelerated kernel against
+ *      the portable one over random lengths and splits, then reports
+ *      GB/s for both. Optional argument is the buffer size in MB.
+ *
+ */
+#include <time.h>
+
+static double bench(const unsigned char *buf, size_t len, unsigned *md)
+{
+    SHA1Context     sha;
+    struct timespec t0, t1;
+    double          secs;
+    size_t          off;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    SHA1Reset(&sha);
+    for(off = 0; off < len; off += SHA1_BUFFER_SIZE)
+    {
+        SHA1Input(&sha, buf + off, (unsigned)
+                  (len - off < SHA1_BUFFER_SIZE ? len - off
+                                                : SHA1_BUFFER_SIZE));
+    }
+    SHA1Result(&sha);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    memcpy(md, sha.Message_Digest, sizeof(sha.Message_Digest));
+    secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    return len / secs / 1e9;
+}
+
+static void digest(const unsigned char *p, size_t len, size_t cut,
+                   unsigned *md)
+{
+    SHA1Context sha;
+
+    SHA1Reset(&sha);
+    SHA1Input(&sha, p, (unsigned) cut);
+    SHA1Input(&sha, p + cut, (unsigned) (len - cut));
+    SHA1Result(&sha);
+    memcpy(md, sha.Message_Digest, sizeof(sha.Message_Digest));
+}
+
+int main(int argc, char *argv[])
+{
+    const char *fips = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    const unsigned fipsmd[5] =
+        { 0x84983E44, 0x1C3BD26E, 0xBAAE4AA1, 0xF95129E5, 0xE54670F1 };
+    size_t      len = 64;
+    unsigned char *buf;
+    unsigned    md[5], ref[5];
+    const char *accel;
+    int         bad = 0;
+    int         i;
+
+    if (argc > 1)
+    {
+        len = strtoul(argv[1], NULL, 10);
+    }
+    len *= 1024 * 1024;
+    if (!(buf = malloc(len)))
+    {
+        fprintf(stderr, "sha1bench: out of memory\n");
+        return 2;
+    }
+    srand(1);
+    for(i = 0; i < (int) len; i++)
+    {
+        buf[i] = (unsigned char) rand();
+    }
+
+    accel = SHA1Implementation();
+    digest((const unsigned char *) fips, strlen(fips), 5, md);
+    bad |= memcmp(md, fipsmd, sizeof(md)) != 0;
+    for(i = 0; i < 2000; i++)
+    {
+        size_t n = rand() % 4096;
+        size_t cut = n ? rand() % n : 0;
+
+        SHA1UseGeneric(1);
+        digest(buf, n, cut, ref);
+        SHA1UseGeneric(0);
+        digest(buf, n, cut, md);
+        if (memcmp(md, ref, sizeof(md)))
+        {
+            fprintf(stderr, "mismatch len=%zu cut=%zu\n", n, cut);
+            bad = 1;
+        }
+    }
+    printf("check %s (dispatch uses %s)\n", bad ? "FAILED" : "ok", accel);
+
+    SHA1UseGeneric(1);
+    printf("generic %6.2f GB/s", bench(buf, len, ref));
+    printf("  SHA1 = %08X %08X %08X %08X %08X\n",
+           ref[0], ref[1], ref[2], ref[3], ref[4]);
+    SHA1UseGeneric(0);
+    printf("%-7s %6.2f GB/s", accel, bench(buf, len, md));
+    printf("  SHA1 = %08X %08X %08X %08X %08X\n",
+           md[0], md[1], md[2], md[3], md[4]);
+    bad |= memcmp(md, ref, sizeof(md)) != 0;
+
+    free(buf);
+    return bad;
+}
+#endif
+
 /*  
  *  usage
  *
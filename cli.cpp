@@ -41,9 +41,11 @@
 // #include <iostream>
 #include "cli.h"
 #include "beacon.h"
+#include "fec.h"
 #include "fileio.h"
 #include "globals.h"
 #include "ip.h"
+#include "kiss.h"
 #include "request.h"
 #include "sarflags.h"
 #include "screen.h"
@@ -128,6 +130,157 @@ cmd::cmd_exit()
 
 // Set cli flags for beacons
 // return whether to run the beacons or not
+// The radio is half duplex, we take turns with the peer
+bool
+cmd::cmd_airtime()
+{
+  cmds c;
+
+  if (_args.size() == 1) {
+    if (c_airtime.state() && !ax25ports.empty())
+      scr.info(ax25ports.front().print());
+    else
+      scr.info(c_airtime.print());
+    return (true);
+  }
+  if (_args.size() == 2 && _args[1] == "?") {
+    scr.info(c.usage("airtime"));
+    return (true);
+  }
+  if (_args.size() == 2 && _args[1] == "off") {
+    c_airtime.off();
+    scr.info(c_airtime.print());
+    return (true);
+  }
+  if ((_args.size() == 2 && isuint(_args[1])) ||
+      (_args.size() == 3 && isuint(_args[1]) && isuint(_args[2]))) {
+    int baud = std::stoi(_args[1]);
+    if (baud == 0) {
+      scr.error("airtime: Invalid baud rate %s", _args[1].c_str());
+      return (true);
+    }
+    c_airtime.on(baud, (_args.size() == 3) ? std::stol(_args[2]) : 300);
+    scr.info(c_airtime.print());
+    return (true);
+  }
+  scr.info(c.usage("airtime"));
+  return (false);
+}
+
+// Ports are opened at startup, so these go in saratoga.conf
+bool
+cmd::cmd_ax25port()
+{
+  cmds c;
+  cli_ax25port::port p;
+  uint8_t addr[7];
+  size_t i;
+
+  if (_args.size() == 1) {
+    if (ax25ports.empty())
+      scr.info(c_ax25port.print());
+    for (i = 0; i < ax25ports.size(); i++)
+      scr.info(ax25ports[i].print());
+    return (true);
+  }
+  if (_args.size() == 2 && _args[1] == "?") {
+    scr.info(c.usage("ax25port"));
+    return (true);
+  }
+  if (_args.size() == 2 && _args[1] == "off") {
+    c_ax25port.off();
+    scr.info(c_ax25port.print());
+    return (true);
+  }
+  p.axport = "";
+  p.device = "";
+  p.call = "";
+  p.baud = 0;
+  p.airbaud = 0;
+  p.txdelay = 300;
+  if (_args[1] == "kiss") {
+    if (_args.size() < 4) {
+      scr.info(c.usage("ax25port"));
+      return (false);
+    }
+    if (!sarnet::kiss::aton(_args[3], addr)) {
+      scr.error("ax25port: Invalid callsign %s", _args[3].c_str());
+      return (true);
+    }
+    p.device = _args[2];
+    p.call = _args[3];
+    i = 4;
+    if (i < _args.size() && isuint(_args[i]))
+      p.baud = std::stoi(_args[i++]);
+  } else {
+    p.axport = _args[1];
+    i = 2;
+  }
+  if (i + 1 < _args.size() && _args[i] == "airtime" && isuint(_args[i + 1])) {
+    p.airbaud = std::stoi(_args[i + 1]);
+    i += 2;
+    if (i < _args.size() && isuint(_args[i]))
+      p.txdelay = std::stol(_args[i++]);
+  }
+  if (i != _args.size()) {
+    scr.info(c.usage("ax25port"));
+    return (false);
+  }
+  if (!c_ax25port.add(p)) {
+    scr.error("ax25port: There is a port %s already",
+              cli_ax25port::name(p).c_str());
+    return (true);
+  }
+  scr.info(c_ax25port.print());
+  return (true);
+}
+
+// Set before the ports open it applies once they are, after it moves the
+// station there now
+bool
+cmd::cmd_ax25route()
+{
+  cmds c;
+  uint8_t addr[7];
+
+  if (_args.size() == 1) {
+    scr.info(c_ax25port.print());
+    for (std::map<string, sarnet::datalink*>::iterator r = ax25routes.begin();
+         r != ax25routes.end(); r++)
+      scr.info("%s on %s", r->first.c_str(), r->second->print().c_str());
+    return (true);
+  }
+  if (_args.size() == 2 && _args[1] == "?") {
+    scr.info(c.usage("ax25route"));
+    return (true);
+  }
+  if (_args.size() == 3) {
+    string call = _args[1];
+    for (size_t i = 0; i < call.length(); i++)
+      call[i] = toupper(call[i]);
+    if (!sarnet::kiss::aton(call, addr)) {
+      scr.error("ax25route: Invalid callsign %s", _args[1].c_str());
+      return (true);
+    }
+    c_ax25port.route(call, _args[2]);
+    if (!ax25ports.empty()) {
+      size_t i;
+      for (i = 0; i < ax25ports.size(); i++)
+        if (ax25ports[i].name() == _args[2])
+          break;
+      if (i == ax25ports.size()) {
+        scr.error("ax25route: No AX.25 port %s", _args[2].c_str());
+        return (true);
+      }
+      ax25reroute(call, ax25ports[i].link());
+    }
+    scr.info(c_ax25port.print());
+    return (true);
+  }
+  scr.info(c.usage("ax25route"));
+  return (false);
+}
+
 bool
 cmd::cmd_beacon()
 {
@@ -239,6 +392,30 @@ cmd::cmd_checksum()
   return (true);
 }
 
+bool
+cmd::cmd_csumcache()
+{
+  cmds c;
+
+  if (_args.size() == 2 && _args[1] == "?") {
+    scr.info(c.usage("csumcache"));
+    return (true);
+  }
+  if (_args.size() == 2) {
+    if (_args[1] == "off")
+      sarcsums.memonly();
+    else if (_args[1] == "clear")
+      sarcsums.clear();
+    else if (!sarcsums.load(_args[1]))
+      return (false);
+  } else if (_args.size() > 2) {
+    scr.error(c.usage("csumcache"));
+    return (false);
+  }
+  scr.info(sarcsums.print());
+  return (true);
+}
+
 bool
 cmd::cmd_debug()
 {
@@ -275,6 +452,60 @@ cmd::cmd_debug()
   return (true);
 }
 
+bool
+cmd::cmd_compress()
+{
+  cmds c;
+
+  if (_args.size() == 1) {
+    scr.info(c_compress.print());
+    return (true);
+  }
+  if (_args.size() == 2 && _args[1] == "?") {
+    scr.info(c.usage("compress"));
+    return (true);
+  }
+  if (_args.size() == 2 && _args[1] == "on") {
+    c_compress.on();
+    scr.info(c_compress.print());
+    return (true);
+  }
+  if (_args.size() == 2 && _args[1] == "off") {
+    c_compress.off();
+    scr.info(c_compress.print());
+    return (true);
+  }
+  scr.info(c.usage("compress"));
+  return (false);
+}
+
+bool
+cmd::cmd_delta()
+{
+  cmds c;
+
+  if (_args.size() == 1) {
+    scr.info(c_delta.print());
+    return (true);
+  }
+  if (_args.size() == 2 && _args[1] == "?") {
+    scr.info(c.usage("delta"));
+    return (true);
+  }
+  if (_args.size() == 2 && _args[1] == "on") {
+    c_delta.on();
+    scr.info(c_delta.print());
+    return (true);
+  }
+  if (_args.size() == 2 && _args[1] == "off") {
+    c_delta.off();
+    scr.info(c_delta.print());
+    return (true);
+  }
+  scr.info(c.usage("delta"));
+  return (false);
+}
+
 bool
 cmd::cmd_descriptor()
 {
@@ -354,6 +585,48 @@ cmd::cmd_eid()
 }
 
 // List current local files that are open and mode
+bool
+cmd::cmd_fec()
+{
+  cmds c;
+
+  std::string::size_type sz; // needed for stoi
+  if (_args.size() == 1) {
+    scr.info(c_fec.print());
+    return (true);
+  }
+  if (_args.size() == 2 && _args[1] == "?") {
+    scr.info(c.usage("fec"));
+    return (true);
+  }
+  if (_args.size() == 2 && _args[1] == "off") {
+    c_fec.off();
+    scr.info(c_fec.print());
+    return (true);
+  }
+  if (_args.size() == 3 && isuint(_args[1]) &&
+      (_args[2] == "auto" || isuint(_args[2]))) {
+    int n = std::stoi(_args[1], &sz);
+    int k = (_args[2] == "auto") ? 1 : std::stoi(_args[2], &sz);
+    if (n < 2 || n > (int)saratoga::fecencoder::maxn || k < 1 ||
+        k > (int)saratoga::fecencoder::maxk || k > n) {
+      scr.error("FEC needs 2 to %d data frames and 1 to %d repairs, no more "
+                "than the data frames",
+                (int)saratoga::fecencoder::maxn,
+                (int)saratoga::fecencoder::maxk);
+      return (true);
+    }
+    if (_args[2] == "auto")
+      c_fec.autok(n);
+    else
+      c_fec.on(n, k);
+    scr.info(c_fec.print());
+    return (true);
+  }
+  scr.info(c.usage("fec"));
+  return (false);
+}
+
 bool
 cmd::cmd_files()
 {
@@ -521,6 +794,42 @@ cmd::cmd_home()
   return (true);
 }
 
+bool
+cmd::cmd_kiss()
+{
+  cmds c;
+  uint8_t addr[7];
+
+  if (_args.size() == 1) {
+    if (c_kiss.state() && !ax25ports.empty())
+      scr.info(ax25ports.front().print());
+    else
+      scr.info(c_kiss.print());
+    return (true);
+  }
+  if (_args.size() == 2 && _args[1] == "?") {
+    scr.info(c.usage("kiss"));
+    return (true);
+  }
+  if (_args.size() == 2 && _args[1] == "off") {
+    c_kiss.off();
+    scr.info(c_kiss.print());
+    return (true);
+  }
+  if ((_args.size() == 3 || (_args.size() == 4 && isuint(_args[3])))) {
+    if (!sarnet::kiss::aton(_args[2], addr)) {
+      scr.error("kiss: Invalid callsign %s", _args[2].c_str());
+      return (true);
+    }
+    c_kiss.on(_args[1], _args[2],
+              (_args.size() == 4) ? std::stoi(_args[3]) : 0);
+    scr.info(c_kiss.print());
+    return (true);
+  }
+  scr.info(c.usage("kiss"));
+  return (false);
+}
+
 bool
 cmd::cmd_ls()
 {
@@ -575,6 +884,86 @@ cmd::cmd_maxbuff()
   return (false);
 }
 
+bool
+cmd::cmd_mput()
+{
+  cmds c;
+  size_t a = 1;
+
+  std::string::size_type sz; // needed for stoi
+  c_mput.ready(false);
+  if (_args.size() == 2 && _args[1] == "?") {
+    scr.info(c.usage("mput"));
+    return (true);
+  }
+  c_mput.zap();
+  if (a < _args.size() && (_args[a] == "v4" || _args[a] == "v6"))
+    c_mput.v6(_args[a++] == "v6");
+  if (a < _args.size() && _args[a] == "nak") {
+    c_mput.nak(true);
+    a++;
+  }
+  // No symbols to send extra of when the receivers NAK
+  if (a == _args.size() || _args.size() - a > (c_mput.nak() ? 1 : 2) ||
+      (_args.size() - a == 2 && !isuint(_args[a + 1]))) {
+    scr.info(c.usage("mput"));
+    return (true);
+  }
+  if (_args.size() - a == 2) {
+    int extra = std::stoi(_args[a + 1], &sz);
+    if (extra > 100) {
+      scr.error("No more than 100%% extra symbols");
+      return (true);
+    }
+    c_mput.extra(extra);
+  }
+  c_mput.fname(_args[a]);
+  // If our first character is / or ./ then local file name is absolute
+  // If not then it is within the c_home directory
+  if (_args[a].find("/") == 0 || _args[a].find("./") == 0)
+    c_mput.localfname(_args[a]);
+  else
+    c_mput.localfname(c_home.dir() + "/" + _args[a]);
+  c_mput.ready(true);
+  return (true);
+}
+
+bool
+cmd::cmd_multipath()
+{
+  cmds c;
+
+  if (_args.size() == 1) {
+    scr.info(c_multipath.print());
+    return (true);
+  }
+  if (_args.size() == 2 && _args[1] == "?") {
+    scr.info(c.usage("multipath"));
+    return (true);
+  }
+  if (_args.size() == 2 && _args[1] == "off") {
+    c_multipath.off();
+    scr.info(c_multipath.print());
+    return (true);
+  }
+  if (_args.size() >= 3) {
+    std::vector<sarnet::ip> addrs;
+    for (size_t i = 1; i < _args.size(); i++) {
+      sarnet::ip isip(_args[i]);
+      if (!isip.isv4() && !isip.isv6() && isip.family() != AF_AX25) {
+        scr.error("multipath: Invalid peer %s", _args[i].c_str());
+        return (true);
+      }
+      addrs.push_back(isip);
+    }
+    c_multipath.add(addrs);
+    scr.info(c_multipath.print());
+    return (true);
+  }
+  scr.info(c.usage("multipath"));
+  return (false);
+}
+
 bool
 cmd::cmd_pinfo()
 {
@@ -1480,6 +1869,156 @@ cli_multicast::print()
   return ("Multicast Disabled");
 }
 
+string
+cli_delta::print()
+{
+  if (this->state() == true)
+    return ("Delta Transfers Enabled");
+  return ("Delta Transfers Disabled");
+}
+
+string
+cli_compress::print()
+{
+  if (this->state() == true)
+    return ("Compressed Transfers Enabled");
+  return ("Compressed Transfers Disabled");
+}
+
+string
+cli_fec::print()
+{
+  char tmp[128];
+
+  if (!this->state())
+    return ("FEC Disabled");
+  if (this->isauto())
+    sprintf(tmp, "FEC Enabled for every %d DATA frames, repairs follow loss",
+            _n);
+  else
+    sprintf(tmp, "FEC Enabled %d repair frames for every %d DATA frames", _k,
+            _n);
+  return (string(tmp));
+}
+
+string
+cli_kiss::print()
+{
+  char tmp[256];
+
+  if (!this->state())
+    return ("KISS TNC Disabled");
+  if (_baud != 0)
+    sprintf(tmp, "KISS TNC on %s at %d baud as %s", _device.c_str(), _baud,
+            _call.c_str());
+  else
+    sprintf(tmp, "KISS TNC on %s as %s", _device.c_str(), _call.c_str());
+  return (string(tmp));
+}
+
+string
+cli_airtime::print()
+{
+  char tmp[128];
+
+  if (!this->state())
+    return ("Airtime Disabled");
+  sprintf(tmp, "Airtime half duplex at %d baud, %ld ms key up", _baud,
+          _txdelay);
+  return (string(tmp));
+}
+
+void
+cli_multipath::add(std::vector<sarnet::ip>& addrs)
+{
+  std::vector<string> node;
+
+  for (size_t i = 0; i < addrs.size(); i++) {
+    node.push_back(addrs[i].straddr());
+    std::vector<string> in = this->paths(node.back());
+    if (!in.empty())
+      _nodes.remove(in);
+  }
+  _nodes.push_back(node);
+}
+
+std::vector<string>
+cli_multipath::paths(const string& addr)
+{
+  sarnet::ip a(addr);
+  string s = a.straddr();
+
+  for (std::list<std::vector<string> >::iterator n = _nodes.begin();
+       n != _nodes.end(); n++)
+    for (size_t i = 0; i < n->size(); i++)
+      if ((*n)[i] == s)
+        return (*n);
+  return (std::vector<string>());
+}
+
+bool
+cli_multipath::same(const string& a, const string& b)
+{
+  std::vector<string> node = this->paths(a);
+  sarnet::ip ib(b);
+  string s = ib.straddr();
+
+  for (size_t i = 0; i < node.size(); i++)
+    if (node[i] == s)
+      return (true);
+  return (false);
+}
+
+string
+cli_multipath::print()
+{
+  string s;
+
+  if (!this->state())
+    return ("Multipath Disabled");
+  s = "Multipath peers:";
+  for (std::list<std::vector<string> >::iterator n = _nodes.begin();
+       n != _nodes.end(); n++) {
+    s += "\n ";
+    for (size_t i = 0; i < n->size(); i++)
+      s += " " + (*n)[i];
+  }
+  return (s);
+}
+
+string
+cli_ax25port::print()
+{
+  char tmp[256];
+  string s;
+
+  if (!this->state())
+    s = "AX.25 port from kiss or axports";
+  for (size_t i = 0; i < _ports.size(); i++) {
+    const port& p = _ports[i];
+    if (i > 0)
+      s += "\n";
+    if (p.axport != "")
+      sprintf(tmp, "AX.25 port %s", p.axport.c_str());
+    else if (p.baud != 0)
+      sprintf(tmp, "AX.25 port KISS TNC on %s at %d baud as %s",
+              p.device.c_str(), p.baud, p.call.c_str());
+    else
+      sprintf(tmp, "AX.25 port KISS TNC on %s as %s", p.device.c_str(),
+              p.call.c_str());
+    s += tmp;
+    if (p.airbaud != 0) {
+      sprintf(tmp, ", half duplex at %d baud, %ld ms key up", p.airbaud,
+              p.txdelay);
+      s += tmp;
+    }
+  }
+  for (std::map<string, string>::iterator r = _routes.begin();
+       r != _routes.end(); r++)
+    s += "\n" + r->first + " by " + r->second;
+  return (s);
+}
+
 string
 cli_prompt::print()
 {
@@ -48,6 +48,7 @@
 #include <cstring>
 #include <iostream>
 #include <list>
+#include <map>
 #include <string>
 #include <sys/types.h>
 #include <vector>
@@ -448,6 +449,59 @@ public:
   bool execute(); // Run the put
 };
 
+// Multicast a file to whoever is listening on the group, as fountain
+// coded blocks with extra percent more symbols than each one needs
+class cli_mput
+{
+private:
+  bool _ready;        // Are we ready to run the command ?
+  string _fname;      // File name in REQUEST packet
+  string _localfname; // Actual Local File name
+  bool _v6;           // IPv6 group rather than IPv4
+  bool _nak;          // Receivers ask for what they lose, not coded
+  int _extra;         // Percent more symbols than the receivers need
+
+public:
+  static const int defextra = 10;
+
+  cli_mput()
+  {
+    _ready = false;
+    _v6 = false;
+    _nak = false;
+    _extra = defextra;
+  };
+  ~cli_mput() { this->zap(); };
+
+  void v6(bool v) { _v6 = v; };
+  bool v6() { return _v6; };
+  void nak(bool n) { _nak = n; };
+  bool nak() { return _nak; };
+  void extra(int e) { _extra = e; };
+  int extra() { return _extra; };
+  void fname(string s) { _fname = s.substr(s.find_last_of("\\/") + 1); };
+  string fname() { return _fname; };
+  void localfname(string s) { _localfname = s; };
+  string localfname() { return _localfname; };
+
+  void zap()
+  {
+    _fname.clear();
+    _localfname.clear();
+    _v6 = false;
+    _nak = false;
+    _extra = defextra;
+  }
+
+  bool ready() { return _ready; };
+  bool ready(bool state)
+  {
+    _ready = state;
+    return _ready;
+  };
+  bool execute(); // Run the mput
+};
+
 class cli_putrm
 {
 private:
@@ -708,6 +762,196 @@ public:
   string print();
 };
 
+// Send and receive changed files as a delta against the old copy
+class cli_delta
+{
+private:
+  bool _state; // true or false
+public:
+  cli_delta() { _state = false; };
+  ~cli_delta() { _state = false; };
+  void on() { _state = true; };
+  void off() { _state = false; };
+  bool state() { return (_state); };
+  string print();
+};
+
+// Offer to compress the DATA of files we send
+class cli_compress
+{
+private:
+  bool _state; // true or false
+public:
+  cli_compress() { _state = false; };
+  ~cli_compress() { _state = false; };
+  void on() { _state = true; };
+  void off() { _state = false; };
+  bool state() { return (_state); };
+  string print();
+};
+
+// Forward error correction, k REPAIR frames for every n DATA frames
+class cli_fec
+{
+private:
+  int _n;     // DATA frames in a group, 0 is off
+  int _k;     // REPAIR frames for each group
+  bool _auto; // Start k at 1 and follow the loss
+public:
+  cli_fec() { this->off(); };
+  ~cli_fec() { this->off(); };
+  void on(int n, int k)
+  {
+    _n = n;
+    _k = k;
+    _auto = false;
+  };
+  void autok(int n)
+  {
+    _n = n;
+    _k = 1;
+    _auto = true;
+  };
+  void off()
+  {
+    _n = 0;
+    _k = 0;
+    _auto = false;
+  };
+  bool state() { return (_n > 0); };
+  int n() { return (_n); };
+  int k() { return (_k); };
+  bool isauto() { return (_auto); };
+  string print();
+};
+
+// AX.25 through a KISS TNC rather than the kernel, set at startup
+class cli_kiss
+{
+private:
+  string _device; // Serial device or "pty", "" is off
+  string _call;   // Our callsign
+  int _baud;      // 0 leaves the line speed alone
+public:
+  cli_kiss() { this->off(); };
+  ~cli_kiss() { this->off(); };
+  void on(string device, string call, int baud)
+  {
+    _device = device;
+    _call = call;
+    _baud = baud;
+  };
+  void off()
+  {
+    _device = "";
+    _call = "";
+    _baud = 0;
+  };
+  bool state() { return (_device != ""); };
+  string device() { return (_device); };
+  string call() { return (_call); };
+  int baud() { return (_baud); };
+  string print();
+};
+
+class cli_airtime
+{
+private:
+  int _baud;     // Radio data rate, 0 is off
+  long _txdelay; // ms from keying up to the first bit
+public:
+  cli_airtime() { this->off(); };
+  ~cli_airtime() { this->off(); };
+  void on(int baud, long txdelay)
+  {
+    _baud = baud;
+    _txdelay = txdelay;
+  };
+  void off()
+  {
+    _baud = 0;
+    _txdelay = 0;
+  };
+  bool state() { return (_baud != 0); };
+  int baud() { return (_baud); };
+  long txdelay() { return (_txdelay); };
+  string print();
+};
+
+// Addresses that are all the one peer, IPv4, IPv6 or AX.25. DATA we send
+// to it goes over all of them and what comes in on any is the one peer's
+class cli_multipath
+{
+private:
+  std::list<std::vector<string> > _nodes; // As sarnet::ip prints them
+
+public:
+  cli_multipath(){};
+  ~cli_multipath() { this->off(); };
+  // A node's addresses, replacing any node any of them was in
+  void add(std::vector<sarnet::ip>& addrs);
+  void off() { _nodes.clear(); };
+  bool state() { return (!_nodes.empty()); };
+  // All the addresses of the node addr is in, none if it is in none
+  std::vector<string> paths(const string& addr);
+  bool same(const string& a, const string& b);
+  string print();
+};
+
+// AX.25 ports to open at startup, in place of the one from kiss and
+// airtime, and which port to reach a callsign on. A station we hear goes
+// back out the port it was heard on unless its route is set here
+class cli_ax25port
+{
+public:
+  struct port
+  {
+    string axport; // From axports, "" for a KISS TNC
+    string device; // KISS serial device or "pty"
+    string call;   // Our callsign on the KISS TNC
+    int baud;      // KISS line speed, 0 leaves it alone
+    int airbaud;   // Half duplex radio data rate, 0 is full duplex
+    long txdelay;  // ms from keying up to the first bit
+  };
+
+private:
+  std::vector<port> _ports;
+  std::map<string, string> _routes; // Callsign to port name
+
+public:
+  cli_ax25port(){};
+  ~cli_ax25port() { this->off(); };
+  // False if there is a port of that name already, ax25route could not
+  // tell them apart
+  bool add(const port& p)
+  {
+    for (size_t i = 0; i < _ports.size(); i++)
+      if (name(_ports[i]) == name(p))
+        return (false);
+    _ports.push_back(p);
+    return (true);
+  };
+  void off()
+  {
+    _ports.clear();
+    _routes.clear();
+  };
+  bool state() { return (!_ports.empty()); };
+  const std::vector<port>& ports() { return (_ports); };
+  // A port by its name in saratoga.conf, its axport or device
+  static string name(const port& p)
+  {
+    return ((p.axport != "") ? p.axport : p.device);
+  };
+  void route(const string& call, const string& port)
+  {
+    _routes[call] = port;
+  };
+  bool routed(const string& call) { return (_routes.count(call) > 0); };
+  const std::map<string, string>& routes() { return (_routes); };
+  string print();
+};
+
 class cli_prompt
 {
 private:
@@ -739,11 +983,18 @@ private:
 public:
   // These are the command line handlers for each function
   bool cmd_help();
+  bool cmd_airtime();
+  bool cmd_ax25port();
+  bool cmd_ax25route();
   bool cmd_beacon();
   bool cmd_checksum();
+  bool cmd_compress();
+  bool cmd_csumcache();
   bool cmd_debug();
+  bool cmd_delta();
   bool cmd_descriptor();
   bool cmd_exit();
+  bool cmd_fec();
   bool cmd_eid();
   bool cmd_files();
   bool cmd_freespace();
@@ -751,8 +1002,11 @@ public:
   bool cmd_getrm();
   bool cmd_history();
   bool cmd_home();
+  bool cmd_kiss();
   bool cmd_ls();
   bool cmd_maxbuff();
+  bool cmd_mput();
+  bool cmd_multipath();
   bool cmd_pinfo();
   bool cmd_peers();
   bool cmd_prompt();
@@ -809,19 +1063,37 @@ class cmds
 private:
   // #define NCMDS (sizeof(_clist) / sizeof(cmd))
 
-  const static int _ncmds = 32;
+  const static int _ncmds = 42;
 
   cmd _clist[_ncmds] = {
     { "?", "", "show valid commands. cmd ? show usage", &cmd::cmd_help },
+    { "airtime", "airtime [off|<baud> [<txdelay ms>]]",
+      "half duplex airtime model for the AX.25 radio link, set at startup",
+      &cmd::cmd_airtime },
+    { "ax25port",
+      "ax25port [off|<axport>|kiss <device|pty> <callsign> [<baud>]] "
+      "[airtime <baud> [<txdelay ms>]]",
+      "add an AX.25 port, set at startup", &cmd::cmd_ax25port },
+    { "ax25route", "ax25route [<callsign> <axport>|<device>]",
+      "which AX.25 port a callsign is reached on", &cmd::cmd_ax25route },
     { "beacon", "beacon [off] [v4|v6|<ip>...] [secs]",
       "send a beacon every secs", &cmd::cmd_beacon },
     { "checksum", "checksum [off|none|crc32|md5|sha1]",
       "set checksums required and type", &cmd::cmd_checksum },
+    { "compress", "compress [on|off]",
+      "offer to compress the data of files we send", &cmd::cmd_compress },
+    { "csumcache", "csumcache [off|clear|<filename>]",
+      "keep checksums of sent files in memory or a file",
+      &cmd::cmd_csumcache },
     { "debug", "debug [off|0..9]", "set debug level 0..9", &cmd::cmd_debug },
+    { "delta", "delta [on|off]",
+      "send only the changes to files the peer already has", &cmd::cmd_delta },
     { "descriptor", "descriptor [off|16|32|64|128]",
       "advertise & set default descriptor size", &cmd::cmd_descriptor },
     { "eid", "eid [off] <eid>", "manually set the eid", &cmd::cmd_eid },
     { "exit", "exit [0|1]", "exit saratoga", &cmd::cmd_exit },
+    { "fec", "fec [off|<n> <k>|<n> auto]",
+      "send k repair frames for every n data frames", &cmd::cmd_fec },
     { "files", "files", "List local files currently open and mode",
       &cmd::cmd_files },
     { "freespace", "freespace [off|on]", "do we advertise freespace",
@@ -833,10 +1105,19 @@ private:
     { "history", "history", "show command history", &cmd::cmd_history },
     { "home", "home <dirname>", "Set home directory for transfers",
       &cmd::cmd_home },
+    { "kiss", "kiss [off|<device>|pty <callsign> [<baud>]]",
+      "AX.25 through a KISS TNC on a serial device or a pty, set at startup",
+      &cmd::cmd_kiss },
     { "ls", "ls <peer> [<dirname>]", "Get a directory listing from a peer",
       &cmd::cmd_ls },
     { "maxbuff", "maxbuff [<length>]", "Set maximum file read buffer length",
       &cmd::cmd_maxbuff },
+    { "mput", "mput [v4|v6] [nak] <filename> [<extra%>]",
+      "Multicast a file fountain coded, or repairing what receivers NAK",
+      &cmd::cmd_mput },
+    { "multipath", "multipath [off|<peer> <peer>...]",
+      "addresses of one peer, DATA to it is striped over all of them",
+      &cmd::cmd_multipath },
     { "pinfo", "pinfo", "List peer information", &cmd::cmd_pinfo },
     { "peers", "peers [remove] [<ip>...]", "List peers or Add/Remove peer(s)",
       &cmd::cmd_peers },
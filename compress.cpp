@@ -0,0 +1,118 @@
+/*
+
+ Copyright (c) 2011, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <zlib.h>
+
+#include "compress.h"
+#include "globals.h"
+
+using namespace std;
+
+namespace saratoga {
+
+// Raw deflate, a DATA frame has no room for a zlib header or trailer
+static const int zwindow = -15;
+
+zblock::zblock(int level)
+{
+  memset(&_def, 0, sizeof(_def));
+  memset(&_inf, 0, sizeof(_inf));
+  _defok = (deflateInit2(&_def, level, Z_DEFLATED, zwindow, 8,
+                         Z_DEFAULT_STRATEGY) == Z_OK);
+  _infok = (inflateInit2(&_inf, zwindow) == Z_OK);
+  if (_defok)
+    _out.resize(deflateBound(&_def, maxblock));
+}
+
+zblock::~zblock()
+{
+  if (_defok)
+    deflateEnd(&_def);
+  if (_infok)
+    inflateEnd(&_inf);
+}
+
+size_t
+zblock::compress(const char* buf, size_t len, char* out, size_t outlen)
+{
+  if (!_defok || len == 0 || len > maxblock)
+    return 0;
+  if (deflateReset(&_def) != Z_OK)
+    return 0;
+  _def.next_in = (Bytef*)buf;
+  _def.avail_in = (uInt)len;
+  _def.next_out = (Bytef*)&_out[0];
+  _def.avail_out = (uInt)_out.size();
+  if (deflate(&_def, Z_FINISH) != Z_STREAM_END)
+    return 0;
+  size_t zlen = hdrlen + _def.total_out;
+  if (zlen > outlen)
+    return zlen;
+  uint16_t ulen = htons((uint16_t)len);
+  memcpy(out, &ulen, hdrlen);
+  memcpy(out + hdrlen, &_out[0], _def.total_out);
+  return zlen;
+}
+
+ssize_t
+zblock::expand(const char* buf, size_t len, char* out, size_t outlen)
+{
+  uint16_t ulen;
+
+  if (!_infok || len <= hdrlen)
+    return -1;
+  memcpy(&ulen, buf, hdrlen);
+  ulen = ntohs(ulen);
+  if (ulen == 0 || ulen > outlen || inflateReset(&_inf) != Z_OK)
+    return -1;
+  _inf.next_in = (Bytef*)buf + hdrlen;
+  _inf.avail_in = (uInt)(len - hdrlen);
+  _inf.next_out = (Bytef*)out;
+  _inf.avail_out = (uInt)ulen;
+  if (inflate(&_inf, Z_FINISH) != Z_STREAM_END || _inf.total_out != ulen) {
+    scr.debug(2, "zblock::expand(): Bad compressed block %s",
+              _inf.msg ? _inf.msg : "");
+    return -1;
+  }
+  return (ssize_t)ulen;
+}
+
+} // Namespace saratoga
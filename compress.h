@@ -0,0 +1,103 @@
+/*
+
+ Copyright (c) 2011, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#ifndef _COMPRESS_H
+#define _COMPRESS_H
+
+#include <cstring>
+#include <inttypes.h>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+#include "saratoga.h"
+
+using namespace std;
+
+namespace saratoga {
+
+/*
+ **********************************************************************
+ * COMPRESS
+ **********************************************************************
+ */
+
+/*
+ * Compressed DATA payloads. Each one is a block of the file deflated on
+ * its own (raw deflate, no zlib header) behind the 16 bit length it
+ * expands to:
+ *	ulen, deflated block
+ * The DATA offset is still the offset in the file, so a frame can be
+ * expanded and written without any of the others and holes are asked
+ * for and resent exactly as they are uncompressed.
+ */
+class zblock
+{
+private:
+  z_stream _def; // Kept and reset between blocks, not set up each time
+  z_stream _inf;
+  bool _defok;
+  bool _infok;
+  vector<char> _out; // Room for the worst a block deflates to
+
+  // The streams cannot be shared so there is no copying
+  zblock(const zblock&);
+  zblock& operator=(const zblock&);
+
+public:
+  // Largest block, the length it expands to has to fit in 16 bits
+  static const size_t maxblock = 65535;
+  static const size_t hdrlen = sizeof(uint16_t);
+
+  zblock(int level = Z_DEFAULT_COMPRESSION);
+  ~zblock();
+
+  // Deflate len bytes of buf and return the length of the payload with
+  // the length in front. It is only put into out if that is no more
+  // than outlen, if not the length says how much smaller to try. 0 if
+  // it cannot be compressed at all
+  size_t compress(const char* buf, size_t len, char* out, size_t outlen);
+
+  // Expand a payload made by compress() into out, which is at least
+  // maxblock long. The expanded length or -1 if it is not valid
+  ssize_t expand(const char* buf, size_t len, char* out, size_t outlen);
+};
+
+} // Namespace saratoga
+
+#endif // _COMPRESS_H
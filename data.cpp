@@ -41,6 +41,7 @@
 #include <string>
 
 #include "data.h"
+#include "dcodec.h"
 #include "frame.h"
 #include "globals.h"
 #include "saratoga.h"
@@ -57,19 +58,9 @@ data::data(const enum f_descriptor& des, const enum f_transfer& tfr,
            const enum f_reqtstamp& ts, const session_t& session,
            const offset_t& offset, const char* dbuf, const size_t& dblen)
 {
-  uint16_t tmp_16;
   uint32_t tmp_32;
-  uint64_t tmp_64;
-#ifdef UINT128_T
-  uint128_t tmp_128;
-#endif
 
-  Fversion version = F_VERSION_1;
-  Fframetype frametype = F_FRAMETYPE_DATA;
   Fdescriptor descriptor = des;
-  Ftransfer transfer = tfr;
-  Freqstatus reqstatus = stat;
-  Feod eod = eodf;
   Freqtstamp reqtstamp = ts;
 
   // Work out how big our frame has to be allocate it
@@ -91,13 +82,7 @@ data::data(const enum f_descriptor& des, const enum f_transfer& tfr,
   // Set and copy flags
   _badframe = false;
 
-  _flags += version;
-  _flags += frametype;
-  _flags += descriptor;
-  _flags += transfer;
-  _flags += reqtstamp;
-  _flags += reqstatus;
-  _flags += eod;
+  _flags = hdr::dataflags(des, tfr, ts, stat, eodf);
 
   tmp_32 = htonl(_flags.get());
   memcpy(dbufp, &tmp_32, sizeof(flag_t));
@@ -111,35 +96,13 @@ data::data(const enum f_descriptor& des, const enum f_transfer& tfr,
 
   // Set and copy offset
   _offset = offset;
-  switch (descriptor.get()) {
-    case F_DESCRIPTOR_16:
-      tmp_16 = htons(_offset);
-      memcpy(dbufp, &tmp_16, sizeof(uint16_t));
-      break;
-    case F_DESCRIPTOR_32:
-      tmp_32 = htonl(_offset);
-      memcpy(dbufp, &tmp_32, sizeof(uint32_t));
-      break;
-    case F_DESCRIPTOR_64:
-      tmp_64 = htonll(_offset);
-      memcpy(dbufp, &tmp_64, sizeof(uint64_t));
-      break;
-    case F_DESCRIPTOR_128:
-#ifdef UINT128_T
-      tmp_128 = htonlll(_offset);
-      memcpy(dbufp, &tmp_128, sizeof(uint128_t));
-      break;
-#else
-      scr.error("data(payload, len): Descriptor 128 Bit Size Not Supported\n");
-      _badframe = true;
-      return;
-#endif
-    default:
-      scr.error("data(payload, len): Invalid Descriptor Size");
-      _badframe = true;
-      return;
+  const dcodecs* dc = dcodecs::lookup(descriptor.get());
+  if (dc == nullptr) {
+    scr.error("data(payload, len): Descriptor 128 Bit Size Not Supported\n");
+    _badframe = true;
+    return;
   }
-  dbufp += descriptor.length();
+  dbufp = dc->put(dbufp, _offset);
 
   // Set and copy the timestamp
   // If we have a timestamp then lets make it by default ZULU time
@@ -197,29 +160,13 @@ data::data(char* payload, size_t paylen)
   paylen -= sizeof(session_t);
 
   // Offset into file/stream
-  switch (descriptor.get()) {
-    case F_DESCRIPTOR_16:
-      _offset = (offset_t)ntohs(*(uint16_t*)payload);
-      break;
-    case F_DESCRIPTOR_32:
-      _offset = (offset_t)ntohl(*(uint32_t*)payload);
-      break;
-    case F_DESCRIPTOR_64:
-      _offset = (offset_t)ntohll(*(uint64_t*)payload);
-      break;
-    case F_DESCRIPTOR_128:
-#ifdef UINT128_T
-      _offset = (offset_t)ntohlll(*(uint128_t*)payload);
-      break;
-#else
-      scr.error("data(frame): Descriptor 128 Bit Size Not Supported\n");
-      _badframe = true;
-      return;
-#endif
-    default:
-      _badframe = true;
-      return;
+  const dcodecs* dc = dcodecs::lookup(descriptor.get());
+  if (dc == nullptr) {
+    scr.error("data(frame): Descriptor 128 Bit Size Not Supported\n");
+    _badframe = true;
+    return;
   }
+  _offset = dc->get(payload);
   payload += descriptor.length();
   paylen -= descriptor.length();
 
@@ -232,8 +179,9 @@ data::data(char* payload, size_t paylen)
     _timestamp = timestamp(); // Place holder
 
   _dbuflen = paylen;
-  // We dont need to copy dbuf we just need to point to it in the payload
-  _dbuf = payload;
+  // We dont need to copy dbuf we just need to point to it in our copy
+  // of the payload, not the callers buffer which may well be reused
+  _dbuf = _payload + (_paylen - paylen);
 }
 
 /*
@@ -260,6 +208,7 @@ data::print()
   Freqtstamp reqtstamp = _flags.get();
   Freqstatus reqstatus = _flags.get();
   Feod eod = _flags.get();
+  Fcompress compress = _flags.get();
 
   s = frametype.print();
   s += printflags("DATA FLAGS", this->flags());
@@ -276,6 +225,8 @@ data::print()
   s += "\n    ";
   s += eod.print();
   s += "\n    ";
+  s += compress.print();
+  s += "\n    ";
 
   sprintf(tmp, "Session: %" PRIu32 "", (uint32_t)_session);
   s += tmp;
@@ -333,6 +284,18 @@ data::reqtstamp(enum f_reqtstamp t)
   return reqtstamp.get();
 }
 
+enum f_compress
+data::compress(enum f_compress c)
+{
+  Fcompress compress = c;
+  _flags += compress;
+  if (_paylen >= sizeof(flag_t)) {
+    uint32_t tmp_32 = htonl(_flags.get());
+    memcpy(_payload, &tmp_32, sizeof(flag_t));
+  }
+  return compress.get();
+}
+
 // Get various flags applicable to data frames
 enum f_descriptor
 data::descriptor()
@@ -369,4 +332,11 @@ data::reqtstamp()
   return t.get();
 }
 
+enum f_compress
+data::compress()
+{
+  Fcompress c = _flags.get();
+  return c.get();
+}
+
 } // Namespace saratoga
@@ -72,7 +72,9 @@ protected:
   char* _payload; // Complete payload of frame
   size_t _paylen; // Length of payload
 public:
-  const static size_t maxframesize = MAXDATA; // Maximum size of a data frame
+  // Maximum size of a data frame, and the size when the link doesn't say
+  const static size_t maxframesize = MAXJUMBODATA;
+  const static size_t defframesize = MAXDATA;
 
   // This is how we assemble a local data
   // To get ready for transmission
@@ -167,6 +169,7 @@ public:
   enum f_reqstatus reqstatus();
   enum f_eod eod();
   enum f_reqtstamp reqtstamp();
+  enum f_compress compress();
 
   // Set various flags applicable to data
   enum f_descriptor descriptor(f_descriptor);
@@ -174,6 +177,8 @@ public:
   enum f_reqstatus reqstatus(f_reqstatus);
   enum f_eod eod(f_eod);
   enum f_reqtstamp reqtstamp(f_reqtstamp);
+  // This one is also written into the assembled frame
+  enum f_compress compress(f_compress);
 
   // What is the session number for this transaction
   session_t session() { return _session; };
@@ -0,0 +1,174 @@
+/*
+
+ Copyright (c) 2011, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#ifndef _DCODEC_H
+#define _DCODEC_H
+
+#include <cstring>
+#include <list>
+#include <string>
+using namespace std;
+
+#include "holes.h"
+#include "saratoga.h"
+#include "sarflags.h"
+
+namespace saratoga {
+/*
+ **********************************************************************
+ * DESCRIPTOR CODECS
+ **********************************************************************
+ */
+
+// Byte swaps to and from network order, these are single instructions
+inline uint16_t
+netorder(uint16_t x)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  return x;
+#else
+  return __builtin_bswap16(x);
+#endif
+}
+
+inline uint32_t
+netorder(uint32_t x)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  return x;
+#else
+  return __builtin_bswap32(x);
+#endif
+}
+
+inline uint64_t
+netorder(uint64_t x)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  return x;
+#else
+  return __builtin_bswap64(x);
+#endif
+}
+
+/*
+ * Encode and decode descriptor sized fields (offsets, progress and
+ * hole pairs). T is the descriptor's integer type so every width
+ * gets its own straight line code, no switch per field.
+ */
+template <typename T>
+struct dcodec
+{
+  static const size_t length = sizeof(T);
+
+  static char* put(char* p, offset_t v)
+  {
+    T tmp = netorder((T)v);
+    memcpy(p, &tmp, sizeof(T));
+    return (p + sizeof(T));
+  };
+
+  static offset_t get(const char* p)
+  {
+    T tmp;
+    memcpy(&tmp, p, sizeof(T));
+    return ((offset_t)netorder(tmp));
+  };
+
+  // Holes go out as start & end pairs
+  static char* putholes(char* p, holes* h)
+  {
+    for (std::list<hole>::iterator i = h->first(); i != h->last(); i++) {
+      p = put(p, i->starts());
+      p = put(p, i->ends());
+    }
+    return p;
+  };
+
+  // Decode n hole pairs into hl, returns how many were valid
+  static size_t getholes(const char* p, size_t n, std::list<hole>& hl)
+  {
+    size_t valid = 0;
+    for (size_t i = 0; i < n; i++, p += 2 * sizeof(T)) {
+      offset_t s = get(p);
+      offset_t e = get(p + sizeof(T));
+      if (e < s)
+        continue;
+      hl.push_back(hole(s, e - s + 1));
+      valid++;
+    }
+    return valid;
+  };
+};
+
+/*
+ * The codec for a descriptor picked at run time. Look it up once with
+ * dcodecs::lookup() and then call through it for the whole frame
+ * or transfer.
+ */
+struct dcodecs
+{
+  size_t length; // # bytes in the descriptor
+  char* (*put)(char*, offset_t);
+  offset_t (*get)(const char*);
+  char* (*putholes)(char*, holes*);
+  size_t (*getholes)(const char*, size_t, std::list<hole>&);
+
+  // nullptr if we do not support the descriptor size (128 bit)
+  static const dcodecs* lookup(enum f_descriptor d)
+  {
+    static const dcodecs codecs[] = {
+      { dcodec<uint16_t>::length, &dcodec<uint16_t>::put,
+        &dcodec<uint16_t>::get, &dcodec<uint16_t>::putholes,
+        &dcodec<uint16_t>::getholes },
+      { dcodec<uint32_t>::length, &dcodec<uint32_t>::put,
+        &dcodec<uint32_t>::get, &dcodec<uint32_t>::putholes,
+        &dcodec<uint32_t>::getholes },
+      { dcodec<uint64_t>::length, &dcodec<uint64_t>::put,
+        &dcodec<uint64_t>::get, &dcodec<uint64_t>::putholes,
+        &dcodec<uint64_t>::getholes },
+    };
+    if (d > F_DESCRIPTOR_64)
+      return nullptr;
+    return &codecs[d];
+  };
+};
+
+} // Namespace saratoga
+
+#endif // _DCODEC_H
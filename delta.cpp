@@ -0,0 +1,296 @@
+/*
+
+ Copyright (c) 2011, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <errno.h>
+#include <iostream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "checksum.h"
+#include "delta.h"
+#include "globals.h"
+#include "saratoga.h"
+#include "screen.h"
+
+using namespace std;
+
+namespace saratoga {
+
+// Blocks no smaller than this or the signatures cost more than they save
+static const uint32_t minblock = 512;
+// and no larger or a small change costs a large resend
+static const uint32_t maxblock = 64 * 1024;
+
+uint32_t
+blocksigs::blocksize(offset_t filesize)
+{
+  uint32_t b = minblock;
+
+  // Round up to the next power of 2 at or past the square root
+  while (b < maxblock && (offset_t)b * b < filesize)
+    b <<= 1;
+  return b;
+}
+
+uint64_t
+blocksigs::strong(const unsigned char* p, size_t len)
+{
+  MD5_CTX ctx;
+  unsigned char digest[16];
+  uint64_t s = 0;
+
+  MD5Init(&ctx);
+  MD5Update(&ctx, (unsigned char*)p, len);
+  MD5Final(digest, &ctx);
+  for (int i = 0; i < 8; i++)
+    s = (s << 8) | digest[i];
+  return s;
+}
+
+void
+blocksigs::start(offset_t filesize)
+{
+  this->clear();
+  _filesize = filesize;
+  _blocksize = blocksize(filesize);
+  _nblocks = (uint32_t)((filesize + _blocksize - 1) / _blocksize);
+  _weak.reserve(_nblocks);
+  _strong.reserve(_nblocks);
+}
+
+void
+blocksigs::update(const char* buf, size_t len)
+{
+  const unsigned char* p = (const unsigned char*)buf;
+  rollsum r;
+
+  while (len > 0 && _got < _nblocks) {
+    size_t n = this->blocklen(_got);
+    if (n > len) {
+      scr.error("blocksigs::update(): Part of block %" PRIu32 " ignored",
+                _got);
+      return;
+    }
+    r.clear();
+    r.update(p, n);
+    _weak.push_back(r.digest());
+    _strong.push_back(strong(p, n));
+    _got++;
+    p += n;
+    len -= n;
+  }
+}
+
+// All three come from the peer, so the block size has to be one that
+// blocksize() could have picked before we size anything by them
+bool
+blocksigs::expect(offset_t filesize, uint32_t bsize, uint32_t nblocks)
+{
+  if (bsize < minblock || bsize > maxblock || (bsize & (bsize - 1)) != 0) {
+    scr.error("blocksigs::expect(): Bad block size %" PRIu32 "", bsize);
+    return false;
+  }
+  if (nblocks == 0 ||
+      (offset_t)(nblocks - 1) * bsize >= filesize ||
+      (offset_t)nblocks * bsize < filesize) {
+    scr.error("blocksigs::expect(): %" PRIu32 " blocks of %" PRIu32
+              " do not make a file of %" PRIu64 "",
+              nblocks, bsize, (uint64_t)filesize);
+    return false;
+  }
+  if (_filesize == filesize && _blocksize == bsize && _nblocks == nblocks)
+    return true;
+  this->clear();
+  _filesize = filesize;
+  _blocksize = bsize;
+  _nblocks = nblocks;
+  _weak.assign(nblocks, 0);
+  _strong.assign(nblocks, 0);
+  _have.assign(nblocks, false);
+  return true;
+}
+
+void
+blocksigs::add(uint32_t i, uint32_t weak, uint64_t strong)
+{
+  if (i >= _nblocks || _have.empty() || _have[i])
+    return;
+  _weak[i] = weak;
+  _strong[i] = strong;
+  _have[i] = true;
+  _got++;
+}
+
+// Fold the 32 bit weak checksum to 16 bits for the quick miss table
+static inline uint32_t
+tag(uint32_t w)
+{
+  return ((w >> 16) ^ w) & 0xffff;
+}
+
+// Add a match, joining it on to the last one if they run on
+static void
+addmatch(std::vector<blockmatch>& found, offset_t to, offset_t from,
+         size_t len)
+{
+  if (!found.empty()) {
+    blockmatch& b = found.back();
+    if (b.to + (offset_t)b.len == to && b.from + (offset_t)b.len == from) {
+      b.len += len;
+      return;
+    }
+  }
+  blockmatch m;
+  m.to = to;
+  m.from = from;
+  m.len = len;
+  found.push_back(m);
+}
+
+// Slide a block sized window over the old file a byte at a time. Where
+// the weak checksum is one of ours confirm it with the strong one and
+// jump a block on, as rsync does. The short last block is only looked
+// for at the end of the old file and where it was in the new one
+size_t
+blocksigs::match(int fd, std::vector<blockmatch>& found) const
+{
+  struct stat sb;
+
+  found.clear();
+  if (!this->complete() || fstat(fd, &sb) < 0 || sb.st_size == 0)
+    return 0;
+  offset_t size = sb.st_size;
+  void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (map == MAP_FAILED) {
+    scr.perror(errno, "blocksigs::match(): Cannot map old file");
+    return 0;
+  }
+  madvise(map, size, MADV_SEQUENTIAL);
+  const unsigned char* p = (const unsigned char*)map;
+
+  // Whole blocks sorted by weak checksum
+  std::vector<std::pair<uint32_t, uint32_t>> index;
+  std::vector<bool> tags(65536, false);
+  for (uint32_t i = 0; i < _nblocks; i++) {
+    if (this->blocklen(i) != _blocksize)
+      continue;
+    index.push_back(std::make_pair(_weak[i], i));
+    tags[tag(_weak[i])] = true;
+  }
+  std::sort(index.begin(), index.end());
+
+  std::vector<bool> matched(_nblocks, false);
+  size_t nmatched = 0;
+  rollsum r;
+  bool fresh = true;
+  offset_t pos = 0;
+  while (!index.empty() && pos + _blocksize <= size) {
+    if (fresh) {
+      r.clear();
+      r.update(p + pos, _blocksize);
+      fresh = false;
+    }
+    uint32_t w = r.digest();
+    bool hit = false;
+    if (tags[tag(w)]) {
+      uint64_t s = 0;
+      bool havestrong = false;
+      std::vector<std::pair<uint32_t, uint32_t>>::iterator i =
+        std::lower_bound(index.begin(), index.end(),
+                         std::make_pair(w, (uint32_t)0));
+      for (; i != index.end() && i->first == w; i++) {
+        if (!havestrong) {
+          s = strong(p + pos, _blocksize);
+          havestrong = true;
+        }
+        if (_strong[i->second] != s)
+          continue;
+        hit = true;
+        // Identical blocks in the new file all come from here
+        if (!matched[i->second]) {
+          matched[i->second] = true;
+          nmatched++;
+          addmatch(found, (offset_t)i->second * _blocksize, pos, _blocksize);
+        }
+      }
+    }
+    if (hit) {
+      pos += _blocksize;
+      fresh = true;
+      continue;
+    }
+    if (pos + _blocksize < size)
+      r.rotate(p[pos], p[pos + _blocksize]);
+    pos++;
+  }
+
+  uint32_t last = _nblocks - 1;
+  size_t lastlen = this->blocklen(last);
+  if (lastlen < _blocksize && !matched[last]) {
+    offset_t at[2] = { size - (offset_t)lastlen, (offset_t)last * _blocksize };
+    for (int i = 0; i < 2; i++) {
+      if ((offset_t)lastlen > size || at[i] + (offset_t)lastlen > size)
+        continue;
+      r.clear();
+      r.update(p + at[i], lastlen);
+      if (r.digest() != _weak[last] || strong(p + at[i], lastlen) != _strong[last])
+        continue;
+      addmatch(found, (offset_t)last * _blocksize, at[i], lastlen);
+      nmatched++;
+      break;
+    }
+  }
+  munmap(map, size);
+  return nmatched;
+}
+
+string
+blocksigs::print() const
+{
+  char tmp[128];
+
+  sprintf(tmp, "Signatures %" PRIu32 " of %" PRIu32 " blocks of %" PRIu32
+               " bytes for %" PRIu64 " bytes",
+          _got, _nblocks, _blocksize, (uint64_t)_filesize);
+  return (string(tmp));
+}
+
+} // Namespace saratoga
@@ -0,0 +1,182 @@
+/*
+
+ Copyright (c) 2011, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#ifndef _DELTA_H
+#define _DELTA_H
+
+#include <cstring>
+#include <inttypes.h>
+#include <string>
+#include <vector>
+
+#include "saratoga.h"
+
+using namespace std;
+
+namespace saratoga {
+
+/*
+ **********************************************************************
+ * DELTA
+ **********************************************************************
+ */
+
+// rsync's weak checksum, two running sums that can be slid along a
+// byte at a time so every offset of the old file can be tried cheaply
+class rollsum
+{
+private:
+  static const uint32_t _offs = 31; // Keeps runs of zeros from summing to 0
+  uint32_t _a;
+  uint32_t _b;
+  size_t _n; // Bytes in the window
+
+public:
+  rollsum() { this->clear(); };
+
+  void clear()
+  {
+    _a = 0;
+    _b = 0;
+    _n = 0;
+  };
+
+  void update(const unsigned char* p, size_t len)
+  {
+    for (size_t i = 0; i < len; i++) {
+      _a += p[i] + _offs;
+      _b += _a;
+    }
+    _n += len;
+  };
+
+  // Drop out from the front of the window and add in at the back
+  void rotate(unsigned char out, unsigned char in)
+  {
+    _a += in - out;
+    _b += _a - _n * (out + _offs);
+  };
+
+  uint32_t digest() const { return ((_b << 16) | (_a & 0xffff)); };
+};
+
+// A block of the new file found in the old one
+struct blockmatch
+{
+  offset_t to;   // Offset in the new file
+  offset_t from; // Offset in the old file
+  size_t len;
+};
+
+/*
+ * The block signatures of a file, a weak rolling checksum and the
+ * first 8 bytes of the MD5 of each block. The sender works them out
+ * as it reads its file, the receiver collects them from SIGNATURE
+ * frames and looks for the blocks in its old copy
+ */
+class blocksigs
+{
+private:
+  offset_t _filesize;
+  uint32_t _blocksize;
+  uint32_t _nblocks;
+  std::vector<uint32_t> _weak;
+  std::vector<uint64_t> _strong;
+  std::vector<bool> _have; // Which signatures have arrived
+  uint32_t _got;           // and how many
+
+public:
+  blocksigs() { this->clear(); };
+  ~blocksigs() { this->clear(); };
+
+  void clear()
+  {
+    _filesize = 0;
+    _blocksize = 0;
+    _nblocks = 0;
+    _weak.clear();
+    _strong.clear();
+    _have.clear();
+    _got = 0;
+  };
+
+  // Block size to use for a file, about the square root of its size
+  static uint32_t blocksize(offset_t);
+
+  // First 8 bytes of the MD5 of a block
+  static uint64_t strong(const unsigned char*, size_t);
+
+  // Sending, start on a file of the size
+  void start(offset_t);
+  // and work out the signatures of the next blocks read from it.
+  // The length is whole blocks except at the end of the file
+  void update(const char*, size_t);
+
+  // Receiving, get ready for the signatures of a file and add them
+  // as they arrive
+  bool expect(offset_t, uint32_t, uint32_t);
+  void add(uint32_t, uint32_t, uint64_t);
+
+  bool empty() const { return _nblocks == 0; };
+  bool complete() const { return _nblocks > 0 && _got == _nblocks; };
+
+  offset_t filesize() const { return _filesize; };
+  uint32_t blocksize() const { return _blocksize; };
+  uint32_t nblocks() const { return _nblocks; };
+  uint32_t count() const { return _got; };
+  uint32_t weak(uint32_t i) const { return _weak[i]; };
+  uint64_t strong(uint32_t i) const { return _strong[i]; };
+
+  // Length of block i, the last one may be short
+  size_t blocklen(uint32_t i) const
+  {
+    if (i + 1 < _nblocks)
+      return _blocksize;
+    return (size_t)(_filesize - (offset_t)i * _blocksize);
+  };
+
+  // Find the blocks in the open old copy of the file. Blocks next to
+  // each other in both files come back as one match
+  size_t match(int, std::vector<blockmatch>&) const;
+
+  string print() const;
+};
+
+} // Namespace saratoga
+
+#endif // _DELTA_H
@@ -93,6 +93,17 @@ cli_beacon::timerexpired()
   return (false);
 }
 
+// Is a transfer going over this AX.25 port, the air is better spent on it
+static bool
+ax25busy(sarnet::datalink* l)
+{
+  for (std::list<tran>::iterator tr = sartransfers.begin();
+       tr != sartransfers.end(); tr++)
+    if (tr->peer() != nullptr && tr->peer()->link() == l)
+      return (true);
+  return (false);
+}
+
 /*
  * Send beacons out
  */
@@ -106,12 +117,18 @@ cli_beacon::execute()
   frame* f;
   sardir::fsinfo* fs = new sardir::fsinfo(".");
 
-  // AX25
-  if (sarnet::udp::ax25available) {
-    scr.msgout("Trying to queue AX25 beacon");
+  // AX25, one on each port, on a half duplex radio a beacon waits for the
+  // transfers
+  for (size_t i = 0; i < ax25ports.size(); i++) {
+    sarnet::ax25port& port = ax25ports[i];
+    if (port.halfduplex() && ax25busy(port.link())) {
+      scr.msgout("AX25 transfer in progress on %s, no AX25 beacon",
+                 port.name().c_str());
+      continue;
+    }
+    scr.msgout("Trying to queue AX25 beacon on %s", port.name().c_str());
     // We always want the AX25 Address in the eid
-    eidstr = std::string(sarnet::udp::ax25srcaddress);
-    // eidstr = ax25multiout->straddr();
+    eidstr = port.link()->addr();
     eidstr += " ";
     eidstr += c_eid.eid();
     // Do we wish to advertise free space
@@ -125,7 +142,7 @@ cli_beacon::execute()
                      c_rx.flag(), eidstr);
     }
 
-    if (f->tx(ax25multiout) < 0)
+    if (f->tx(port.group()) < 0)
       scr.error("Cant queue a multicast AX25 beacon");
     else
       scr.msgout("cli_beacon::execute() AX25 Multicast Beacon in buffer EID %s",
@@ -262,6 +279,7 @@ cli_put::execute()
     delete locfp;
     return (false);
   }
+  offset_t fsize = locfp->filesize();
   delete locfp;
 
   // All is good locally so create the REQUEST to send
@@ -273,6 +291,8 @@ cli_put::execute()
     this->ready(false);
     return (false);
   }
+  // Offsets no wider than the file needs
+  ((saratoga::request*)f)->descriptor(fitdescriptor(fsize));
 
   // Is our peer in the current list of open sockets
   // If not then create the new peer and open a socket to it
@@ -317,6 +337,72 @@ cli_put::execute()
   }
 }
 
+// Multicast a file. The REQUEST and METADATA go to the group, followed
+// by the fountain coded blocks of the file or by the file itself and
+// then the holes the receivers NAK
+bool
+cli_mput::execute()
+{
+  session_t sess = c_session.set();
+  string fname = c_mput.fname();
+  string localfname = c_mput.localfname();
+  sarnet::udp* group = c_mput.v6() ? v6mcastout : v4mcastout;
+  string groupstr = group->straddr();
+  saratoga::tran* t;
+
+  scr.debug(2, "cli_mput::execute(): fname=%s group=%s", fname.c_str(),
+            groupstr.c_str());
+  this->ready(false);
+
+  if (!c_multicast.state()) {
+    scr.error("Multicast is disabled, cannot mput %s", fname.c_str());
+    return (false);
+  }
+  // Is our local file OK to read and there ?
+  sarfile::fileio* locfp = new sarfile::fileio(localfname, sarfile::FILE_READ);
+  if (!locfp->ok() || !locfp->isfile()) {
+    scr.error("Unable to open local file %s for transfer", localfname.c_str());
+    delete locfp;
+    return (false);
+  }
+  offset_t fsize = locfp->filesize();
+  delete locfp;
+
+  saratoga::request* rp = new request(F_REQUEST_PUT, sess, fname);
+  if (rp->badframe()) {
+    scr.error("Badly formed REQUEST frame");
+    delete rp;
+    return (false);
+  }
+  rp->descriptor(fitdescriptor(fsize));
+  if ((t = sartransfers.add(OUTBOUND, TO_SOCKET, rp, group, localfname)) ==
+      nullptr) {
+    scr.debug(3, "cli_mput::execute(): Frame or transfer is bad");
+    delete rp;
+    return (false);
+  }
+  if (c_mput.nak())
+    t->nakput();
+  else
+    t->fountainput(c_mput.extra());
+
+  // Everyone listening on the group takes the REQUEST, the METADATA
+  // saves each of them asking for it
+  int plen;
+  if ((plen = rp->tx(group)) <= 0) {
+    scr.error("Can't send PUT REQUEST to %s for %s Length %d",
+              groupstr.c_str(), fname.c_str(), plen);
+    sartransfers.remove(t);
+    delete rp;
+    return (false);
+  }
+  scr.msgout("cli_mput::execute(): Tx PUT REQUEST to %s for %s Length %d",
+             groupstr.c_str(), fname.c_str(), plen);
+  delete rp;
+  t->sendmetadata();
+  return (true);
+}
+
 // Put then remove a file send the REQUEST
 bool
 cli_putrm::execute()
@@ -0,0 +1,439 @@
+/*
+
+ Copyright (c) 2011, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <string>
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define FEC_HAVE_X86 1
+#include <tmmintrin.h>
+#endif
+
+#include "fec.h"
+#include "globals.h"
+#include "repair.h"
+
+using namespace std;
+
+namespace saratoga {
+
+/*
+ * GF(2^8)
+ */
+
+static uint8_t gfexp[512];
+static uint8_t gflog[256];
+static bool gfready = false;
+
+static void
+gfinit()
+{
+  unsigned int x = 1;
+
+  for (int i = 0; i < 255; i++) {
+    gfexp[i] = (uint8_t)x;
+    gflog[x] = (uint8_t)i;
+    x <<= 1;
+    if (x & 0x100)
+      x ^= 0x11d;
+  }
+  // Doubled so a sum of two logs needs no modulo
+  for (int i = 255; i < 512; i++)
+    gfexp[i] = gfexp[i - 255];
+  gfready = true;
+}
+
+uint8_t
+gf256::mul(uint8_t a, uint8_t b)
+{
+  if (!gfready)
+    gfinit();
+  if (a == 0 || b == 0)
+    return 0;
+  return gfexp[gflog[a] + gflog[b]];
+}
+
+uint8_t
+gf256::inv(uint8_t a)
+{
+  if (!gfready)
+    gfinit();
+  if (a == 0)
+    return 0;
+  return gfexp[255 - gflog[a]];
+}
+
+static void
+muladd_scalar(uint8_t c, const uint8_t* src, uint8_t* dst, size_t len)
+{
+  uint8_t row[256];
+
+  for (int i = 0; i < 256; i++)
+    row[i] = gf256::mul(c, (uint8_t)i);
+  for (size_t i = 0; i < len; i++)
+    dst[i] ^= row[src[i]];
+}
+
+#ifdef FEC_HAVE_X86
+// c * x is c * (low nibble) ^ c * (high nibble << 4), two 16 entry
+// tables that pshufb looks up for 16 bytes at once
+__attribute__((target("ssse3"))) static void
+muladd_ssse3(uint8_t c, const uint8_t* src, uint8_t* dst, size_t len)
+{
+  uint8_t lo[16], hi[16];
+
+  for (int i = 0; i < 16; i++) {
+    lo[i] = gf256::mul(c, (uint8_t)i);
+    hi[i] = gf256::mul(c, (uint8_t)(i << 4));
+  }
+  __m128i tlo = _mm_loadu_si128((const __m128i*)lo);
+  __m128i thi = _mm_loadu_si128((const __m128i*)hi);
+  __m128i mask = _mm_set1_epi8(0x0f);
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16) {
+    __m128i x = _mm_loadu_si128((const __m128i*)(src + i));
+    __m128i l = _mm_shuffle_epi8(tlo, _mm_and_si128(x, mask));
+    __m128i h =
+      _mm_shuffle_epi8(thi, _mm_and_si128(_mm_srli_epi64(x, 4), mask));
+    __m128i d = _mm_loadu_si128((const __m128i*)(dst + i));
+    _mm_storeu_si128((__m128i*)(dst + i),
+                     _mm_xor_si128(d, _mm_xor_si128(l, h)));
+  }
+  for (; i < len; i++)
+    dst[i] ^= lo[src[i] & 0x0f] ^ hi[src[i] >> 4];
+}
+#endif
+
+typedef void (*muladd_fn)(uint8_t, const uint8_t*, uint8_t*, size_t);
+
+static muladd_fn
+muladd_pick()
+{
+#ifdef FEC_HAVE_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("ssse3"))
+    return muladd_ssse3;
+#endif
+  return muladd_scalar;
+}
+
+static muladd_fn muladd_best = nullptr;
+
+void
+gf256::muladd(uint8_t c, const uint8_t* src, uint8_t* dst, size_t len)
+{
+  if (c == 0 || len == 0)
+    return;
+  if (muladd_best == nullptr)
+    muladd_best = muladd_pick();
+  muladd_best(c, src, dst, len);
+}
+
+const char*
+gf256::implementation()
+{
+  if (muladd_best == nullptr)
+    muladd_best = muladd_pick();
+#ifdef FEC_HAVE_X86
+  if (muladd_best == muladd_ssse3)
+    return "ssse3";
+#endif
+  return "scalar";
+}
+
+// Cauchy matrix coefficient of member j in repair row r. x_r counts
+// down from 255 and y_j up from 0 so they never meet
+static uint8_t
+coef(uint8_t r, size_t j)
+{
+  return gf256::inv((uint8_t)(255 - r) ^ (uint8_t)j);
+}
+
+/*
+ * Groups
+ */
+
+size_t
+fecgroup::maxlen() const
+{
+  size_t m = 0;
+
+  for (size_t j = 0; j < len.size(); j++)
+    if (len[j] > m)
+      m = len[j];
+  return m;
+}
+
+bool
+fecgroup::same(const fecgroup& g) const
+{
+  return first == g.first && len == g.len && span == g.span && z == g.z;
+}
+
+/*
+ * Sending
+ */
+
+void
+fecencoder::setup(uint8_t n, uint8_t k, bool autok)
+{
+  if (n > maxn)
+    n = maxn;
+  if (k > maxk)
+    k = maxk;
+  if (k > n)
+    k = n;
+  _n = (k == 0) ? 0 : n;
+  _k = k;
+  _want = k;
+  _auto = autok;
+  _lastholes = 0;
+  _clean = 0;
+  _next = 0;
+  _group = fecgroup();
+  _group.first = 0;
+}
+
+void
+fecencoder::fit(size_t room)
+{
+  while (_n > 0 && this->overhead() > room / 2)
+    _n--;
+  if (_k > _n)
+    _k = _n;
+  if (_want > _n)
+    _want = _n;
+}
+
+void
+fecencoder::add(offset_t off, const char* buf, size_t len, size_t span, bool z)
+{
+  if (_group.len.empty()) {
+    _group.first = off;
+    _group.rows.clear();
+  }
+  size_t j = _group.len.size();
+  _group.len.push_back((uint16_t)len);
+  _group.span.push_back((uint16_t)span);
+  _group.z.push_back(z);
+  _next = off + span;
+  for (uint8_t r = 0; r < _k && len > 0; r++) {
+    std::vector<uint8_t>& row = _group.rows[r];
+    if (row.size() < len)
+      row.resize(len, 0);
+    gf256::muladd(coef(r, j), (const uint8_t*)buf, &row[0], len);
+  }
+}
+
+void
+fecencoder::next()
+{
+  _group.len.clear();
+  _group.span.clear();
+  _group.z.clear();
+  _group.rows.clear();
+  _k = _want;
+}
+
+void
+fecencoder::observe(offset_t holebytes)
+{
+  if (!_auto || _n == 0)
+    return;
+  if (holebytes > _lastholes) {
+    if (_want < maxk && _want < _n)
+      _want++;
+    _clean = 0;
+  } else if (++_clean >= 4 && _want > 1) {
+    _want--;
+    _clean = 0;
+  }
+  _lastholes = holebytes;
+}
+
+string
+fecencoder::print() const
+{
+  char tmp[128];
+
+  if (_n == 0)
+    return ("FEC off");
+  sprintf(tmp, "FEC %d repair frames per %d DATA%s (%s)", (int)_want,
+          (int)_n, _auto ? " adjusted to loss" : "",
+          gf256::implementation());
+  return (string(tmp));
+}
+
+/*
+ * Receiving
+ */
+
+void
+fecdecoder::keep(offset_t off, const char* buf, size_t len, bool z)
+{
+  std::map<offset_t, fecblock>::iterator i = _cache.find(off);
+  if (i == _cache.end()) {
+    _order.push_back(off);
+    i = _cache.insert(std::make_pair(off, fecblock())).first;
+  }
+  i->second.offset = off;
+  i->second.z = z;
+  i->second.payload.assign(buf, buf + len);
+  while (_order.size() > maxcache) {
+    _cache.erase(_order.front());
+    _order.pop_front();
+  }
+}
+
+bool
+fecdecoder::add(repair& rep, std::vector<fecblock>& rebuilt)
+{
+  _active = true;
+  fecgroup layout = rep.group();
+  std::map<offset_t, fecgroup>::iterator gi = _groups.find(layout.first);
+  if (gi == _groups.end() || !gi->second.same(layout)) {
+    _groups[layout.first] = layout;
+    gi = _groups.find(layout.first);
+  }
+  fecgroup& g = gi->second;
+  g.rows[rep.row()].assign((const uint8_t*)rep.parity(),
+                           (const uint8_t*)rep.parity() + rep.paritylen());
+  while (_groups.size() > maxgroups) {
+    if (_groups.begin() == gi)
+      break;
+    _groups.erase(_groups.begin());
+  }
+
+  // Which members have we not had
+  size_t n = g.len.size();
+  std::vector<offset_t> offs(n);
+  std::vector<const fecblock*> have(n, (const fecblock*)nullptr);
+  std::vector<size_t> lost;
+  offset_t off = g.first;
+  for (size_t j = 0; j < n; j++) {
+    offs[j] = off;
+    std::map<offset_t, fecblock>::iterator c = _cache.find(off);
+    if (c != _cache.end() && c->second.payload.size() == g.len[j] &&
+        c->second.z == g.z[j])
+      have[j] = &c->second;
+    else
+      lost.push_back(j);
+    off += g.span[j];
+  }
+  if (lost.empty()) {
+    _groups.erase(gi);
+    return false;
+  }
+  size_t m = lost.size();
+  if (m > g.rows.size())
+    return false;
+
+  // Take the known members out of m of the repairs, leaving m
+  // equations in the m lost ones
+  size_t plen = g.maxlen();
+  if (plen == 0) {
+    _groups.erase(gi);
+    return false;
+  }
+  std::vector<std::vector<uint8_t> > b;
+  std::vector<std::vector<uint8_t> > a;
+  for (std::map<uint8_t, std::vector<uint8_t> >::iterator r = g.rows.begin();
+       r != g.rows.end() && b.size() < m; r++) {
+    if (r->second.size() != plen)
+      continue;
+    std::vector<uint8_t> row = r->second;
+    for (size_t j = 0; j < n; j++)
+      if (have[j] != nullptr && !have[j]->payload.empty())
+        gf256::muladd(coef(r->first, j),
+                      (const uint8_t*)&have[j]->payload[0], &row[0],
+                      have[j]->payload.size());
+    std::vector<uint8_t> arow(m);
+    for (size_t c = 0; c < m; c++)
+      arow[c] = coef(r->first, lost[c]);
+    b.push_back(row);
+    a.push_back(arow);
+  }
+  if (b.size() < m)
+    return false;
+
+  // Gauss-Jordan, any square Cauchy submatrix can be inverted
+  std::vector<uint8_t> tmp(plen);
+  for (size_t c = 0; c < m; c++) {
+    size_t p = c;
+    while (p < m && a[p][c] == 0)
+      p++;
+    if (p == m) {
+      scr.error("fecdecoder::add(): Cannot solve repair group at %" PRIu64
+                "",
+                (uint64_t)g.first);
+      _groups.erase(gi);
+      return false;
+    }
+    std::swap(a[p], a[c]);
+    std::swap(b[p], b[c]);
+    uint8_t s = gf256::inv(a[c][c]);
+    for (size_t x = 0; x < m; x++)
+      a[c][x] = gf256::mul(s, a[c][x]);
+    std::fill(tmp.begin(), tmp.end(), 0);
+    gf256::muladd(s, &b[c][0], &tmp[0], plen);
+    b[c].swap(tmp);
+    for (size_t i = 0; i < m; i++) {
+      uint8_t f = a[i][c];
+      if (i == c || f == 0)
+        continue;
+      for (size_t x = 0; x < m; x++)
+        a[i][x] ^= gf256::mul(f, a[c][x]);
+      gf256::muladd(f, &b[c][0], &b[i][0], plen);
+    }
+  }
+
+  for (size_t c = 0; c < m; c++) {
+    fecblock blk;
+    size_t j = lost[c];
+    blk.offset = offs[j];
+    blk.z = g.z[j];
+    blk.payload.assign((const char*)&b[c][0],
+                       (const char*)&b[c][0] + g.len[j]);
+    rebuilt.push_back(blk);
+  }
+  _groups.erase(gi);
+  return true;
+}
+
+} // Namespace saratoga
@@ -0,0 +1,193 @@
+/*
+
+ Copyright (c) 2011, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#ifndef _FEC_H
+#define _FEC_H
+
+#include <cstring>
+#include <deque>
+#include <inttypes.h>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "saratoga.h"
+
+using namespace std;
+
+namespace saratoga {
+
+class repair;
+
+/*
+ **********************************************************************
+ * FEC
+ **********************************************************************
+ */
+
+// Arithmetic in GF(2^8) over x^8+x^4+x^3+x^2+1 for the repair frames
+class gf256
+{
+public:
+  static uint8_t mul(uint8_t, uint8_t);
+  static uint8_t inv(uint8_t);
+  // dst ^= c * src for len bytes, 16 at a time with table lookups if
+  // the CPU can
+  static void muladd(uint8_t, const uint8_t*, uint8_t*, size_t);
+  static const char* implementation();
+};
+
+/*
+ * Forward error correction. Each group of up to n DATA frames sent one
+ * after the other is followed by k REPAIR frames, row r holding the sum
+ * of every frame's payload times the Cauchy coefficient 1/(x_r + y_j).
+ * Any k of the frames lost can be rebuilt from k of the repairs and the
+ * rest of the group, so the receiver fills them in without a STATUS
+ * round trip. Payloads are as sent, compressed or not, zero padded to
+ * the longest in the group.
+ */
+
+// A DATA payload as it went on the wire and where it goes in the file
+struct fecblock
+{
+  offset_t offset;
+  bool z; // A compressed block
+  std::vector<char> payload;
+};
+
+// The member layout of a group, as each REPAIR frame carries it
+struct fecgroup
+{
+  offset_t first;              // Offset of the first member
+  std::vector<uint16_t> len;   // Payload length of each member
+  std::vector<uint16_t> span;  // and how much of the file it covers
+  std::vector<bool> z;         // Compressed payloads
+  std::map<uint8_t, std::vector<uint8_t> > rows; // Repairs received
+
+  size_t maxlen() const;
+  bool same(const fecgroup&) const;
+};
+
+// Sending, builds the repair rows as the group's DATA goes out
+class fecencoder
+{
+private:
+  uint8_t _n;           // Most DATA frames in a group, 0 when off
+  uint8_t _k;           // Repair frames for the group being built
+  uint8_t _want;        // and for the next one
+  bool _auto;           // k follows the loss seen in STATUS
+  offset_t _lastholes;  // Hole bytes in the last STATUS
+  int _clean;           // STATUS frames in a row with no new holes
+  offset_t _next;       // Where the next member has to start
+  fecgroup _group;      // The members so far, the rows are our parity
+
+public:
+  // n + k distinct field elements are needed for the coefficients
+  static const uint8_t maxn = 64;
+  static const uint8_t maxk = 16;
+
+  fecencoder() { this->setup(0, 0, false); };
+
+  void setup(uint8_t, uint8_t, bool);
+  bool on() const { return _n > 0; };
+
+  // Fewer DATA frames a group when describing them would take more
+  // than half of room, a DATA payload and its header, off if none fit
+  void fit(size_t room);
+
+  // How much each DATA payload gives up so a REPAIR, which carries
+  // the group layout as well, is no bigger than a DATA frame
+  size_t overhead() const { return _n > 0 ? 4 + 4 * (size_t)_n : 0; };
+
+  // Can a DATA payload at the offset join the group being built
+  bool fits(offset_t off) const
+  {
+    return _group.len.empty() || off == _next;
+  };
+  void add(offset_t, const char*, size_t, size_t, bool);
+  bool full() const { return _group.len.size() >= _n; };
+  bool empty() const { return _group.len.empty(); };
+
+  const fecgroup& group() const { return _group; };
+  uint8_t k() const { return _k; };
+
+  // The group has gone, start the next one
+  void next();
+
+  // Adjust k for the next group from the hole bytes in a STATUS, up
+  // one when they grow and back down after a run without new loss
+  void observe(offset_t);
+
+  string print() const;
+};
+
+// Receiving, keeps the recent DATA payloads and REPAIR frames until a
+// group can be solved. Nothing is kept until the sender has shown it
+// sends REPAIR frames
+class fecdecoder
+{
+private:
+  std::map<offset_t, fecblock> _cache;
+  std::deque<offset_t> _order; // Oldest payload first
+  std::map<offset_t, fecgroup> _groups;
+  bool _active = false; // A REPAIR has arrived
+
+public:
+  static const size_t maxcache = 2 * fecencoder::maxn;
+  static const size_t maxgroups = 8;
+
+  void clear()
+  {
+    _cache.clear();
+    _order.clear();
+    _groups.clear();
+    _active = false;
+  };
+
+  // A DATA payload has arrived
+  void keep(offset_t, const char*, size_t, bool);
+  bool active() const { return _active; };
+
+  // A REPAIR has arrived. True with the lost members of its group in
+  // rebuilt once there are enough repairs to solve it
+  bool add(repair&, std::vector<fecblock>&);
+};
+
+} // Namespace saratoga
+
+#endif // _FEC_H
@@ -48,10 +48,17 @@
 #include <limits>
 #include <limits>
 #include <string>
+#include <ftw.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/statvfs.h>
 #include <sys/types.h>
 
+// From linux/fs.h, which does not mix with the libc headers
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+
 using namespace std;
 
 namespace sarfile {
@@ -70,6 +77,44 @@ fexists(string fname)
   return (false);
 }
 
+// What fsame() is looking for, nftw() gives us no way to pass it
+static offset_t fsame_size;
+static checksums::checksum fsame_csum;
+static string fsame_found;
+
+static int
+fsame_entry(const char* fname, const struct stat* st, int flag, struct FTW* ftw)
+{
+  checksums::checksum have;
+
+  // Just the directory itself, not below it
+  if (flag == FTW_D)
+    return (ftw->level == 0) ? FTW_CONTINUE : FTW_SKIP_SUBTREE;
+  if (flag != FTW_F || !S_ISREG(st->st_mode) ||
+      (offset_t)st->st_size != fsame_size)
+    return FTW_CONTINUE;
+  if (sarcsums.find(*st, fsame_csum.csumtype(), have) &&
+      have.strval() == fsame_csum.strval()) {
+    fsame_found = fname;
+    return FTW_STOP;
+  }
+  return FTW_CONTINUE;
+}
+
+// Only the checksum cache is consulted, nothing is read. Files we have
+// sent, or received and verified, are in it
+string
+fsame(string dir, offset_t size, checksums::checksum c)
+{
+  if (c.csumtype() == checksums::CSUM_NONE)
+    return "";
+  fsame_size = size;
+  fsame_csum = c;
+  fsame_found = "";
+  nftw(dir.c_str(), fsame_entry, 8, FTW_PHYS | FTW_ACTIONRETVAL);
+  return fsame_found;
+}
+
 // Open a local file for reading or writing
 fileio::fileio(string fname, enum rorw rwx)
 {
@@ -83,7 +128,7 @@ fileio::fileio(string fname, enum rorw rwx)
       // We do not truncate it
       // ie Only create if it does not already exist
       _fd = open(fname.c_str(),
-                 O_CREAT | O_WRONLY | O_EXCL | O_LARGEFILE | O_SYNC | O_TRUNC,
+                 O_CREAT | O_RDWR | O_EXCL | O_LARGEFILE | O_SYNC | O_TRUNC,
                  S_IWUSR | S_IRUSR | S_IRGRP | S_IROTH);
       if (_fd < 0) {
         scr.perror(errno, "fileio::fileio(%s): Cannot create file",
@@ -111,7 +156,7 @@ fileio::fileio(string fname, enum rorw rwx)
       _rorw = FILE_WRITE;
       // We remove O_EXCL if it exists then we truncate it
       _fd =
-        open(fname.c_str(), O_CREAT | O_WRONLY | O_LARGEFILE | O_SYNC | O_TRUNC,
+        open(fname.c_str(), O_CREAT | O_RDWR | O_LARGEFILE | O_SYNC | O_TRUNC,
              S_IWUSR | S_IRUSR | S_IRGRP | S_IROTH);
       if (_fd < 0) {
         scr.perror(errno, "fileio::fileio: Cannot create file %s",
@@ -245,6 +290,182 @@ fileio::fwrite(const saratoga::buffer& b, bool sequential)
   return (tmp->len());
 }
 
+// Write len bytes at offset o straight away without lseek or
+// queueing a copy of it. Used for received DATA so we write directly
+// out of the receive buffer
+ssize_t
+fileio::pwrite(const char* b, const size_t len, const offset_t o)
+{
+  size_t totwritten = 0;
+
+  while (totwritten < len) {
+    ssize_t nwritten =
+      ::pwrite64(_fd, b + totwritten, len - totwritten, o + totwritten);
+    if (nwritten < 0) {
+      if (errno == EINTR)
+        continue;
+      scr.perror(errno, "fileio::pwrite(%d) Cannot write %zu bytes to %s\n",
+                 _fd, len, _fname.c_str());
+      return (-1);
+    }
+    totwritten += nwritten;
+  }
+  scr.debug(5, "fileio::pwrite: Wrote %zu bytes at offset %" PRIu64 " to %s",
+            totwritten, (uint64_t)o, _fname.c_str());
+  return (totwritten);
+}
+
+// If the checksum cache has a checksum of the type for this file as it
+// is now then use it, no need to read the file
+bool
+fileio::csumcached(enum checksums::csum_type t)
+{
+  struct stat st;
+  checksums::checksum c;
+
+  if (fstat(_fd, &st) != 0 || !sarcsums.find(st, t, c))
+    return false;
+  scr.debug(3, "fileio::csumcached: %s checksum %s from cache", _fname.c_str(),
+            c.print().c_str());
+  _csum = c;
+  _csum_done = true;
+  return true;
+}
+
+void
+fileio::csumcache()
+{
+  struct stat st;
+
+  if (fstat(_fd, &st) != 0) {
+    scr.perror(errno, "fileio::csumcache: Cannot stat %s", _fname.c_str());
+    return;
+  }
+  sarcsums.add(st, _csum);
+}
+
+// Share the blocks of src with a reflink if the filesystem can, otherwise
+// hard link src over our name. Either way our descriptor ends up on the
+// new contents
+bool
+fileio::clonefrom(string src)
+{
+  int sfd = open(src.c_str(), O_RDONLY | O_LARGEFILE);
+
+  if (sfd < 0) {
+    scr.perror(errno, "fileio::clonefrom: Cannot open %s", src.c_str());
+    return false;
+  }
+  if (ioctl(_fd, FICLONE, sfd) == 0) {
+    close(sfd);
+    scr.debug(3, "fileio::clonefrom: Reflinked %s to %s", src.c_str(),
+              _fname.c_str());
+    return true;
+  }
+  close(sfd);
+
+  string tmpname = _fname + ".link";
+  unlink(tmpname.c_str());
+  if (link(src.c_str(), tmpname.c_str()) != 0 ||
+      rename(tmpname.c_str(), _fname.c_str()) != 0) {
+    scr.perror(errno, "fileio::clonefrom: Cannot link %s to %s", src.c_str(),
+               _fname.c_str());
+    unlink(tmpname.c_str());
+    return false;
+  }
+  int fd = open(_fname.c_str(), O_RDONLY | O_LARGEFILE);
+  if (fd >= 0) {
+    dup2(fd, _fd);
+    close(fd);
+  }
+  scr.debug(3, "fileio::clonefrom: Linked %s to %s", src.c_str(),
+            _fname.c_str());
+  return true;
+}
+
+// Copy len bytes at from in the open file sfd to to in ours. The kernel
+// does it with copy_file_range() where it can, sharing the blocks on
+// file systems that allow it, otherwise we read and write it ourselves
+ssize_t
+fileio::copyfrom(int sfd, const offset_t from, const size_t len,
+                 const offset_t to)
+{
+  size_t totcopied = 0;
+
+  while (totcopied < len) {
+    loff_t in = from + totcopied;
+    loff_t out = to + totcopied;
+    ssize_t ncopied =
+      ::copy_file_range(sfd, &in, _fd, &out, len - totcopied, 0);
+    if (ncopied < 0 && errno == EINTR)
+      continue;
+    if (ncopied <= 0)
+      break;
+    totcopied += ncopied;
+  }
+  if (totcopied < len) {
+    checksums::csumbuf cbuf;
+    if (!cbuf.ok())
+      return (-1);
+    while (totcopied < len) {
+      size_t n = min(checksums::csum_buflen, len - totcopied);
+      ssize_t nread = ::pread64(sfd, cbuf.buf(), n, from + totcopied);
+      if (nread < 0 && errno == EINTR)
+        continue;
+      if (nread <= 0) {
+        scr.perror(errno, "fileio::copyfrom(%d) Cannot read for %s\n", sfd,
+                   _fname.c_str());
+        return (-1);
+      }
+      if (this->pwrite(cbuf.buf(), nread, to + totcopied) != nread)
+        return (-1);
+      totcopied += nread;
+    }
+  }
+  scr.debug(5, "fileio::copyfrom: Copied %zu bytes from %" PRIu64
+               " to %" PRIu64 " in %s",
+            totcopied, (uint64_t)from, (uint64_t)to, _fname.c_str());
+  return (totcopied);
+}
+
+// Give the file a new name, replacing whatever had it
+bool
+fileio::frename(string newname)
+{
+  if (rename(_fname.c_str(), newname.c_str()) != 0) {
+    scr.perror(errno, "fileio::frename: Cannot rename %s to %s",
+               _fname.c_str(), newname.c_str());
+    return false;
+  }
+  scr.debug(3, "fileio::frename: Renamed %s to %s", _fname.c_str(),
+            newname.c_str());
+  _fname = newname;
+  return true;
+}
+
+// Read len bytes at offset o back from a file being written, used to
+// catch the running checksum up over data that arrived out of order
+ssize_t
+fileio::pread(char* b, const size_t len, const offset_t o)
+{
+  size_t totread = 0;
+
+  while (totread < len) {
+    ssize_t nread = ::pread64(_fd, b + totread, len - totread, o + totread);
+    if (nread < 0) {
+      if (errno == EINTR)
+        continue;
+      scr.perror(errno, "fileio::pread(%d) Cannot read %zu bytes from %s\n",
+                 _fd, len, _fname.c_str());
+      return (-1);
+    }
+    if (nread == 0)
+      break;
+    totread += nread;
+  }
+  return (totread);
+}
+
 // Actually write buffers to a file
 ssize_t
 fileio::write()
@@ -374,6 +595,30 @@ fileio::read(size_t blen)
   return (nread);
 }
 
+// Read into the fileio _buf list from offset o of the file, for sending
+// just the parts of it the other end has asked for
+ssize_t
+fileio::read(size_t blen, offset_t o)
+{
+  ssize_t nread;
+
+  char* b = new char[blen];
+
+  _ready = true;
+  nread = this->pread(b, blen, o);
+  if (nread < 0) {
+    delete[] b;
+    return (-1);
+  }
+  if (nread > 0) {
+    _buf.push_back(saratoga::buffer(b, nread, o));
+    scr.debug(9, "fileio::read(%s): Buffer Read %ld Bytes at offet %" PRIu64 "",
+              this->fname().c_str(), nread, o);
+  }
+  delete[] b;
+  return (nread);
+}
+
 // This returns a buffers contents as a char *
 // and alters/removes the buffers from the _buf list
 // Handles smaller or multiple spans of _buf list
@@ -66,6 +66,9 @@ using namespace std;
 namespace sarfile {
 
 extern bool fexists(string);
+// A file in the directory of the given size whose checksum we know and
+// is the one given, "" if there is none
+extern string fsame(string, offset_t, checksums::checksum);
 
 enum rorw
 {
@@ -153,6 +156,12 @@ public:
   ssize_t fwrite(const char*, const size_t, const offset_t);
   // Sequenitial or lseek write
   ssize_t fwrite(const saratoga::buffer&, bool);
+  // Positional write now, not queued for the select() loop
+  ssize_t pwrite(const char*, const size_t, const offset_t);
+  // Positional read of data already written
+  ssize_t pread(char*, const size_t, const offset_t);
+  // Copy a range of another open file into ours
+  ssize_t copyfrom(int, const offset_t, const size_t, const offset_t);
 
   // Get a string from the fileio buffers and remove it
   // from the buffers. You need to allocate the char *
@@ -168,6 +177,8 @@ public:
   // This actually does a sequential read from a file to a buffer of length
   ssize_t read(size_t);
   ssize_t read(void*, size_t);
+  // and a read from an offset in the file to a buffer of length
+  ssize_t read(size_t, offset_t);
 
   bool ok() { return _ok; };
 
@@ -202,6 +213,17 @@ public:
   // Reset the checksum entry
   inline void setcsum(const checksums::checksum& newcsum) { _csum = newcsum; };
 
+  // Take our checksum from the checksum cache if it is there
+  bool csumcached(enum checksums::csum_type);
+  // Put our checksum in the checksum cache
+  void csumcache();
+
+  // Make our contents those of an identical local file, no copying
+  bool clonefrom(string);
+
+  // Rename the file
+  bool frename(string);
+
   // File size
   inline offset_t filesize() { return _dir.filesize(); };
 
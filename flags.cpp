@@ -219,6 +219,15 @@ Fframetype::print()
     case F_FRAMETYPE_STATUS:
       s += "ERRCODE";
       break;
+    case F_FRAMETYPE_SIGNATURE:
+      s += "SIGNATURE";
+      break;
+    case F_FRAMETYPE_REPAIR:
+      s += "REPAIR";
+      break;
+    case F_FRAMETYPE_SYMBOL:
+      s += "SYMBOL";
+      break;
     default:
       s += "Unrecognised Frame Type";
       break;
@@ -749,6 +758,58 @@ Ffreespaced::print()
   return (s);
 }
 
+/*
+ **********************************************************************************************************
+ * Fcompress functions
+ */
+
+// Print out the compress
+string
+Fcompress::print()
+{
+  string s("Compress ");
+
+  switch (Fcompress::get()) {
+    case F_COMPRESS_NO:
+      s += "No";
+      break;
+    case F_COMPRESS_YES:
+      s += "Yes";
+      break;
+    default:
+      s += "Invalid";
+      break;
+  }
+  s += printbits(Fcompress::shift(), Fcompress::mask());
+  return (s);
+}
+
+/*
+ **********************************************************************************************************
+ * Fmcast functions
+ */
+
+// Print out the mcast
+string
+Fmcast::print()
+{
+  string s("Multicast ");
+
+  switch (Fmcast::get()) {
+    case F_MCAST_NO:
+      s += "No";
+      break;
+    case F_MCAST_YES:
+      s += "Yes";
+      break;
+    default:
+      s += "Invalid";
+      break;
+  }
+  s += printbits(Fmcast::shift(), Fmcast::mask());
+  return (s);
+}
+
 /*
  **********************************************************************************************************
  * Fcsumlen functions
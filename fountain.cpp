@@ -0,0 +1,549 @@
+/*
+
+ Copyright (c) 2011, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <string>
+
+#include "fountain.h"
+
+using namespace std;
+
+namespace saratoga {
+
+/*
+ * LT code
+ */
+
+// Robust soliton, R = c ln(k / delta) sqrt(k) with a spike at k / R
+static const double ltc = 0.05;
+static const double ltdelta = 0.5;
+
+// SplitMix64, the same numbers from the same seed at both ends
+static inline uint64_t
+ltrand(uint64_t& s)
+{
+  uint64_t z = (s += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+static bool
+isprime(uint32_t x)
+{
+  if (x < 2)
+    return false;
+  for (uint32_t d = 2; d * d <= x; d++)
+    if (x % d == 0)
+      return false;
+  return true;
+}
+
+void
+ltcode::setup(uint32_t k)
+{
+  _k = (k == 0) ? 1 : k;
+  // As many parity symbols as Raptor (RFC 5053) uses, a prime so the
+  // three checks of each source symbol are different
+  _s = (_k + 99) / 100 + (uint32_t)ceil(sqrt(2.0 * _k));
+  if (_s < 3)
+    _s = 3;
+  while (!isprime(_s))
+    _s++;
+  uint32_t n = this->n();
+  _cdf.assign(n, 0);
+
+  double r = ltc * log(n / ltdelta) * sqrt((double)n);
+  if (r < 1.0)
+    r = 1.0;
+  uint32_t spike = (uint32_t)(n / r);
+  if (spike > n / 2)
+    spike = n / 2;
+
+  std::vector<double> mu(n + 1, 0.0);
+  mu[1] = 1.0 / n;
+  for (uint32_t d = 2; d <= n; d++)
+    mu[d] = 1.0 / ((double)d * (d - 1));
+  for (uint32_t d = 1; d < spike; d++)
+    mu[d] += r / ((double)d * n);
+  if (spike > 1 && r / ltdelta > 1.0)
+    mu[spike] += r * log(r / ltdelta) / n;
+
+  double sum = 0.0;
+  for (uint32_t d = 1; d <= n; d++)
+    sum += mu[d];
+  double acc = 0.0;
+  for (uint32_t d = 1; d <= n; d++) {
+    acc += mu[d];
+    double p = acc / sum * 4294967296.0;
+    _cdf[d - 1] = (p >= 4294967295.0) ? 0xFFFFFFFFU : (uint32_t)p;
+  }
+  _cdf[n - 1] = 0xFFFFFFFFU;
+}
+
+void
+ltcode::checks(uint32_t i, uint32_t* c) const
+{
+  uint32_t a = 1 + (i / _s) % (_s - 1);
+  uint32_t b = i % _s;
+
+  c[0] = b;
+  c[1] = (b + a) % _s;
+  c[2] = (b + 2 * a) % _s;
+}
+
+void
+ltcode::neighbours(uint32_t e, std::vector<uint32_t>& nbrs) const
+{
+  uint64_t s = ((uint64_t)_k << 32) | e;
+  s = ltrand(s);
+  uint32_t n = this->n();
+  uint32_t r = (uint32_t)(ltrand(s) >> 32);
+  uint32_t d =
+    (uint32_t)(std::upper_bound(_cdf.begin(), _cdf.end(), r) - _cdf.begin()) +
+    1;
+  if (d > n)
+    d = n;
+
+  nbrs.clear();
+  if (d <= 32) {
+    while (nbrs.size() < d) {
+      uint32_t j = (uint32_t)(((ltrand(s) >> 32) * n) >> 32);
+      if (std::find(nbrs.begin(), nbrs.end(), j) == nbrs.end())
+        nbrs.push_back(j);
+    }
+    return;
+  }
+  std::vector<bool> taken(n, false);
+  while (nbrs.size() < d) {
+    uint32_t j = (uint32_t)(((ltrand(s) >> 32) * n) >> 32);
+    if (!taken[j]) {
+      taken[j] = true;
+      nbrs.push_back(j);
+    }
+  }
+}
+
+// A word at a time, the bytes left over one by one
+void
+ltxor(char* dst, const char* src, size_t len)
+{
+  size_t i = 0;
+  uint64_t a, b;
+
+  for (; i + 8 <= len; i += 8) {
+    memcpy(&a, dst + i, 8);
+    memcpy(&b, src + i, 8);
+    a ^= b;
+    memcpy(dst + i, &a, 8);
+  }
+  for (; i < len; i++)
+    dst[i] ^= src[i];
+}
+
+/*
+ * Encoder
+ */
+
+char*
+ltencoder::setup(size_t blen, size_t symlen)
+{
+  _blen = blen;
+  _symlen = (symlen == 0) ? 1 : symlen;
+  uint32_t k = (uint32_t)((blen + _symlen - 1) / _symlen);
+  _code.setup(k);
+  _block.assign((size_t)_code.n() * _symlen, 0);
+  _parity = false;
+  return &_block[0];
+}
+
+void
+ltencoder::encode(uint32_t e, char* out)
+{
+  if (!_parity) {
+    uint32_t c[3];
+    char* parity = &_block[(size_t)_code.k() * _symlen];
+    for (uint32_t i = 0; i < _code.k(); i++) {
+      _code.checks(i, c);
+      for (int j = 0; j < 3; j++)
+        ltxor(parity + (size_t)c[j] * _symlen, &_block[(size_t)i * _symlen],
+              _symlen);
+    }
+    _parity = true;
+  }
+  _code.neighbours(e, _nbrs);
+  memcpy(out, &_block[(size_t)_nbrs[0] * _symlen], _symlen);
+  for (size_t i = 1; i < _nbrs.size(); i++)
+    ltxor(out, &_block[(size_t)_nbrs[i] * _symlen], _symlen);
+}
+
+/*
+ * Decoder
+ */
+
+void
+ltdecoder::setup(size_t blen, size_t symlen)
+{
+  _blen = blen;
+  _symlen = (symlen == 0) ? 1 : symlen;
+  uint32_t k = (uint32_t)((blen + _symlen - 1) / _symlen);
+  _code.setup(k);
+  uint32_t n = _code.n();
+  _block.assign((size_t)n * _symlen, 0);
+  _have.assign(n, false);
+  _found = 0;
+  _received = 0;
+  _refs.assign(n, std::vector<uint32_t>());
+  _live = 0;
+  _nextsolve = 0;
+
+  // Each parity symbol and its source symbols XOR to nothing, rows
+  // that are there from the start
+  _rows.assign(_code.s(), ltrow());
+  uint32_t c[3];
+  for (uint32_t i = 0; i < _code.k(); i++) {
+    _code.checks(i, c);
+    for (int j = 0; j < 3; j++)
+      _rows[c[j]].nbrs.push_back(i);
+  }
+  for (uint32_t j = 0; j < _code.s(); j++) {
+    _rows[j].nbrs.push_back(_code.k() + j);
+    _rows[j].sym.assign(_symlen, 0);
+    for (size_t i = 0; i < _rows[j].nbrs.size(); i++)
+      _refs[_rows[j].nbrs[i]].push_back(j);
+    _live++;
+  }
+}
+
+// Source symbol s is known, take it out of every row that has it and
+// carry on with any row that is down to one unknown
+void
+ltdecoder::found(uint32_t s, const char* sym)
+{
+  std::vector<uint32_t> ripple;
+
+  memcpy(&_block[(size_t)s * _symlen], sym, _symlen);
+  _have[s] = true;
+  _found++;
+  ripple.push_back(s);
+  while (!ripple.empty()) {
+    s = ripple.back();
+    ripple.pop_back();
+    const char* v = &_block[(size_t)s * _symlen];
+    for (size_t i = 0; i < _refs[s].size(); i++) {
+      ltrow& r = _rows[_refs[s][i]];
+      std::vector<uint32_t>::iterator j =
+        std::find(r.nbrs.begin(), r.nbrs.end(), s);
+      if (j == r.nbrs.end())
+        continue;
+      *j = r.nbrs.back();
+      r.nbrs.pop_back();
+      ltxor(&r.sym[0], v, _symlen);
+      if (r.nbrs.size() > 1)
+        continue;
+      uint32_t u = r.nbrs[0];
+      if (!_have[u]) {
+        memcpy(&_block[(size_t)u * _symlen], &r.sym[0], _symlen);
+        _have[u] = true;
+        _found++;
+        ripple.push_back(u);
+      }
+      r.nbrs.clear();
+      std::vector<char>().swap(r.sym);
+      _live--;
+    }
+    std::vector<uint32_t>().swap(_refs[s]);
+  }
+}
+
+// Gaussian elimination over GF(2) of rows of w words, the first m
+// columns. True if every column has a pivot, order then lists the rows
+// in pivot order. With syms each row's symbol is carried along and the
+// rows are back substituted so row order[c] ends up as column c alone
+static bool
+gf2solve(std::vector<uint64_t>& m, size_t n, size_t w, size_t cols,
+         std::vector<size_t>& order, std::vector<char*>* syms, size_t symlen)
+{
+  order.resize(n);
+  for (size_t i = 0; i < n; i++)
+    order[i] = i;
+  for (size_t c = 0; c < cols; c++) {
+    size_t word = c / 64;
+    uint64_t bit = (uint64_t)1 << (c % 64);
+    size_t p = c;
+    while (p < n && !(m[order[p] * w + word] & bit))
+      p++;
+    if (p == n)
+      return false;
+    std::swap(order[c], order[p]);
+    const uint64_t* prow = &m[order[c] * w];
+    for (size_t q = c + 1; q < n; q++) {
+      uint64_t* qrow = &m[order[q] * w];
+      if (!(qrow[word] & bit))
+        continue;
+      for (size_t x = word; x < w; x++)
+        qrow[x] ^= prow[x];
+      if (syms)
+        ltxor((*syms)[order[q]], (*syms)[order[c]], symlen);
+    }
+  }
+  if (!syms)
+    return true;
+  for (size_t c = cols; c-- > 0;) {
+    size_t word = c / 64;
+    uint64_t bit = (uint64_t)1 << (c % 64);
+    for (size_t q = 0; q < c; q++)
+      if (m[order[q] * w + word] & bit)
+        ltxor((*syms)[order[q]], (*syms)[order[c]], symlen);
+  }
+  return true;
+}
+
+// Peeling has stalled, solve the rows that are left. Peeling carries on
+// regardless by setting aside (inactivating) an unknown whenever no row
+// is down to one, so every other unknown comes out as a symbol plus some
+// of the inactive ones. The rows not used in that give a small dense
+// system for the inactive unknowns, solved by elimination. Only the bits
+// are worked on until it is certain there is a solution, then the
+// symbols follow
+bool
+ltdecoder::solve()
+{
+  uint32_t nsym = _code.n();
+  std::vector<int32_t> col(nsym, -1);
+  std::vector<uint32_t> unknown;
+
+  for (uint32_t i = 0; i < nsym; i++)
+    if (!_have[i]) {
+      col[i] = (int32_t)unknown.size();
+      unknown.push_back(i);
+    }
+  std::vector<size_t> rows;
+  for (size_t i = 0; i < _rows.size(); i++)
+    if (_rows[i].nbrs.size() > 1)
+      rows.push_back(i);
+  size_t u = unknown.size();
+  size_t n = rows.size();
+  if (u == 0 || n < u)
+    return false;
+
+  // The unknowns of each row as columns, and the rows with each column
+  std::vector<std::vector<uint32_t> > rc(n);
+  std::vector<std::vector<uint32_t> > cr(u);
+  std::vector<uint32_t> deg(n);
+  std::vector<uint32_t> ones;
+  for (size_t i = 0; i < n; i++) {
+    const std::vector<uint32_t>& nb = _rows[rows[i]].nbrs;
+    for (size_t j = 0; j < nb.size(); j++) {
+      rc[i].push_back((uint32_t)col[nb[j]]);
+      cr[col[nb[j]]].push_back((uint32_t)i);
+    }
+    deg[i] = (uint32_t)nb.size();
+  }
+
+  std::vector<int32_t> pivot(u, -1); // Row giving each peeled column
+  std::vector<bool> used(n, false);
+  std::vector<bool> settled(u, false);
+  std::vector<int32_t> inactive(u, -1); // Index among the inactive
+  std::vector<uint32_t> order;          // Columns as they were peeled
+  std::vector<uint32_t> inact;
+  size_t nsettled = 0;
+
+  while (nsettled < u) {
+    size_t r = n;
+    while (!ones.empty() && r == n) {
+      if (!used[ones.back()] && deg[ones.back()] == 1)
+        r = ones.back();
+      ones.pop_back();
+    }
+    if (r == n) {
+      // Nothing down to one, set aside all but one of the unknowns of
+      // the row with fewest
+      for (size_t i = 0; i < n; i++)
+        if (!used[i] && deg[i] > 1 && (r == n || deg[i] < deg[r]))
+          r = i;
+      if (r == n)
+        return false;
+      bool kept = false;
+      for (size_t j = 0; j < rc[r].size(); j++) {
+        uint32_t c = rc[r][j];
+        if (settled[c])
+          continue;
+        if (!kept) {
+          kept = true;
+          continue;
+        }
+        settled[c] = true;
+        nsettled++;
+        inactive[c] = (int32_t)inact.size();
+        inact.push_back(c);
+        for (size_t x = 0; x < cr[c].size(); x++)
+          if (--deg[cr[c][x]] == 1)
+            ones.push_back(cr[c][x]);
+      }
+    }
+    uint32_t c = 0;
+    for (size_t j = 0; j < rc[r].size(); j++)
+      if (!settled[rc[r][j]])
+        c = rc[r][j];
+    pivot[c] = (int32_t)r;
+    used[r] = true;
+    settled[c] = true;
+    nsettled++;
+    order.push_back(c);
+    for (size_t x = 0; x < cr[c].size(); x++)
+      if (--deg[cr[c][x]] == 1)
+        ones.push_back(cr[c][x]);
+  }
+
+  // Which inactive unknowns each peeled one is in, then the same for
+  // the rows left over, the system for the inactive unknowns
+  size_t m = inact.size();
+  size_t w = (m + 63) / 64;
+  std::vector<uint64_t> in(u * w, 0);
+  for (size_t p = 0; p < order.size(); p++) {
+    uint32_t c = order[p];
+    const std::vector<uint32_t>& rr = rc[pivot[c]];
+    for (size_t j = 0; j < rr.size(); j++) {
+      if (rr[j] == c)
+        continue;
+      if (inactive[rr[j]] >= 0)
+        in[c * w + inactive[rr[j]] / 64] ^= (uint64_t)1
+                                            << (inactive[rr[j]] % 64);
+      else
+        for (size_t x = 0; x < w; x++)
+          in[c * w + x] ^= in[rr[j] * w + x];
+    }
+  }
+  std::vector<size_t> spare;
+  for (size_t i = 0; i < n; i++)
+    if (!used[i])
+      spare.push_back(i);
+  std::vector<uint64_t> dense(spare.size() * w, 0);
+  for (size_t s = 0; s < spare.size(); s++) {
+    const std::vector<uint32_t>& rr = rc[spare[s]];
+    for (size_t j = 0; j < rr.size(); j++) {
+      if (inactive[rr[j]] >= 0)
+        dense[s * w + inactive[rr[j]] / 64] ^= (uint64_t)1
+                                               << (inactive[rr[j]] % 64);
+      else
+        for (size_t x = 0; x < w; x++)
+          dense[s * w + x] ^= in[rr[j] * w + x];
+    }
+  }
+  std::vector<size_t> dorder;
+  std::vector<uint64_t> check(dense);
+  if (!gf2solve(check, spare.size(), w, m, dorder, nullptr, 0))
+    return false;
+
+  // It solves. The peeled unknowns as their symbol plus inactive ones
+  for (size_t p = 0; p < order.size(); p++) {
+    uint32_t c = order[p];
+    char* v = &_block[(size_t)unknown[c] * _symlen];
+    const std::vector<uint32_t>& rr = rc[pivot[c]];
+    memcpy(v, &_rows[rows[pivot[c]]].sym[0], _symlen);
+    for (size_t j = 0; j < rr.size(); j++)
+      if (rr[j] != c && inactive[rr[j]] < 0)
+        ltxor(v, &_block[(size_t)unknown[rr[j]] * _symlen], _symlen);
+  }
+  // The inactive unknowns from the rows left over
+  std::vector<char*> syms(spare.size());
+  for (size_t s = 0; s < spare.size(); s++) {
+    const std::vector<uint32_t>& rr = rc[spare[s]];
+    syms[s] = &_rows[rows[spare[s]]].sym[0];
+    for (size_t j = 0; j < rr.size(); j++)
+      if (inactive[rr[j]] < 0)
+        ltxor(syms[s], &_block[(size_t)unknown[rr[j]] * _symlen], _symlen);
+  }
+  gf2solve(dense, spare.size(), w, m, dorder, &syms, _symlen);
+  for (size_t i = 0; i < m; i++)
+    memcpy(&_block[(size_t)unknown[inact[i]] * _symlen], syms[dorder[i]],
+           _symlen);
+  // and put them into the peeled ones
+  for (size_t p = 0; p < order.size(); p++) {
+    uint32_t c = order[p];
+    char* v = &_block[(size_t)unknown[c] * _symlen];
+    for (size_t i = 0; i < m; i++)
+      if (in[c * w + i / 64] & ((uint64_t)1 << (i % 64)))
+        ltxor(v, &_block[(size_t)unknown[inact[i]] * _symlen], _symlen);
+  }
+  for (size_t c = 0; c < u; c++)
+    _have[unknown[c]] = true;
+  _found = nsym;
+  _rows.clear();
+  _refs.clear();
+  _live = 0;
+  return true;
+}
+
+bool
+ltdecoder::add(uint32_t e, const char* sym)
+{
+  if (this->done())
+    return true;
+  _received++;
+
+  ltrow r;
+  _code.neighbours(e, _nbrs);
+  r.sym.assign(sym, sym + _symlen);
+  for (size_t i = 0; i < _nbrs.size(); i++) {
+    if (_have[_nbrs[i]])
+      ltxor(&r.sym[0], &_block[(size_t)_nbrs[i] * _symlen], _symlen);
+    else
+      r.nbrs.push_back(_nbrs[i]);
+  }
+  if (r.nbrs.size() == 1)
+    this->found(r.nbrs[0], &r.sym[0]);
+  else if (r.nbrs.size() > 1) {
+    size_t at = _rows.size();
+    for (size_t i = 0; i < r.nbrs.size(); i++)
+      _refs[r.nbrs[i]].push_back((uint32_t)at);
+    _rows.push_back(ltrow());
+    _rows.back().nbrs.swap(r.nbrs);
+    _rows.back().sym.swap(r.sym);
+    _live++;
+  }
+  uint32_t left = _code.n() - _found;
+  if (left > 0 && _live >= left && _received >= _nextsolve && !this->solve())
+    _nextsolve = _received + 1 + left / 256;
+  return this->done();
+}
+
+} // Namespace saratoga
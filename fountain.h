@@ -0,0 +1,175 @@
+/*
+
+ Copyright (c) 2011, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#ifndef _FOUNTAIN_H
+#define _FOUNTAIN_H
+
+#include <cstring>
+#include <inttypes.h>
+#include <string>
+#include <vector>
+
+#include "saratoga.h"
+
+using namespace std;
+
+namespace saratoga {
+
+/*
+ **********************************************************************
+ * FOUNTAIN
+ **********************************************************************
+ */
+
+/*
+ * Fountain coding for multicast puts, a Raptor style code. The file is
+ * cut into blocks of no more than maxk source symbols. A few parity
+ * symbols are added to each block, every source symbol being in three of
+ * them, and the block then goes out as a run of encoding symbols that
+ * has no end. Encoding symbol e is the XOR of a set of the source and
+ * parity symbols picked by a generator seeded with e, so the receiver
+ * works out the same set from e alone. The size of each set follows the
+ * robust soliton distribution, which lets the receiver peel the block
+ * apart as symbols arrive, and the parity fills in the odd symbol that no
+ * encoding symbol happened to include. What the peeling leaves is solved
+ * by elimination. Any k and a few more will do, whichever were lost.
+ */
+
+// The symbols of a block of k that make up each encoding symbol
+class ltcode
+{
+private:
+  uint32_t _k;                // Source symbols
+  uint32_t _s;                // Parity symbols, a prime
+  std::vector<uint32_t> _cdf; // Chance of each degree or less, of 2^32
+
+public:
+  ltcode() { this->setup(1); };
+
+  void setup(uint32_t);
+  uint32_t k() const { return _k; };
+  uint32_t s() const { return _s; };
+  // Source then parity, what the encoding symbols are made from
+  uint32_t n() const { return _k + _s; };
+
+  // The three parity symbols source symbol i is in
+  void checks(uint32_t, uint32_t*) const;
+
+  // The source and parity symbols in encoding symbol e
+  void neighbours(uint32_t, std::vector<uint32_t>&) const;
+};
+
+// XOR a symbol into another
+void ltxor(char*, const char*, size_t);
+
+// Sending, a block read in whole and encoded from
+class ltencoder
+{
+private:
+  ltcode _code;
+  size_t _blen;             // Bytes of the file in the block
+  size_t _symlen;           // Bytes in each symbol
+  std::vector<char> _block; // n symbols, zero past the end of the file
+  bool _parity;             // The parity has been worked out
+  std::vector<uint32_t> _nbrs;
+
+public:
+  // Most source symbols in a block. A receiver keeps about this many
+  // symbols while it decodes
+  static const uint32_t maxk = 1024;
+
+  ltencoder() { this->setup(0, 1); };
+
+  // Size up for a block, returns where to read its blen bytes to
+  // before the first symbol is encoded
+  char* setup(size_t, size_t);
+
+  uint32_t k() const { return _code.k(); };
+  size_t blen() const { return _blen; };
+  size_t symlen() const { return _symlen; };
+
+  // Encoding symbol e into a buffer of symlen
+  void encode(uint32_t, char*);
+};
+
+// Receiving, builds a block from whichever encoding symbols arrive
+class ltdecoder
+{
+private:
+  // An encoding symbol less the source symbols already known
+  struct ltrow
+  {
+    std::vector<uint32_t> nbrs;
+    std::vector<char> sym;
+  };
+
+  ltcode _code;
+  size_t _blen;
+  size_t _symlen;
+  std::vector<char> _block; // Source and parity as they are found
+  std::vector<bool> _have;
+  uint32_t _found;
+  uint32_t _received;
+  std::vector<ltrow> _rows;
+  std::vector<std::vector<uint32_t> > _refs; // Rows using each symbol
+  size_t _live;        // Rows with more than one unknown
+  uint32_t _nextsolve; // Symbols in before elimination is tried again
+  std::vector<uint32_t> _nbrs;
+
+  void found(uint32_t, const char*);
+  bool solve();
+
+public:
+  ltdecoder() { this->setup(0, 1); };
+
+  void setup(size_t, size_t);
+
+  // An encoding symbol has arrived. True once the block is complete
+  bool add(uint32_t, const char*);
+
+  bool done() const { return _found == _code.n(); };
+  uint32_t k() const { return _code.k(); };
+  uint32_t received() const { return _received; };
+  size_t blen() const { return _blen; };
+  size_t symlen() const { return _symlen; };
+  const char* block() const { return _block.empty() ? nullptr : &_block[0]; };
+};
+
+} // Namespace saratoga
+
+#endif // _FOUNTAIN_H
@@ -0,0 +1,206 @@
+/*
+
+ Copyright (c) 2011, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+/*
+ * FOUNTAINDRIVER.CPP - check and benchmark for the fountain code
+ * (fountain.cpp)
+ *
+ * Decodes blocks of different sizes from encoding symbols with random
+ * loss and checks them against the original, reporting how many symbols
+ * over k each needed. Then times the encoder and decoder, and compares
+ * the frames a multicast put sends to reach every receiver with what
+ * putting the file to each receiver in turn would cost.
+ *
+ * Arguments: symbol length (default 1412), loss percent (default 10)
+ * and trials per block size (default 20).
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <time.h>
+#include <vector>
+
+#include "fountain.h"
+
+#ifdef FOUNTAINBENCH
+using namespace saratoga;
+
+static double
+Seconds(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static bool
+Lost(int percent)
+{
+  return (rand() % 1000) < percent * 10;
+}
+
+// Encoding symbols through a lossy channel until the block decodes,
+// how many got through
+static uint32_t
+Decode(ltencoder& enc, ltdecoder& dec, int loss, std::vector<char>& sym)
+{
+  dec.setup(enc.blen(), enc.symlen());
+  for (uint32_t e = 0;; e++) {
+    if (Lost(loss))
+      continue;
+    enc.encode(e, &sym[0]);
+    if (dec.add(e, &sym[0]))
+      return dec.received();
+  }
+}
+
+// Frames until every one of n receivers has the file, by multicast with
+// the fountain code and by a unicast put to each, resending what is lost
+static void
+Compare(size_t filesyms, int n, int loss)
+{
+  ltencoder enc;
+  std::vector<ltdecoder> dec(n);
+  std::vector<char> sym(16);
+  uint64_t multicast = 0;
+  uint64_t unicast = 0;
+
+  for (size_t first = 0; first < filesyms; first += ltencoder::maxk) {
+    size_t k = filesyms - first;
+    if (k > ltencoder::maxk)
+      k = ltencoder::maxk;
+    enc.setup(k * sym.size(), sym.size());
+    for (int r = 0; r < n; r++)
+      dec[r].setup(enc.blen(), enc.symlen());
+    int left = n;
+    for (uint32_t e = 0; left > 0; e++) {
+      multicast++;
+      enc.encode(e, &sym[0]);
+      for (int r = 0; r < n; r++)
+        if (!dec[r].done() && !Lost(loss) && dec[r].add(e, &sym[0]))
+          left--;
+    }
+  }
+  for (int r = 0; r < n; r++) {
+    size_t missing = filesyms;
+    while (missing > 0) {
+      size_t sent = missing;
+      unicast += sent;
+      for (size_t i = 0; i < sent; i++)
+        if (!Lost(loss))
+          missing--;
+    }
+  }
+  printf("%4d receivers %2d%% loss  multicast %8" PRIu64
+         "  unicast %9" PRIu64 "  %6.1fx\n",
+         n, loss, multicast, unicast, (double)unicast / multicast);
+}
+
+int
+main(int argc, char* argv[])
+{
+  size_t symlen = argc > 1 ? strtoul(argv[1], NULL, 10) : 1412;
+  int loss = argc > 2 ? atoi(argv[2]) : 10;
+  int trials = argc > 3 ? atoi(argv[3]) : 20;
+  uint32_t ks[] = { 1, 2, 3, 10, 50, 100, 300, 1000, ltencoder::maxk };
+  std::vector<char> sym(symlen);
+  ltencoder enc;
+  ltdecoder dec;
+  int bad = 0;
+  double t;
+
+  if (symlen == 0 || loss < 0 || loss > 90 || trials < 1) {
+    fprintf(stderr, "fountainbench: symlen loss%% trials\n");
+    return 2;
+  }
+  srand(1);
+  for (size_t i = 0; i < sizeof(ks) / sizeof(ks[0]); i++) {
+    uint32_t most = 0;
+    uint64_t total = 0;
+    for (int j = 0; j < trials; j++) {
+      // Short last symbol, it is zero padded
+      size_t blen = ks[i] * symlen - (ks[i] > 1 ? symlen / 3 : 0);
+      char* b = enc.setup(blen, symlen);
+      for (size_t x = 0; x < blen; x++)
+        b[x] = (char)rand();
+      uint32_t got = Decode(enc, dec, loss, sym);
+      if (memcmp(dec.block(), b, blen) != 0) {
+        fprintf(stderr, "k %u: block decoded wrong\n", ks[i]);
+        bad = 1;
+      }
+      total += got;
+      if (got > most)
+        most = got;
+    }
+    printf("k %4u  symbols needed mean %7.1f (+%5.1f%%)  worst %4u\n", ks[i],
+           (double)total / trials,
+           100.0 * ((double)total / trials - ks[i]) / ks[i], most);
+  }
+  printf("check %s\n", bad ? "FAILED" : "ok");
+
+  // Speed of a full block
+  uint32_t k = ltencoder::maxk;
+  char* b = enc.setup((size_t)k * symlen, symlen);
+  for (size_t x = 0; x < (size_t)k * symlen; x++)
+    b[x] = (char)rand();
+  uint32_t n = 0;
+  t = Seconds();
+  for (int j = 0; j < trials; j++)
+    for (uint32_t e = 0; e < k; e++, n++)
+      enc.encode(e, &sym[0]);
+  t = Seconds() - t;
+  printf("encode %8.1f MB/s\n", n * symlen / t / 1e6);
+  n = 0;
+  t = Seconds();
+  for (int j = 0; j < trials; j++)
+    n += Decode(enc, dec, loss, sym);
+  t = Seconds() - t;
+  printf("decode %8.1f MB/s (with encoding, %d%% loss)\n",
+         trials * (double)k * symlen / t / 1e6, loss);
+
+  // Four full blocks of file to each number of receivers
+  int receivers[] = { 1, 4, 16, 64 };
+  int losses[] = { 1, 5, 20 };
+  for (size_t l = 0; l < sizeof(losses) / sizeof(losses[0]); l++)
+    for (size_t r = 0; r < sizeof(receivers) / sizeof(receivers[0]); r++)
+      Compare(4 * ltencoder::maxk, receivers[r], losses[l]);
+  return bad;
+}
+#endif
@@ -61,6 +61,10 @@ const int MAXDATA = 8192 - 40 - 8 - 4 - 4 - 8 - 16;
 const int MAXDATA = 1500 - 40 - 8 - 4 - 4 - 8 - 16;
 #endif
 
+// DATA is sized at run time to the link to the peer, as big as this
+// on a 9000 byte jumbo frame LAN. MAXDATA is used when we can't tell.
+const int MAXJUMBODATA = 9000 - 40 - 8 - 4 - 4 - 8 - 16;
+
 // Minimum Directory Entry Payload is DirFlags + Mtime + Ctime + Null Byte
 const int MINDIRENT = 4 + 4 + 4 + 1;
 // Minimum Beacon Payload is just the SarFlags
@@ -0,0 +1,217 @@
+/*
+
+ Copyright (c) 2011, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <string>
+
+#include "dcodec.h"
+#include "frameview.h"
+#include "globals.h"
+#include "holes.h"
+#include "saratoga.h"
+#include "sarflags.h"
+#include "screen.h"
+#include "timestamp.h"
+
+using namespace std;
+
+namespace saratoga {
+
+// Decode a network order descriptor sized field at byte position pos
+// The caller has already bounds checked it
+offset_t
+frameview::getdescriptor(size_t pos) const
+{
+  const dcodecs* dc = dcodecs::lookup(this->descriptor());
+
+  // 128 bit descriptors are rejected by validate()
+  if (dc == nullptr)
+    return 0;
+  return dc->get(_frame + pos);
+}
+
+// Is this the frame we expected and is the fixed part all there
+bool
+frameview::validate(enum f_frametype ftype, size_t hdrlen)
+{
+  if (_badframe)
+    return false;
+
+  flag_t flags = this->flags();
+
+  if (hdr::version::get(flags) != F_VERSION_1) {
+    scr.error("frameview: Bad Saratoga Version");
+    _badframe = true;
+    return false;
+  }
+  if (hdr::frametype::get(flags) != (flag_t)ftype) {
+    scr.error("frameview: Frame type mismatch");
+    _badframe = true;
+    return false;
+  }
+  if (this->descriptor() == F_DESCRIPTOR_128) {
+    scr.error("frameview: Descriptor 128 Bit Size Not Supported\n");
+    _badframe = true;
+    return false;
+  }
+  if (_framelen < hdrlen) {
+    scr.error("frameview: Frame too short %zu < %zu", _framelen, hdrlen);
+    _badframe = true;
+    return false;
+  }
+  _hdrlen = hdrlen;
+  return true;
+}
+
+/*
+ * DATA
+ */
+dataview::dataview(const char* f, size_t len)
+  : frameview(f, len)
+{
+  if (_badframe)
+    return;
+  size_t hdrlen = sizeof(flag_t) + sizeof(session_t) + this->dlength();
+  if (this->reqtstamp() == F_TIMESTAMP_YES)
+    hdrlen += timestamp().length();
+  this->validate(F_FRAMETYPE_DATA, hdrlen);
+}
+
+timestamp
+dataview::tstamp() const
+{
+  size_t pos = sizeof(flag_t) + sizeof(session_t) + this->dlength();
+  return timestamp(const_cast<char*>(_frame + pos));
+}
+
+string
+dataview::print() const
+{
+  char tmp[128];
+
+  if (_badframe)
+    return ("dataview::print():: Bad DATA Frame");
+  sprintf(tmp, "DATA Session: %" PRIu32 " Offset: %" PRIu64
+               " Buffer Length: %zu",
+          (uint32_t) this->session(), (uint64_t) this->offset(),
+          this->dbuflen());
+  return (string)tmp;
+}
+
+/*
+ * STATUS
+ */
+statusview::statusview(const char* f, size_t len)
+  : frameview(f, len)
+{
+  _tslen = 0;
+  if (_badframe)
+    return;
+  if (this->reqtstamp() == F_TIMESTAMP_YES)
+    _tslen = timestamp().length();
+  size_t hdrlen =
+    sizeof(flag_t) + sizeof(session_t) + _tslen + this->dlength() * 2;
+  if (!this->validate(F_FRAMETYPE_STATUS, hdrlen))
+    return;
+  if ((_framelen - _hdrlen) % (this->dlength() * 2) != 0)
+    scr.debug(3, "statusview: Trailing partial hole pair ignored");
+}
+
+timestamp
+statusview::tstamp() const
+{
+  if (_tslen == 0)
+    return timestamp();
+  return timestamp(
+    const_cast<char*>(_frame + sizeof(flag_t) + sizeof(session_t)));
+}
+
+// Holes are sent as start & end, holes store start & length
+void
+statusview::getholes(holes* h) const
+{
+  std::list<hole> hl;
+  const dcodecs* dc = dcodecs::lookup(this->descriptor());
+  size_t count = this->holecount();
+
+  if (dc == nullptr || count == 0)
+    return;
+  if (dc->getholes(this->holebuf(), count, hl) != count)
+    scr.error("statusview: Invalid holes ignored");
+  h->add(hl);
+}
+
+string
+statusview::print() const
+{
+  char tmp[128];
+  string s;
+
+  if (_badframe)
+    return ("statusview::print():: Bad STATUS Frame");
+  sprintf(tmp, "STATUS Session: %" PRIu32 " Progress: %" PRIu64
+               " Inresponseto: %" PRIu64 " Holes: %zu",
+          (uint32_t) this->session(), (uint64_t) this->progress(),
+          (uint64_t) this->inresponseto(), this->holecount());
+  s = tmp;
+  for (size_t i = 0; i < this->holecount(); i++) {
+    sprintf(tmp, "\n    Hole[%zu]:%" PRIu64 " to %" PRIu64 "", i + 1,
+            (uint64_t) this->holestart(i), (uint64_t) this->holeend(i));
+    s += tmp;
+  }
+  return (s);
+}
+
+/*
+ * METADATA
+ */
+metadataview::metadataview(const char* f, size_t len)
+  : frameview(f, len)
+{
+  _csumlen = 0;
+  if (_badframe)
+    return;
+  // Checksum length is in 32 bit words
+  _csumlen = hdr::csumlen::get(this->flags()) * sizeof(uint32_t);
+  this->validate(F_FRAMETYPE_METADATA,
+                 sizeof(flag_t) + sizeof(session_t) + _csumlen);
+}
+
+}; // namespace saratoga
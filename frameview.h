@@ -0,0 +1,282 @@
+/*
+
+ Copyright (c) 2011, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#ifndef _FRAMEVIEW_H
+#define _FRAMEVIEW_H
+
+#include <cstring>
+#include <iostream>
+#include <string>
+using namespace std;
+
+#include "holes.h"
+#include "saratoga.h"
+#include "sarflags.h"
+#include "screen.h"
+#include "timestamp.h"
+
+namespace saratoga {
+/*
+ **********************************************************************
+ * FRAME VIEWS
+ **********************************************************************
+ */
+
+/*
+ * A frame view is a read only window onto a frame sitting in the
+ * receive buffer. Nothing is copied or allocated, the header is bounds
+ * checked once when the view is created and every field is decoded from
+ * the buffer only when it is asked for. The receive buffer MUST outlive
+ * the view.
+ */
+class frameview
+{
+protected:
+  const char* _frame; // The received frame (not ours do not free it)
+  size_t _framelen;   // Length of the received frame
+  size_t _hdrlen;     // Length of the fixed part of the frame
+  bool _badframe;     // Is the frame too short or not what we expected
+
+  // Raw network order fields at byte position pos in the frame
+  uint32_t get32(size_t pos) const
+  {
+    uint32_t tmp;
+    memcpy(&tmp, _frame + pos, sizeof(uint32_t));
+    return ntohl(tmp);
+  };
+  offset_t getdescriptor(size_t pos) const;
+
+  // Check version & frametype and that hdrlen bytes are there
+  bool validate(enum f_frametype, size_t hdrlen);
+
+public:
+  frameview(const char* f, size_t len)
+  {
+    _frame = f;
+    _framelen = len;
+    _hdrlen = 0;
+    _badframe = (f == nullptr || len < sizeof(flag_t) + sizeof(session_t));
+  };
+
+  bool badframe() const { return _badframe; };
+
+  flag_t flags() const { return (flag_t)get32(0); };
+  session_t session() const { return (session_t)get32(sizeof(flag_t)); };
+
+  enum f_descriptor descriptor() const
+  {
+    return (enum f_descriptor)hdr::descriptor::get(this->flags());
+  };
+
+  // Number of bytes in a descriptor for this frame (2, 4, 8 or 16)
+  size_t dlength() const
+  {
+    return ((size_t)2 << hdr::descriptor::get(this->flags()));
+  };
+
+  const char* frame() const { return _frame; };
+  size_t framelen() const { return _framelen; };
+};
+
+/*
+ * DATA frame view
+ *	flags, session, offset, [timestamp], payload
+ */
+class dataview : public frameview
+{
+public:
+  dataview(const char*, size_t);
+
+  enum f_transfer transfer() const
+  {
+    return (enum f_transfer)hdr::transfer::get(this->flags());
+  };
+  enum f_reqtstamp reqtstamp() const
+  {
+    return (enum f_reqtstamp)hdr::reqtstamp::get(this->flags());
+  };
+  enum f_reqstatus reqstatus() const
+  {
+    return (enum f_reqstatus)hdr::reqstatus::get(this->flags());
+  };
+  enum f_eod eod() const
+  {
+    return (enum f_eod)hdr::eod::get(this->flags());
+  };
+  enum f_compress compress() const
+  {
+    return (enum f_compress)hdr::compress::get(this->flags());
+  };
+
+  offset_t offset() const
+  {
+    return getdescriptor(sizeof(flag_t) + sizeof(session_t));
+  };
+
+  // Only valid if reqtstamp() is F_TIMESTAMP_YES
+  timestamp tstamp() const;
+
+  // The payload span, points into the receive buffer
+  const char* dbuf() const { return _frame + _hdrlen; };
+  size_t dbuflen() const { return _framelen - _hdrlen; };
+
+  string print() const;
+};
+
+/*
+ * STATUS frame view
+ *	flags, session, [timestamp], progress, inresponseto, holes...
+ * Holes are pairs of descriptors (start, end) both inclusive
+ */
+class statusview : public frameview
+{
+private:
+  size_t _tslen; // 0 or the length of the timestamp
+public:
+  statusview(const char*, size_t);
+
+  enum f_reqtstamp reqtstamp() const
+  {
+    return (enum f_reqtstamp)hdr::reqtstamp::get(this->flags());
+  };
+  enum f_metadatarecvd metadatarecvd() const
+  {
+    return (enum f_metadatarecvd)hdr::metadatarecvd::get(this->flags());
+  };
+  enum f_allholes allholes() const
+  {
+    return (enum f_allholes)hdr::allholes::get(this->flags());
+  };
+  enum f_reqholes reqholes() const
+  {
+    return (enum f_reqholes)hdr::reqholes::get(this->flags());
+  };
+  enum f_compress compress() const
+  {
+    return (enum f_compress)hdr::compress::get(this->flags());
+  };
+  enum f_errcode errcode() const
+  {
+    return (enum f_errcode)hdr::errcode::get(this->flags());
+  };
+
+  timestamp tstamp() const;
+
+  offset_t progress() const
+  {
+    return getdescriptor(sizeof(flag_t) + sizeof(session_t) + _tslen);
+  };
+  offset_t inresponseto() const
+  {
+    return getdescriptor(sizeof(flag_t) + sizeof(session_t) + _tslen +
+                         this->dlength());
+  };
+
+  // The hole pairs span
+  const char* holebuf() const { return _frame + _hdrlen; };
+  size_t holecount() const
+  {
+    return (_framelen - _hdrlen) / (this->dlength() * 2);
+  };
+  offset_t holestart(size_t n) const
+  {
+    return getdescriptor(_hdrlen + n * this->dlength() * 2);
+  };
+  offset_t holeend(size_t n) const
+  {
+    return getdescriptor(_hdrlen + n * this->dlength() * 2 + this->dlength());
+  };
+
+  // Add all of the hole pairs to h, compressing only once
+  void getholes(holes* h) const;
+
+  string errprint() const
+  {
+    Ferrcode e = this->flags();
+    return e.print();
+  };
+  string print() const;
+};
+
+/*
+ * METADATA frame view
+ *	flags, session, [checksum], directory entry
+ */
+class metadataview : public frameview
+{
+private:
+  size_t _csumlen; // Length of the checksum in bytes
+public:
+  metadataview(const char*, size_t);
+
+  enum f_transfer transfer() const
+  {
+    return (enum f_transfer)hdr::transfer::get(this->flags());
+  };
+  enum f_progress progress() const
+  {
+    return (enum f_progress)hdr::progress::get(this->flags());
+  };
+  enum f_udptype metadata_udptype() const
+  {
+    return (enum f_udptype)hdr::metadata_udptype::get(this->flags());
+  };
+  enum f_compress compress() const
+  {
+    return (enum f_compress)hdr::compress::get(this->flags());
+  };
+  enum f_csumtype csumtype() const
+  {
+    return (enum f_csumtype)hdr::csumtype::get(this->flags());
+  };
+
+  // The checksum span (network order 32 bit words)
+  const char* csumbuf() const
+  {
+    return _frame + sizeof(flag_t) + sizeof(session_t);
+  };
+  size_t csumlen() const { return _csumlen; };
+
+  // The directory entry span
+  const char* direntbuf() const { return _frame + _hdrlen; };
+  size_t direntlen() const { return _framelen - _hdrlen; };
+};
+
+} // Namespace saratoga
+
+#endif // _FRAMEVIEW_H
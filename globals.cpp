@@ -72,6 +72,7 @@ cli_history c_history;
 cli_home c_home;
 cli_ls c_ls;
 cli_put c_put;
+cli_mput c_mput;
 cli_putrm c_putrm;
 cli_rm c_rm;
 cli_rmdir c_rmdir;
@@ -84,6 +85,13 @@ cli_timezone c_timezone;
 cli_transfers c_transfers;
 cli_tx c_tx;
 cli_multicast c_multicast;
+cli_delta c_delta;
+cli_compress c_compress;
+cli_fec c_fec;
+cli_kiss c_kiss;
+cli_airtime c_airtime;
+cli_multipath c_multipath;
+cli_ax25port c_ax25port;
 cli_prompt c_prompt;
 cli_maxbuff c_maxbuff;
 
@@ -93,6 +101,8 @@ string if_loop = "127.0.0.1";
 string if6_loop = "::1";
 string if_mcast = "224.0.0.108";
 string if6_mcast = "FF02:0:0:0:0:0:0:6c";
+string ax25_port = "spacelink"; // From axports
+string ax25_mcast = "ALL";
 
 /* permanently opend sockets */
 sarnet::udp* v4out;
@@ -101,8 +111,8 @@ sarnet::udp* v6out;
 sarnet::udp* v6mcastout;
 sarnet::udp* v4ax24dummyout;
 
-sarnet::udp* ax25multiout;
-sarnet::udp* ax25multiin;
+std::vector<sarnet::ax25port> ax25ports;
+std::map<string, sarnet::datalink*> ax25routes;
 sarnet::udp* v4in;
 sarnet::udp* v6in;
 sarnet::udp* v4loop;
@@ -126,6 +136,11 @@ saratoga::peersinfo sarpeersinfo;
 // Dynamic List of current transfers in progress
 saratoga::transfers sartransfers;
 
+// Checksums already computed for local files
+checksums::csumcache sarcsums;
+// Completions from the checksum thread pool
+int sarcsumfd = -1;
+
 // Beacon Timer every n secs
 timer_group::timer beacontimer(0);
 
@@ -135,7 +150,35 @@ maxfd()
 {
   int lfilesfd = sarfiles.largestfd();
   int lpeersfd = sarpeers.largestfd();
-  return (lpeersfd > lfilesfd) ? lpeersfd : lfilesfd;
+  int lfd = (lpeersfd > lfilesfd) ? lpeersfd : lfilesfd;
+  return (sarcsumfd > lfd) ? sarcsumfd : lfd;
+}
+
+// The AX.25 port a callsign is reached on, by its route or the first
+sarnet::datalink*
+ax25route(const string& call)
+{
+  if (ax25ports.empty())
+    return (nullptr);
+  std::map<string, sarnet::datalink*>::iterator r = ax25routes.find(call);
+  if (r != ax25routes.end())
+    return (r->second);
+  return (ax25ports.front().link());
+}
+
+// Reach a callsign by link from now on, a station we already have moves
+// there with whatever it has queued
+void
+ax25reroute(const string& call, sarnet::datalink* l)
+{
+  ax25routes[call] = l;
+  sarnet::ip a(call);
+  sarnet::udp* p = sarpeers.match(&a);
+  if (p != nullptr && p->family() == AF_AX25 && p->link() != l) {
+    p->relink(l);
+    sarpeers.fdchange(true);
+    scr.msg("[AX25] %s now on %s", call.c_str(), l->print().c_str());
+  }
 }
 
 // Convert an ascii string of len bytes to integer
@@ -51,6 +51,7 @@
 #include <cstring>
 #include <iostream>
 #include <list>
+#include <map>
 #include <string>
 #include <sys/types.h>
 #include <vector>
@@ -94,6 +95,7 @@ extern cli_history c_history;
 extern cli_home c_home;
 extern cli_ls c_ls;
 extern cli_put c_put;
+extern cli_mput c_mput;
 extern cli_putrm c_putrm;
 extern cli_rm c_rm;
 extern cli_rmdir c_rmdir;
@@ -106,6 +108,13 @@ extern cli_timezone c_timezone;
 extern cli_transfers c_transfers;
 extern cli_tx c_tx;
 extern cli_multicast c_multicast;
+extern cli_delta c_delta;
+extern cli_compress c_compress;
+extern cli_fec c_fec;
+extern cli_kiss c_kiss;
+extern cli_airtime c_airtime;
+extern cli_multipath c_multipath;
+extern cli_ax25port c_ax25port;
 extern cli_prompt c_prompt;
 extern cli_maxbuff c_maxbuff;
 
@@ -115,12 +124,17 @@ extern const string if_loop;
 extern const string if6_loop;
 extern const string if_mcast;
 extern const string if6_mcast;
+extern string ax25_port;
+extern string ax25_mcast;
 
 // Permanently open udp sockets
 extern sarnet::udp* v4out;
 
-extern sarnet::udp* ax25multiout;
-extern sarnet::udp* ax25multiin;
+// The AX.25 ports, kernel or KISS, the first is where a station goes
+// when it has no route. Which port a callsign is on, heard there or set
+// with ax25route
+extern std::vector<sarnet::ax25port> ax25ports;
+extern std::map<string, sarnet::datalink*> ax25routes;
 extern sarnet::udp* v4mcastout;
 extern sarnet::udp* v6out;
 extern sarnet::udp* v6mcastout;
@@ -146,9 +160,15 @@ extern sarnet::peers sarpeers;
 extern saratoga::peersinfo sarpeersinfo;
 // Current transfers in progress
 extern saratoga::transfers sartransfers;
+// Checksums of local files already computed
+extern checksums::csumcache sarcsums;
+// Readable when the checksum threads have finished a file, -1 if none
+extern int sarcsumfd;
 
 // Functions in globals.cpp
 extern int maxfd();
+extern sarnet::datalink* ax25route(const string&);
+extern void ax25reroute(const string&, sarnet::datalink*);
 extern string printhex(const char*, const size_t);
 extern string printhex(const string);
 extern string printflags(string, flag_t);
@@ -305,6 +305,8 @@ scanagain:
     // Do we have a previous hole in the list
     std::list<hole>::iterator nexthole = curhole;
     nexthole++; // Point to the next hole
+    if (nexthole == _holes.end())
+      return;
     s = "Next hole is: " + nexthole->print();
     scr.debug(1, s);
 
@@ -313,8 +315,9 @@ scanagain:
       s = "curbegin == nextbegin " + curhole->print() + " " + nexthole->print();
       scr.debug(1, s);
       if (curhole->length() == nexthole->length()) {
-        // The holes are the same so remove dups
-        _holes.unique(compare_hole);
+        // The holes are the same so remove dups. Only equal ones,
+        // compare_hole() orders them and would take the rest too
+        _holes.unique();
         s = "Duplicate hole removed " + curhole->print();
         scr.debug(1, s);
         goto scanagain;
@@ -336,7 +339,7 @@ scanagain:
           nexthole->print();
       scr.debug(1, s);
       // Our current hole extends beyond the next hole
-      if (nexthole->ends() <= curhole->ends() + 1) {
+      if (nexthole->ends() <= curhole->ends()) {
         _holes.remove(*nexthole);
         goto scanagain;
       }
@@ -388,6 +391,23 @@ holes::add(offset_t begin, offset_t len)
   return;
 }
 
+// Add a list of holes to the list
+// Used when a STATUS carries many holes so we don't compress() per hole
+void
+holes::add(std::list<hole>& hl)
+{
+  for (std::list<hole>::iterator i = hl.begin(); i != hl.end(); i++) {
+    if (i->length() == 0)
+      continue;
+    if (_holes.size() >= holes::_max) {
+      scr.error("Maximum number of holes reached - Holes not added");
+      break;
+    }
+    _holes.push_back(*i);
+  }
+  this->compress();
+}
+
 void
 holes::remove(offset_t begin, offset_t len)
 {
@@ -161,6 +161,9 @@ public:
   // Add a hole to the list of holes
   void add(offset_t begin, offset_t len);
 
+  // Add a whole list of holes and only compress once
+  void add(std::list<hole>& hl);
+
   // Copy a list of holes
   holes& operator=(const holes& h)
   {
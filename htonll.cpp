@@ -39,40 +39,17 @@
 #include "saratoga.h"
 
 /*
- * Convert host to unsigned long long
+ * Convert host to network unsigned long long
+ * The compiler turns these into a single bswap (or nothing on big endian)
  */
 uint64_t
 htonll(uint64_t x)
 {
-  union htonll_type
-  {
-    uint64_t ull;
-    char c[8];
-  };
-  union htonll_type tmp, y;
-  static int i = 1;
-
-  /*
-   * We are Bigendian just return the same
-   */
-  if ((*(char*)&i) == 0)
-    return ((uint64_t)x);
-
-  /*
-   * We are Little Endian swap the bytes
-   */
-  tmp.ull = x;
-
-  y.c[0] = tmp.c[7];
-  y.c[1] = tmp.c[6];
-  y.c[2] = tmp.c[5];
-  y.c[3] = tmp.c[4];
-  y.c[4] = tmp.c[3];
-  y.c[5] = tmp.c[2];
-  y.c[6] = tmp.c[1];
-  y.c[7] = tmp.c[0];
-
-  return ((uint64_t)y.ull);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  return (x);
+#else
+  return (__builtin_bswap64(x));
+#endif
 }
 
 /*
@@ -81,33 +58,9 @@ htonll(uint64_t x)
 uint64_t
 ntohll(uint64_t x)
 {
-  union htonll_type
-  {
-    uint64_t ull;
-    char c[8];
-  };
-  union htonll_type tmp, y;
-  static int i = 1;
-
-  /*
-   * We are Bigendian just return the same
-   */
-  if ((*(char*)&i) == 0)
-    return ((uint64_t)x);
-
-  /*
-   * We are Little Endian swap the bytes
-   */
-  tmp.ull = x;
-
-  y.c[0] = tmp.c[7];
-  y.c[1] = tmp.c[6];
-  y.c[2] = tmp.c[5];
-  y.c[3] = tmp.c[4];
-  y.c[4] = tmp.c[3];
-  y.c[5] = tmp.c[2];
-  y.c[6] = tmp.c[1];
-  y.c[7] = tmp.c[0];
-
-  return ((uint64_t)y.ull);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  return (x);
+#else
+  return (__builtin_bswap64(x));
+#endif
 }
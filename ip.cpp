@@ -299,6 +299,7 @@ if_mtu(string ifname)
 udp::udp(string addr, int port)
 {
   const int on = 1;
+  _link = nullptr;
   struct sockaddr_in* in = (sockaddr_in*)&_sa;
   struct sockaddr_in6* in6 = (sockaddr_in6*)&_sa;
 
@@ -311,7 +312,12 @@ udp::udp(string addr, int port)
 
   switch (ipa.family()) {
     case AF_AX25:
-      constructax25(addr);
+      if (saratoga::ax25route(addr) == nullptr) {
+        _fd = -1;
+        saratoga::scr.error("Can't reach %s: No AX.25 link", addr.c_str());
+        return;
+      }
+      this->onlink(saratoga::ax25route(addr), addr);
       return;
     case AF_INET:
       _fd = socket(AF_INET, SOCK_DGRAM, proto->p_proto);
@@ -359,12 +365,14 @@ udp::udp(string addr, int port)
     _fd = -1;
     return;
   }
+  this->linkup(&_sa);
 }
 
 // Open socket to addr for writing
 udp::udp(sarnet::ip* addr, int port)
 {
   const int on = 1;
+  _link = nullptr;
   struct sockaddr_in* in = (sockaddr_in*)&_sa;
   struct sockaddr_in6* in6 = (sockaddr_in6*)&_sa;
 
@@ -376,7 +384,13 @@ udp::udp(sarnet::ip* addr, int port)
 
   switch (addr->family()) {
     case AF_AX25:
-      constructax25(addr->addrax25());
+      if (saratoga::ax25route(addr->addrax25()) == nullptr) {
+        _fd = -1;
+        saratoga::scr.error("Can't reach %s: No AX.25 link",
+                            addr->addrax25().c_str());
+        return;
+      }
+      this->onlink(saratoga::ax25route(addr->addrax25()), addr->addrax25());
       return;
     case AF_INET:
       _fd = socket(AF_INET, SOCK_DGRAM, proto->p_proto);
@@ -424,10 +438,12 @@ udp::udp(sarnet::ip* addr, int port)
     _fd = -1;
     return;
   }
+  this->linkup(&_sa);
 }
 
 udp::udp(struct sockaddr_storage* p)
 {
+  _link = nullptr;
 
   _readytotx = false;
   _fd = -1;                           // No fd for this type of udp
@@ -474,6 +490,7 @@ udp::udp(enum mcast_dir dir, udp* p, string addr, int port)
   proto = getprotobyname("UDP");
   ip ipa(addr);
 
+  _link = nullptr;
   _readytotx = false;
   _delay = new timer_group::timer(addr, c_timer.framedelay());
 
@@ -537,6 +554,7 @@ udp::udp(enum mcast_dir dir, udp* p, string addr, int port)
         _fd = -1;
         return;
       }
+      this->linkup();
       return;
     } else // MCAST_IN
     {
@@ -583,6 +601,7 @@ udp::udp(enum mcast_dir dir, udp* p, string addr, int port)
       string dmsg = "Multicast IPv4 input " + ipa.print() + " bound to " +
                     p->straddr() + " port " + p->strport();
       saratoga::scr.debug(7, "%s", dmsg.c_str());
+      this->linkup();
       return;
     }
     return;
@@ -639,7 +658,7 @@ udp::udp(enum mcast_dir dir, udp* p, string addr, int port)
         _fd = -1;
         return;
       }
-
+      this->linkup();
       return;
     } else // MCAST_IN
     {
@@ -678,6 +697,7 @@ udp::udp(enum mcast_dir dir, udp* p, string addr, int port)
       string dmsg = "Multicast IPv6 input " + ipa.print() + " bound to " +
                     p->straddr() + " port " + p->strport();
       saratoga::scr.debug(7, "%s", dmsg.c_str());
+      this->linkup();
       return;
     }
     return;
@@ -697,6 +717,7 @@ udp::udp(int protocol, int port)
   struct sockaddr_in6* in6 = (sockaddr_in6*)&_sa;
 
   proto = getprotobyname("UDP");
+  _link = nullptr;
   _readytotx = true;
   _delay = new timer_group::timer(c_timer.framedelay());
 
@@ -774,6 +795,8 @@ udp::udp(int protocol, int port)
     default:
       break;
   }
+  if (_fd != -1)
+    this->linkup();
 }
 
 // Should we do a htons here CHECK IT!
@@ -811,108 +834,84 @@ udp::strport()
   return (s);
 }
 
+// A link for the socket we have just opened
+void
+udp::linkup(const struct sockaddr_storage* peer)
+{
+  _link = new udplink(_fd, this->family(), peer);
+}
+
 // Actually send buffers to a udp socket
 int
 udp::send()
 {
-  if (this->family() == AF_AX25)
-    return ax25send();
-
-  // static socklen_t	tolen;
-  socklen_t tolen;
   ssize_t nwritten;
-  int flags = MSG_DONTWAIT;
-  size_t bcount = 0; // # bytes written
   string adr = this->straddr();
 
-  switch (this->family()) {
-    case AF_INET6:
-      tolen = sizeof(struct sockaddr_in6);
-      break;
-    case AF_INET:
-      tolen = sizeof(struct sockaddr_in);
-      break;
-    default:
-      saratoga::scr.error(
-        "hello udp::send(): Bad protocol only AF_INET & AF_INET6 supported\n");
-      return (-1);
+  if (_link == nullptr) {
+    saratoga::scr.error("udp::send(): No link to send to %s on", adr.c_str());
+    _buf.clear();
+    _queued = 0;
+    _readytotx = false;
+    return (-1);
   }
 
   // We only send frames when our delay has timed out
-  // Yes we will send all of the frames in our buffersa
-  // YES this could be problamatic I know but I dont want to do
-  // too many system calls!
+  // Yes we will send all of the frames in our buffers
+  // in as few system calls as the link can manage
   if (!_delay->timedout())
     return (0);
   _delay->reset();
-  // Send the buffers & flush the buffers
-  while (!_buf.empty()) {
-    saratoga::buffer* tmp = &(_buf.front());
-    char* b = tmp->buf();
-    ssize_t blen = tmp->len();
-    if (blen != 0) {
-      nwritten = sendto(_fd, b, blen, flags, this->saptr(), tolen);
-      if (nwritten < 0) {
-        int err = errno;
-        saratoga::scr.perror(
-          err, "udp::send(%d): Cannot write %d bytes to %s Port %d\n",
-          this->fd(), blen, adr.c_str(), this->port());
-      } else {
-        saratoga::scr.debug(4, "udp::send(%d): Wrote %d bytes to %s Port %d",
-                            this->fd(), nwritten, adr.c_str(), this->port());
-      }
-      bcount += nwritten;
-    }
-    // Pop it whether we sent it correctoy or not so we don't get
-    // into a race condition
-    _buf.pop_front();
-    // Send back total bytes written
+
+  linkaddr to = (this->family() == AF_AX25) ? linkaddr(_call) : linkaddr(&_sa);
+  if ((nwritten = _link->sendbatch(to, _buf)) < 0) {
+    int err = errno;
+    saratoga::scr.perror(err, "udp::send(%d): Cannot write to %s Port %d\n",
+                         this->fd(), adr.c_str(), this->port());
+    nwritten = 0;
+  } else {
+    saratoga::scr.debug(4, "udp::send(%d): Wrote %d bytes to %s Port %d",
+                        this->fd(), (int)nwritten, adr.c_str(), this->port());
   }
-  _readytotx = false;
-  return (bcount);
+  // Go round again for what the link had no room for
+  _readytotx = (!_buf.empty() || _link->backlog() > 0);
+  _queued = 0;
+  for (std::list<saratoga::buffer>::iterator b = _buf.begin(); b != _buf.end();
+       b++)
+    _queued += b->len();
+  _link->measure(nwritten, _readytotx);
+  return (nwritten);
 }
 
 ssize_t
 udp::rx(char* b, sarnet::ip* from)
 {
-  memset(b, 0, 9000);
-  if (this->family() == AF_AX25)
-    return ax25rx(b, from);
-
-  string s;
-
-  struct sockaddr_storage addrbuf;
-
-  socklen_t socklen;
+  linkaddr a;
   ssize_t nread;
-  int flags = MSG_DONTWAIT;
 
-  s = "Receiving interface " + this->print();
-  saratoga::scr.debug(2, s);
-  switch (this->family()) {
-    case AF_INET:
-      socklen = sizeof(struct sockaddr_in);
-      break;
-    case AF_INET6:
-      socklen = sizeof(struct sockaddr_in6);
-      break;
-    default:
-      saratoga::scr.error("udp::rx() Invalid family");
-      return -1;
+  if (_link == nullptr) {
+    saratoga::scr.error("udp::rx() No link");
+    return -1;
   }
+  memset(b, 0, 9000);
+  saratoga::scr.debug(2, "Receiving interface " + this->print());
 
-  nread = recvfrom(_fd, b, 9000, flags, (struct sockaddr*)&addrbuf, &socklen);
-
-  sarnet::ip retaddr(&addrbuf);
-  *from = retaddr;
-  s = retaddr.straddr();
-  saratoga::scr.debug(7, "udp::rx(): Received %d bytes from %s", nread,
-                      s.c_str());
-  if (nread < 0) {
+  if ((nread = _link->rx(b, 9000, a)) < 0) {
     int err = errno;
     saratoga::scr.perror(err, "udp::rx(): Cannot read\n");
+    return (nread);
   }
-
+  if (nread == 0)
+    return (0);
+  if (a.family() == AF_AX25) {
+    sarnet::ip retaddr(a.call());
+    *from = retaddr;
+  } else {
+    sarnet::ip retaddr(a.storage());
+    *from = retaddr;
+  }
+  saratoga::scr.debug(7, "udp::rx(): Received %d bytes from %s", (int)nread,
+                      from->straddr().c_str());
   return (nread);
 }
 
@@ -921,7 +920,7 @@ string
 udp::straddr()
 {
   if (this->family() == AF_AX25)
-    return (string)ax25addr;
+    return (_call);
 
   saratoga::scr.debug(7, "udp::straddr()\n");
   string ret;
@@ -1018,6 +1017,10 @@ peers::largestfd()
   largest = FDMAX(largest, v6mcastout->fd());
   largest = FDMAX(largest, v4mcastin->fd());
   largest = FDMAX(largest, v6mcastin->fd());
+  for (size_t i = 0; i < ax25ports.size(); i++) {
+    largest = FDMAX(largest, ax25ports[i].link()->fd());
+    largest = FDMAX(largest, ax25ports[i].link()->wfd());
+  }
 
   for (std::list<udp>::iterator i = _peers.begin(); i != _peers.end(); i++) {
     if (i->fd() > largest)
@@ -1085,14 +1088,8 @@ peers::add(sarnet::ip* address, int port)
       return (&(*i));
     }
   }
-  // AX25
-  if (address->family() == AF_AX25) {
-    char* cstr = new char[address->addrax25().length() + 1];
-    strcpy(cstr, address->addrax25().c_str());
-    newsock = new sarnet::udp(cstr);
-    saratoga::scr.debug(7, "created new AX25 peer %s", newsock->straddr());
-  } else
-    newsock = new sarnet::udp(address, port);
+  // AX25 peers are stations on the AX.25 link
+  newsock = new sarnet::udp(address, port);
 
   if (newsock->fd() <= 2) {
     saratoga::scr.error("peers::add cannot add peer with fd <= 2, fd=%d",
@@ -1121,14 +1118,7 @@ peers::add(string addr, int port)
       return (&(*i));
     }
   }
-  // AX25
-  if ((new ip(addr))->family() == AF_AX25) {
-    char* cstr = new char[addr.length() + 1];
-    strcpy(cstr, addr.c_str());
-    saratoga::scr.debug(7, "peers::add(string,int) created AX25 sock.");
-    newsock = new sarnet::udp(cstr);
-  } else
-    newsock = new sarnet::udp(addr, port);
+  newsock = new sarnet::udp(addr, port);
 
   if (newsock->fd() <= 2) {
     saratoga::scr.error("peers::add cannot add peer with fd <= 2, fd=%d",
@@ -1214,250 +1204,23 @@ peers::match(string addr)
  *  AX25
  *************************************/
 
-int udp::ax25outsock;
-char* udp::ax25srcaddress;
-struct full_sockaddr_ax25 udp::ax25src;
-bool udp::ax25available = false;
-char* udp::ax25portcall;
-int udp::ax25slen;
-int udp::ax25insock;
-char* udp::dev;
-
-int
-udp::initax25()
+udp::udp(datalink* l, string call)
 {
-  // AX25
-  if (ax25_config_load_ports() == 0) {
-    saratoga::scr.error("[AX25] No AX.25 ports defined\n");
-    return -1;
-  } else {
-
-    // Bootstrap
-    if ((ax25portcall = ax25_config_get_addr((char*)ax25port)) == NULL) {
-      saratoga::scr.error("[AX25] Invalid AX.25 port \n" + string(ax25port));
-      return -1;
-    }
-
-    // Prepare out socket
-    if ((ax25slen = ax25_aton(ax25portcall, &ax25src)) == -1) {
-      saratoga::scr.error("[AX25] Unable to convert source callsign \n" +
-                          string(ax25portcall));
-      return -1;
-    }
-    if ((ax25outsock = socket(AF_AX25, SOCK_DGRAM, 0)) == -1) {
-      saratoga::scr.error("[AX25] socket() error");
-      return -1;
-    }
-    if (bind(ax25outsock, (struct sockaddr*)&ax25src, ax25slen) == -1) {
-      saratoga::scr.error("[AX25] bind() error");
-      return -1;
-    }
-
-    ax25srcaddress = ax25_ntoa(&ax25src.fsa_ax25.sax25_call);
-
-    // Prepare in socket
-    if ((dev = ax25_config_get_dev((char*)ax25port)) == NULL) {
-      saratoga::scr.error(
-        "AX25 could not init outsocket: invalid port name \n");
-      return 1;
-    }
-    if ((ax25insock = socket(PF_PACKET, SOCK_PACKET, htons(ETH_P_AX25))) ==
-        -1) {
-      saratoga::scr.error("AX25 could not init outsocket \n" +
-                          to_string(ax25insock));
-      return 1;
-    }
-
-    ax25available = true;
-    saratoga::ax25multiout = new sarnet::udp(udp::ax25multidestcall);
-    saratoga::ax25multiin = new sarnet::udp(true);
-    saratoga::scr.msg("[AX25] AX.25 started with success.\n");
-  }
-
-  return 0;
+  this->onlink(l, call);
 }
 
+// A station on an AX.25 link, the link's fd is the one to write on
 void
-udp::constructax25(char* destcall)
-{
-
-  ax25addr = (string)destcall;
-  ax25destcall = destcall;
-  //_maxbuff=_ax25size;
-
-  // AX25 Stuff
-  if ((ax25dlen = ax25_aton(ax25destcall, &ax25dest)) == -1) {
-    saratoga::scr.error("[AX25] Unable to convert destination callsign \n" +
-                        string(ax25destcall));
-    return;
-  }
-
-  // IP Stuff
-  int port = 0;
-
-  const int on = 1;
-  struct sockaddr_in* in = (sockaddr_in*)&_sa;
-
-  _isax25 = true;
-  _readytotx = false;
-  _buf.empty();                       // No buffers either
-  _delay = new timer_group::timer(0); // No timer
-  _fd = ax25outsock;
-}
-
-// For in socket
-udp::udp(bool imanidiot)
+udp::onlink(datalink* l, string call)
 {
-  _maxbuff = _ax25size;
-
-  // IP Stuff
-  int port = 0;
-
-  const int on = 1;
-  struct sockaddr_in* in = (sockaddr_in*)&_sa;
-  struct protoent* proto;
-
-  _readytotx = false;
-
-  _isax25 = true;
+  _link = l;
+  _call = call;
+  bzero(&_sa, sizeof(struct sockaddr_storage));
+  _sa.ss_family = AF_AX25;
+  _fd = l->wfd();
   _readytotx = false;
   _buf.empty();                       // No buffers either
   _delay = new timer_group::timer(0); // No timer
-  _fd = ax25insock;
-}
-
-int
-udp::ax25send()
-{
-
-  saratoga::scr.debug(7, "udp::ax25send() entered.");
-  // static socklen_t	tolen;
-  socklen_t tolen;
-  ssize_t nwritten;
-  int flags = MSG_DONTWAIT;
-  size_t bcount = 0; // # bytes written
-  string adr = this->straddr();
-
-  // We only send frames when our delay has timed out
-  // Yes we will send all of the frames in our buffersa
-  // YES this could be problamatic I know but I dont want to do
-  // too many system calls!
-  if (!_delay->timedout())
-    return (0);
-  _delay->reset();
-  // Send the buffers & flush the buffers
-  while (!_buf.empty()) {
-    saratoga::buffer* tmp = &(_buf.front());
-    char* b = tmp->buf();
-    ssize_t blen = tmp->len();
-    if (blen != 0) {
-      // nwritten = sendto(_fd, b, blen, flags, this->saptr(), tolen);
-      saratoga::scr.debug(7, "[AX25] sendto AX25 something!");
-      nwritten = sendto(udp::ax25outsock, b, blen, flags,
-                        (struct sockaddr*)&ax25dest, ax25dlen);
-      if (nwritten < 0) {
-        int err = errno;
-        saratoga::scr.perror(
-          err, "ax25::send(%d): Cannot write %d bytes to %s Port %d\n",
-          this->fd(), blen, adr.c_str(), this->port());
-      } else {
-        saratoga::scr.debug(4, "ax25::send(%d): Wrote %d bytes to %s Port %d",
-                            this->fd(), nwritten, adr.c_str(), this->port());
-      }
-      bcount += nwritten;
-    }
-    // Pop it whether we sent it correctoy or not so we don't get
-    // into a race condition
-    _buf.pop_front();
-    // Send back total bytes written
-  }
-  _readytotx = false;
-  return (bcount);
-}
-
-// For out socket.
-udp::udp(char* destcall)
-{
-  constructax25(destcall);
-}
-
-static char*
-readable_dump(unsigned char* data, int length)
-{
-  unsigned char c;
-  int i;
-  int cr = 1;
-  char buf[1500];
-  memset(buf, 0, 1500);
-  char* str;
-  char *d, *m, *y, *h, *min, *s, *upd, *uph, *upm, *load0, *load1, *load2,
-    *freemem;
-
-  for (i = 0; length > 0; i++) {
-
-    c = *data++;
-    length--;
-
-    switch (c) {
-      case 0x00:
-        buf[i] = ' ';
-      case 0x0A: /* hum... */
-      case 0x0D:
-        if (cr)
-          buf[i] = ' ';
-        else
-          i--;
-        break;
-      default:
-        buf[i] = c;
-    }
-    cr = (buf[i] != '\n');
-  }
-  if (cr)
-    buf[i++] = '\n';
-  buf[i++] = '\0';
-  str = (char*)malloc(sizeof(char) * i);
-  memcpy(str, &buf[17], i);
-  return str;
-}
-
-ssize_t
-udp::ax25rx(char* b, sarnet::ip* from)
-{
-  saratoga::scr.debug(7, "udp::rx: Doing a AX25 detour.");
-  struct sockaddr sa;
-  socklen_t asize = sizeof(sa);
-  char* srcaddr;
-  char* tmp[8];
-  int nread;
-  unsigned char* data = ((unsigned char*)malloc(sizeof(unsigned char) * 9000));
-  memset(data, 0, 9000);
-
-  saratoga::scr.msg("AX25 Checking for messages.");
-
-  if ((nread = recvfrom(ax25insock, data, 9000, 0, &sa, &asize)) == -1) {
-    saratoga::scr.debug(7, "Nothing to read from ax25insock!");
-    return 0;
-  }
-
-  memcpy(b, &data[17], 8983);
-
-  memcpy(tmp, &data[8], 7);
-  srcaddr = ax25_ntoa((ax25_address*)tmp);
-  string addr = (string)srcaddr;
-  // string addr = sa.sa_data;
-  saratoga::scr.msg("AX25 Received beacon from " + addr);
-
-  sarnet::ip retaddr(addr);
-  *from = retaddr;
-
-  saratoga::scr.debug(7, "ax25::rx(): Received %d bytes from " + addr, nread);
-  if (nread < 0) {
-    int err = errno;
-    saratoga::scr.perror(err, "ax25::rx(): Cannot read\n");
-  }
-
-  return (nread - 17);
 }
 
 }; // namespace sarnet
@@ -71,6 +71,7 @@
 #include <netax25/axconfig.h>
 #include <netax25/axlib.h>
 
+#include "link.h"
 #include "sarflags.h"
 #include "screen.h"
 #include "timer.h"
@@ -461,85 +462,38 @@ public:
 class udp
 {
 private:
-  // AX25
-
-  static struct full_sockaddr_ax25 ax25src;
-  static char* ax25portcall;
-  static int ax25slen;
-  static char* dev;
-
-  static constexpr char* ax25port = "spacelink";
-  static constexpr char* ax25multidestcall = "ALL";
-
-  struct full_sockaddr_ax25 ax25dest;
-  char* ax25destcall;
-  string ax25addr;
-  int ax25dlen;
-
-  void constructax25(char* destcall);
-
-  void constructax25(string destcall)
-  {
-    char* cstr = new char[destcall.length() + 1];
-    strcpy(cstr, destcall.c_str());
-    this->constructax25(cstr);
-  }
-
-  int ax25send();
-  ssize_t ax25rx(char* b, sarnet::ip* from);
-
-  bool _isax25 = false;
-
-  // END
+  datalink* _link; // What the frames go over, shared by copies
+  string _call;    // AX.25 callsign, _sa has only the family
 
   struct sockaddr_storage
     _sa;   // sockaddr info and it is big enough to hold v4 & v6 info
   int _fd; // file descriptor
   std::list<saratoga::buffer> _buf; // Frames queued to send
+  size_t _queued = 0;               // Bytes of them
   bool _readytotx;                  // Sets FD_SET() or FD_CLR() for tx
   timer_group::timer*
     _delay; // Used to implement a delay between sending frames
 
-  static const ssize_t _jumbosize = 8192; // Jumbo ethernet frame size
-  static const ssize_t _ethsize = 1500;   // Normal ethernet frame size
-  static const ssize_t _udpheader = 8;    // Size of the udp header
-  static const ssize_t _v4header = 20;    // Max Size of an ipv4 header
-  static const ssize_t _v6header = 40;    // Size of an ipv6 header
-  static const ssize_t _ax25size = 255;
-  ssize_t _maxbuff = _ethsize;
-
   // We will ALWAYS send or recv a minumum of 4 bytes as this is the size of
   // the saratoga flags header so set the watermarks to this
   const int _rcvlowat = 4;
   const int _sndlowat = 4;
 
-  ssize_t _maxframesize()
-  {
-    if (this->family() == AF_INET)
-      return (_maxbuff - _v4header - _udpheader);
-    else if (this->family() == AF_AX25)
-      return _maxbuff;
-    else
-      return (_maxbuff - _v6header - _udpheader);
-  };
-
-public:
-  // AX25
-
-  static int ax25outsock;
-  static int ax25insock;
-  static bool ax25available;
-  static char* ax25srcaddress;
-
-  static int initax25();
+  // A link for the socket we have just opened, frames sized for the
+  // route to peer when we write to one
+  void linkup(const struct sockaddr_storage* peer = nullptr);
 
-  udp(char* dest);
-  udp(bool imanidiot);
+  // Or one we share as a station on it
+  void onlink(datalink* l, string call);
 
-  // END
+public:
+  // An AX.25 station on a link
+  udp(datalink* l, string call);
 
   udp()
   {
+    _link = nullptr;
+    _call = "";
     _fd = -1;
     _buf.empty();
     bzero(&_sa, sizeof(struct sockaddr_storage));
@@ -566,7 +520,9 @@ public:
   {
     // Clear the buffers
     _buf.clear();
-    if (_fd > 2) {
+    _queued = 0;
+    // An AX.25 station's fd is its link's
+    if (_fd > 2 && this->family() != AF_AX25) {
       shutdown(_fd, SHUT_RDWR);
       close(_fd);
       _fd = -1;
@@ -582,14 +538,10 @@ public:
     _fd = b->fd();
     _readytotx = b->_readytotx;
     _buf = b->_buf;
-    _isax25 = b->_isax25;
-    ax25destcall = b->ax25destcall;
-    ax25addr = b->ax25addr;
-    ax25dlen = b->ax25dlen;
-    ax25dest = b->ax25dest;
-
-    bzero(&_sa, sizeof(struct sockaddr_storage));
-    bcopy(&_sa, b->addr(), sizeof(struct sockaddr_storage));
+    _queued = b->_queued;
+    _link = b->_link;
+    _call = b->_call;
+    memcpy(&_sa, b->addr(), sizeof(struct sockaddr_storage));
   }
 
   // Copy a socket assignment
@@ -597,37 +549,52 @@ public:
   {
     _fd = s1.fd();
     _readytotx = s1.ready();
-
-    _isax25 = s1._isax25;
-    ax25destcall = s1.ax25destcall;
-    ax25addr = s1.ax25addr;
-    ax25dlen = s1.ax25dlen;
-    ax25dest = s1.ax25dest;
-
-    bzero(&_sa, sizeof(struct sockaddr_storage));
-    bcopy(&_sa, s1.addr(), sizeof(struct sockaddr_storage));
+    _link = s1._link;
+    _call = s1._call;
+    memcpy(&_sa, s1.addr(), sizeof(struct sockaddr_storage));
     return (*this);
   };
 
   bool operator==(const udp& s)
   {
+    return ((_fd == s._fd) && (_readytotx == s._readytotx) &&
+            //			(_buf == s._buf) &&
+            (memcmp(&_sa, &s._sa, sizeof(struct sockaddr_storage)) == 0) &&
+            _call == s._call);
+  };
 
-    if (!_isax25) {
-      return ((_fd == s._fd) && (_readytotx == s._readytotx) &&
-              //			(_buf == s._buf) &&
-              (memcmp(&_sa, &s._sa, sizeof(struct sockaddr_storage)) == 0));
-    } else
-      return ax25addr == s.ax25addr;
+  // Longest frame we can send, and the longest that goes out whole
+  ssize_t mtu() { return ((_link != nullptr) ? (ssize_t)_link->mtu() : 0); };
+  ssize_t framesize()
+  {
+    return ((_link != nullptr) ? (ssize_t)_link->framesize() : 0);
   };
 
-  ssize_t framesize() { return _maxframesize(); };
+  datalink* link() { return (_link); };
 
-  // What are we v4 or v6
-  int family()
+  // Frames already read from the link that select() won't tell us about
+  bool pending() { return (_link != nullptr && _link->pending()); };
+
+  // ms until the link will take frames again, 0 it will now
+  long holdoff() { return ((_link != nullptr) ? _link->holdoff() : 0); };
+
+  // An AX.25 station now reached on another port, what is queued goes
+  // with it
+  void relink(datalink* l)
   {
-    if (_isax25)
-      return AF_AX25;
+    _link = l;
+    _fd = l->wfd();
+  };
+
+  // Bytes waiting to go, here and in the link
+  size_t queued()
+  {
+    return (_queued + ((_link != nullptr) ? _link->backlog() : 0));
+  };
 
+  // What are we v4, v6 or AX.25
+  int family()
+  {
     struct sockaddr* s = (struct sockaddr*)&_sa;
     return (s->sa_family);
   };
@@ -647,6 +614,7 @@ public:
     // alloc the memory for it and then push it
     saratoga::buffer* tmp = new saratoga::buffer(buf, buflen);
     _buf.push_back(*tmp);
+    _queued += buflen;
 
     // make FD_SET ready() test to true
     // that way we can call send() when ready
@@ -701,6 +669,33 @@ public:
   virtual string print();
 };
 
+// An AX.25 port we have open, its name in saratoga.conf, the link and the
+// station on it that frames to the group go to
+class ax25port
+{
+private:
+  string _name;
+  datalink* _link;
+  udp* _group;
+  bool _halfduplex; // Stations wait for the transfers on it
+
+public:
+  ax25port(const string& name, datalink* l, const string& group,
+           bool halfduplex)
+  {
+    _name = name;
+    _link = l;
+    _group = new udp(l, group);
+    _halfduplex = halfduplex;
+  };
+
+  string name() { return (_name); };
+  datalink* link() { return (_link); };
+  udp* group() { return (_group); };
+  bool halfduplex() { return (_halfduplex); };
+  string print() { return (_name + ": " + _link->print()); };
+};
+
 // List of currently opened udp peers
 class peers
 {
@@ -0,0 +1,459 @@
+/*
+
+ Copyright (c) 2011, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <termios.h>
+#include <unistd.h>
+
+#include "kiss.h"
+
+using namespace std;
+
+namespace sarnet {
+
+const uint8_t kiss::FEND;
+const uint8_t kiss::FESC;
+const uint8_t kiss::TFEND;
+const uint8_t kiss::TFESC;
+const uint8_t kiss::DATAFRAME;
+const size_t kiss::maxframe;
+
+kiss::kiss()
+{
+  _fd = -1;
+  _ptyhold = -1;
+  _device = "";
+  _ptyname = "";
+  _mycallstr = "";
+  _decoded = nullptr;
+  memset(_mycall, 0, sizeof(_mycall));
+  memset(_groupcall, 0, sizeof(_groupcall));
+  _rbuf.resize(readsize);
+  _inframe = false;
+  _esc = false;
+  _toolong = false;
+  _outoff = 0;
+  _txframes = 0;
+  _rxframes = 0;
+  _rxdropped = 0;
+}
+
+void
+kiss::zap()
+{
+  if (_fd >= 0)
+    close(_fd);
+  if (_ptyhold >= 0)
+    close(_ptyhold);
+  _fd = -1;
+  _ptyhold = -1;
+  _rxq.clear();
+  _frame.clear();
+  _out.clear();
+  _outoff = 0;
+  _inframe = false;
+  _esc = false;
+  _toolong = false;
+}
+
+// Raw 8 bit, no echo, no line editing, at the given speed
+bool
+kiss::rawmode(int fd, int baud)
+{
+  struct termios t;
+  speed_t speed;
+
+  if (tcgetattr(fd, &t) < 0)
+    return (errno == ENOTTY && baud == 0); // A pipe or socket will do
+  cfmakeraw(&t);
+  t.c_cflag |= (CLOCAL | CREAD);
+  t.c_cc[VMIN] = 1;
+  t.c_cc[VTIME] = 0;
+  if (baud != 0) {
+    switch (baud) {
+      case 1200:
+        speed = B1200;
+        break;
+      case 2400:
+        speed = B2400;
+        break;
+      case 4800:
+        speed = B4800;
+        break;
+      case 9600:
+        speed = B9600;
+        break;
+      case 19200:
+        speed = B19200;
+        break;
+      case 38400:
+        speed = B38400;
+        break;
+      case 57600:
+        speed = B57600;
+        break;
+      case 115200:
+        speed = B115200;
+        break;
+      case 230400:
+        speed = B230400;
+        break;
+      default:
+        errno = EINVAL;
+        return (false);
+    }
+    cfsetispeed(&t, speed);
+    cfsetospeed(&t, speed);
+  }
+  return (tcsetattr(fd, TCSANOW, &t) == 0);
+}
+
+bool
+kiss::open(const string& device, const string& mycall,
+           const string& groupcall, int baud)
+{
+  this->zap();
+  if (!aton(mycall, _mycall) || !aton(groupcall, _groupcall)) {
+    errno = EINVAL;
+    return (false);
+  }
+  _mycallstr = ntoa(_mycall);
+  _device = device;
+  if (device == "pty") {
+    char* slave;
+    if ((_fd = posix_openpt(O_RDWR | O_NOCTTY)) < 0 || grantpt(_fd) < 0 ||
+        unlockpt(_fd) < 0 || (slave = ptsname(_fd)) == nullptr)
+      goto fail;
+    _ptyname = slave;
+    if ((_ptyhold = ::open(slave, O_RDWR | O_NOCTTY)) < 0 ||
+        !rawmode(_ptyhold, 0))
+      goto fail;
+  } else {
+    if ((_fd = ::open(device.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK)) < 0 ||
+        !rawmode(_fd, baud))
+      goto fail;
+  }
+  if (fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK) < 0)
+    goto fail;
+  return (true);
+
+fail:
+  int err = errno;
+  this->zap();
+  errno = err;
+  return (false);
+}
+
+// "CALL" or "CALL-SSID", upper cased and shifted, SSID in bits 1..4 of
+// the last byte with the reserved bits set
+bool
+kiss::aton(const string& call, uint8_t* addr)
+{
+  size_t dash = call.find('-');
+  string c = call.substr(0, dash);
+  int ssid = 0;
+
+  if (c.length() < 1 || c.length() > 6)
+    return (false);
+  if (dash != string::npos) {
+    string s = call.substr(dash + 1);
+    if (s.length() < 1 || s.length() > 2)
+      return (false);
+    for (size_t i = 0; i < s.length(); i++)
+      if (!isdigit((unsigned char)s[i]))
+        return (false);
+    if ((ssid = atoi(s.c_str())) > 15)
+      return (false);
+  }
+  for (size_t i = 0; i < 6; i++) {
+    unsigned char ch = (i < c.length()) ? toupper((unsigned char)c[i]) : ' ';
+    if (ch != ' ' && !isalnum(ch))
+      return (false);
+    addr[i] = (uint8_t)(ch << 1);
+  }
+  addr[6] = (uint8_t)(0x60 | (ssid << 1));
+  return (true);
+}
+
+string
+kiss::ntoa(const uint8_t* addr)
+{
+  string s = "";
+  char tmp[8];
+  int ssid = (addr[6] >> 1) & 0x0F;
+
+  for (size_t i = 0; i < 6; i++) {
+    char ch = (char)(addr[i] >> 1);
+    if (ch == ' ')
+      break;
+    s += ch;
+  }
+  if (ssid != 0) {
+    sprintf(tmp, "-%d", ssid);
+    s += tmp;
+  }
+  return (s);
+}
+
+// Same callsign and SSID, whatever the other bits are
+static bool
+samecall(const uint8_t* a, const uint8_t* b)
+{
+  return (memcmp(a, b, 6) == 0 && (a[6] & 0x1E) == (b[6] & 0x1E));
+}
+
+// Append to _out with FEND and FESC escaped, the runs in between in one go
+void
+kiss::escape(const uint8_t* b, size_t len)
+{
+  size_t run = 0;
+
+  for (size_t i = 0; i < len; i++) {
+    if (b[i] != FEND && b[i] != FESC)
+      continue;
+    _out.insert(_out.end(), b + run, b + i);
+    _out.push_back(FESC);
+    _out.push_back(b[i] == FEND ? TFEND : TFESC);
+    run = i + 1;
+  }
+  _out.insert(_out.end(), b + run, b + len);
+}
+
+bool
+kiss::queue(const string& dest, const char* b, size_t len)
+{
+  uint8_t hdr[16];
+
+  if (!aton(dest, hdr))
+    return (false);
+  hdr[6] |= 0x80; // Command
+  memcpy(&hdr[7], _mycall, 7);
+  hdr[13] |= 0x01; // Last address
+  hdr[14] = UI;
+  hdr[15] = NOLAYER3;
+
+  // Drop what has been written once it is most of the buffer
+  if (_outoff > 0 && _outoff >= _out.size() / 2) {
+    _out.erase(_out.begin(), _out.begin() + _outoff);
+    _outoff = 0;
+  }
+  _out.push_back(FEND);
+  _out.push_back(DATAFRAME);
+  escape(hdr, sizeof(hdr));
+  escape((const uint8_t*)b, len);
+  _out.push_back(FEND);
+  _txframes++;
+  return (true);
+}
+
+ssize_t
+kiss::flush()
+{
+  ssize_t total = 0;
+
+  while (_outoff < _out.size()) {
+    ssize_t n = write(_fd, &_out[_outoff], _out.size() - _outoff);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        break;
+      return (-1);
+    }
+    _outoff += n;
+    total += n;
+  }
+  if (_outoff == _out.size()) {
+    _out.clear();
+    _outoff = 0;
+  }
+  return (total);
+}
+
+// A whole KISS frame is in _frame, keep it if it is a UI frame for us
+void
+kiss::decode()
+{
+  const uint8_t* f = &_frame[0];
+  size_t len = _frame.size();
+  size_t pos = 1;
+
+  // Data frames only, not TNC parameters
+  if (len < 1 + 14 + 2 || (f[0] & 0x0F) != DATAFRAME) {
+    _rxdropped++;
+    return;
+  }
+  // Destination, source, then up to 8 digipeaters
+  for (int naddr = 1;; naddr++) {
+    if (pos + 7 > len || naddr > 10) {
+      _rxdropped++;
+      return;
+    }
+    pos += 7;
+    if (f[pos - 1] & 0x01)
+      break;
+  }
+  if (pos + 2 > len || pos < 1 + 14 || (f[pos] & ~0x10) != UI ||
+      f[pos + 1] != NOLAYER3) {
+    _rxdropped++;
+    return;
+  }
+  if ((!samecall(&f[1], _mycall) && !samecall(&f[1], _groupcall)) ||
+      samecall(&f[8], _mycall)) {
+    _rxdropped++;
+    return;
+  }
+  pos += 2;
+  _decoded->push_back(linkframe());
+  _decoded->back().from = linkaddr(ntoa(&f[8]));
+  _decoded->back().data.assign(f + pos, f + len);
+  _rxframes++;
+}
+
+// Unescape what was read, decoding each frame as its closing FEND arrives
+void
+kiss::deframe(const uint8_t* b, size_t len)
+{
+  static const size_t maxkiss = 1 + 10 * 7 + 2 + maxframe;
+  size_t i = 0;
+
+  while (i < len) {
+    uint8_t c = b[i];
+    if (c == FEND) {
+      if (_inframe && !_frame.empty() && !_toolong)
+        decode();
+      else if (_toolong)
+        _rxdropped++;
+      _frame.clear();
+      _inframe = true;
+      _esc = false;
+      _toolong = false;
+      i++;
+      continue;
+    }
+    if (!_inframe) {
+      i++;
+      continue;
+    }
+    if (_esc) {
+      _esc = false;
+      c = (c == TFEND) ? FEND : (c == TFESC) ? FESC : c;
+    } else if (c == FESC) {
+      _esc = true;
+      i++;
+      continue;
+    } else {
+      // Take the run up to the next special byte in one go
+      size_t j = i;
+      while (j < len && b[j] != FEND && b[j] != FESC)
+        j++;
+      if (_frame.size() + (j - i) > maxkiss)
+        _toolong = true;
+      else
+        _frame.insert(_frame.end(), b + i, b + j);
+      i = j;
+      continue;
+    }
+    if (_frame.size() + 1 > maxkiss)
+      _toolong = true;
+    else
+      _frame.push_back(c);
+    i++;
+  }
+}
+
+ssize_t
+kiss::sendbatch(const linkaddr& to, std::list<saratoga::buffer>& frames)
+{
+  while (!frames.empty()) {
+    saratoga::buffer* b = &frames.front();
+    if (b->len() != 0 && !this->queue(to.call(), b->buf(), b->len())) {
+      frames.clear();
+      errno = EINVAL;
+      return (-1);
+    }
+    frames.pop_front();
+  }
+  return (this->flush());
+}
+
+ssize_t
+kiss::recvbatch(std::deque<linkframe>& frames)
+{
+  size_t before = frames.size();
+
+  _decoded = &frames;
+  for (;;) {
+    ssize_t n = read(_fd, &_rbuf[0], readsize);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EIO)
+        break;
+      _decoded = nullptr;
+      return (-1);
+    }
+    if (n == 0)
+      break;
+    deframe(&_rbuf[0], n);
+    // Stop at a short read, or once we have something for a full one
+    if ((size_t)n < readsize || frames.size() > before)
+      break;
+  }
+  _decoded = nullptr;
+  return (frames.size() - before);
+}
+
+string
+kiss::print()
+{
+  char tmp[256];
+
+  sprintf(tmp, "KISS %s as %s, %zu frames sent, %zu received, %zu dropped",
+          (_ptyname != "") ? _ptyname.c_str() : _device.c_str(),
+          _mycallstr.c_str(), _txframes, _rxframes, _rxdropped);
+  return (string(tmp));
+}
+
+}; // namespace sarnet
@@ -0,0 +1,160 @@
+/*
+
+ Copyright (c) 2011, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#ifndef _KISS_H
+#define _KISS_H
+
+#include <deque>
+#include <inttypes.h>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#include "link.h"
+
+using namespace std;
+
+namespace sarnet {
+
+/*
+ **********************************************************************
+ * KISS
+ **********************************************************************
+ */
+
+/*
+ * AX.25 through a KISS TNC on a serial line or pty, no kernel AX.25
+ * stack needed. Each frame goes out as an AX.25 UI frame (control 0x03,
+ * PID 0xF0, no layer 3) from our callsign, wrapped in KISS framing:
+ * FEND, a command byte for data on port 0, the frame with any FEND or
+ * FESC in it escaped, then FEND. The TNC adds the FCS.
+ *
+ * Writes are batched, every frame queued goes to the device in one
+ * write(). Reads are batched too, one read() takes whatever the device
+ * has and all the frames in it are decoded. Only UI frames to our
+ * callsign or the group callsign are kept.
+ *
+ * A device of "pty" opens a pseudo terminal instead, ptyname() is the
+ * end for the TNC side (kissattach, a soundmodem or another saratoga).
+ */
+class kiss : public datalink
+{
+private:
+  int _fd;         // The serial line or pty master
+  int _ptyhold;    // Our hold on the pty slave so reads don't fail with EIO
+  string _device;  // What we opened
+  string _ptyname; // Slave of our pty
+  uint8_t _mycall[7];
+  uint8_t _groupcall[7];
+  string _mycallstr;
+
+  std::deque<linkframe>* _decoded; // Where decode() puts frames
+  std::vector<uint8_t> _rbuf;       // What one read() gets
+  std::vector<uint8_t> _frame; // The frame being unescaped
+  bool _inframe;               // Have we seen the opening FEND
+  bool _esc;                   // Was the last byte FESC
+  bool _toolong;               // Drop the frame being unescaped
+
+  // Encoded frames not written yet
+  std::vector<uint8_t> _out;
+  size_t _outoff;
+
+  size_t _txframes;
+  size_t _rxframes;
+  size_t _rxdropped;
+
+  static const uint8_t FEND = 0xC0;
+  static const uint8_t FESC = 0xDB;
+  static const uint8_t TFEND = 0xDC;
+  static const uint8_t TFESC = 0xDD;
+  static const uint8_t DATAFRAME = 0x00; // Data on port 0
+  static const uint8_t UI = 0x03;
+  static const uint8_t NOLAYER3 = 0xF0;
+  static const size_t readsize = 65536;
+
+  void escape(const uint8_t* b, size_t len);
+  void deframe(const uint8_t* b, size_t len);
+  void decode();
+  bool rawmode(int fd, int baud);
+
+public:
+  static const size_t maxframe = 9000; // Longest info field kept
+  static const size_t ax25mtu = 255;
+
+  kiss();
+  ~kiss() { this->zap(); };
+
+  void zap();
+
+  // Open a serial device at baud (0 leaves the speed alone) or "pty",
+  // false with errno set if it can't be done
+  bool open(const string& device, const string& mycall,
+            const string& groupcall, int baud);
+
+  int family() { return (AF_AX25); };
+  size_t mtu() { return (ax25mtu); };
+  int fd() { return (_fd); };
+  string addr() { return (_mycallstr); };
+  string ptyname() { return (_ptyname); };
+
+  // Queue a UI frame to a callsign, false if the callsign is bad
+  bool queue(const string& dest, const char* b, size_t len);
+
+  // Write what is queued, the bytes written, 0 if the device is full
+  // or -1 on an error
+  ssize_t flush();
+
+  // Bytes queued and not yet written
+  size_t backlog() { return (_out.size() - _outoff); };
+
+  // Queue them all then flush
+  ssize_t sendbatch(const linkaddr& to, std::list<saratoga::buffer>& frames);
+
+  // Decode every frame in one read()
+  ssize_t recvbatch(std::deque<linkframe>& frames);
+
+  // Callsigns to and from the 7 byte AX.25 address form
+  static bool aton(const string& call, uint8_t* addr);
+  static string ntoa(const uint8_t* addr);
+
+  string print();
+};
+
+}; // namespace sarnet
+
+#endif // _KISS_H
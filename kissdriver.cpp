@@ -0,0 +1,198 @@
+/*
+
+ Copyright (c) 2011, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+/*
+ * KISSDRIVER.CPP - check and benchmark for the KISS TNC link (kiss.cpp)
+ *
+ * Checks callsign encoding, then opens a pty as one end of the link and
+ * its slave as the other, and sends frames across with every byte value
+ * in them, some to a callsign the far end must drop. Each frame is
+ * checked as it arrives and the run is timed, first writing each frame
+ * on its own and then writing them in batches.
+ *
+ * Arguments: frames to send (default 20000), longest info field
+ * (default 240) and frames in a batch (default 32).
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <poll.h>
+#include <string>
+#include <time.h>
+#include <vector>
+
+#include "kiss.h"
+
+#ifdef KISSBENCH
+using namespace sarnet;
+
+static double
+Seconds(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+// Frame i's info field, its number then a pattern through all byte values
+static size_t
+Fill(std::vector<char>& b, size_t i, size_t maxlen)
+{
+  size_t len = 4 + (i * 37) % (maxlen - 3);
+  uint32_t id = i;
+
+  b.resize(len);
+  memcpy(&b[0], &id, 4);
+  for (size_t j = 4; j < len; j++)
+    b[j] = (char)((i * 131 + j * 7) ^ (j >> 3));
+  return len;
+}
+
+static bool
+Codec(void)
+{
+  const char* good[] = { "G4ABC", "G4ABC-7", "ALL", "N0CALL-15", "a1b" };
+  const char* bad[] = { "", "TOOLONGX", "G4ABC-16", "G4ABC-", "G4-ABC", "G4*B" };
+  uint8_t addr[7];
+  bool ok = true;
+
+  for (size_t i = 0; i < sizeof(good) / sizeof(good[0]); i++) {
+    string s = good[i];
+    for (size_t j = 0; j < s.length(); j++)
+      s[j] = toupper(s[j]);
+    if (!kiss::aton(good[i], addr) || kiss::ntoa(addr) != s) {
+      fprintf(stderr, "callsign %s did not come back\n", good[i]);
+      ok = false;
+    }
+  }
+  for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    if (kiss::aton(bad[i], addr)) {
+      fprintf(stderr, "callsign %s taken\n", bad[i]);
+      ok = false;
+    }
+  return ok;
+}
+
+// Send n frames from a to b, batch to a write, how long it took or < 0
+static double
+Run(kiss& a, kiss& b, size_t n, size_t maxlen, size_t batch)
+{
+  std::vector<char> out, in(kiss::maxframe);
+  size_t sent = 0, expect = 0, got = 0, idle = 0;
+  struct pollfd p;
+  linkaddr from;
+  ssize_t len;
+  double t = Seconds();
+
+  p.fd = b.fd();
+  p.events = POLLIN;
+  for (size_t i = 0; i < n; i++)
+    if (i % 16 != 15)
+      expect++;
+  while (got < expect) {
+    // Every 16th to someone else, every 8th to the group
+    for (size_t k = 0; k < batch && sent < n && (k > 0 || a.backlog() == 0);
+         k++) {
+      Fill(out, sent, maxlen);
+      a.queue((sent % 16 == 15) ? "N0ONE" : (sent % 8 == 7) ? "ALL" : "SAR2",
+              &out[0], out.size());
+      sent++;
+    }
+    if (a.flush() < 0) {
+      perror("kissbench: write");
+      return -1;
+    }
+    if (poll(&p, 1, 1000) <= 0) {
+      if (++idle > 2) {
+        fprintf(stderr, "kissbench: stalled at %zu of %zu\n", got, expect);
+        return -1;
+      }
+      continue;
+    }
+    idle = 0;
+    while ((len = b.rx(&in[0], in.size(), from)) > 0) {
+      uint32_t i;
+      memcpy(&i, &in[0], 4);
+      Fill(out, i, maxlen);
+      if (from.call() != "SAR1" || i % 16 == 15 || (size_t)len != out.size() ||
+          memcmp(&in[0], &out[0], len) != 0) {
+        fprintf(stderr, "kissbench: frame %u from %s bad\n", i,
+                from.call().c_str());
+        return -1;
+      }
+      got++;
+    }
+  }
+  return Seconds() - t;
+}
+
+int
+main(int argc, char** argv)
+{
+  size_t n = argc > 1 ? strtoul(argv[1], NULL, 10) : 20000;
+  size_t maxlen = argc > 2 ? strtoul(argv[2], NULL, 10) : 240;
+  size_t batch = argc > 3 ? strtoul(argv[3], NULL, 10) : 32;
+  kiss a, b;
+  bool ok = Codec();
+  double t1, tb;
+
+  printf("callsigns %s\n", ok ? "ok" : "FAILED");
+  if (maxlen < 8 || maxlen > kiss::maxframe || batch < 1) {
+    fprintf(stderr, "kissbench: bad arguments\n");
+    return 2;
+  }
+  if (!a.open("pty", "SAR1", "ALL", 0) ||
+      !b.open(a.ptyname(), "SAR2", "ALL", 0)) {
+    perror("kissbench: open");
+    return 2;
+  }
+  printf("pty %s, %zu frames of up to %zu bytes\n", a.ptyname().c_str(), n,
+         maxlen);
+
+  if ((t1 = Run(a, b, n, maxlen, 1)) < 0 ||
+      (tb = Run(a, b, n, maxlen, batch)) < 0)
+    return 1;
+  printf("one a write    %8.0f frames/s\n", n / t1);
+  printf("%3zu a write    %8.0f frames/s\n", batch, n / tb);
+  printf("%s\n", a.print().c_str());
+  printf("%s\n", b.print().c_str());
+  return ok ? 0 : 1;
+}
+#endif
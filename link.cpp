@@ -0,0 +1,929 @@
+/*
+
+ Copyright (c) 2011, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <arpa/inet.h>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <netax25/axconfig.h>
+#include <netax25/axlib.h>
+
+#include "globals.h"
+#include "link.h"
+#include "screen.h"
+
+using namespace std;
+
+namespace sarnet {
+
+// Milliseconds on the monotonic clock
+static uint64_t
+msnow()
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return ((uint64_t)t.tv_sec * 1000 + t.tv_nsec / 1000000);
+}
+
+void
+datalink::measure(size_t bytes, bool busy)
+{
+  uint64_t now = msnow();
+
+  if (_ratefrom == 0)
+    _ratefrom = now;
+  _ratebytes += bytes;
+  _ratebusy = _ratebusy || busy;
+  if (now - _ratefrom < ratems)
+    return;
+  double sample = (double)_ratebytes * 1000 / (now - _ratefrom);
+  if (_ratebusy)
+    _rate = (_rate == 0) ? sample : (3 * _rate + sample) / 4;
+  else if (sample > _rate)
+    _rate = sample;
+  _ratefrom = now;
+  _ratebytes = 0;
+  _ratebusy = false;
+}
+
+/*
+ * UDP
+ */
+
+udplink::udplink(int fd, int family, const struct sockaddr_storage* peer)
+{
+  _fd = fd;
+  _family = family;
+  _mtu = ethsize;
+  _maxmtu = ethsize;
+  _probe = 0;
+  _probes = 0;
+  _probing = 0;
+  if (peer == nullptr)
+    return;
+
+  // Never fragment, and send what we ask to however big the kernel
+  // thinks the path is, we find out for ourselves
+  int probe = (_family == AF_INET) ? IP_PMTUDISC_PROBE : IPV6_PMTUDISC_PROBE;
+  int on = 1;
+  if (_family == AF_INET)
+    setsockopt(_fd, IPPROTO_IP, IP_MTU_DISCOVER, &probe, sizeof(probe));
+  else {
+    setsockopt(_fd, IPPROTO_IPV6, IPV6_MTU_DISCOVER, &probe, sizeof(probe));
+    setsockopt(_fd, IPPROTO_IPV6, IPV6_DONTFRAG, &on, sizeof(on));
+  }
+  size_t route = this->routemtu(peer);
+  if (route == 0)
+    return;
+  _maxmtu = min(route, maxframe + udpheader + this->ipheader());
+  _mtu = min(basemtu, _maxmtu);
+  this->nextprobe();
+}
+
+ssize_t
+udplink::sendbatch(const linkaddr& to, std::list<saratoga::buffer>& frames)
+{
+  struct mmsghdr msgs[txbatch];
+  struct iovec iov[txbatch];
+  ssize_t bcount = 0;
+
+  while (!frames.empty()) {
+    std::list<saratoga::buffer>::iterator b = frames.begin();
+    unsigned int n = 0;
+
+    for (; n < txbatch && b != frames.end(); n++, b++) {
+      iov[n].iov_base = b->buf();
+      iov[n].iov_len = b->len();
+      memset(&msgs[n].msg_hdr, 0, sizeof(struct msghdr));
+      msgs[n].msg_hdr.msg_name = (void*)to.sa();
+      msgs[n].msg_hdr.msg_namelen = to.salen();
+      msgs[n].msg_hdr.msg_iov = &iov[n];
+      msgs[n].msg_hdr.msg_iovlen = 1;
+    }
+    int sent = sendmmsg(_fd, msgs, n, MSG_DONTWAIT);
+    if (sent < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        break;
+      // Bigger than the interface, don't search past it
+      if (errno == EMSGSIZE) {
+        size_t route = this->routemtu(to.storage());
+        if (route > 0 && route < _maxmtu)
+          _maxmtu = route;
+        if (_mtu > _maxmtu)
+          _mtu = _maxmtu;
+        if (_probe > _maxmtu)
+          this->nextprobe();
+      }
+      // Pop it so we don't go round again on it
+      frames.pop_front();
+      return (-1);
+    }
+    for (int i = 0; i < sent; i++) {
+      bcount += msgs[i].msg_len;
+      frames.pop_front();
+    }
+    if ((unsigned int)sent < n)
+      break;
+  }
+  return (bcount);
+}
+
+ssize_t
+udplink::recvbatch(std::deque<linkframe>& frames)
+{
+  struct mmsghdr msgs[rxbatch];
+  struct iovec iov[rxbatch];
+  struct sockaddr_storage from[rxbatch];
+
+  if (_rbuf.empty())
+    _rbuf.resize(rxbatch * maxframe);
+  for (size_t i = 0; i < rxbatch; i++) {
+    iov[i].iov_base = &_rbuf[i * maxframe];
+    iov[i].iov_len = maxframe;
+    memset(&msgs[i].msg_hdr, 0, sizeof(struct msghdr));
+    msgs[i].msg_hdr.msg_name = &from[i];
+    msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+    msgs[i].msg_hdr.msg_iov = &iov[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  int got;
+  while ((got = recvmmsg(_fd, msgs, rxbatch, MSG_DONTWAIT, nullptr)) < 0 &&
+         errno == EINTR)
+    ;
+  if (got < 0)
+    return ((errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1);
+  // Handed out where they are, rx() copies each out once
+  for (int i = 0; i < got; i++) {
+    frames.push_back(linkframe());
+    frames.back().from = linkaddr(&from[i]);
+    frames.back().view = &_rbuf[i * maxframe];
+    frames.back().viewlen = msgs[i].msg_len;
+  }
+  return (got);
+}
+
+// Connecting a scratch socket has the kernel look the route up, IP_MTU
+// then tells us the MTU of the interface it goes out
+size_t
+udplink::routemtu(const struct sockaddr_storage* peer)
+{
+  int mtu = 0;
+  socklen_t len = sizeof(mtu);
+  linkaddr to(peer);
+
+  int fd = socket(_family, SOCK_DGRAM, 0);
+  if (fd < 0)
+    return (0);
+  if (connect(fd, to.sa(), to.salen()) < 0 ||
+      getsockopt(fd, (_family == AF_INET) ? IPPROTO_IP : IPPROTO_IPV6,
+                 (_family == AF_INET) ? IP_MTU : IPV6_MTU, &mtu, &len) < 0)
+    mtu = 0;
+  close(fd);
+  if (mtu < (int)(udpheader + v6header))
+    return (0);
+  return ((size_t)mtu);
+}
+
+// Try the route MTU first, it is what most paths turn out to have, and
+// halve the distance from there each time a size fails
+void
+udplink::nextprobe()
+{
+  _probes = 0;
+  _probing = 0;
+  if (_maxmtu < _mtu + minstep)
+    _probe = 0;
+  else if (_probe == 0)
+    _probe = _maxmtu;
+  else
+    _probe = (_mtu + _maxmtu + 1) / 2;
+}
+
+// UDP payload size of the probe to send now, 0 if there is none to send
+// or one is out already
+size_t
+udplink::probesize()
+{
+  if (_probe == 0)
+    return (0);
+  if (_probing != 0) {
+    if (time(nullptr) - _probing < probewait)
+      return (0);
+    // Never heard how that one went
+    this->probed(_probe - udpheader - this->ipheader(), false);
+    if (_probe == 0)
+      return (0);
+  }
+  return (_probe - udpheader - this->ipheader());
+}
+
+void
+udplink::probesent(size_t size)
+{
+  if (size + udpheader + this->ipheader() == _probe)
+    _probing = time(nullptr);
+}
+
+void
+udplink::probed(size_t size, bool ok)
+{
+  size_t ipsize = size + udpheader + this->ipheader();
+
+  if (ipsize != _probe)
+    return;
+  _probing = 0;
+  if (ok) {
+    _mtu = _probe;
+    saratoga::scr.debug(2, "udplink::probed(): Path MTU at least %zu", _mtu);
+    this->nextprobe();
+    return;
+  }
+  if (++_probes < maxprobes)
+    return;
+  _maxmtu = _probe - 1;
+  saratoga::scr.debug(2, "udplink::probed(): Path MTU less than %zu", _probe);
+  this->nextprobe();
+}
+
+string
+udplink::print()
+{
+  char tmp[96];
+
+  sprintf(tmp, "UDP %s fd=%d PMTU=%zu", (_family == AF_INET) ? "IPv4" : "IPv6",
+          _fd, _mtu);
+  string s(tmp);
+  if (_probe != 0) {
+    sprintf(tmp, " probing %zu of %zu", _probe, _maxmtu);
+    s += tmp;
+  }
+  return (s);
+}
+
+/*
+ * AX.25 kernel stack
+ */
+
+ax25kernel::ax25kernel()
+{
+  _outsock = -1;
+  _insock = -1;
+  _port = "";
+  _call = "";
+  _destcall = "";
+  _destlen = -1;
+  _ring = nullptr;
+  _block = 0;
+  memset(&_lastsrc, 0, sizeof(_lastsrc));
+  _rxframes = 0;
+  _rxdropped = 0;
+}
+
+ax25kernel::~ax25kernel()
+{
+  if (_ring != nullptr)
+    munmap(_ring, ringblocks * blocksize);
+  if (_outsock >= 0)
+    close(_outsock);
+  if (_insock >= 0)
+    close(_insock);
+}
+
+// What the packet socket gives us, the KISS port byte then the AX.25
+// header with no digipeaters (destination, source, control and PID), then
+// the saratoga frame
+static const size_t ax25hdrlen = 17;
+static const size_t ax25dstoff = 1;
+static const size_t ax25srcoff = 8;
+static const uint32_t ax25ui = 0x03;
+static const uint32_t ax25nolayer3 = 0xF0;
+
+// Big endian words of a callsign for the filter to compare against
+static uint32_t
+callword(const ax25_address& a)
+{
+  const unsigned char* c = (const unsigned char*)a.ax25_call;
+
+  return ((uint32_t)c[0] << 24 | (uint32_t)c[1] << 16 | (uint32_t)c[2] << 8 |
+          c[3]);
+}
+
+static uint32_t
+callhalf(const ax25_address& a)
+{
+  const unsigned char* c = (const unsigned char*)a.ax25_call;
+
+  return ((uint32_t)c[4] << 8 | c[5]);
+}
+
+static uint32_t
+callssid(const ax25_address& a)
+{
+  return ((unsigned char)a.ax25_call[6] & 0x1E);
+}
+
+// Drop in the kernel all but what came in to us, is KISS data, a UI frame
+// with no layer 3 and no digipeaters, and is to our callsign or the group
+bool
+ax25kernel::filter(const ax25_address& me, const ax25_address& group)
+{
+  enum
+  {
+    PKTTYPE,
+    NOTOUT,
+    LEN,
+    LONGENOUGH,
+    KISS,
+    KISSDATA,
+    LASTADDR,
+    NODIGI,
+    CTRL,
+    NOPOLL,
+    UI,
+    PID,
+    NOL3,
+    ME0,
+    ME0EQ,
+    ME1,
+    ME1EQ,
+    ME2,
+    ME2SSID,
+    ME2EQ,
+    GROUP0,
+    GROUP0EQ,
+    GROUP1,
+    GROUP1EQ,
+    GROUP2,
+    GROUP2SSID,
+    GROUP2EQ,
+    ACCEPT,
+    REJECT,
+    NINSNS
+  };
+  struct sock_filter prog[NINSNS] = {
+    BPF_STMT(BPF_LD | BPF_W | BPF_ABS,
+             (uint32_t)(SKF_AD_OFF + SKF_AD_PKTTYPE)),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, PACKET_OUTGOING, REJECT - NOTOUT - 1,
+             0),
+    BPF_STMT(BPF_LD | BPF_W | BPF_LEN, 0),
+    BPF_JUMP(BPF_JMP | BPF_JGT | BPF_K, ax25hdrlen, 0,
+             REJECT - LONGENOUGH - 1),
+    BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 0),
+    BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x0F, REJECT - KISSDATA - 1, 0),
+    BPF_STMT(BPF_LD | BPF_B | BPF_ABS, ax25hdrlen - 3),
+    BPF_JUMP(BPF_JMP | BPF_JSET | BPF_K, 0x01, 0, REJECT - NODIGI - 1),
+    BPF_STMT(BPF_LD | BPF_B | BPF_ABS, ax25hdrlen - 2),
+    BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xEF),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ax25ui, 0, REJECT - UI - 1),
+    BPF_STMT(BPF_LD | BPF_B | BPF_ABS, ax25hdrlen - 1),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ax25nolayer3, 0,
+             REJECT - NOL3 - 1),
+    BPF_STMT(BPF_LD | BPF_W | BPF_ABS, ax25dstoff),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, callword(me), 0, GROUP0 - ME0EQ - 1),
+    BPF_STMT(BPF_LD | BPF_H | BPF_ABS, ax25dstoff + 4),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, callhalf(me), 0, GROUP0 - ME1EQ - 1),
+    BPF_STMT(BPF_LD | BPF_B | BPF_ABS, ax25dstoff + 6),
+    BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0x1E),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, callssid(me), ACCEPT - ME2EQ - 1,
+             GROUP0 - ME2EQ - 1),
+    BPF_STMT(BPF_LD | BPF_W | BPF_ABS, ax25dstoff),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, callword(group), 0,
+             REJECT - GROUP0EQ - 1),
+    BPF_STMT(BPF_LD | BPF_H | BPF_ABS, ax25dstoff + 4),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, callhalf(group), 0,
+             REJECT - GROUP1EQ - 1),
+    BPF_STMT(BPF_LD | BPF_B | BPF_ABS, ax25dstoff + 6),
+    BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0x1E),
+    BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, callssid(group), 0,
+             REJECT - GROUP2EQ - 1),
+    BPF_STMT(BPF_RET | BPF_K, 0xFFFF),
+    BPF_STMT(BPF_RET | BPF_K, 0),
+  };
+  struct sock_fprog fprog;
+
+  fprog.len = NINSNS;
+  fprog.filter = prog;
+  if (setsockopt(_insock, SOL_SOCKET, SO_ATTACH_FILTER, &fprog,
+                 sizeof(fprog)) < 0) {
+    saratoga::scr.perror(errno, "[AX25] Cannot attach filter on %s",
+                         _port.c_str());
+    return (false);
+  }
+  return (true);
+}
+
+// Frames go into blocks of the ring the kernel hands us whole, so a batch
+// is a block and reading it is no system calls at all
+bool
+ax25kernel::ring(int ifindex)
+{
+  int version = TPACKET_V3;
+  struct tpacket_req3 req;
+  struct sockaddr_ll ll;
+
+  if (setsockopt(_insock, SOL_PACKET, PACKET_VERSION, &version,
+                 sizeof(version)) < 0) {
+    saratoga::scr.perror(errno, "[AX25] No TPACKET_V3 on %s", _port.c_str());
+    return (false);
+  }
+  memset(&req, 0, sizeof(req));
+  req.tp_block_size = blocksize;
+  req.tp_block_nr = ringblocks;
+  req.tp_frame_size = ringframe;
+  req.tp_frame_nr = (blocksize * ringblocks) / ringframe;
+  req.tp_retire_blk_tov = retirems;
+  if (setsockopt(_insock, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) < 0) {
+    saratoga::scr.perror(errno, "[AX25] Cannot set up ring on %s",
+                         _port.c_str());
+    return (false);
+  }
+  void* m = mmap(nullptr, ringblocks * blocksize, PROT_READ | PROT_WRITE,
+                 MAP_SHARED, _insock, 0);
+  if (m == MAP_FAILED) {
+    saratoga::scr.perror(errno, "[AX25] Cannot map ring on %s", _port.c_str());
+    return (false);
+  }
+  _ring = (char*)m;
+  _block = 0;
+
+  // Only now that the filter is on does anything come in
+  memset(&ll, 0, sizeof(ll));
+  ll.sll_family = AF_PACKET;
+  ll.sll_protocol = htons(ETH_P_AX25);
+  ll.sll_ifindex = ifindex;
+  if (bind(_insock, (struct sockaddr*)&ll, sizeof(ll)) < 0) {
+    saratoga::scr.perror(errno, "[AX25] Cannot bind to %s", _port.c_str());
+    return (false);
+  }
+  return (true);
+}
+
+bool
+ax25kernel::open(const string& port, const string& group)
+{
+  struct full_sockaddr_ax25 src;
+  struct full_sockaddr_ax25 grp;
+  char* portcall;
+  char* dev;
+  int srclen;
+  int ifindex;
+
+  _port = port;
+  if (ax25_config_load_ports() == 0) {
+    saratoga::scr.error("[AX25] No AX.25 ports defined\n");
+    return (false);
+  }
+  if ((portcall = ax25_config_get_addr((char*)port.c_str())) == NULL) {
+    saratoga::scr.error("[AX25] Invalid AX.25 port \n" + port);
+    return (false);
+  }
+
+  // Prepare out socket
+  if ((srclen = ax25_aton(portcall, &src)) == -1) {
+    saratoga::scr.error("[AX25] Unable to convert source callsign \n" +
+                        string(portcall));
+    return (false);
+  }
+  if ((_outsock = socket(AF_AX25, SOCK_DGRAM, 0)) == -1) {
+    saratoga::scr.error("[AX25] socket() error");
+    return (false);
+  }
+  if (bind(_outsock, (struct sockaddr*)&src, srclen) == -1) {
+    saratoga::scr.error("[AX25] bind() error");
+    return (false);
+  }
+  _call = ax25_ntoa(&src.fsa_ax25.sax25_call);
+
+  // Prepare in socket, it gets nothing until it is bound to the device
+  if ((dev = ax25_config_get_dev((char*)port.c_str())) == NULL ||
+      (ifindex = if_nametoindex(dev)) == 0) {
+    saratoga::scr.error("AX25 could not init insocket: invalid port name \n");
+    return (false);
+  }
+  if (ax25_aton((char*)group.c_str(), &grp) == -1) {
+    saratoga::scr.error("[AX25] Unable to convert group callsign \n" + group);
+    return (false);
+  }
+  if ((_insock = socket(AF_PACKET, SOCK_RAW, 0)) == -1) {
+    saratoga::scr.error("AX25 could not init insocket \n" +
+                        to_string(_insock));
+    return (false);
+  }
+  return (this->filter(src.fsa_ax25.sax25_call, grp.fsa_ax25.sax25_call) &&
+          this->ring(ifindex));
+}
+
+ssize_t
+ax25kernel::sendbatch(const linkaddr& to, std::list<saratoga::buffer>& frames)
+{
+  ssize_t bcount = 0;
+
+  if (to.call() != _destcall) {
+    _destcall = to.call();
+    _destlen = ax25_aton((char*)_destcall.c_str(), &_dest);
+  }
+  if (_destlen == -1) {
+    frames.clear();
+    errno = EINVAL;
+    return (-1);
+  }
+  while (!frames.empty()) {
+    saratoga::buffer* b = &frames.front();
+    ssize_t nwritten = sendto(_outsock, b->buf(), b->len(), MSG_DONTWAIT,
+                              (struct sockaddr*)&_dest, _destlen);
+    if (nwritten < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        break;
+      frames.pop_front();
+      return (-1);
+    }
+    bcount += nwritten;
+    frames.pop_front();
+  }
+  return (bcount);
+}
+
+// Each frame is copied once, out of the ring into a pooled buffer, as the
+// block goes back to the kernel at the end of the batch
+ssize_t
+ax25kernel::recvbatch(std::deque<linkframe>& frames)
+{
+  ssize_t got = 0;
+
+  for (size_t i = 0; i < ringblocks; i++) {
+    struct tpacket_block_desc* bd =
+      (struct tpacket_block_desc*)(_ring + _block * blocksize);
+    if ((bd->hdr.bh1.block_status & TP_STATUS_USER) == 0)
+      break;
+    __sync_synchronize();
+    struct tpacket3_hdr* h =
+      (struct tpacket3_hdr*)((char*)bd + bd->hdr.bh1.offset_to_first_pkt);
+    for (uint32_t n = 0; n < bd->hdr.bh1.num_pkts; n++) {
+      const char* data = (const char*)h + h->tp_mac;
+      if (h->tp_snaplen > ax25hdrlen) {
+        if (memcmp(&_lastsrc, data + ax25srcoff, sizeof(_lastsrc)) != 0) {
+          memcpy(&_lastsrc, data + ax25srcoff, sizeof(_lastsrc));
+          _lastfrom = linkaddr(string(ax25_ntoa(&_lastsrc)));
+        }
+        frames.push_back(linkframe());
+        frames.back().from = _lastfrom;
+        fill(frames.back().data, data + ax25hdrlen,
+             h->tp_snaplen - ax25hdrlen);
+        got++;
+      }
+      h = (struct tpacket3_hdr*)((char*)h + h->tp_next_offset);
+    }
+    __sync_synchronize();
+    bd->hdr.bh1.block_status = TP_STATUS_KERNEL;
+    _block = (_block + 1) % ringblocks;
+  }
+  _rxframes += got;
+  return (got);
+}
+
+string
+ax25kernel::print()
+{
+  struct tpacket_stats_v3 st;
+  socklen_t len = sizeof(st);
+  char tmp[128];
+
+  // Reading the kernel's counts zeroes them
+  if (_insock >= 0 &&
+      getsockopt(_insock, SOL_PACKET, PACKET_STATISTICS, &st, &len) == 0)
+    _rxdropped += st.tp_drops;
+  sprintf(tmp, ", %zu frames in, %zu dropped with the ring full", _rxframes,
+          _rxdropped);
+  return ("AX.25 port " + _port + " as " + _call + string(tmp));
+}
+
+/*
+ * In memory
+ */
+
+ssize_t
+memlink::sendbatch(const linkaddr& to, std::list<saratoga::buffer>& frames)
+{
+  ssize_t bcount = 0;
+
+  while (!frames.empty()) {
+    saratoga::buffer* b = &frames.front();
+    if (_peer != nullptr && b->len() <= _mtu &&
+        (_loss == 0 || (int)(rand_r(&_seed) % 100) >= _loss)) {
+      _peer->_inbox.push_back(linkframe());
+      _peer->_inbox.back().from = _me;
+      _peer->_inbox.back().data.assign(b->buf(), b->buf() + b->len());
+    }
+    bcount += b->len();
+    frames.pop_front();
+  }
+  return (bcount);
+}
+
+ssize_t
+memlink::recvbatch(std::deque<linkframe>& frames)
+{
+  ssize_t got = _inbox.size();
+
+  while (!_inbox.empty()) {
+    frames.push_back(linkframe());
+    frames.back().from = _inbox.front().from;
+    frames.back().data.swap(_inbox.front().data);
+    _inbox.pop_front();
+  }
+  return (got);
+}
+
+string
+memlink::print()
+{
+  char tmp[64];
+
+  sprintf(tmp, "Memory link, %zu waiting, %d%% loss", _inbox.size(), _loss);
+  return (string(tmp));
+}
+
+/*
+ * Fragmenting
+ */
+
+ssize_t
+fraglink::sendbatch(const linkaddr& to, std::list<saratoga::buffer>& frames)
+{
+  size_t wire = _lower->mtu();
+  size_t room = wire - hdrlen;
+  bool toobig = false;
+  std::vector<char> frag(wire);
+
+  std::list<saratoga::buffer>::iterator b = frames.begin();
+  while (b != frames.end()) {
+    if (b->len() <= wire) {
+      b++;
+      continue;
+    }
+    if (b->len() > this->mtu()) {
+      b = frames.erase(b);
+      toobig = true;
+      continue;
+    }
+    std::list<saratoga::buffer> frags;
+    size_t nfrags = (b->len() + room - 1) / room;
+    for (size_t i = 0; i < nfrags; i++) {
+      size_t off = i * room;
+      size_t len = (b->len() - off < room) ? b->len() - off : room;
+      frag[0] = fragmark | (unsigned char)i;
+      if (i == nfrags - 1)
+        frag[0] |= lastfrag;
+      frag[1] = _id;
+      memcpy(&frag[hdrlen], b->buf() + off, len);
+      frags.push_back(saratoga::buffer(&frag[0], hdrlen + len));
+    }
+    _id++;
+    b = frames.erase(b);
+    frames.splice(b, frags);
+  }
+  ssize_t sent = _lower->sendbatch(to, frames);
+  if (sent >= 0 && toobig) {
+    errno = EMSGSIZE;
+    return (-1);
+  }
+  return (sent);
+}
+
+ssize_t
+fraglink::recvbatch(std::deque<linkframe>& frames)
+{
+  std::deque<linkframe> got;
+  ssize_t n = _lower->recvbatch(got);
+
+  if (n <= 0)
+    return (n);
+  n = 0;
+  while (!got.empty()) {
+    linkframe& f = got.front();
+    if (f.len() > 0 && ((unsigned char)f.buf()[0] & fragmark) == fragmark) {
+      if (this->reassemble(f, frames))
+        n++;
+    } else {
+      frames.push_back(linkframe());
+      frames.back().from = f.from;
+      frames.back().data.swap(f.data);
+      frames.back().view = f.view;
+      frames.back().viewlen = f.viewlen;
+      n++;
+    }
+    recycle(f.data);
+    got.pop_front();
+  }
+  return (n);
+}
+
+bool
+fraglink::reassemble(linkframe& f, std::deque<linkframe>& frames)
+{
+  if (f.len() <= hdrlen)
+    return (false);
+  unsigned char h = f.buf()[0];
+  unsigned char id = f.buf()[1];
+  size_t index = h & indexmask;
+
+  uint64_t now = msnow();
+  std::list<partial>::iterator p;
+  for (p = _partial.begin(); p != _partial.end();) {
+    if (now - p->when > partialms) {
+      p = _partial.erase(p);
+      _dropped++;
+    } else
+      p++;
+  }
+  for (p = _partial.begin(); p != _partial.end(); p++)
+    if (p->id == id && p->from == f.from)
+      break;
+  if (p != _partial.end() &&
+      (!p->part[index].empty() ||
+       (p->last >= 0 && (h & lastfrag) && (size_t)p->last != index) ||
+       (p->last >= 0 && !(h & lastfrag) && index >= (size_t)p->last))) {
+    // Left over from an earlier frame with this number
+    _partial.erase(p);
+    _dropped++;
+    p = _partial.end();
+  }
+  if (p == _partial.end()) {
+    if (_partial.size() >= maxpartial) {
+      _partial.pop_front();
+      _dropped++;
+    }
+    _partial.push_back(partial());
+    p = --_partial.end();
+    p->from = f.from;
+    p->id = id;
+    p->when = now;
+    p->last = -1;
+    p->count = 0;
+  }
+  if (h & lastfrag)
+    p->last = index;
+  p->part[index].assign(f.buf() + hdrlen, f.buf() + f.len());
+  p->count++;
+  if (p->last < 0 || p->count < (size_t)p->last + 1)
+    return (false);
+  for (int i = 0; i <= p->last; i++)
+    if (p->part[i].empty())
+      return (false);
+
+  frames.push_back(linkframe());
+  frames.back().from = p->from;
+  for (int i = 0; i <= p->last; i++)
+    frames.back().data.insert(frames.back().data.end(), p->part[i].begin(),
+                              p->part[i].end());
+  _partial.erase(p);
+  return (true);
+}
+
+string
+fraglink::print()
+{
+  char tmp[128];
+
+  sprintf(tmp, ", fragments up to %zu, %zu joining, %zu dropped",
+          this->mtu(), _partial.size(), _dropped);
+  return (_lower->print() + string(tmp));
+}
+
+/*
+ * Half duplex airtime
+ */
+
+long
+airtime::holdoff()
+{
+  uint64_t now = msnow();
+
+  return ((_nextok > now) ? (long)(_nextok - now) : 0);
+}
+
+// As much of the list as fits in what is left of the window goes to the
+// link below, at least one frame a window however long it is. When the
+// window is used up the peer gets its turn. An empty list still goes
+// down so the link can write out what it had no room for before.
+ssize_t
+airtime::sendbatch(const linkaddr& to, std::list<saratoga::buffer>& frames)
+{
+  uint64_t now = msnow();
+
+  if (now < _nextok)
+    return (0);
+  if (frames.empty())
+    return (_lower->sendbatch(to, frames));
+  // Off the air since the last, a new window with a new key up
+  if (_airend + slotms < now)
+    _used = 0;
+  if (_airend < now)
+    _airend = now;
+
+  std::list<saratoga::buffer> burst;
+  std::vector<long> times;
+  long used = _used;
+  while (!frames.empty()) {
+    long t = this->frametime(frames.front().len());
+    if (times.empty() && _airend == now)
+      t += _txdelay;
+    if (used > 0 && used + t > windowms)
+      break;
+    used += t;
+    times.push_back(t);
+    burst.splice(burst.end(), frames, frames.begin());
+  }
+  ssize_t sent = _lower->sendbatch(to, burst);
+
+  // Only what went counts, what didn't goes back on the front
+  size_t went = times.size() - burst.size();
+  for (size_t i = 0; i < went; i++) {
+    _used += times[i];
+    _airend += times[i];
+  }
+  bool full = !frames.empty() && burst.empty();
+  frames.splice(frames.begin(), burst);
+  if (full) {
+    _nextok = _airend + 2 * _txdelay + this->frametime(statusbytes) + slotms;
+    _used = 0;
+    _windows++;
+  }
+  return (sent);
+}
+
+// Whatever we hear the peer has the channel, we wait for it to finish
+ssize_t
+airtime::recvbatch(std::deque<linkframe>& frames)
+{
+  ssize_t n = _lower->recvbatch(frames);
+
+  if (n > 0) {
+    uint64_t now = msnow();
+    _nextok = ((_airend > now) ? _airend : now) + slotms;
+    _used = 0;
+  }
+  return (n);
+}
+
+string
+airtime::print()
+{
+  char tmp[128];
+
+  sprintf(tmp, ", %d baud half duplex, %ld ms key up, %zu windows", _baud,
+          _txdelay, _windows);
+  return (_lower->print() + string(tmp));
+}
+
+}; // namespace sarnet
@@ -0,0 +1,520 @@
+/*
+
+ Copyright (c) 2011, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#ifndef _LINK_H
+#define _LINK_H
+
+#include <cstring>
+#include <deque>
+#include <list>
+#include <string>
+#include <vector>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+
+#include <netax25/ax25.h>
+
+#include "saratoga.h"
+
+using namespace std;
+
+namespace sarnet {
+
+/*
+ **********************************************************************
+ * LINKS
+ **********************************************************************
+ */
+
+// Who a frame goes to or came from on a link, an IPv4 or IPv6 address
+// and port or an AX.25 callsign
+class linkaddr
+{
+private:
+  struct sockaddr_storage _sa; // Just the family for AX.25
+  string _call;                // AX.25 callsign
+public:
+  linkaddr()
+  {
+    memset(&_sa, 0, sizeof(_sa));
+    _call = "";
+  };
+  linkaddr(const struct sockaddr_storage* sa)
+  {
+    memcpy(&_sa, sa, sizeof(_sa));
+    _call = "";
+  };
+  linkaddr(const string& call)
+  {
+    memset(&_sa, 0, sizeof(_sa));
+    _sa.ss_family = AF_AX25;
+    _call = call;
+  };
+
+  int family() const { return (_sa.ss_family); };
+  const string& call() const { return (_call); };
+  const struct sockaddr* sa() const { return ((const struct sockaddr*)&_sa); };
+  struct sockaddr_storage* storage() { return (&_sa); };
+  const struct sockaddr_storage* storage() const { return (&_sa); };
+  socklen_t salen() const
+  {
+    if (_sa.ss_family == AF_INET)
+      return (sizeof(struct sockaddr_in));
+    if (_sa.ss_family == AF_INET6)
+      return (sizeof(struct sockaddr_in6));
+    return (0);
+  };
+
+  bool operator==(const linkaddr& rhs) const
+  {
+    if (_sa.ss_family != rhs._sa.ss_family)
+      return (false);
+    if (_sa.ss_family == AF_AX25)
+      return (_call == rhs._call);
+    return (memcmp(&_sa, &rhs._sa, this->salen()) == 0);
+  };
+};
+
+// A received frame and who sent it. A link can leave the frame where it
+// read it to, in view, which holds until its next recvbatch()
+struct linkframe
+{
+  linkaddr from;
+  std::vector<char> data;
+  const char* view = nullptr;
+  size_t viewlen = 0;
+
+  const char* buf() const { return ((view != nullptr) ? view : data.data()); };
+  size_t len() const { return ((view != nullptr) ? viewlen : data.size()); };
+};
+
+/*
+ * What saratoga sends and receives frames over. A link moves batches of
+ * frames, it says how big a frame can be and what its addresses are,
+ * and fd() is what select() waits on for it. Reads are batched, rx()
+ * hands out one frame at a time from the last batch so check pending()
+ * before waiting in select() again.
+ */
+class datalink
+{
+private:
+  static const size_t poolmax = 64;
+
+  // Frame buffers to reuse, here so the links need nothing from link.cpp
+  static std::vector<std::vector<char> >& pool()
+  {
+    static std::vector<std::vector<char> > p;
+    return (p);
+  };
+
+  uint64_t _ratefrom = 0; // ms, when the rate measure started
+  size_t _ratebytes = 0;  // Bytes sent since
+  bool _ratebusy = false; // Frames were left waiting meanwhile
+  double _rate = 0;       // Bytes a second, 0 not known yet
+  static const uint64_t ratems = 250;
+
+protected:
+  std::deque<linkframe> _rxq; // Read in a batch, not yet handed out
+
+  // Copy len bytes of a frame into data, taking a buffer from the pool
+  // when data has none big enough, and give it back when done with
+  static void fill(std::vector<char>& data, const void* b, size_t len)
+  {
+    if (data.capacity() < len && !pool().empty()) {
+      data.swap(pool().back());
+      pool().pop_back();
+    }
+    data.assign((const char*)b, (const char*)b + len);
+  };
+  static void recycle(std::vector<char>& data)
+  {
+    if (data.capacity() == 0 || pool().size() >= poolmax)
+      return;
+    pool().push_back(std::vector<char>());
+    pool().back().swap(data);
+  };
+
+public:
+  virtual ~datalink(){};
+
+  // AF_INET, AF_INET6 or AF_AX25
+  virtual int family() = 0;
+
+  // Longest saratoga frame the link carries
+  virtual size_t mtu() = 0;
+
+  // Longest that goes out as one frame on the wire, less than mtu()
+  // when the link fragments. DATA is sized to fit this.
+  virtual size_t framesize() { return (this->mtu()); };
+
+  // For select(), reading and writing, -1 if there is none
+  virtual int fd() = 0;
+  virtual int wfd() { return (this->fd()); };
+
+  // Our own address on the link where it has one, the AX.25 callsign
+  virtual string addr() { return (""); };
+
+  // Send frames to one address, popping each as it goes. Frames there
+  // is no room for yet stay on the list. Bytes sent or -1 with errno
+  // set, the frame that failed is dropped.
+  virtual ssize_t sendbatch(const linkaddr& to,
+                            std::list<saratoga::buffer>& frames) = 0;
+
+  // Append what one batched read gets, the number of frames, 0 if
+  // nothing was waiting or -1 with errno set
+  virtual ssize_t recvbatch(std::deque<linkframe>& frames) = 0;
+
+  // Bytes taken by sendbatch() that have still to go out
+  virtual size_t backlog() { return (0); };
+
+  // ms before the link takes any more frames, a shared radio channel
+  // has times it is not ours to send on
+  virtual long holdoff() { return (0); };
+
+  // How fast the link takes frames, bytes a second, 0 until it is known.
+  // measure() is told what each send got out and if frames were left, a
+  // link that took all it was given is only known to be at least as fast
+  double rate() { return (_rate); };
+  void measure(size_t bytes, bool busy);
+
+  // Path MTU search. A frame of probesize() is wanted to see if it gets
+  // through, 0 if not, probesent() when one goes and probed() with how
+  // it went. Links that know their MTU have nothing to find out.
+  virtual size_t probesize() { return (0); };
+  virtual void probesent(size_t size){};
+  virtual void probed(size_t size, bool ok){};
+
+  virtual string print() = 0;
+
+  // The next frame into b, its length, 0 if there is none or -1
+  ssize_t rx(char* b, size_t len, linkaddr& from)
+  {
+    if (_rxq.empty()) {
+      ssize_t n = this->recvbatch(_rxq);
+      if (n < 0)
+        return (n);
+      if (_rxq.empty())
+        return (0);
+    }
+    linkframe& f = _rxq.front();
+    size_t n = (f.len() < len) ? f.len() : len;
+    if (n > 0)
+      memcpy(b, f.buf(), n);
+    from = f.from;
+    recycle(f.data);
+    _rxq.pop_front();
+    return (n);
+  };
+
+  // Frames read that select() won't tell us about
+  bool pending() { return (!_rxq.empty()); };
+};
+
+// A UDP socket, IPv4 or IPv6, frames go out with sendmmsg() and come in
+// with recvmmsg(). The socket belongs to the udp that opened it. Given
+// the peer it writes to, frames don't fragment and the path MTU is
+// searched for (RFC 8899 packetization layer PMTUD) from the base size
+// up to the MTU of the route there. Otherwise they are normal ethernet.
+class udplink : public datalink
+{
+private:
+  int _fd;
+  int _family;
+  size_t _mtu;             // Largest IP datagram known to get to the peer
+  size_t _maxmtu;          // Route MTU, less as probes fail
+  size_t _probe;           // IP datagram size being tried, 0 search done
+  int _probes;             // Times _probe has been tried
+  time_t _probing;         // When the probe out went, 0 if none is
+  std::vector<char> _rbuf; // rxbatch frames, allocated on the first read
+
+  static const size_t txbatch = 64;
+  static const size_t rxbatch = 16;
+  static const size_t maxframe = 9000;
+  static const size_t ethsize = 1500; // Normal ethernet frame size
+  static const size_t basemtu = 1200; // Start of the search
+  static const size_t udpheader = 8;
+  static const size_t v4header = 20;
+  static const size_t v6header = 40;
+  static const int maxprobes = 3;   // Tries before a size is given up
+  static const size_t minstep = 16; // Search ends this close
+  static const time_t probewait = 30;
+
+  // The interface MTU of the route to the peer, 0 if there is none
+  size_t routemtu(const struct sockaddr_storage* peer);
+  size_t ipheader() { return ((_family == AF_INET) ? v4header : v6header); };
+  void nextprobe();
+
+public:
+  udplink(int fd, int family, const struct sockaddr_storage* peer = nullptr);
+  ~udplink(){};
+
+  int family() { return (_family); };
+  size_t mtu() { return (_mtu - udpheader - this->ipheader()); };
+  int fd() { return (_fd); };
+
+  size_t probesize();
+  void probesent(size_t size);
+  void probed(size_t size, bool ok);
+
+  ssize_t sendbatch(const linkaddr& to, std::list<saratoga::buffer>& frames);
+  ssize_t recvbatch(std::deque<linkframe>& frames);
+  string print();
+};
+
+// AX.25 through the kernel stack, a port from axports. UI frames go out
+// an AF_AX25 datagram socket and come in an AF_PACKET socket on the
+// port's device. A BPF filter in the kernel passes only saratoga's UI
+// frames for us, and they are read straight out of a mapped ring.
+class ax25kernel : public datalink
+{
+private:
+  int _outsock;
+  int _insock;
+  string _port;
+  string _call;                     // Our callsign on the port
+  string _destcall;                 // Callsign in _dest
+  struct full_sockaddr_ax25 _dest;  // Last destination, most batches
+  int _destlen;                     // go to the same one
+  char* _ring;                      // TPACKET_V3 receive ring
+  size_t _block;                    // Next block of it to read
+  ax25_address _lastsrc;            // Who sent the last frame, most
+  linkaddr _lastfrom;               // batches come from the one peer
+  size_t _rxframes;
+  size_t _rxdropped;                // By the kernel with the ring full
+  static const size_t ringblocks = 8;
+  static const size_t blocksize = 1 << 14;
+  static const size_t ringframe = 1 << 11;
+  static const unsigned int retirems = 10; // Hand over part full blocks
+
+  bool filter(const ax25_address& me, const ax25_address& group);
+  bool ring(int ifindex);
+
+public:
+  static const size_t ax25mtu = 255;
+
+  ax25kernel();
+  ~ax25kernel();
+
+  // Open both sockets on the named port, frames in are those to our
+  // callsign or the group's. False if it can't be done.
+  bool open(const string& port, const string& group);
+
+  int family() { return (AF_AX25); };
+  size_t mtu() { return (ax25mtu); };
+  int fd() { return (_insock); };
+  int wfd() { return (_outsock); };
+  string addr() { return (_call); };
+
+  ssize_t sendbatch(const linkaddr& to, std::list<saratoga::buffer>& frames);
+  ssize_t recvbatch(std::deque<linkframe>& frames);
+  string print();
+};
+
+// Two of these connected together pass frames in memory, no system
+// calls, so the protocol can be run and timed on its own. It is point
+// to point, whatever the address frames go to the peer. Loss is the
+// percent of frames sent that are thrown away. membench (memdriver.cpp)
+// puts a file over a pair of them.
+class memlink : public datalink
+{
+private:
+  linkaddr _me;
+  memlink* _peer;
+  std::deque<linkframe> _inbox;
+  size_t _mtu;
+  int _loss;
+  unsigned int _seed;
+
+public:
+  memlink(const linkaddr& me, size_t mtu)
+  {
+    _me = me;
+    _peer = nullptr;
+    _mtu = mtu;
+    _loss = 0;
+    _seed = 1;
+  };
+  ~memlink(){};
+
+  void connect(memlink* peer)
+  {
+    _peer = peer;
+    peer->_peer = this;
+  };
+  void loss(int percent) { _loss = percent; };
+
+  int family() { return (_me.family()); };
+  size_t mtu() { return (_mtu); };
+  int fd() { return (-1); };
+  string addr() { return (_me.call()); };
+
+  ssize_t sendbatch(const linkaddr& to, std::list<saratoga::buffer>& frames);
+  ssize_t recvbatch(std::deque<linkframe>& frames);
+  string print();
+};
+
+/*
+ * Splits saratoga frames too big for the link under it into fragments
+ * and joins them up again at the other end. Frames that fit go out as
+ * they are. A fragment has a two byte header, the first byte has the
+ * version bits all set so it can't be taken for a saratoga frame, then
+ * the last fragment flag and the fragment number, the second byte
+ * numbers the frame. Frames being joined up are kept per sender and
+ * frame number, only maxpartial of them, the oldest goes when another
+ * is needed so a lost fragment costs no more than one frame. The frame
+ * number wraps, so a partial older than partialms, or one a fragment
+ * doesn't fit (its slot already filled, a different last fragment),
+ * is started again rather than joined to the new fragments.
+ */
+class fraglink : public datalink
+{
+private:
+  datalink* _lower;
+  unsigned char _id; // Number of the next frame we fragment
+  size_t _dropped;   // Frames given up on with fragments missing
+
+  static const unsigned char fragmark = 0xE0;
+  static const unsigned char lastfrag = 0x10;
+  static const unsigned char indexmask = 0x0F;
+  static const size_t hdrlen = 2;
+  static const size_t maxfrags = 16;
+  static const size_t maxpartial = 8;
+  static const uint64_t partialms = 3000;
+
+  struct partial
+  {
+    linkaddr from;
+    unsigned char id;
+    uint64_t when; // msnow() of the first fragment
+    int last; // Fragment number of the last, -1 until it arrives
+    size_t count;
+    std::vector<char> part[maxfrags];
+  };
+  std::list<partial> _partial;
+
+  // Add a fragment, true and the whole frame on frames if that
+  // completes it
+  bool reassemble(linkframe& f, std::deque<linkframe>& frames);
+
+public:
+  // The fraglink owns lower from now on
+  fraglink(datalink* lower)
+  {
+    _lower = lower;
+    _id = 0;
+    _dropped = 0;
+  };
+  ~fraglink() { delete _lower; };
+
+  int family() { return (_lower->family()); };
+  size_t mtu() { return (maxfrags * (_lower->mtu() - hdrlen)); };
+  size_t framesize() { return (_lower->framesize()); };
+  int fd() { return (_lower->fd()); };
+  int wfd() { return (_lower->wfd()); };
+  string addr() { return (_lower->addr()); };
+  size_t backlog() { return (_lower->backlog()); };
+  long holdoff() { return (_lower->holdoff()); };
+
+  ssize_t sendbatch(const linkaddr& to, std::list<saratoga::buffer>& frames);
+  ssize_t recvbatch(std::deque<linkframe>& frames);
+  string print();
+};
+
+/*
+ * Shares a half duplex radio channel with the peer. How long each frame
+ * is on the air is worked out from the baud rate, so frames go out in
+ * windows of a bounded airtime. After a window the channel is left to
+ * the peer long enough for it to key up and send a STATUS, and anything
+ * heard from it holds us off until it has finished. sendbatch() leaves
+ * frames on the list while we wait and holdoff() says how long for.
+ */
+class airtime : public datalink
+{
+private:
+  datalink* _lower;
+  int _baud;
+  long _txdelay;    // ms from keying up to the first bit
+  uint64_t _airend; // When what we have sent will be off the air
+  uint64_t _nextok; // We don't send before this
+  long _used;       // ms of air used in this window
+  size_t _windows;  // Windows sent, for print()
+
+  static const long windowms = 4000;     // Air we take at a time
+  static const long slotms = 100;        // Quiet after the peer
+  static const size_t ax25overhead = 19; // Addresses, control, PID, FCS, flag
+  static const size_t statusbytes = 64;  // Room to leave for a STATUS
+
+  // ms on the air for a frame of len bytes, bit stuffing adds about 5%
+  long frametime(size_t len)
+  {
+    return ((long)((len + ax25overhead) * 8 * 1050) / _baud + 1);
+  };
+
+public:
+  // The airtime owns lower from now on
+  airtime(datalink* lower, int baud, long txdelay)
+  {
+    _lower = lower;
+    _baud = (baud > 0) ? baud : 1200;
+    _txdelay = txdelay;
+    _airend = 0;
+    _nextok = 0;
+    _used = 0;
+    _windows = 0;
+  };
+  ~airtime() { delete _lower; };
+
+  int family() { return (_lower->family()); };
+  size_t mtu() { return (_lower->mtu()); };
+  size_t framesize() { return (_lower->framesize()); };
+  int fd() { return (_lower->fd()); };
+  int wfd() { return (_lower->wfd()); };
+  string addr() { return (_lower->addr()); };
+  size_t backlog() { return (_lower->backlog()); };
+  long holdoff();
+
+  ssize_t sendbatch(const linkaddr& to, std::list<saratoga::buffer>& frames);
+  ssize_t recvbatch(std::deque<linkframe>& frames);
+  string print();
+};
+
+}; // namespace sarnet
+
+#endif // _LINK_H
@@ -0,0 +1,216 @@
+/*
+
+ Copyright (c) 2011, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+
+/*
+ * MEMDRIVER.CPP - benchmark of the transfer engine over a memory link
+ *
+ * Puts a file from one transfer to another across a connected pair of
+ * memory links (memlink in link.h), with no sockets or kernel in the
+ * way, so what is timed is the engine itself: framing, the queues, the
+ * hole lists and STATUS, and writing the file. Frames can be lost on
+ * the way to see how the holes are filled in. The file that arrives is
+ * checked against the one sent.
+ *
+ * Arguments: file size in MB (default 64), loss percent each way
+ * (default 0) and the link MTU (default 9000).
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "globals.h"
+#include "frameview.h"
+#include "link.h"
+#include "metadata.h"
+#include "repair.h"
+#include "tran.h"
+
+#ifdef MEMBENCH
+using namespace saratoga;
+
+static const char* srcname = "membench.tmp";
+static const char* dstname = "membench.out";
+
+static double
+Seconds(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static bool
+Make(size_t size)
+{
+  std::vector<char> b(1024 * 1024);
+  FILE* fp = fopen(srcname, "w");
+
+  if (fp == NULL)
+    return false;
+  srand(1);
+  for (size_t done = 0; done < size; done += b.size()) {
+    size_t n = (size - done < b.size()) ? size - done : b.size();
+    for (size_t i = 0; i < n; i++)
+      b[i] = (char)rand();
+    if (fwrite(&b[0], 1, n, fp) != n) {
+      fclose(fp);
+      return false;
+    }
+  }
+  return fclose(fp) == 0;
+}
+
+static bool
+Same(void)
+{
+  std::vector<char> a(1024 * 1024), b(1024 * 1024);
+  FILE* fa = fopen(srcname, "r");
+  FILE* fb = fopen(dstname, "r");
+  bool same = (fa != NULL && fb != NULL);
+  size_t na, nb;
+
+  while (same) {
+    na = fread(&a[0], 1, a.size(), fa);
+    nb = fread(&b[0], 1, b.size(), fb);
+    same = (na == nb && memcmp(&a[0], &b[0], na) == 0);
+    if (na == 0)
+      break;
+  }
+  if (fa != NULL)
+    fclose(fa);
+  if (fb != NULL)
+    fclose(fb);
+  return same;
+}
+
+int
+main(int argc, char** argv)
+{
+  size_t mb = argc > 1 ? strtoul(argv[1], NULL, 10) : 64;
+  int loss = argc > 2 ? atoi(argv[2]) : 0;
+  size_t mtu = argc > 3 ? strtoul(argv[3], NULL, 10) : 9000;
+  std::vector<char> b(9000);
+  sarnet::ip from;
+  ssize_t len;
+  size_t data = 0, statuses = 0, iter, idle = 0;
+
+  if (mb == 0 || loss < 0 || loss > 50 || mtu < 512 || mtu > b.size()) {
+    fprintf(stderr, "membench: MB loss%% mtu\n");
+    return 2;
+  }
+  if (!Make(mb * 1024 * 1024)) {
+    perror("membench: Cannot make the file to send");
+    return 2;
+  }
+  unlink(dstname);
+
+  sarnet::memlink a(sarnet::linkaddr(string("SAR1")), mtu);
+  sarnet::memlink z(sarnet::linkaddr(string("SAR2")), mtu);
+  a.connect(&z);
+  a.loss(loss);
+  z.loss(loss);
+  sarnet::udp* out = new sarnet::udp(&a, "SAR2");
+  sarnet::udp* back = new sarnet::udp(&z, "SAR1");
+  request req(F_REQUEST_PUT, 1, dstname);
+  tran* s = sartransfers.add(OUTBOUND, TO_SOCKET, &req, out, srcname);
+  tran* r = sartransfers.add(INBOUND, FROM_SOCKET, &req, back, dstname);
+  if (s == nullptr || r == nullptr) {
+    fprintf(stderr, "membench: Cannot start the transfers\n");
+    return 2;
+  }
+
+  double t = Seconds();
+  s->sendmetadata();
+  for (iter = 0; !r->done() && idle < 1000; iter++) {
+    size_t before = data;
+    // The sender fills its holes first, then carries on through the file
+    if (s->holelist()->count() > 0)
+      s->sendholes(65536);
+    else if (s->local()->read(65536) > 0)
+      s->senddata(s->local()->buffers());
+    out->send();
+    while ((len = back->rx(&b[0], &from)) > 0) {
+      Fframetype ft((flag_t)ntohl(*(uint32_t*)&b[0]));
+      if (ft.get() == F_FRAMETYPE_METADATA) {
+        metadata m(&b[0], len);
+        r->applymetadata(&m);
+      } else if (ft.get() == F_FRAMETYPE_DATA) {
+        dataview d(&b[0], len);
+        r->applydata(d);
+        data++;
+      } else if (ft.get() == F_FRAMETYPE_REPAIR) {
+        repair rp(&b[0], len);
+        r->applyrepair(&rp);
+      }
+    }
+    // A STATUS back every few rounds, as the receiver is asked for one
+    if (iter % 4 == 3 || r->done()) {
+      r->sendstatus();
+      back->send();
+      while ((len = out->rx(&b[0], &from)) > 0) {
+        statusview sv(&b[0], len);
+        s->applystatus(sv);
+        statuses++;
+      }
+    }
+    idle = (data == before) ? idle + 1 : 0;
+  }
+  t = Seconds() - t;
+  r->local()->fflush();
+  bool same = r->done() && Same();
+
+  // Back from the ncurses screen to say how it went
+  endwin();
+  printf("%zu MB, %d%% loss each way, MTU %zu\n", mb, loss, mtu);
+  printf("%zu DATA and %zu STATUS frames in %zu rounds\n", data, statuses,
+         iter);
+  printf("%8.1f MB/s\n", mb / t);
+  printf("%s\n", a.print().c_str());
+  printf("file %s\n", same ? "ok" : "FAILED");
+  unlink(srcname);
+  unlink(dstname);
+  return same ? 0 : 1;
+}
+#endif
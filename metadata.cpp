@@ -52,6 +52,51 @@ using namespace std;
 
 namespace saratoga {
 
+enum checksums::csum_type
+tocsumtype(enum f_csumtype f)
+{
+  switch (f) {
+    case F_CSUM_CRC32:
+      return checksums::CSUM_CRC32;
+    case F_CSUM_MD5:
+      return checksums::CSUM_MD5;
+    case F_CSUM_SHA1:
+      return checksums::CSUM_SHA1;
+    default:
+      return checksums::CSUM_NONE;
+  }
+}
+
+enum f_csumtype
+tocsumflag(enum checksums::csum_type c)
+{
+  switch (c) {
+    case checksums::CSUM_CRC32:
+      return F_CSUM_CRC32;
+    case checksums::CSUM_MD5:
+      return F_CSUM_MD5;
+    case checksums::CSUM_SHA1:
+      return F_CSUM_SHA1;
+    default:
+      return F_CSUM_NONE;
+  }
+}
+
+enum f_csumlen
+tocsumlen(enum checksums::csum_type c)
+{
+  switch (c) {
+    case checksums::CSUM_CRC32:
+      return F_CSUMLEN_CRC32;
+    case checksums::CSUM_MD5:
+      return F_CSUMLEN_MD5;
+    case checksums::CSUM_SHA1:
+      return F_CSUMLEN_SHA1;
+    default:
+      return F_CSUMLEN_NONE;
+  }
+}
+
 metadata::metadata(const enum f_descriptor des, const enum f_transfer tfr,
                    const enum f_progress prog, const session_t session,
                    sarfile::fileio* local)
@@ -61,23 +106,12 @@ metadata::metadata(const enum f_descriptor des, const enum f_transfer tfr,
   _badframe = false;
   _payload = nullptr;
 
-  Fversion version = F_VERSION_1;
-  Fframetype frametype = F_FRAMETYPE_METADATA;
-  Fdescriptor descriptor = des;
-  Ftransfer transfer = tfr;  // What are we transferring
-  Fprogress progress = prog; // Are we in progress or terminating
-  Fmetadata_udptype metadata_udptype = F_UDPONLY; // We only do UDP
-  Fcsumtype csumtype = local->csum().csumtype();
-  Fcsumlen csumlen = local->csum().csumlen();
-
-  _flags += version;
-  _flags += frametype;
-  _flags += descriptor;
-  _flags += transfer;
-  _flags += progress;
-  _flags += metadata_udptype;
-  _flags += csumtype;
-  _flags += csumlen;
+  Fcsumtype csumtype = tocsumflag(local->csum().csumtype());
+  Fcsumlen csumlen = tocsumlen(local->csum().csumtype());
+
+  // We only do UDP
+  _flags = hdr::metadataflags(des, tfr, prog, F_UDPONLY, csumlen.get(),
+                              csumtype.get());
 
   _session = session;
 
@@ -261,6 +295,30 @@ metadata::csumlen(enum f_csumlen l)
   return csumlen.get();
 }
 
+enum f_compress
+metadata::compress(enum f_compress c)
+{
+  Fcompress compress = c;
+  _flags += compress;
+  if (_paylen >= sizeof(flag_t)) {
+    uint32_t tmp_32 = htonl(_flags.get());
+    memcpy(_payload, &tmp_32, sizeof(flag_t));
+  }
+  return compress.get();
+}
+
+enum f_mcast
+metadata::mcast(enum f_mcast m)
+{
+  Fmcast mcast = m;
+  _flags += mcast;
+  if (_paylen >= sizeof(flag_t)) {
+    uint32_t tmp_32 = htonl(_flags.get());
+    memcpy(_payload, &tmp_32, sizeof(flag_t));
+  }
+  return mcast.get();
+}
+
 // Get various flags applicable to metadata frames
 enum f_descriptor
 metadata::descriptor()
@@ -304,6 +362,20 @@ metadata::csumlen()
   return l.get();
 }
 
+enum f_compress
+metadata::compress()
+{
+  Fcompress c = _flags.get();
+  return c.get();
+}
+
+enum f_mcast
+metadata::mcast()
+{
+  Fmcast m = _flags.get();
+  return m.get();
+}
+
 /*
  * Print out the metadata
  *	flags
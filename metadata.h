@@ -142,6 +142,8 @@ public:
   enum f_udptype metadata_udptype();
   enum f_csumlen csumlen();
   enum f_csumtype csumtype();
+  enum f_compress compress();
+  enum f_mcast mcast();
 
   // Set various flags applicable to metadata
   enum f_descriptor descriptor(f_descriptor);
@@ -150,6 +152,9 @@ public:
   enum f_udptype metadata_udptype(f_udptype);
   enum f_csumlen csumlen(f_csumlen);
   enum f_csumtype csumtype(f_csumtype);
+  // These two are also written into the assembled frame
+  enum f_compress compress(f_compress);
+  enum f_mcast mcast(f_mcast);
 
   // Yes I am a METADATA frame
   f_frametype type() { return F_FRAMETYPE_METADATA; };
@@ -179,6 +184,11 @@ public:
   string print();
 };
 
+// Map between the METADATA checksum flags and the checksums library type
+extern enum checksums::csum_type tocsumtype(enum f_csumtype);
+extern enum f_csumtype tocsumflag(enum checksums::csum_type);
+extern enum f_csumlen tocsumlen(enum checksums::csum_type);
+
 } // Namespace saratoga
 
 #endif // _METADATA_H
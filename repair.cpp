@@ -0,0 +1,279 @@
+/*
+
+ Copyright (c) 2012, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "dcodec.h"
+#include "fec.h"
+#include "frame.h"
+#include "globals.h"
+#include "repair.h"
+#include "saratoga.h"
+#include "sarflags.h"
+#include "screen.h"
+
+using namespace std;
+
+namespace saratoga {
+
+// Flags, session, first offset, then n, k, row and a spare byte
+static size_t
+rephdrlen(const dcodecs* dc)
+{
+  return sizeof(flag_t) + sizeof(session_t) + dc->length + 4;
+}
+
+// Create a repair frame from scratch
+repair::repair(const enum f_descriptor des, const session_t session,
+               const fecencoder& fec, const uint8_t row)
+{
+  uint32_t tmp_32;
+  uint16_t tmp_16;
+
+  _badframe = false;
+  _payload = nullptr;
+  _paylen = 0;
+  _session = session;
+  _k = fec.k();
+  _row = row;
+  _parityoff = 0;
+
+  const dcodecs* dc = dcodecs::lookup(des);
+  if (dc == nullptr) {
+    scr.error("repair(): Descriptor 128 Bit Size Not Supported\n");
+    _badframe = true;
+    return;
+  }
+  const fecgroup& g = fec.group();
+  std::map<uint8_t, std::vector<uint8_t> >::const_iterator r =
+    g.rows.find(row);
+  if (g.len.empty() || r == g.rows.end()) {
+    scr.error("repair(): No repair row %d", (int)row);
+    _badframe = true;
+    return;
+  }
+  _group.first = g.first;
+  _group.len = g.len;
+  _group.span = g.span;
+  _group.z = g.z;
+
+  // Work out how big our frame has to be and allocate it
+  size_t n = g.len.size();
+  _parityoff = rephdrlen(dc) + n * 2 * sizeof(uint16_t);
+  size_t fsize = _parityoff + r->second.size();
+
+  _payload = new char[fsize];
+  _paylen = fsize;
+  char* rbufp = _payload;
+
+  // Set and copy flags
+  _flags = hdr::repairflags(des);
+
+  tmp_32 = htonl(_flags.get());
+  memcpy(rbufp, &tmp_32, sizeof(flag_t));
+  rbufp += sizeof(flag_t);
+
+  // Set and copy session
+  tmp_32 = htonl(session);
+  memcpy(rbufp, &tmp_32, sizeof(session_t));
+  rbufp += sizeof(session_t);
+
+  rbufp = dc->put(rbufp, _group.first);
+  *rbufp++ = (char)n;
+  *rbufp++ = (char)_k;
+  *rbufp++ = (char)_row;
+  *rbufp++ = 0;
+
+  for (size_t j = 0; j < n; j++) {
+    tmp_16 = htons(g.len[j] | (g.z[j] ? zbit : 0));
+    memcpy(rbufp, &tmp_16, sizeof(uint16_t));
+    rbufp += sizeof(uint16_t);
+    tmp_16 = htons(g.span[j]);
+    memcpy(rbufp, &tmp_16, sizeof(uint16_t));
+    rbufp += sizeof(uint16_t);
+  }
+  if (!r->second.empty())
+    memcpy(rbufp, &r->second[0], r->second.size());
+}
+
+/*
+ * Given a buffer and length, assemble the repair
+ */
+repair::repair(char* payload, const size_t pl)
+{
+  size_t paylen = pl;
+  uint16_t tmp_16;
+
+  // Copy the frame info
+  _badframe = false;
+  _paylen = paylen;
+  _payload = new char[_paylen];
+  memcpy(_payload, payload, paylen);
+
+  _session = 0;
+  _k = 0;
+  _row = 0;
+  _parityoff = 0;
+  _group.first = 0;
+
+  if (paylen < sizeof(flag_t) + sizeof(session_t)) {
+    scr.error("repair(frame): Frame too short");
+    _badframe = true;
+    return;
+  }
+
+  // Assemble the flags info
+  _flags = (flag_t)ntohl(*(uint32_t*)payload);
+  payload += sizeof(flag_t);
+  paylen -= sizeof(flag_t);
+
+  Fversion version = _flags.get();
+  Fframetype frametype = _flags.get();
+  Fdescriptor descriptor = _flags.get();
+
+  if (version.get() != F_VERSION_1) {
+    scr.error("Repair: Bad Saratoga Version");
+    _badframe = true;
+    return;
+  }
+  if (frametype.get() != F_FRAMETYPE_REPAIR) {
+    scr.error("Repair: Not a REPAIR frame");
+    _badframe = true;
+    return;
+  }
+  const dcodecs* dc = dcodecs::lookup(descriptor.get());
+  if (dc == nullptr) {
+    scr.error("repair(frame): Descriptor 128 Bit Size Not Supported\n");
+    _badframe = true;
+    return;
+  }
+  if (pl < rephdrlen(dc)) {
+    scr.error("repair(frame): Frame too short");
+    _badframe = true;
+    return;
+  }
+
+  // Session ID
+  _session = (session_t)ntohl(*(uint32_t*)payload);
+  payload += sizeof(session_t);
+  paylen -= sizeof(session_t);
+
+  _group.first = dc->get(payload);
+  payload += dc->length;
+  paylen -= dc->length;
+
+  size_t n = (uint8_t)payload[0];
+  _k = (uint8_t)payload[1];
+  _row = (uint8_t)payload[2];
+  payload += 4;
+  paylen -= 4;
+
+  if (n == 0 || n > fecencoder::maxn || _k == 0 || _k > fecencoder::maxk ||
+      _row >= _k || paylen < n * 2 * sizeof(uint16_t)) {
+    scr.error("repair(frame): Bad repair group");
+    _badframe = true;
+    return;
+  }
+  for (size_t j = 0; j < n; j++) {
+    memcpy(&tmp_16, payload, sizeof(uint16_t));
+    tmp_16 = ntohs(tmp_16);
+    _group.len.push_back(tmp_16 & ~zbit);
+    _group.z.push_back((tmp_16 & zbit) != 0);
+    memcpy(&tmp_16, payload + sizeof(uint16_t), sizeof(uint16_t));
+    _group.span.push_back(ntohs(tmp_16));
+    payload += 2 * sizeof(uint16_t);
+    paylen -= 2 * sizeof(uint16_t);
+  }
+  _parityoff = pl - paylen;
+  // The parity is as long as the longest payload
+  if (paylen != _group.maxlen()) {
+    scr.error("repair(frame): Parity length %zu should be %zu", paylen,
+              _group.maxlen());
+    _badframe = true;
+    return;
+  }
+}
+
+enum f_descriptor
+repair::descriptor()
+{
+  Fdescriptor t = _flags.get();
+  return t.get();
+}
+
+/*
+ * Print out the repair flags & group
+ */
+string
+repair::print()
+{
+  char tmp[128];
+  string s;
+
+  if (_badframe) {
+    s = "repair::print(): Bad REPAIR Frame";
+    scr.error(s);
+    return (s);
+  }
+  Fversion version = _flags.get();
+  Fframetype frametype = _flags.get();
+  Fdescriptor descriptor = _flags.get();
+
+  s = frametype.print();
+  s += printflags("REPAIR FLAGS", this->flags());
+  s += "    ";
+  s += version.print();
+  s += "\n    ";
+  s += descriptor.print();
+  s += "\n    ";
+  sprintf(tmp, "Session: %" PRIu32 "", (uint32_t)_session);
+  s += tmp;
+  s += "\n    ";
+  sprintf(tmp, "Repair %d of %d for %zu DATA frames from offset %" PRIu64 "",
+          (int)_row + 1, (int)_k, _group.len.size(),
+          (uint64_t)_group.first);
+  s += tmp;
+  s += "\n    ";
+  sprintf(tmp, "Parity Length: %zu", this->paritylen());
+  s += tmp;
+  return (s);
+}
+
+}; // Namespace saratoga
@@ -0,0 +1,183 @@
+/*
+
+ Copyright (c) 2011, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#ifndef _REPAIR_H
+#define _REPAIR_H
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "fec.h"
+#include "frame.h"
+#include "ip.h"
+#include "saratoga.h"
+#include "sarflags.h"
+#include "screen.h"
+
+using namespace std;
+
+namespace saratoga {
+/*
+ **********************************************************************
+ * REPAIR
+ **********************************************************************
+ */
+
+/*
+ * One row of the forward error correction for a group of DATA frames,
+ * see fec.h. After the flags and session come the offset of the first
+ * DATA frame in the group (descriptor sized), the number of frames in
+ * the group, the number of repairs for it and which repair this is,
+ * then for each frame its payload length (top bit set if compressed)
+ * and how much of the file it covers, both 16 bit, then the parity
+ */
+class repair : public frame
+{
+private:
+  Fflag _flags;        // repair's Flags
+  session_t _session;  // The session ID
+  fecgroup _group;     // Layout of the group, no rows
+  uint8_t _k;          // Repairs for the group
+  uint8_t _row;        // Which one this is
+  size_t _parityoff;   // Where the parity starts in the payload
+protected:
+  bool _badframe; // Are we a good or bad repair frame
+  char* _payload; // Complete payload of frame
+  size_t _paylen; // Length of payload
+public:
+  // Top bit of a member's length, the payload is compressed
+  static const uint16_t zbit = 0x8000;
+
+  // This is how we assemble a local repair frame for a row of a group
+  repair(const enum f_descriptor, // Flags
+         const session_t,         // Session
+         const fecencoder&,       // The group
+         const uint8_t);          // Row
+
+  // We have received a remote frame that is REPAIR
+  repair(char*,         // Pointer to buffer received
+         const size_t); // Total length of buffer
+
+  ~repair() { this->clear(); };
+
+  void clear()
+  {
+    if (_paylen > 0)
+      delete[] _payload;
+    _paylen = 0;
+    _flags = 0;
+    _session = 0;
+    _group = fecgroup();
+    _k = 0;
+    _row = 0;
+    _parityoff = 0;
+  };
+
+  // Copy Constructor
+  repair(const repair& old)
+  {
+    if (old._paylen > 0) {
+      _payload = new char[old._paylen];
+      memcpy(_payload, old._payload, old._paylen);
+    } else
+      _payload = nullptr;
+    _paylen = old._paylen;
+    _flags = old._flags;
+    _session = old._session;
+    _group = old._group;
+    _k = old._k;
+    _row = old._row;
+    _parityoff = old._parityoff;
+    _badframe = old._badframe;
+  }
+
+  repair& operator=(const repair& old)
+  {
+    if (old._paylen > 0) {
+      _payload = new char[old._paylen];
+      memcpy(_payload, old._payload, old._paylen);
+    } else
+      _payload = nullptr;
+    _paylen = old._paylen;
+    _flags = old._flags;
+    _session = old._session;
+    _group = old._group;
+    _k = old._k;
+    _row = old._row;
+    _parityoff = old._parityoff;
+    _badframe = old._badframe;
+    return (*this);
+  };
+
+  bool badframe() { return _badframe; };
+  size_t paylen() { return _paylen; };
+  char* payload() { return _payload; };
+
+  enum f_descriptor descriptor();
+
+  session_t session() { return _session; };
+  const fecgroup& group() { return _group; };
+  uint8_t k() { return _k; };
+  uint8_t row() { return _row; };
+  const char* parity() { return _payload + _parityoff; };
+  size_t paritylen() { return _paylen - _parityoff; };
+
+  // The repair frames flags
+  flag_t flags() { return _flags.get(); };
+
+  // Yes I am a repair frame
+  f_frametype type() { return F_FRAMETYPE_REPAIR; };
+
+  ssize_t tx(sarnet::udp* sock) { return (sock->tx(_payload, _paylen)); };
+
+  ssize_t rx()
+  {
+    string s = "REPAIR RX: ";
+    s += this->print();
+    cout << s << endl;
+    return (-1);
+  };
+
+  string print();
+};
+
+} // Namespace saratoga
+
+#endif // _REPAIR_H
@@ -238,6 +238,19 @@ public:
   // What are the requests flags
   flag_t flags() { return _flags.get(); };
 
+  // Narrow the descriptor to what the file needs, it is written into
+  // the assembled frame too
+  enum f_descriptor descriptor(enum f_descriptor d)
+  {
+    Fdescriptor descriptor = d;
+    _flags += descriptor;
+    if (_paylen >= sizeof(flag_t)) {
+      uint32_t tmp_32 = htonl(_flags.get());
+      memcpy(_payload, &tmp_32, sizeof(flag_t));
+    }
+    return descriptor.get();
+  };
+
   // These and only these flags can be changed during a session
 
   // Transmit a request to a socket
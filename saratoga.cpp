@@ -40,6 +40,7 @@
 #include "cli.h"
 #include "globals.h"
 #include "ip.h"
+#include "kiss.h"
 #include "sarflags.h"
 #include "screen.h"
 #include "timestamp.h"
@@ -54,9 +55,13 @@
 #include "beacon.h"
 #include "data.h"
 #include "frame.h"
+#include "frameview.h"
 #include "metadata.h"
 #include "request.h"
+#include "repair.h"
+#include "signature.h"
 #include "status.h"
+#include "symbol.h"
 
 #include "holes.h"
 
@@ -66,6 +71,27 @@ namespace saratoga {
 
 bool resizeset = false;
 
+// The group sends our own multicast put back to us, there is nothing to
+// do with it. A frame is ours if it is for a session we are multicasting
+// and comes from our own address
+static bool
+ourmulticast(const string& from, const char* buf, size_t len,
+             enum f_frametype type)
+{
+  session_t session;
+
+  if (type != F_FRAMETYPE_REQUEST && type != F_FRAMETYPE_METADATA &&
+      type != F_FRAMETYPE_DATA && type != F_FRAMETYPE_REPAIR &&
+      type != F_FRAMETYPE_SYMBOL)
+    return false;
+  if (len < sizeof(flag_t) + sizeof(session_t))
+    return false;
+  memcpy(&session, buf + sizeof(flag_t), sizeof(session_t));
+  if (sartransfers.mmatch((session_t)ntohl(session)) == nullptr)
+    return false;
+  return (from == v4out->straddr() || from == v6out->straddr());
+}
+
 // Work out what frame type we have read and handle it
 // If the # if fd's change then return true so we know in our mainloop
 // to redo the select()
@@ -74,24 +100,22 @@ readhandler(string from, char* buf, size_t len)
 {
 
   flag_t flags;
-  sarnet::udp* sock;  // Where we want to create a socket to for writing
-  sarnet::ip* ipaddr; // Source IP address
-  saratoga::tran* t;  // The applicable transfer a frame is received for
+  sarnet::udp* sock; // Where we want to create a socket to for writing
+  saratoga::tran* t; // The applicable transfer a frame is received for
 
-  ipaddr = new sarnet::ip(from);
+  sarnet::ip ipaddr(from); // Source IP address
   // What is the source IP of this frame
   // Add it into our list of peers and open a socket to the peer (to)
   // if not already there
-  if ((sock = sarpeers.match(ipaddr)) == nullptr) {
-    if (ipaddr->family() == AF_AX25)
-      sarpeers.add(ipaddr, 0);
+  if ((sock = sarpeers.match(&ipaddr)) == nullptr) {
+    if (ipaddr.family() == AF_AX25)
+      sarpeers.add(&ipaddr, 0);
     else
-      sarpeers.add(ipaddr, sarport);
+      sarpeers.add(&ipaddr, sarport);
 
     // Make SURE we have the socket in the list and it is open
-    if ((sock = sarpeers.match(ipaddr)) == nullptr) {
-      string socks = sock->print();
-      scr.error("Readhandler: Cannot establish socket to %s", socks.c_str());
+    if ((sock = sarpeers.match(&ipaddr)) == nullptr) {
+      scr.error("Readhandler: Cannot establish socket to %s", from.c_str());
       return false;
     }
   }
@@ -115,6 +139,11 @@ readhandler(string from, char* buf, size_t len)
     return false;
   }
 
+  if (ourmulticast(from, buf, len, frametype.get())) {
+    scr.debug(9, "Rx our own multicast from %s", from.c_str());
+    return false;
+  }
+
   switch (frametype.get()) {
     case F_FRAMETYPE_BEACON:
       saratoga::beacon* b;
@@ -123,7 +152,7 @@ readhandler(string from, char* buf, size_t len)
         scr.error("Rx malformed BEACON from %s", from.c_str());
       else {
         scr.msgin("Rx BEACON from %s", from.c_str());
-        sarpeersinfo.add(ipaddr, b); // Get the beacon info from it
+        sarpeersinfo.add(&ipaddr, b); // Get the beacon info from it
         scr.debug(7, b->print());
       }
       delete b;
@@ -148,7 +177,13 @@ readhandler(string from, char* buf, size_t len)
       delete r;
       return true;
       break;
-    case F_FRAMETYPE_METADATA:
+    case F_FRAMETYPE_METADATA: {
+      // Bounds check it in place before we decode the directory entry
+      saratoga::metadataview mv(buf, len);
+      if (mv.badframe()) {
+        scr.error("Rx malformed METADATA from %s", from.c_str());
+        return false;
+      }
       saratoga::metadata* m;
       m = new metadata(buf, len);
       if (m->badframe())
@@ -157,104 +192,161 @@ readhandler(string from, char* buf, size_t len)
         scr.msgin("Rx METATDATA from %s", from.c_str());
         if ((t = sartransfers.rxmetadata(m, sock)) == nullptr)
           scr.error("Bad METADATA no such transfer");
-        else
-          t->sendstatus();
+        else if (!t->sigwait() && !t->multicast())
+          t->sendstatus(); // Else once the signatures say what we need,
+                           // or from a group once we have lost something
         scr.debug(7, m->print());
       }
       delete m;
       return false;
       break;
-    case F_FRAMETYPE_DATA:
-      saratoga::data* d;
-      d = new data(buf, len);
-      if (d->badframe())
+    }
+    case F_FRAMETYPE_DATA: {
+      // Decoded in place, the payload is written from buf
+      saratoga::dataview d(buf, len);
+      if (d.badframe())
         scr.error("Rx malformed DATA from %s", from.c_str());
       else {
         scr.msgin("Rx DATA from %s Length=%d Offset=%" PRIu64 "", from.c_str(),
-                  d->dbuflen(), d->offset());
+                  d.dbuflen(), d.offset());
 
         if ((t = sartransfers.rxdata(d, sock)) == nullptr)
           scr.error("Bad DATA no such transfer");
         else {
-          if (t->status_expired())
+          if (t->status_due())
             t->sendstatus();
         }
-        scr.debug(7, d->print());
       }
-      delete d;
       return false;
       break;
-    case F_FRAMETYPE_STATUS:
-      saratoga::status* s;
-      s = new status(buf, len);
-      if (s->badframe()) {
+    }
+    case F_FRAMETYPE_STATUS: {
+      // Decoded in place, holes are read straight from buf
+      saratoga::statusview s(buf, len);
+      if (s.badframe()) {
         scr.error("Rx malformed STATUS from %s", from.c_str());
-        delete s;
         return false;
-      } else {
-        if ((t = sartransfers.rxstatus(s, sock)) == nullptr) {
-          scr.error("Bad STATUS no such transfer");
-          delete s;
-          return false;
+      }
+      if ((t = sartransfers.rxstatus(s, sock)) == nullptr) {
+        scr.error("Bad STATUS no such transfer");
+        return false;
+      }
+      // Reset the STATUS timer
+      t->status_reset();
+      scr.msgin("Rx STATUS from %s ERRCODE=%s", from.c_str(),
+                s.errprint().c_str());
+      // A receiver of a multicast put we are sending, the others
+      // carry on whatever this one says
+      if (t->multicast() && t->dir() == TO_SOCKET) {
+        if (s.errcode() != F_ERRCODE_SUCCESS)
+          scr.error("Received STATUS ERROR %s from %s, leaving it out of "
+                    "multicast transfer %" PRIu32 "",
+                    s.errprint().c_str(), from.c_str(), t->session());
+        else if (s.metadatarecvd() == F_METADATARECVD_YES &&
+                 s.holecount() == 0 && s.progress() == t->localflen()) {
+          scr.msg("%s has completed multicast transfer %" PRIu32 "",
+                  from.c_str(), t->session());
+          t->sendstatus(sock); // So it can close its tfr
+        }
+        scr.debug(7, s.print());
+        return false;
+      }
+      // THIS IS WHERE WE HANDLE ALL OF THE STATUS
+      // ERROR CODES
+      if (s.errcode() != F_ERRCODE_SUCCESS) {
+        // Lets just tell us for the moment
+        scr.error("Received STATUS ERROR %s Removing transfer: %s",
+                  s.errprint().c_str(), t->print().c_str());
+        sartransfers.remove(t);
+        return true;
+      }
+      // All is done we have received the metadata and we have no holes
+      // and the progress is the size of the file
+      if (t->metadatarecvd() == F_METADATARECVD_YES && s.holecount() == 0 &&
+          s.progress() == t->localflen()) {
+        scr.msg("Received STATUS and completed transfer %" PRIu32 " from %s",
+                t->session(), from.c_str());
+        t->sendstatus(); // Send a status back to the other end to close
+                         // its tfr
+        // transfer is done so remove it
+        sartransfers.remove(t);
+        return true;
+      }
+      // We have holes, add them to the transfer for processing
+      if (s.holecount() > 0) {
+        if (s.allholes() == F_ALLHOLES_YES) {
+          // All of the holes are in this STATUS frame for the transfer
+          // Clear the existing holes (if any)
+          // MMMMMMMMMM lets think about this some more!!!!!!!
+          t->holes_clear();
+          // Now Add the new holes that are in our STATUS frame
+          t->holes_add(s);
+          scr.msg("Received all holes in STATUS transfer %" PRIu32 ": %s",
+                  t->session(), t->holes_print().c_str());
         } else {
-          // Reset the STATUS timer
-          t->status_reset();
-          scr.msgin("Rx STATUS from %s ERRCODE=%s", from.c_str(),
-                    s->errprint().c_str());
-          // THIS IS WHERE WE HANDLE ALL OF THE STATUS
-          // ERROR CODES
-          if (s->errcode() != F_ERRCODE_SUCCESS) {
-            // Lets just tell us for the moment
-            scr.error("Received STATUS ERROR %s Removing transfer: %s",
-                      s->errprint().c_str(), t->print().c_str());
-            sartransfers.remove(t);
-            delete s;
-            return true;
-          } else {
-            // All is done we have received the metadata and we have no holes
-            // and the progress is the size of the file
-            if (t->metadatarecvd() == F_METADATARECVD_YES &&
-                s->holecount() == 0 && s->progress() == t->localflen()) {
-              scr.msg("Received STATUS and completed transfer %" PRIu32
-                      " from %s",
-                      t->session(), from.c_str());
-              t->sendstatus(); // Send a status back to the other end to close
-                               // its tfr
-              // transfer is done so remove it
-              sartransfers.remove(t);
-              delete s;
-              return true;
-            }
-            // We have holes, add them to the transfer for processing
-            if (s->holecount() > 0) {
-              if (s->allholes() == F_ALLHOLES_YES) {
-                // All of the holes are in this STATUS frame for the transfer
-                // Clear the existing holes (if any)
-                // MMMMMMMMMM lets think about this some more!!!!!!!
-                t->holes_clear();
-                // Now Add the new holes that are in our STATUS frame
-                t->holes_add(s->holesptr());
-                scr.msg("Received all holes in STATUS transfer %" PRIu32 ": %s",
-                        t->session(), t->holes_print().c_str());
-              } else {
-                // The holes are to be added to the transfers current hole list
-                t->holes_add(s->holesptr());
-                scr.msg("Added more holes from STATUS transfer %" PRIu32 ": %s",
-                        t->session(), t->holes_print().c_str());
-              }
-            }
-          }
+          // The holes are to be added to the transfers current hole list
+          t->holes_add(s);
+          scr.msg("Added more holes from STATUS transfer %" PRIu32 ": %s",
+                  t->session(), t->holes_print().c_str());
         }
-        scr.debug(7, s->print());
       }
-      delete s;
+      scr.debug(7, s.print());
+      return false;
+      break;
+    }
+    case F_FRAMETYPE_SIGNATURE: {
+      saratoga::signature* g;
+      g = new signature(buf, len);
+      if (g->badframe())
+        scr.error("Rx malformed SIGNATURE from %s", from.c_str());
+      else {
+        scr.msgin("Rx SIGNATURE from %s", from.c_str());
+        if (sartransfers.rxsignature(g, sock) == nullptr)
+          scr.error("Bad SIGNATURE no such transfer");
+        scr.debug(7, g->print());
+      }
+      delete g;
+      return false;
+      break;
+    }
+    case F_FRAMETYPE_REPAIR: {
+      saratoga::repair* p;
+      p = new repair(buf, len);
+      if (p->badframe())
+        scr.error("Rx malformed REPAIR from %s", from.c_str());
+      else {
+        scr.msgin("Rx REPAIR from %s", from.c_str());
+        if ((t = sartransfers.rxrepair(p, sock)) == nullptr)
+          scr.error("Bad REPAIR no such transfer");
+        else if (t->status_due())
+          t->sendstatus();
+        scr.debug(7, p->print());
+      }
+      delete p;
       return false;
       break;
+    }
+    case F_FRAMETYPE_SYMBOL: {
+      saratoga::symbol* y;
+      y = new symbol(buf, len);
+      if (y->badframe())
+        scr.error("Rx malformed SYMBOL from %s", from.c_str());
+      else {
+        scr.msgin("Rx SYMBOL from %s", from.c_str());
+        if ((t = sartransfers.rxsymbol(y, sock)) == nullptr)
+          scr.error("Bad SYMBOL no such transfer");
+        else if (t->status_due())
+          t->sendstatus();
+        scr.debug(9, y->print());
+      }
+      delete y;
+      return false;
+      break;
+    }
     default:
       scr.error("Rx Invalid Saratoga Frame Type from %s", from.c_str());
       break;
   }
-  delete ipaddr;
   return false;
 }
 
@@ -320,6 +412,44 @@ help(string s)
     saratoga::scr.std('\n');
 }
 
+// Open an AX.25 port, a KISS TNC or the kernel's, paced for a half duplex
+// radio and fragmenting what is too big for a UI frame
+static void
+openax25(const cli_ax25port::port& p)
+{
+  sarnet::datalink* l = nullptr;
+
+  if (p.axport == "") {
+    sarnet::kiss* tnc = new sarnet::kiss();
+    if (tnc->open(p.device, p.call, ax25_mcast, p.baud)) {
+      l = tnc;
+      if (tnc->ptyname() != "")
+        saratoga::scr.msg("[AX25] KISS TNC pty is %s", tnc->ptyname().c_str());
+    } else {
+      saratoga::scr.perror(errno, "[AX25] Cannot open KISS TNC %s",
+                           p.device.c_str());
+      delete tnc;
+    }
+  } else {
+    sarnet::ax25kernel* port = new sarnet::ax25kernel();
+    if (port->open(p.axport, ax25_mcast))
+      l = port;
+    else
+      delete port;
+  }
+  if (l == nullptr)
+    return;
+  // On a half duplex radio we take turns on the air with the peer
+  if (p.airbaud > 0)
+    l = new sarnet::airtime(l, p.airbaud, p.txdelay);
+  // Frames too big for a UI frame go out in fragments
+  l = new sarnet::fraglink(l);
+  ax25ports.push_back(
+    sarnet::ax25port(cli_ax25port::name(p), l, ax25_mcast, p.airbaud > 0));
+  saratoga::scr.msg("[AX25] AX.25 started with success on %s\n",
+                    l->print().c_str());
+}
+
 // Initialise saratoga. Open the sockets
 void
 initialise(string logname, string confname)
@@ -365,7 +495,35 @@ initialise(string logname, string confname)
     sleep(3);
   }
 
-  sarnet::udp::initax25();
+  // The AX.25 ports in saratoga.conf, or else the one KISS TNC if one is
+  // set up, or else the kernel's
+  if (c_ax25port.state()) {
+    for (size_t i = 0; i < c_ax25port.ports().size(); i++)
+      openax25(c_ax25port.ports()[i]);
+  } else {
+    cli_ax25port::port p;
+    p.axport = c_kiss.state() ? "" : ax25_port;
+    p.device = c_kiss.device();
+    p.call = c_kiss.call();
+    p.baud = c_kiss.baud();
+    p.airbaud = c_airtime.state() ? c_airtime.baud() : 0;
+    p.txdelay = c_airtime.txdelay();
+    openax25(p);
+  }
+  // Stations set to a port in saratoga.conf
+  for (std::map<string, string>::const_iterator r =
+         c_ax25port.routes().begin();
+       r != c_ax25port.routes().end(); r++) {
+    size_t i;
+    for (i = 0; i < ax25ports.size(); i++)
+      if (ax25ports[i].name() == r->second)
+        break;
+    if (i < ax25ports.size())
+      ax25reroute(r->first, ax25ports[i].link());
+    else
+      saratoga::scr.error("[AX25] No AX.25 port %s for %s", r->second.c_str(),
+                          r->first.c_str());
+  }
 
   // IPv4 listening input socket
   v4in = new sarnet::udp(AF_INET, sarport);
@@ -431,6 +589,13 @@ initialise(string logname, string confname)
     saratoga::scr.msg(" Mcast In %s", v6mcastin->print().c_str());
     saratoga::scr.msg(" Mcast Out %s", v6mcastout->print().c_str());
   }
+  // Whole file checksums are worked out off the main loop
+  sarcsumfd = CSUMPOOL_Start(0);
+  if (sarcsumfd < 0)
+    saratoga::scr.error("Cannot start checksum threads, checksums will be "
+                        "computed as files are sent");
+  else
+    saratoga::scr.msg("Checksum threads %d", CSUMPOOL_Threads());
   sarlog->fflush(); // Make sure our log file is flushed
   saratoga::scr.msg("initialise(): %s", interfaces.print().c_str());
 }
@@ -456,6 +621,9 @@ finalise(string config_file)
   sprintf(str, "####################SARATOGA ENDED OK###################\n");
   saratoga::scr.msg(str);
 
+  // What the checksum cache has not written out yet
+  sarcsums.flush();
+
   // Write out the configuration file updating session
   writeconf(config_file);
   sarlog->fflush();
@@ -486,6 +654,16 @@ fdchange()
   return (false);
 }
 
+// Has a link read frames in a batch that select() won't tell us about
+static bool
+rxpending(std::vector<sarnet::udp*>& inputs)
+{
+  for (size_t i = 0; i < inputs.size(); i++)
+    if (inputs[i]->pending())
+      return (true);
+  return (false);
+}
+
 //#ifdef SARATOGA
 int
 main(int argc, char** argv)
@@ -527,6 +705,8 @@ main(int argc, char** argv)
   fd_set cwfd;
   saratoga::cmds c;
   struct timespec wakeup;
+  struct timespec nowait;
+  struct timespec holdwait;
   int inkey;
   int selval;     // Value returned by pselect
   char buf[9000]; // Current frame input buffer
@@ -534,9 +714,20 @@ main(int argc, char** argv)
 
   initialise(logname, confname);
 
+  // Where frames come in, IPv4 & IPv6 unicast and multicast then AX.25
+  std::vector<sarnet::udp*> inputs;
+  inputs.push_back(v4in);
+  inputs.push_back(v4mcastin);
+  inputs.push_back(v6in);
+  inputs.push_back(v6mcastin);
+  for (size_t i = 0; i < ax25ports.size(); i++)
+    inputs.push_back(ax25ports[i].group());
+
   // Wake up every 5 seconds in select if required
   wakeup.tv_sec = 5;
   wakeup.tv_nsec = 0;
+  nowait.tv_sec = 0;
+  nowait.tv_nsec = 0;
 
   // Initial Prompt
   saratoga::scr.prompt();
@@ -593,12 +784,12 @@ main(int argc, char** argv)
     FD_SET(v6mcastin->fd(), &crfd);
     v6mcastin->ready(true);
 
-    // AX25
-    if (sarnet::udp::ax25available) {
-      FD_SET(ax25multiin->fd(), &crfd);
-      ax25multiin->ready(true);
-      (ax25multiout->ready()) ? FD_SET(ax25multiout->fd(), &cwfd)
-                              : FD_CLR(ax25multiout->fd(), &cwfd);
+    // AX25, each port
+    for (size_t i = 0; i < ax25ports.size(); i++) {
+      sarnet::udp* group = ax25ports[i].group();
+      FD_SET(ax25ports[i].link()->fd(), &crfd);
+      (group->ready() && group->holdoff() == 0) ? FD_SET(group->fd(), &cwfd)
+                                                : FD_CLR(group->fd(), &cwfd);
     }
 
     (sarlog->ready()) ? FD_SET(sarlog->fd(), &cwfd)
@@ -614,10 +805,15 @@ main(int argc, char** argv)
     (v6loop->ready()) ? FD_SET(v6loop->fd(), &cwfd)
                       : FD_CLR(v6loop->fd(), &cwfd);
 
+    // Have the checksum threads finished anything
+    if (sarcsumfd >= 0)
+      FD_SET(sarcsumfd, &crfd);
+
     // Are we ready to write to peers
     for (std::list<sarnet::udp>::iterator p = sarpeers.begin();
          p != sarpeers.end(); p++)
-      (p->ready()) ? FD_SET(p->fd(), &cwfd) : FD_CLR(p->fd(), &cwfd);
+      (p->ready() && p->holdoff() == 0) ? FD_SET(p->fd(), &cwfd)
+                                        : FD_CLR(p->fd(), &cwfd);
 
     // Are we ready to read or write to the local files
     for (std::list<saratoga::tran>::iterator tr = sartransfers.begin();
@@ -642,8 +838,22 @@ main(int argc, char** argv)
       }
     }
 
-    selval =
-      pselect(saratoga::maxfd() + 1, &crfd, &cwfd, nullptr, &wakeup, nullptr);
+    // Don't sit in select() with frames from a batch still to handle, nor
+    // past when the radio is ours to send on again
+    struct timespec* timeout = rxpending(inputs) ? &nowait : &wakeup;
+    long hold = 0;
+    for (size_t i = 0; i < ax25ports.size(); i++) {
+      long h = ax25ports[i].link()->holdoff();
+      if (h > 0 && (hold == 0 || h < hold))
+        hold = h;
+    }
+    if (timeout == &wakeup && hold > 0 && hold < wakeup.tv_sec * 1000) {
+      holdwait.tv_sec = hold / 1000;
+      holdwait.tv_nsec = (hold % 1000) * 1000000;
+      timeout = &holdwait;
+    }
+    selval = pselect(saratoga::maxfd() + 1, &crfd, &cwfd, nullptr, timeout,
+                     nullptr);
     switch (selval) {
       case -1:
         saratoga::scr.perror(errno, "Failure in select");
@@ -675,6 +885,9 @@ main(int argc, char** argv)
       beacontimer.reset(); // alterado //TODO Ele nunca chega aqui!??
     }
 
+    // Checksums worked out since it was last written go to the cache file
+    sarcsums.tick();
+
     // Handle al of the c_xxxxxx these are the results of
     // command line inputs
 
@@ -701,6 +914,16 @@ main(int argc, char** argv)
         saratoga::scr.error("Could not send put");
     }
 
+    // Multicast a file
+    if (saratoga::c_mput.ready()) {
+      if (saratoga::c_mput.execute()) {
+        saratoga::c_mput.ready(FALSE);
+        if (fdchange())
+          goto mainloop;
+      } else
+        saratoga::scr.error("Could not send mput");
+    }
+
     // Put then remove a file
     if (saratoga::c_putrm.ready()) {
       if (saratoga::c_putrm.execute()) {
@@ -889,76 +1112,40 @@ main(int argc, char** argv)
     // Now go through all of the open fd's and handle I/O on them if they are
     // ready
 
-    // Handle V4 Input frames
-    if (FD_ISSET(v4in->fd(), &crfd)) {
-      sarnet::ip* from = new sarnet::ip();
-      sz = v4in->rx(buf, from);
-      string s = from->straddr();
-      saratoga::scr.debug(7, "main(): v4in Read %d bytes from %s", sz,
-                          s.c_str());
-      delete from;
-      if (saratoga::readhandler(s, buf, sz) && fdchange())
-        goto mainloop;
-    }
-    // Handle V4 Input Multicast frames
-    if (FD_ISSET(v4mcastin->fd(), &crfd)) {
-      sarnet::ip* from = new sarnet::ip();
-      sz = v4mcastin->rx(buf, from);
-      string s = from->straddr();
-      saratoga::scr.debug(7, "main(): v4mcastin Read %d bytes from %s", sz,
-                          s.c_str());
-      delete from;
-      if (saratoga::readhandler(s, buf, sz) && fdchange())
-        goto mainloop;
-    }
-    // Handle V6 Input frames
-    if (FD_ISSET(v6in->fd(), &crfd)) {
+    // Handle Input frames
+    for (size_t i = 0; i < inputs.size(); i++) {
+      sarnet::udp* in = inputs[i];
+      if (!FD_ISSET(in->link()->fd(), &crfd) && !in->pending())
+        continue;
       sarnet::ip* from = new sarnet::ip();
-      sz = v6in->rx(buf, from);
+      sz = in->rx(buf, from);
       string s = from->straddr();
-      saratoga::scr.debug(7, "main(): v6in Read %d bytes from %s", sz,
-                          s.c_str());
       delete from;
+      if (sz <= 0)
+        continue;
+      saratoga::scr.debug(7, "main(): %s Read %d bytes from %s",
+                          in->print().c_str(), sz, s.c_str());
+      // A station is reached on the port we last heard it on, unless it
+      // was set to one
+      if (in->family() == AF_AX25 && !c_ax25port.routed(s) &&
+          saratoga::ax25route(s) != in->link())
+        saratoga::ax25reroute(s, in->link());
       if (saratoga::readhandler(s, buf, sz) && fdchange())
         goto mainloop;
     }
-    // Handle V6 Input Multicast frames
-    if (FD_ISSET(v6mcastin->fd(), &crfd)) {
-      sarnet::ip* from = new sarnet::ip();
-      sz = v6mcastin->rx(buf, from);
-      string s = from->straddr();
-      saratoga::scr.debug(7, "main(): v6mcastin Read %d bytes from %s", sz,
-                          s.c_str());
-      delete from;
-      if (saratoga::readhandler(s, buf, sz) && fdchange()) //;
-        goto mainloop;
-    }
-
-    // Handle AX25 Input Multicast frames
-    // if (FD_ISSET(v4mcastin->fd(), &crfd))
-    if (sarnet::udp::ax25available && FD_ISSET(ax25multiin->fd(), &crfd)) {
-      sarnet::ip* from = new sarnet::ip();
-      sz = ax25multiout->rx(buf, from);
-      if (sz > 0) {
-        string s = from->straddr();
-        saratoga::scr.debug(7, "main(): ax25castin Read %d bytes from %s", sz,
-                            s.c_str());
-        delete from;
-        if (saratoga::readhandler(s, buf, sz) && fdchange()) {
-          goto mainloop;
-        }
-      }
-    }
 
     // Multicast Outputs
     if (c_multicast.state() == true) {
       // Send AX25 Multicast stuff.
-      if (sarnet::udp::ax25available && FD_ISSET(ax25multiout->fd(), &cwfd)) {
-
-        if ((sz = ax25multiout->send()) > 0)
-          saratoga::scr.debug(7, "main(): ax25multiout Wrote %d bytes", sz);
-        else
-          ax25multiout->ready(false);
+      for (size_t i = 0; i < ax25ports.size(); i++) {
+        sarnet::udp* group = ax25ports[i].group();
+        if (!FD_ISSET(group->fd(), &cwfd))
+          continue;
+        if ((sz = group->send()) > 0)
+          saratoga::scr.debug(7, "main(): %s group Wrote %d bytes",
+                              ax25ports[i].name().c_str(), sz);
+        else if (group->queued() == 0) // Anything left keeps it ready
+          group->ready(false);
       }
 
       // Handle V4 Multicast Output frames
@@ -1017,7 +1204,7 @@ main(int argc, char** argv)
         if ((sz = p->send()) > 0) {
           saratoga::scr.debug(7, "main(): Wrote %d bytes to peer %s", sz,
                               p->straddr().c_str());
-        } else
+        } else if (p->queued() == 0) // Anything left keeps it ready
           p->ready(false);
       }
     }
@@ -1026,6 +1213,10 @@ main(int argc, char** argv)
     if (FD_ISSET(sarlog->fd(), &cwfd))
       sarlog->fflush();
 
+    // Checksums are ready, send them in METADATA
+    if (sarcsumfd >= 0 && FD_ISSET(sarcsumfd, &crfd))
+      sartransfers.csumready();
+
     // Write to and read from currently open files as required
     for (std::list<saratoga::tran>::iterator tr = sartransfers.begin();
          tr != sartransfers.end(); tr++) {
@@ -1034,8 +1225,18 @@ main(int argc, char** argv)
       if (t == nullptr)
         continue;
       saratoga::scr.debug(7, "main(): Looking at %s", f->print().c_str());
-      // If our status timer has expired then send one
-      if (t != nullptr && t->ready() && t->status_expired())
+      // A multicast put is done once it has nothing more to send and
+      // no receiver has asked for anything for a transfer timer
+      if (t->mcastidle() && t->transfer_expired()) {
+        saratoga::scr.msg("Finished multicast transfer %" PRIu32 "",
+                          t->session());
+        sartransfers.remove(t);
+        goto mainloop;
+      }
+      // If our status timer has expired then send one, the receivers
+      // of a multicast put send theirs
+      if (t != nullptr && t->ready() && t->status_due() &&
+          !(t->multicast() && t->dir() == TO_SOCKET))
         t->sendstatus();
       switch (f->rorw()) {
         case sarfile::FILE_WRITE:
@@ -1049,7 +1250,7 @@ main(int argc, char** argv)
         case sarfile::FILE_READ:
           // Read from local file
           if (FD_ISSET(f->fd(), &crfd)) {
-            if ((t == nullptr) || !t->ready()) {
+            if ((t == nullptr) || !t->ready() || t->deltawait()) {
               // We aren;t ready to send data yet
               // We havn't got a status frame
               f->ready(false);
@@ -1057,6 +1258,24 @@ main(int argc, char** argv)
               break;
             } else
               f->ready(true);
+            // Multicasting, symbols of the blocks still owed them
+            if (t->fountain()) {
+              if (!t->sendsymbols(c_maxbuff.get()))
+                f->ready(false);
+              break;
+            }
+            // Multicasting, the holes the receivers asked for go ahead
+            // of the rest of the file
+            if (t->multicast() && t->holelist()->count() > 0) {
+              t->sendholes(c_maxbuff.get());
+              break;
+            }
+            // Sending a delta, only what the other end is missing
+            if (t->delta()) {
+              if (!t->sendholes(c_maxbuff.get()))
+                f->ready(false);
+              break;
+            }
             // Read maximum buffer we can from local file
             if ((sz = f->read(c_maxbuff.get())) > 0) {
               saratoga::tran* t;
@@ -1092,6 +1311,7 @@ closedown:
   }
 
   sartransfers.zap();
+  CSUMPOOL_Stop();
 
   finalise(confname);
   return (saratoga::c_exit.flag());
@@ -137,4 +137,18 @@ maxdescriptor()
   return (F_DESCRIPTOR_64); // 2^64 or more we dont do 2^128 yet
 }
 
+// The smallest descriptor that holds the size of a file, and so every
+// offset into it, but no bigger than the one we are set to use
+enum f_descriptor
+fitdescriptor(offset_t size)
+{
+  enum f_descriptor d = F_DESCRIPTOR_64;
+
+  if (size <= 0xFFFF)
+    d = F_DESCRIPTOR_16;
+  else if (size <= 0xFFFFFFFF)
+    d = F_DESCRIPTOR_32;
+  return ((d < c_descriptor.flag()) ? d : c_descriptor.flag());
+}
+
 }; // Namespace saratoga
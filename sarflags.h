@@ -126,6 +126,8 @@ namespace saratoga {
  * | | | | | | | | | | |X|X|-> Type of Transfer - f_transfer
  * | | | | | | | | | | | | |X|-> Transfer in Progress - f_progress
  * | | | | | | | | | | | | | |X|-> Reliability - f_udptype
+ * | | | | | | | | | | | | | | | | | | | | |X|-> Compression Offered - f_compress
+ * | | | | | | | | | | | | | | | | | | | | | |X|-> Multicast - f_mcast
  * | | | | | | | | | | | | | | | | | | | | | | | | |X|X|X|X|-> Checksum Length -
  f_csumlen
  * | | | | | | | | | | | | | | | | | | | | | | | | | | | | |X|X|X|X|-> Checksum
@@ -147,6 +149,7 @@ namespace saratoga {
  * | | | | | | | | | | | | |X|-> Timestamps - f_reqtstamp
  * | | | | | | | | | | | | | | | |X|-> Request Status - f_reqstatus
  * | | | | | | | | | | | | | | | | |X|-> End of Data - f_eod
+ * | | | | | | | | | | | | | | | | | | | | |X|-> Compressed Payload - f_compress
  * | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | |
  *  0                   1                   2                   3
  *  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
@@ -164,6 +167,7 @@ namespace saratoga {
  * | | | | | | | | | | | | | |X|->Metadata Received - f_metadatarecvd
  * | | | | | | | | | | | | | | |X|-> All Holes - f_allholes
  * | | | | | | | | | | | | | | | |X|-> Holes Requested or Sent - f_reqholes
+ * | | | | | | | | | | | | | | | | | | | | |X|-> Compression Accepted - f_compress
  * | | | | | | | | | | | | | | | | | | | | | | | | |X|X|X|X|X|X|X|X|-> Error
  Code - f_errcode
  * | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | |
@@ -172,6 +176,45 @@ namespace saratoga {
  *
  *******************************************************************
 
+ * SIGNATURE FRAME FLAGS
+ *  0                   1                   2                   3
+ *  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+ * | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | |
+ * |0|0|1|-> Version 1 - f_version
+ * | | | |0|0|1|0|1|-> Signature Frame - f_frametype
+ * | | | | | | | | |X|X|-> Descriptor - f_descriptor
+ * | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | |
+ *  0                   1                   2                   3
+ *  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+ *
+ *******************************************************************
+
+ * REPAIR FRAME FLAGS
+ *  0                   1                   2                   3
+ *  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+ * | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | |
+ * |0|0|1|-> Version 1 - f_version
+ * | | | |0|0|1|1|0|-> Repair Frame - f_frametype
+ * | | | | | | | | |X|X|-> Descriptor - f_descriptor
+ * | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | |
+ *  0                   1                   2                   3
+ *  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+ *
+ *******************************************************************
+
+ * SYMBOL FRAME FLAGS
+ *  0                   1                   2                   3
+ *  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+ * | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | |
+ * |0|0|1|-> Version 1 - f_version
+ * | | | |0|0|1|1|1|-> Symbol Frame - f_frametype
+ * | | | | | | | | |X|X|-> Descriptor - f_descriptor
+ * | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | | |
+ *  0                   1                   2                   3
+ *  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+ *
+ *******************************************************************
+
  *
  * Saratoga Dflag Header Field Format - 16 bit unsigned integer (dflag_t)
  *
@@ -219,7 +262,7 @@ namespace saratoga {
 
 // How many bits to shift across to get the flag
 template <typename T>
-inline T
+constexpr inline T
 SHIFT(const T& bits, const T& msb)
 {
   return (32 - bits - msb);
@@ -227,12 +270,87 @@ SHIFT(const T& bits, const T& msb)
 
 // How many bits long is the flag
 template <typename T>
-inline T
+constexpr inline T
 MASK(const T& bits)
 {
   return ((1 << bits) - 1);
 }
 
+/*
+ * Compile time description of a field in the 32 bit header flags.
+ * BITS is how wide it is and MSB the first bit as numbered in the
+ * diagrams above. Everything here folds down to a shift and a mask.
+ */
+template <flag_t BITS, flag_t MSB>
+struct fbits
+{
+  static_assert(BITS > 0 && BITS + MSB <= 32, "fbits: Field outside flag_t");
+
+  static constexpr flag_t bits = BITS;
+  static constexpr flag_t msb = MSB;
+  static constexpr flag_t shift = 32 - BITS - MSB;
+  static constexpr flag_t mask = ((flag_t)1 << BITS) - 1;
+  static constexpr flag_t set = mask << shift;
+
+  // Value of the field in flags f
+  static constexpr flag_t get(flag_t f) { return ((f >> shift) & mask); };
+  // Field value v in its position in the flags
+  static constexpr flag_t val(flag_t v) { return ((v & mask) << shift); };
+  // Flags f with the field replaced by v
+  static constexpr flag_t put(flag_t f, flag_t v)
+  {
+    return ((f & ~set) | val(v));
+  };
+};
+
+// Every header field, these are what the Fxxxx classes below use
+namespace hdr {
+typedef fbits<3, 0> version;
+typedef fbits<5, 3> frametype;
+typedef fbits<2, 8> descriptor;
+typedef fbits<1, 11> stream;
+typedef fbits<2, 10> transfer;
+typedef fbits<1, 12> reqtstamp;
+typedef fbits<1, 12> progress;
+typedef fbits<2, 12> txwilling;
+typedef fbits<1, 13> metadata_udptype;
+typedef fbits<1, 13> metadatarecvd;
+typedef fbits<1, 14> allholes;
+typedef fbits<8, 24> requesttype;
+typedef fbits<2, 14> rxwilling;
+typedef fbits<1, 15> reqholes;
+typedef fbits<1, 15> fileordir;
+typedef fbits<1, 15> reqstatus;
+typedef fbits<1, 16> udptype;
+typedef fbits<1, 16> eod;
+typedef fbits<1, 17> freespace;
+typedef fbits<2, 18> freespaced;
+typedef fbits<1, 20> compress;
+typedef fbits<1, 21> mcast;
+typedef fbits<4, 24> csumlen;
+typedef fbits<4, 28> csumtype;
+typedef fbits<8, 24> errcode;
+
+// Do the fields F... that make up a frame header overlap
+template <typename... F>
+struct fields;
+
+template <>
+struct fields<>
+{
+  static constexpr flag_t set = 0;
+  static constexpr bool disjoint = true;
+};
+
+template <typename H, typename... T>
+struct fields<H, T...>
+{
+  static constexpr flag_t set = H::set | fields<T...>::set;
+  static constexpr bool disjoint =
+    ((H::set & fields<T...>::set) == 0) && fields<T...>::disjoint;
+};
+}; // namespace hdr
+
 // Getting & Setting Flag bits
 class Sflag
 {
@@ -270,8 +388,8 @@ enum f_version
 class Fversion : private Sflag
 {
 protected:
-  static const flag_t bits = 3;
-  static const flag_t msb = 0;
+  static const flag_t bits = hdr::version::bits;
+  static const flag_t msb = hdr::version::msb;
   enum f_version version;
 
 public:
@@ -325,7 +443,7 @@ public:
 
 /*
  * Saratoga Frame Type - Bits 3-7
- *  BEACON,REQUEST,METADATA,DATA,STATUS
+ *  BEACON,REQUEST,METADATA,DATA,STATUS,SIGNATURE
  */
 enum f_frametype
 {
@@ -333,14 +451,17 @@ enum f_frametype
   F_FRAMETYPE_REQUEST = 0x01,
   F_FRAMETYPE_METADATA = 0x02,
   F_FRAMETYPE_DATA = 0x03,
-  F_FRAMETYPE_STATUS = 0x04
+  F_FRAMETYPE_STATUS = 0x04,
+  F_FRAMETYPE_SIGNATURE = 0x05,
+  F_FRAMETYPE_REPAIR = 0x06,
+  F_FRAMETYPE_SYMBOL = 0x07
 };
 
 class Fframetype : private Sflag
 {
 protected:
-  static const flag_t bits = 5;
-  static const flag_t msb = 3;
+  static const flag_t bits = hdr::frametype::bits;
+  static const flag_t msb = hdr::frametype::msb;
   enum f_frametype frametype;
 
 public:
@@ -401,11 +522,16 @@ enum f_descriptor
   F_DESCRIPTOR_128 = 0x03
 };
 
+// Descriptor for the largest file the OS allows, and the smallest for
+// a file of a given size (sarflags.cpp)
+extern enum f_descriptor maxdescriptor();
+extern enum f_descriptor fitdescriptor(offset_t);
+
 class Fdescriptor : private Sflag
 {
 protected:
-  static const flag_t bits = 2;
-  static const flag_t msb = 8;
+  static const flag_t bits = hdr::descriptor::bits;
+  static const flag_t msb = hdr::descriptor::msb;
   enum f_descriptor descriptor;
 
 public:
@@ -470,8 +596,8 @@ enum f_stream
 class Fstream : private Sflag
 {
 protected:
-  static const flag_t bits = 1;
-  static const flag_t msb = 11;
+  static const flag_t bits = hdr::stream::bits;
+  static const flag_t msb = hdr::stream::msb;
   enum f_stream stream;
 
 public:
@@ -535,8 +661,8 @@ enum f_transfer
 class Ftransfer : private Sflag
 {
 protected:
-  static const flag_t bits = 2;
-  static const flag_t msb = 10;
+  static const flag_t bits = hdr::transfer::bits;
+  static const flag_t msb = hdr::transfer::msb;
   enum f_transfer transfer;
 
 public:
@@ -598,8 +724,8 @@ enum f_reqtstamp
 class Freqtstamp : private Sflag
 {
 protected:
-  static const flag_t bits = 1;
-  static const flag_t msb = 12;
+  static const flag_t bits = hdr::reqtstamp::bits;
+  static const flag_t msb = hdr::reqtstamp::msb;
   enum f_reqtstamp reqtstamp;
 
 public:
@@ -661,8 +787,8 @@ enum f_progress
 class Fprogress : private Sflag
 {
 protected:
-  static const flag_t bits = 1;
-  static const flag_t msb = 12;
+  static const flag_t bits = hdr::progress::bits;
+  static const flag_t msb = hdr::progress::msb;
   enum f_progress progress;
 
 public:
@@ -726,8 +852,8 @@ enum f_txwilling
 class Ftxwilling : private Sflag
 {
 protected:
-  static const flag_t bits = 2;
-  static const flag_t msb = 12;
+  static const flag_t bits = hdr::txwilling::bits;
+  static const flag_t msb = hdr::txwilling::msb;
   enum f_txwilling txwilling;
 
 public:
@@ -792,8 +918,8 @@ enum f_udptype
 class Fmetadata_udptype : private Sflag
 {
 protected:
-  static const flag_t bits = 1;
-  static const flag_t msb = 13;
+  static const flag_t bits = hdr::metadata_udptype::bits;
+  static const flag_t msb = hdr::metadata_udptype::msb;
   enum f_udptype metadata_udptype;
 
 public:
@@ -855,8 +981,8 @@ enum f_metadatarecvd
 class Fmetadatarecvd : private Sflag
 {
 protected:
-  static const flag_t bits = 1;
-  static const flag_t msb = 13;
+  static const flag_t bits = hdr::metadatarecvd::bits;
+  static const flag_t msb = hdr::metadatarecvd::msb;
   enum f_metadatarecvd metadatarecvd;
 
 public:
@@ -921,8 +1047,8 @@ enum f_allholes
 class Fallholes : private Sflag
 {
 protected:
-  static const flag_t bits = 1;
-  static const flag_t msb = 14;
+  static const flag_t bits = hdr::allholes::bits;
+  static const flag_t msb = hdr::allholes::msb;
   enum f_allholes allholes;
 
 public:
@@ -989,8 +1115,8 @@ enum f_requesttype
 class Frequesttype : private Sflag
 {
 protected:
-  static const flag_t bits = 8;
-  static const flag_t msb = 24;
+  static const flag_t bits = hdr::requesttype::bits;
+  static const flag_t msb = hdr::requesttype::msb;
   enum f_requesttype requesttype;
 
 public:
@@ -1054,8 +1180,8 @@ enum f_rxwilling
 class Frxwilling : private Sflag
 {
 protected:
-  static const flag_t bits = 2;
-  static const flag_t msb = 14;
+  static const flag_t bits = hdr::rxwilling::bits;
+  static const flag_t msb = hdr::rxwilling::msb;
   enum f_rxwilling rxwilling;
 
 public:
@@ -1117,8 +1243,8 @@ enum f_reqholes
 class Freqholes : private Sflag
 {
 protected:
-  static const flag_t bits = 1;
-  static const flag_t msb = 15;
+  static const flag_t bits = hdr::reqholes::bits;
+  static const flag_t msb = hdr::reqholes::msb;
   enum f_reqholes reqholes;
 
 public:
@@ -1180,8 +1306,8 @@ enum f_fileordir
 class Ffileordir : private Sflag
 {
 protected:
-  static const flag_t bits = 1;
-  static const flag_t msb = 15;
+  static const flag_t bits = hdr::fileordir::bits;
+  static const flag_t msb = hdr::fileordir::msb;
   enum f_fileordir fileordir;
 
 public:
@@ -1243,8 +1369,8 @@ enum f_reqstatus
 class Freqstatus : private Sflag
 {
 protected:
-  static const flag_t bits = 1;
-  static const flag_t msb = 15;
+  static const flag_t bits = hdr::reqstatus::bits;
+  static const flag_t msb = hdr::reqstatus::msb;
   enum f_reqstatus reqstatus;
 
 public:
@@ -1307,8 +1433,8 @@ public:
 class Fudptype : private Sflag
 {
 protected:
-  static const flag_t bits = 1;
-  static const flag_t msb = 16;
+  static const flag_t bits = hdr::udptype::bits;
+  static const flag_t msb = hdr::udptype::msb;
   enum f_udptype udptype;
 
 public:
@@ -1365,8 +1491,8 @@ enum f_eod
 class Feod : private Sflag
 {
 protected:
-  static const flag_t bits = 1;
-  static const flag_t msb = 16;
+  static const flag_t bits = hdr::eod::bits;
+  static const flag_t msb = hdr::eod::msb;
   enum f_eod eod;
 
 public:
@@ -1428,8 +1554,8 @@ enum f_freespace
 class Ffreespace : private Sflag
 {
 protected:
-  static const flag_t bits = 1;
-  static const flag_t msb = 17;
+  static const flag_t bits = hdr::freespace::bits;
+  static const flag_t msb = hdr::freespace::msb;
   enum f_freespace freespace;
 
 public:
@@ -1493,8 +1619,8 @@ enum f_freespaced
 class Ffreespaced : private Sflag
 {
 protected:
-  static const flag_t bits = 2;
-  static const flag_t msb = 18;
+  static const flag_t bits = hdr::freespaced::bits;
+  static const flag_t msb = hdr::freespaced::msb;
   enum f_freespaced freespaced;
 
 public:
@@ -1544,6 +1670,135 @@ public:
   string print();
 };
 
+/*
+ * Compressed Payload - Bit 20
+ *  METADATA - the sender offers to compress the DATA
+ *  STATUS - the receiver takes up the offer
+ *  DATA - this payload is a compressed block
+ */
+enum f_compress
+{
+  F_COMPRESS_NO = 0x00,
+  F_COMPRESS_YES = 0x01
+};
+
+class Fcompress : private Sflag
+{
+protected:
+  static const flag_t bits = hdr::compress::bits;
+  static const flag_t msb = hdr::compress::msb;
+  enum f_compress compress;
+
+public:
+  // Constructor set the compress.
+  Fcompress()
+    : Sflag(SHIFT(bits, msb), MASK(bits))
+  {
+    compress = F_COMPRESS_NO;
+  };
+  Fcompress(enum f_compress f)
+    : Sflag(SHIFT(bits, msb), MASK(bits))
+  {
+    compress = f;
+  };
+  Fcompress(flag_t f)
+    : Sflag(SHIFT(bits, msb), MASK(bits))
+  {
+    compress = (enum f_compress)(fget(f));
+  };
+
+  Fcompress& operator=(f_compress f)
+  {
+    compress = f;
+    return (*this);
+  };
+  Fcompress& operator=(flag_t f)
+  {
+    compress = (enum f_compress)fget(f);
+    return (*this);
+  };
+
+  // What is the compress
+  enum f_compress get() { return (compress); };
+  enum f_compress get(flag_t f) { return ((enum f_compress)fget(f)); };
+
+  flag_t setflag(flag_t f)
+  {
+    f = fset(f, compress);
+    return f;
+  };
+
+  flag_t shift() { return (SHIFT(bits, msb)); };
+  flag_t mask() { return (MASK(bits)); };
+
+  // Print out the current compress
+  string print();
+};
+
+/*
+ * Multicast - Bit 21
+ *  METADATA - the sender is multicasting to a group, a receiver holds
+ *  back its STATUS and sends it only for what it has lost
+ */
+enum f_mcast
+{
+  F_MCAST_NO = 0x00,
+  F_MCAST_YES = 0x01
+};
+
+class Fmcast : private Sflag
+{
+protected:
+  static const flag_t bits = hdr::mcast::bits;
+  static const flag_t msb = hdr::mcast::msb;
+  enum f_mcast mcast;
+
+public:
+  // Constructor set the mcast.
+  Fmcast()
+    : Sflag(SHIFT(bits, msb), MASK(bits))
+  {
+    mcast = F_MCAST_NO;
+  };
+  Fmcast(enum f_mcast f)
+    : Sflag(SHIFT(bits, msb), MASK(bits))
+  {
+    mcast = f;
+  };
+  Fmcast(flag_t f)
+    : Sflag(SHIFT(bits, msb), MASK(bits))
+  {
+    mcast = (enum f_mcast)(fget(f));
+  };
+
+  Fmcast& operator=(f_mcast f)
+  {
+    mcast = f;
+    return (*this);
+  };
+  Fmcast& operator=(flag_t f)
+  {
+    mcast = (enum f_mcast)fget(f);
+    return (*this);
+  };
+
+  // What is the mcast
+  enum f_mcast get() { return (mcast); };
+  enum f_mcast get(flag_t f) { return ((enum f_mcast)fget(f)); };
+
+  flag_t setflag(flag_t f)
+  {
+    f = fset(f, mcast);
+    return f;
+  };
+
+  flag_t shift() { return (SHIFT(bits, msb)); };
+  flag_t mask() { return (MASK(bits)); };
+
+  // Print out the current mcast
+  string print();
+};
+
 /*
  * Checksum Length - Bits 24-27
  * METADATA
@@ -1559,8 +1814,8 @@ enum f_csumlen
 class Fcsumlen : private Sflag
 {
 protected:
-  static const flag_t bits = 4;
-  static const flag_t msb = 24;
+  static const flag_t bits = hdr::csumlen::bits;
+  static const flag_t msb = hdr::csumlen::msb;
   enum f_csumlen csumlen;
 
 public:
@@ -1625,8 +1880,8 @@ enum f_csumtype
 class Fcsumtype : private Sflag
 {
 protected:
-  static const flag_t bits = 4;
-  static const flag_t msb = 28;
+  static const flag_t bits = hdr::csumtype::bits;
+  static const flag_t msb = hdr::csumtype::msb;
   enum f_csumtype csumtype;
 
 public:
@@ -1703,8 +1958,8 @@ enum f_errcode
 class Ferrcode : private Sflag
 {
 protected:
-  static const flag_t bits = 8;
-  static const flag_t msb = 24;
+  static const flag_t bits = hdr::errcode::bits;
+  static const flag_t msb = hdr::errcode::msb;
   enum f_errcode errcode;
 
 public:
@@ -1882,6 +2137,16 @@ public:
     flag = f.setflag(flag);
     return (*this);
   };
+  Fflag operator+=(Fcompress f)
+  {
+    flag = f.setflag(flag);
+    return (*this);
+  };
+  Fflag operator+=(Fmcast f)
+  {
+    flag = f.setflag(flag);
+    return (*this);
+  };
   Fflag operator+=(Fcsumlen f)
   {
     flag = f.setflag(flag);
@@ -1901,6 +2166,100 @@ public:
   string print();
 };
 
+/*
+ * Header flags for each frame type assembled at compile time from the
+ * hdr:: field descriptions. These replace a chain of Fflag += Fxxxx.
+ */
+namespace hdr {
+
+constexpr flag_t
+dataflags(enum f_descriptor d, enum f_transfer t, enum f_reqtstamp ts,
+          enum f_reqstatus rs, enum f_eod e)
+{
+  return (version::val(F_VERSION_1) | frametype::val(F_FRAMETYPE_DATA) |
+          descriptor::val(d) | transfer::val(t) | reqtstamp::val(ts) |
+          reqstatus::val(rs) | eod::val(e));
+}
+
+constexpr flag_t
+statusflags(enum f_descriptor d, enum f_reqtstamp ts,
+            enum f_metadatarecvd mr, enum f_allholes ah, enum f_reqholes rh,
+            enum f_errcode ec)
+{
+  return (version::val(F_VERSION_1) | frametype::val(F_FRAMETYPE_STATUS) |
+          descriptor::val(d) | reqtstamp::val(ts) | metadatarecvd::val(mr) |
+          allholes::val(ah) | reqholes::val(rh) | errcode::val(ec));
+}
+
+constexpr flag_t
+metadataflags(enum f_descriptor d, enum f_transfer t, enum f_progress p,
+              enum f_udptype u, enum f_csumlen cl, enum f_csumtype ct)
+{
+  return (version::val(F_VERSION_1) | frametype::val(F_FRAMETYPE_METADATA) |
+          descriptor::val(d) | transfer::val(t) | progress::val(p) |
+          metadata_udptype::val(u) | csumlen::val(cl) | csumtype::val(ct));
+}
+
+constexpr flag_t
+signatureflags(enum f_descriptor d)
+{
+  return (version::val(F_VERSION_1) | frametype::val(F_FRAMETYPE_SIGNATURE) |
+          descriptor::val(d));
+}
+
+constexpr flag_t
+repairflags(enum f_descriptor d)
+{
+  return (version::val(F_VERSION_1) | frametype::val(F_FRAMETYPE_REPAIR) |
+          descriptor::val(d));
+}
+
+constexpr flag_t
+symbolflags(enum f_descriptor d)
+{
+  return (version::val(F_VERSION_1) | frametype::val(F_FRAMETYPE_SYMBOL) |
+          descriptor::val(d));
+}
+
+// Fields of each frame header must not overlap
+static_assert(fields<version, frametype, descriptor, stream, txwilling,
+                     rxwilling, udptype, freespace, freespaced>::disjoint,
+              "BEACON header fields overlap");
+static_assert(
+  fields<version, frametype, descriptor, stream, udptype, requesttype>::disjoint,
+  "REQUEST header fields overlap");
+static_assert(fields<version, frametype, descriptor, transfer, progress,
+                     metadata_udptype, compress, mcast, csumlen,
+                     csumtype>::disjoint,
+              "METADATA header fields overlap");
+static_assert(fields<version, frametype, descriptor, transfer, reqtstamp,
+                     reqstatus, eod, compress>::disjoint,
+              "DATA header fields overlap");
+static_assert(fields<version, frametype, descriptor, reqtstamp, metadatarecvd,
+                     allholes, reqholes, compress, errcode>::disjoint,
+              "STATUS header fields overlap");
+
+// And they must sit where the diagrams at the top of this file say
+static_assert(version::val(F_VERSION_1) == 0x20000000, "Version is bits 0-2");
+static_assert(frametype::set == 0x1F000000, "Frame type is bits 3-7");
+static_assert(descriptor::set == 0x00C00000, "Descriptor is bits 8-9");
+static_assert(transfer::set == 0x00300000, "Transfer is bits 10-11");
+static_assert(stream::set == 0x00100000, "Stream is bit 11");
+static_assert(reqtstamp::set == 0x00080000, "Timestamp is bit 12");
+static_assert(metadatarecvd::set == 0x00040000, "Metadata recvd is bit 13");
+static_assert(allholes::set == 0x00020000, "All holes is bit 14");
+static_assert(reqstatus::set == 0x00010000, "Request status is bit 15");
+static_assert(eod::set == 0x00008000, "End of data is bit 16");
+static_assert(compress::set == 0x00000800, "Compress is bit 20");
+static_assert(mcast::set == 0x00000400, "Multicast is bit 21");
+static_assert(csumlen::set == 0x000000F0, "Checksum length is bits 24-27");
+static_assert(csumtype::set == 0x0000000F, "Checksum type is bits 28-31");
+static_assert(errcode::set == 0x000000FF, "Error code is bits 24-31");
+static_assert(dataflags(F_DESCRIPTOR_64, F_TRANSFER_FILE, F_TIMESTAMP_NO,
+                        F_REQSTATUS_YES, F_EOD_YES) == 0x23818000,
+              "DATA flags do not match the header diagram");
+}; // namespace hdr
+
 }; // Namespace saratoga
 
 #endif // _SARFLAGS_H
@@ -0,0 +1,277 @@
+/*
+
+ Copyright (c) 2012, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "dcodec.h"
+#include "delta.h"
+#include "frame.h"
+#include "globals.h"
+#include "saratoga.h"
+#include "sarflags.h"
+#include "screen.h"
+#include "signature.h"
+
+using namespace std;
+
+namespace saratoga {
+
+// Flags, session, file size, block size, # blocks and first block
+static size_t
+sighdrlen(const dcodecs* dc)
+{
+  return sizeof(flag_t) + sizeof(session_t) + dc->length + 3 * sizeof(uint32_t);
+}
+
+// Create a signature frame from scratch
+signature::signature(const enum f_descriptor des, const session_t session,
+                     const blocksigs& sigs, const uint32_t first,
+                     const uint32_t count)
+{
+  uint32_t tmp_32;
+  uint64_t tmp_64;
+
+  _badframe = false;
+
+  const dcodecs* dc = dcodecs::lookup(des);
+  if (dc == nullptr) {
+    scr.error("signature(): Descriptor 128 Bit Size Not Supported\n");
+    _badframe = true;
+    _payload = nullptr;
+    _paylen = 0;
+    return;
+  }
+  if (first >= sigs.nblocks() || count > sigs.nblocks() - first) {
+    scr.error("signature(): Blocks %" PRIu32 " to %" PRIu32
+              " out of range",
+              first, first + count);
+    _badframe = true;
+    _payload = nullptr;
+    _paylen = 0;
+    return;
+  }
+
+  // Work out how big our frame has to be and allocate it
+  size_t fsize = sighdrlen(dc) + count * entrylen;
+
+  _payload = new char[fsize];
+  _paylen = fsize;
+  char* sbufp = _payload;
+
+  // Set and copy flags
+  _flags = hdr::signatureflags(des);
+
+  tmp_32 = htonl(_flags.get());
+  memcpy(sbufp, &tmp_32, sizeof(flag_t));
+  sbufp += sizeof(flag_t);
+
+  // Set and copy session
+  _session = session;
+  tmp_32 = htonl(session);
+  memcpy(sbufp, &tmp_32, sizeof(session_t));
+  sbufp += sizeof(session_t);
+
+  _filesize = sigs.filesize();
+  sbufp = dc->put(sbufp, _filesize);
+
+  _blocksize = sigs.blocksize();
+  _nblocks = sigs.nblocks();
+  _first = first;
+  uint32_t hdr[3] = { _blocksize, _nblocks, _first };
+  for (int i = 0; i < 3; i++) {
+    tmp_32 = htonl(hdr[i]);
+    memcpy(sbufp, &tmp_32, sizeof(uint32_t));
+    sbufp += sizeof(uint32_t);
+  }
+
+  for (uint32_t i = first; i < first + count; i++) {
+    _weak.push_back(sigs.weak(i));
+    _strong.push_back(sigs.strong(i));
+    tmp_32 = htonl(sigs.weak(i));
+    memcpy(sbufp, &tmp_32, sizeof(uint32_t));
+    sbufp += sizeof(uint32_t);
+    tmp_64 = netorder(sigs.strong(i));
+    memcpy(sbufp, &tmp_64, sizeof(uint64_t));
+    sbufp += sizeof(uint64_t);
+  }
+}
+
+/*
+ * Given a buffer and length, assemble the signature
+ */
+signature::signature(char* payload, const size_t pl)
+{
+  size_t paylen = pl;
+  uint32_t tmp_32;
+  uint64_t tmp_64;
+
+  // Copy the frame info
+  _badframe = false;
+  _paylen = paylen;
+  _payload = new char[_paylen];
+  memcpy(_payload, payload, paylen);
+
+  _session = 0;
+  _filesize = 0;
+  _blocksize = 0;
+  _nblocks = 0;
+  _first = 0;
+
+  if (paylen < sizeof(flag_t) + sizeof(session_t)) {
+    scr.error("signature(frame): Frame too short");
+    _badframe = true;
+    return;
+  }
+
+  // Assemble the flags info
+  _flags = (flag_t)ntohl(*(uint32_t*)payload);
+  payload += sizeof(flag_t);
+  paylen -= sizeof(flag_t);
+
+  Fversion version = _flags.get();
+  Fframetype frametype = _flags.get();
+  Fdescriptor descriptor = _flags.get();
+
+  if (version.get() != F_VERSION_1) {
+    scr.error("Signature: Bad Saratoga Version");
+    _badframe = true;
+    return;
+  }
+  if (frametype.get() != F_FRAMETYPE_SIGNATURE) {
+    scr.error("Signature: Not a SIGNATURE frame");
+    _badframe = true;
+    return;
+  }
+  const dcodecs* dc = dcodecs::lookup(descriptor.get());
+  if (dc == nullptr) {
+    scr.error("signature(frame): Descriptor 128 Bit Size Not Supported\n");
+    _badframe = true;
+    return;
+  }
+  if (pl < sighdrlen(dc)) {
+    scr.error("signature(frame): Frame too short");
+    _badframe = true;
+    return;
+  }
+
+  // Session ID
+  _session = (session_t)ntohl(*(uint32_t*)payload);
+  payload += sizeof(session_t);
+  paylen -= sizeof(session_t);
+
+  _filesize = dc->get(payload);
+  payload += dc->length;
+  paylen -= dc->length;
+
+  uint32_t hdr[3];
+  for (int i = 0; i < 3; i++) {
+    memcpy(&tmp_32, payload, sizeof(uint32_t));
+    hdr[i] = ntohl(tmp_32);
+    payload += sizeof(uint32_t);
+    paylen -= sizeof(uint32_t);
+  }
+  _blocksize = hdr[0];
+  _nblocks = hdr[1];
+  _first = hdr[2];
+
+  // Anything left are the signatures
+  if (paylen % entrylen != 0 || _first > _nblocks ||
+      paylen / entrylen > _nblocks - _first) {
+    scr.error("signature(frame): Bad signature list");
+    _badframe = true;
+    return;
+  }
+  while (paylen >= entrylen) {
+    memcpy(&tmp_32, payload, sizeof(uint32_t));
+    memcpy(&tmp_64, payload + sizeof(uint32_t), sizeof(uint64_t));
+    _weak.push_back(ntohl(tmp_32));
+    _strong.push_back(netorder(tmp_64));
+    payload += entrylen;
+    paylen -= entrylen;
+  }
+}
+
+enum f_descriptor
+signature::descriptor()
+{
+  Fdescriptor t = _flags.get();
+  return t.get();
+}
+
+/*
+ * Print out the signature flags & block range
+ */
+string
+signature::print()
+{
+  char tmp[128];
+  string s;
+
+  if (_badframe) {
+    s = "signature::print(): Bad SIGNATURE Frame";
+    scr.error(s);
+    return (s);
+  }
+  Fversion version = _flags.get();
+  Fframetype frametype = _flags.get();
+  Fdescriptor descriptor = _flags.get();
+
+  s = frametype.print();
+  s += printflags("SIGNATURE FLAGS", this->flags());
+  s += "    ";
+  s += version.print();
+  s += "\n    ";
+  s += descriptor.print();
+  s += "\n    ";
+  sprintf(tmp, "Session: %" PRIu32 "", (uint32_t)_session);
+  s += tmp;
+  s += "\n    ";
+  sprintf(tmp, "File Size: %" PRIu64 " Block Size: %" PRIu32
+               " Blocks: %" PRIu32 "",
+          (uint64_t)_filesize, _blocksize, _nblocks);
+  s += tmp;
+  s += "\n    ";
+  sprintf(tmp, "Signatures for blocks %" PRIu32 " to %" PRIu32 "", _first,
+          _first + this->count());
+  s += tmp;
+  return (s);
+}
+
+}; // Namespace saratoga
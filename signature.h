@@ -0,0 +1,199 @@
+/*
+
+ Copyright (c) 2011, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#ifndef _SIGNATURE_H
+#define _SIGNATURE_H
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "delta.h"
+#include "frame.h"
+#include "ip.h"
+#include "saratoga.h"
+#include "sarflags.h"
+#include "screen.h"
+
+using namespace std;
+
+namespace saratoga {
+/*
+ **********************************************************************
+ * SIGNATURE
+ **********************************************************************
+ */
+
+/*
+ * Block signatures of the file being sent so a receiver holding an
+ * older copy can build the new one from it, see delta.h. After the
+ * flags and session come the file size (descriptor sized), the block
+ * size, the number of blocks and the index of the first block in this
+ * frame, then a 4 byte weak and 8 byte strong checksum per block
+ */
+class signature : public frame
+{
+private:
+  Fflag _flags;                  // signature's Flags
+  session_t _session;            // The session ID
+  offset_t _filesize;            // Size of the file signed
+  uint32_t _blocksize;           // Bytes in each block
+  uint32_t _nblocks;             // Blocks in the file
+  uint32_t _first;               // Index of the first block in the frame
+  std::vector<uint32_t> _weak;   // Rolling checksum of each block
+  std::vector<uint64_t> _strong; // and its MD5
+protected:
+  bool _badframe; // Are we a good or bad signature frame
+  char* _payload; // Complete payload of frame
+  size_t _paylen; // Length of payload
+public:
+  // Size of a signature entry
+  static const size_t entrylen = 4 + 8;
+
+  // How many signatures fit in a frame, no more than a full DATA frame
+  // as the file size and block fields are no bigger than DATA's offset
+  // and timestamp
+  static const uint32_t maxentries = MAXDATA / entrylen;
+
+  // This is how we assemble a local signature frame for up to count
+  // blocks from first
+  signature(const enum f_descriptor, // Flags
+            const session_t,         // Session
+            const blocksigs&,        // The signatures
+            const uint32_t,          // First block
+            const uint32_t);         // Number of blocks
+
+  // We have received a remote frame that is SIGNATURE
+  signature(char*,         // Pointer to buffer received
+            const size_t); // Total length of buffer
+
+  ~signature() { this->clear(); };
+
+  void clear()
+  {
+    if (_paylen > 0)
+      delete[] _payload;
+    _paylen = 0;
+    _flags = 0;
+    _session = 0;
+    _filesize = 0;
+    _blocksize = 0;
+    _nblocks = 0;
+    _first = 0;
+    _weak.clear();
+    _strong.clear();
+  };
+
+  // Copy Constructor
+  signature(const signature& old)
+  {
+    if (old._paylen > 0) {
+      _payload = new char[old._paylen];
+      memcpy(_payload, old._payload, old._paylen);
+    } else
+      _payload = nullptr;
+    _paylen = old._paylen;
+    _flags = old._flags;
+    _session = old._session;
+    _filesize = old._filesize;
+    _blocksize = old._blocksize;
+    _nblocks = old._nblocks;
+    _first = old._first;
+    _weak = old._weak;
+    _strong = old._strong;
+    _badframe = old._badframe;
+  }
+
+  signature& operator=(const signature& old)
+  {
+    if (old._paylen > 0) {
+      _payload = new char[old._paylen];
+      memcpy(_payload, old._payload, old._paylen);
+    } else
+      _payload = nullptr;
+    _paylen = old._paylen;
+    _flags = old._flags;
+    _session = old._session;
+    _filesize = old._filesize;
+    _blocksize = old._blocksize;
+    _nblocks = old._nblocks;
+    _first = old._first;
+    _weak = old._weak;
+    _strong = old._strong;
+    _badframe = old._badframe;
+    return (*this);
+  };
+
+  bool badframe() { return _badframe; };
+  size_t paylen() { return _paylen; };
+  char* payload() { return _payload; };
+
+  enum f_descriptor descriptor();
+
+  session_t session() { return _session; };
+  offset_t filesize() { return _filesize; };
+  uint32_t blocksize() { return _blocksize; };
+  uint32_t nblocks() { return _nblocks; };
+  uint32_t first() { return _first; };
+  uint32_t count() { return (uint32_t)_weak.size(); };
+  uint32_t weak(uint32_t i) { return _weak[i]; };
+  uint64_t strong(uint32_t i) { return _strong[i]; };
+
+  // The signature frames flags
+  flag_t flags() { return _flags.get(); };
+
+  // Yes I am a signature frame
+  f_frametype type() { return F_FRAMETYPE_SIGNATURE; };
+
+  ssize_t tx(sarnet::udp* sock) { return (sock->tx(_payload, _paylen)); };
+
+  ssize_t rx()
+  {
+    string s = "SIGNATURE RX: ";
+    s += this->print();
+    cout << s << endl;
+    return (-1);
+  };
+
+  string print();
+};
+
+} // Namespace saratoga
+
+#endif // _SIGNATURE_H
@@ -40,6 +40,7 @@
 #include <iostream>
 #include <string>
 
+#include "dcodec.h"
 #include "frame.h"
 #include "globals.h"
 #include "holes.h"
@@ -61,12 +62,7 @@ status::status(const enum f_descriptor des, const enum f_metadatarecvd md,
                const offset_t progress, const offset_t inresponseto,
                saratoga::holes* h)
 {
-  uint16_t tmp_16;
   uint32_t tmp_32;
-  uint64_t tmp_64;
-#ifdef UINT128_T
-  uint128_t tmp_128;
-#endif
 
   _badframe = false;
 
@@ -74,34 +70,26 @@ status::status(const enum f_descriptor des, const enum f_metadatarecvd md,
   if (h != nullptr)
     holecount = h->count();
 
-  Fversion version = F_VERSION_1;
-  Fframetype frametype = F_FRAMETYPE_STATUS;
-  Fdescriptor descriptor = des;
-  Freqtstamp reqtstamp = F_TIMESTAMP_NO;
-  Fmetadatarecvd metadatarecvd = md;
-  Fallholes allholes = ah;
-  Freqholes freqholes = ho;
-  Ferrcode errcode = st;
+  const dcodecs* dc = dcodecs::lookup(des);
+  if (dc == nullptr) {
+    scr.error("status(): Descriptor 128 Bit Size Not Supported\n");
+    _badframe = true;
+    _payload = nullptr;
+    _paylen = 0;
+    return;
+  }
 
   // Work out how big our frame has to be and allocate it
   size_t fsize = sizeof(flag_t) + sizeof(session_t);
-  fsize += descriptor.length(); // Offset
-
-  fsize += (descriptor.length() * 2);             // progress, inresponseto
-  fsize += (descriptor.length() * 2 * holecount); // and the holes if any
+  fsize += (dc->length * 2);             // progress, inresponseto
+  fsize += (dc->length * 2 * holecount); // and the holes if any
 
   _payload = new char[fsize];
   _paylen = fsize;
   char* sbufp = _payload;
 
   // Set and copy flags
-  _flags += version;
-  _flags += frametype;
-  _flags += descriptor;
-  _flags += reqtstamp;
-  _flags += metadatarecvd;
-  _flags += allholes;
-  _flags += errcode;
+  _flags = hdr::statusflags(des, F_TIMESTAMP_NO, md, ah, ho, st);
 
   tmp_32 = htonl(_flags.get());
   memcpy(sbufp, &tmp_32, sizeof(flag_t));
@@ -118,99 +106,13 @@ status::status(const enum f_descriptor des, const enum f_metadatarecvd md,
 
   _progress = progress;
   _inresponseto = inresponseto;
-  switch (descriptor.get()) {
-    case F_DESCRIPTOR_16:
-      tmp_16 = htons((uint16_t)_progress);
-      memcpy(sbufp, &tmp_16, sizeof(uint16_t));
-      sbufp += sizeof(uint16_t);
-      tmp_16 = htons((uint16_t)_inresponseto);
-      memcpy(sbufp, &tmp_16, sizeof(uint16_t));
-      sbufp += sizeof(uint16_t);
-      break;
-    case F_DESCRIPTOR_32:
-      tmp_32 = htonl((uint32_t)_progress);
-      memcpy(sbufp, &tmp_32, sizeof(uint32_t));
-      sbufp += sizeof(uint32_t);
-      tmp_32 = htonl((uint32_t)_inresponseto);
-      memcpy(sbufp, &tmp_32, sizeof(uint32_t));
-      sbufp += sizeof(uint32_t);
-      break;
-    case F_DESCRIPTOR_64:
-      tmp_64 = htonll(_progress);
-      memcpy(sbufp, &tmp_64, sizeof(uint64_t));
-      sbufp += sizeof(uint64_t);
-      tmp_64 = htonll(_inresponseto);
-      memcpy(sbufp, &tmp_64, sizeof(uint64_t));
-      sbufp += sizeof(uint64_t);
-      break;
-    case F_DESCRIPTOR_128:
-#ifdef UINT128_T
-      tmp_128 = htonlll(_progress);
-      memcpy(sbufp, &tmp_128, sizeof(uint128_t));
-      sbufp += sizeof(uint128_t);
-      tmp_128 = htonlll(_inresponseto);
-      memcpy(sbufp, &tmp_128, sizeof(uint128_t));
-      sbufp += sizeof(uint128_t);
-      break;
-#else
-      _badframe = true;
-      scr.error("status(): Descriptor 128 Bit Size Not Supported\n");
-      return;
-#endif
-    default:
-      _badframe = true;
-      scr.error("status(): Invalid Descriptor Size");
-      return;
-  }
+  sbufp = dc->put(sbufp, _progress);
+  sbufp = dc->put(sbufp, _inresponseto);
 
-  // And the holes if any
-  for (std::list<saratoga::hole>::iterator i = h->first(); i != h->last();
-       i++) {
-    _holes.add(i->starts(), i->length());
-    switch (descriptor.get()) {
-      case F_DESCRIPTOR_16:
-        tmp_16 = htons((uint16_t)i->starts());
-        memcpy(sbufp, &tmp_16, sizeof(uint16_t));
-        sbufp += sizeof(uint16_t);
-        tmp_16 = htons((uint16_t)i->ends());
-        memcpy(sbufp, &tmp_16, sizeof(uint16_t));
-        sbufp += sizeof(uint16_t);
-        break;
-      case F_DESCRIPTOR_32:
-        tmp_32 = htonl((uint32_t)i->starts());
-        memcpy(sbufp, &tmp_32, sizeof(uint32_t));
-        sbufp += sizeof(uint32_t);
-        tmp_32 = htonl((uint32_t)i->ends());
-        memcpy(sbufp, &tmp_32, sizeof(uint32_t));
-        sbufp += sizeof(uint32_t);
-        break;
-      case F_DESCRIPTOR_64:
-        tmp_64 = htonll(i->starts());
-        memcpy(sbufp, &tmp_64, sizeof(uint64_t));
-        sbufp += sizeof(uint64_t);
-        tmp_64 = htonll(i->ends());
-        memcpy(sbufp, &tmp_64, sizeof(uint64_t));
-        sbufp += sizeof(uint64_t);
-        break;
-      case F_DESCRIPTOR_128:
-#ifdef UINT128_T
-        tmp_128 = htonlll(i->starts());
-        memcpy(sbufp, &tmp_128, sizeof(uint128_t));
-        sbufp += sizeof(uint128_t);
-        tmp_128 = htonlll(i->ends());
-        memcpy(sbufp, &tmp_128, sizeof(uint128_t));
-        sbufp += sizeof(uint128_t);
-        break;
-#else
-        scr.error("status(): Descriptor 128 Bit Size Not Supported\n");
-        _badframe = true;
-        return;
-#endif
-      default:
-        scr.error("status(): Invalid Descriptor Size");
-        _badframe = true;
-        return;
-    }
+  // And the holes if any, already compressed so just copy them
+  if (h != nullptr) {
+    sbufp = dc->putholes(sbufp, h);
+    _holes = *h;
   }
 }
 
@@ -222,12 +124,7 @@ status::status(const enum f_descriptor des, const enum f_metadatarecvd md,
                const timestamp& tstamp, const offset_t progress,
                const offset_t inresponseto, saratoga::holes* h)
 {
-  uint16_t tmp_16;
   uint32_t tmp_32;
-  uint64_t tmp_64;
-#ifdef UINT128_T
-  uint128_t tmp_128;
-#endif
 
   timestamp ts = tstamp;
 
@@ -237,34 +134,27 @@ status::status(const enum f_descriptor des, const enum f_metadatarecvd md,
   if (h != nullptr)
     holecount = h->count();
 
-  Fversion version = F_VERSION_1;
-  Fframetype frametype = F_FRAMETYPE_STATUS;
-  Fdescriptor descriptor = des;
-  Freqtstamp reqtstamp = F_TIMESTAMP_YES;
-  Fmetadatarecvd metadatarecvd = md;
-  Fallholes allholes = ah;
-  Freqholes freqholes = ho;
-  Ferrcode errcode = st;
+  const dcodecs* dc = dcodecs::lookup(des);
+  if (dc == nullptr) {
+    scr.error("status(): Descriptor 128 Bit Size Not Supported\n");
+    _badframe = true;
+    _payload = nullptr;
+    _paylen = 0;
+    return;
+  }
 
   // Work out how big our frame has to be and allocate it
   size_t fsize = sizeof(flag_t) + sizeof(session_t);
-  fsize += descriptor.length(); // Offset
   fsize += ts.length();
-  fsize += (descriptor.length() * 2);             // progress, inresponseto
-  fsize += (descriptor.length() * 2 * holecount); // and the holes if any
+  fsize += (dc->length * 2);             // progress, inresponseto
+  fsize += (dc->length * 2 * holecount); // and the holes if any
 
   _payload = new char[fsize];
   _paylen = fsize;
   char* sbufp = _payload;
 
   // Set and copy flags
-  _flags += version;
-  _flags += frametype;
-  _flags += descriptor;
-  _flags += reqtstamp;
-  _flags += metadatarecvd;
-  _flags += allholes;
-  _flags += errcode;
+  _flags = hdr::statusflags(des, F_TIMESTAMP_YES, md, ah, ho, st);
 
   tmp_32 = htonl(_flags.get());
   memcpy(sbufp, &tmp_32, sizeof(flag_t));
@@ -283,99 +173,13 @@ status::status(const enum f_descriptor des, const enum f_metadatarecvd md,
 
   _progress = progress;
   _inresponseto = inresponseto;
-  switch (descriptor.get()) {
-    case F_DESCRIPTOR_16:
-      tmp_16 = htons((uint16_t)_progress);
-      memcpy(sbufp, &tmp_16, sizeof(uint16_t));
-      sbufp += sizeof(uint16_t);
-      tmp_16 = htons((uint16_t)_inresponseto);
-      memcpy(sbufp, &tmp_16, sizeof(uint16_t));
-      sbufp += sizeof(uint16_t);
-      break;
-    case F_DESCRIPTOR_32:
-      tmp_32 = htonl((uint32_t)_progress);
-      memcpy(sbufp, &tmp_32, sizeof(uint32_t));
-      sbufp += sizeof(uint32_t);
-      tmp_32 = htonl((uint32_t)_inresponseto);
-      memcpy(sbufp, &tmp_32, sizeof(uint32_t));
-      sbufp += sizeof(uint32_t);
-      break;
-    case F_DESCRIPTOR_64:
-      tmp_64 = htonll(_progress);
-      memcpy(sbufp, &tmp_64, sizeof(uint64_t));
-      sbufp += sizeof(uint64_t);
-      tmp_64 = htonll(_inresponseto);
-      memcpy(sbufp, &tmp_64, sizeof(uint64_t));
-      sbufp += sizeof(uint64_t);
-      break;
-    case F_DESCRIPTOR_128:
-#ifdef UINT128_T
-      tmp_128 = htonlll(_progress);
-      memcpy(sbufp, &tmp_128, sizeof(uint128_t));
-      sbufp += sizeof(uint128_t);
-      tmp_128 = htonlll(_inresponseto);
-      memcpy(sbufp, &tmp_128, sizeof(uint128_t));
-      sbufp += sizeof(uint128_t);
-      break;
-#else
-      _badframe = true;
-      scr.error("status(): Descriptor 128 Bit Size Not Supported\n");
-      return;
-#endif
-    default:
-      _badframe = true;
-      scr.error("status(): Invalid Descriptor Size");
-      return;
-  }
+  sbufp = dc->put(sbufp, _progress);
+  sbufp = dc->put(sbufp, _inresponseto);
 
-  // And the holes if any
-  for (std::list<saratoga::hole>::iterator i = h->first(); i != h->last();
-       i++) {
-    _holes.add(i->starts(), i->length());
-    switch (descriptor.get()) {
-      case F_DESCRIPTOR_16:
-        tmp_16 = htons((uint16_t)i->starts());
-        memcpy(sbufp, &tmp_16, sizeof(uint16_t));
-        sbufp += sizeof(uint16_t);
-        tmp_16 = htons((uint16_t)i->ends());
-        memcpy(sbufp, &tmp_16, sizeof(uint16_t));
-        sbufp += sizeof(uint16_t);
-        break;
-      case F_DESCRIPTOR_32:
-        tmp_32 = htonl((uint32_t)i->starts());
-        memcpy(sbufp, &tmp_32, sizeof(uint32_t));
-        sbufp += sizeof(uint32_t);
-        tmp_32 = htonl((uint32_t)i->ends());
-        memcpy(sbufp, &tmp_32, sizeof(uint32_t));
-        sbufp += sizeof(uint32_t);
-        break;
-      case F_DESCRIPTOR_64:
-        tmp_64 = htonll(i->starts());
-        memcpy(sbufp, &tmp_64, sizeof(uint64_t));
-        sbufp += sizeof(uint64_t);
-        tmp_64 = htonll(i->ends());
-        memcpy(sbufp, &tmp_64, sizeof(uint64_t));
-        sbufp += sizeof(uint64_t);
-        break;
-      case F_DESCRIPTOR_128:
-#ifdef UINT128_T
-        tmp_128 = htonlll(i->starts());
-        memcpy(sbufp, &tmp_128, sizeof(uint128_t));
-        sbufp += sizeof(uint128_t);
-        tmp_128 = htonlll(i->ends());
-        memcpy(sbufp, &tmp_128, sizeof(uint128_t));
-        sbufp += sizeof(uint128_t);
-        break;
-#else
-        scr.error("status(): Descriptor 128 Bit Size Not Supported\n");
-        _badframe = true;
-        return;
-#endif
-      default:
-        scr.error("status(): Invalid Descriptor Size");
-        _badframe = true;
-        return;
-    }
+  // And the holes if any, already compressed so just copy them
+  if (h != nullptr) {
+    sbufp = dc->putholes(sbufp, h);
+    _holes = *h;
   }
 }
 
@@ -384,9 +188,6 @@ status::status(const enum f_descriptor des, const enum f_metadatarecvd md,
  */
 status::status(char* payload, const size_t pl)
 {
-  offset_t tmp1;
-  offset_t tmp2;
-
   size_t paylen = pl;
 
   // Copy the frame info
@@ -439,100 +240,27 @@ status::status(char* payload, const size_t pl)
     _timestamp = timestamp();
 
   // Progress & Inresponseto
-  switch (descriptor.get()) {
-    case F_DESCRIPTOR_16:
-      _progress = (offset_t)ntohs(*(uint16_t*)payload);
-      payload += sizeof(uint16_t);
-      paylen -= sizeof(uint16_t);
-      _inresponseto = (offset_t)ntohs(*(uint16_t*)payload);
-      payload += sizeof(uint16_t);
-      paylen -= sizeof(uint16_t);
-      break;
-    case F_DESCRIPTOR_32:
-      _progress = (offset_t)ntohl(*(uint32_t*)payload);
-      payload += sizeof(uint32_t);
-      paylen -= sizeof(uint32_t);
-      _inresponseto = (offset_t)ntohl(*(uint32_t*)payload);
-      payload += sizeof(uint32_t);
-      paylen -= sizeof(uint32_t);
-      break;
-    case F_DESCRIPTOR_64:
-      _progress = (offset_t)ntohll(*(uint64_t*)payload);
-      payload += sizeof(uint64_t);
-      paylen -= sizeof(uint64_t);
-      _inresponseto = (offset_t)ntohll(*(uint64_t*)payload);
-      payload += sizeof(uint64_t);
-      paylen -= sizeof(uint64_t);
-      break;
-    case F_DESCRIPTOR_128:
-#ifdef UINT128_T
-      _progress = (offset_t)ntohlll(*(uint128_t*)payload);
-      payload += sizeof(uint128_t);
-      paylen -= sizeof(uint128_t);
-      _inresponseto = (offset_t)ntohlll(*(uint128_t*)payload);
-      payload += sizeof(uint128_t);
-      paylen -= sizeof(uint128_t);
-      break;
-#else
-      scr.error("status(frame): Descriptor 128 Bit Size Not Supported\n");
-      _badframe = true;
-      return;
-#endif
-    default:
-      _badframe = true;
-      return;
+  const dcodecs* dc = dcodecs::lookup(descriptor.get());
+  if (dc == nullptr) {
+    scr.error("status(frame): Descriptor 128 Bit Size Not Supported\n");
+    _badframe = true;
+    return;
   }
-
-  // Anything left are holes
-  tmp1 = 0;
-  tmp2 = 0;
-  int holecnt = paylen / (descriptor.length() * 2);
-  for (int i = 0; i < holecnt; i++) {
-    switch (descriptor.get()) {
-      case F_DESCRIPTOR_16:
-        tmp1 = (offset_t)ntohs(*(uint16_t*)payload);
-        payload += sizeof(uint16_t);
-        paylen -= sizeof(uint16_t);
-        tmp2 = (offset_t)ntohs(*(uint16_t*)payload);
-        payload += sizeof(uint16_t);
-        paylen -= sizeof(uint16_t);
-        break;
-      case F_DESCRIPTOR_32:
-        tmp1 = (offset_t)ntohl(*(uint32_t*)payload);
-        payload += sizeof(uint32_t);
-        paylen -= sizeof(uint32_t);
-        tmp2 = (offset_t)ntohl(*(uint32_t*)payload);
-        payload += sizeof(uint32_t);
-        paylen -= sizeof(uint32_t);
-        break;
-      case F_DESCRIPTOR_64:
-        tmp1 = (offset_t)ntohll(*(uint64_t*)payload);
-        payload += sizeof(uint64_t);
-        paylen -= sizeof(uint64_t);
-        tmp2 = (offset_t)ntohll(*(uint64_t*)payload);
-        payload += sizeof(uint64_t);
-        paylen -= sizeof(uint64_t);
-        break;
-      case F_DESCRIPTOR_128:
-#ifdef UINT128_T
-        tmp1 = (offset_t)ntohlll(*(uint128_t*)payload);
-        payload += sizeof(uint128_t);
-        paylen -= sizeof(uint128_t);
-        tmp2 = (offset_t)ntohlll(*(uint128_t*)payload);
-        payload += sizeof(uint128_t);
-        paylen -= sizeof(uint128_t);
-        break;
-#else
-        scr.error("status(frame): Descriptor 128 Bit Size Not Supported\n");
-        _badframe = true;
-        return;
-#endif
-      default:
-        _badframe = true;
-        return;
-    }
-    _holes.add(tmp1, tmp2);
+  if (paylen < dc->length * 2) {
+    scr.error("status(frame): Frame too short");
+    _badframe = true;
+    return;
   }
+  _progress = dc->get(payload);
+  payload += dc->length;
+  _inresponseto = dc->get(payload);
+  payload += dc->length;
+  paylen -= dc->length * 2;
+
+  // Anything left are holes, start & end pairs
+  std::list<hole> hl;
+  dc->getholes(payload, paylen / (dc->length * 2), hl);
+  _holes.add(hl);
 }
 
 string
@@ -566,6 +294,7 @@ status::print()
   Freqtstamp reqtstamp = _flags.get();
   Fmetadatarecvd metadatarecvd = _flags.get();
   Fallholes allholes = _flags.get();
+  Fcompress compress = _flags.get();
   Ferrcode errcode = _flags.get();
 
   s = frametype.print();
@@ -581,6 +310,8 @@ status::print()
   s += "\n    ";
   s += allholes.print();
   s += "\n    ";
+  s += compress.print();
+  s += "\n    ";
   s += errcode.print();
   s += "\n    ";
   sprintf(tmp, "Session: %" PRIu32 "", (uint32_t)_session);
@@ -658,6 +389,18 @@ status::errcode(enum f_errcode t)
   return errcode.get();
 }
 
+enum f_compress
+status::compress(enum f_compress c)
+{
+  Fcompress compress = c;
+  _flags += compress;
+  if (_paylen >= sizeof(flag_t)) {
+    uint32_t tmp_32 = htonl(_flags.get());
+    memcpy(_payload, &tmp_32, sizeof(flag_t));
+  }
+  return compress.get();
+}
+
 // Get various flags applicable to status frames
 enum f_descriptor
 status::descriptor()
@@ -701,4 +444,11 @@ status::reqtstamp()
   return t.get();
 }
 
+enum f_compress
+status::compress()
+{
+  Fcompress c = _flags.get();
+  return c.get();
+}
+
 }; // Namespace saratoga
@@ -164,6 +164,7 @@ public:
   enum f_allholes allholes();
   enum f_reqholes reqholes();
   enum f_reqtstamp reqtstamp();
+  enum f_compress compress();
 
   // Set various flags applicable to status
   enum f_descriptor descriptor(enum f_descriptor);
@@ -172,6 +173,8 @@ public:
   enum f_allholes allholes(enum f_allholes);
   enum f_reqholes reqholes(enum f_reqholes);
   enum f_reqtstamp reqtstamp(enum f_reqtstamp);
+  // This one is also written into the assembled frame
+  enum f_compress compress(enum f_compress);
 
   // What is the session number for this transaction
   session_t session() { return _session; };
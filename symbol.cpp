@@ -0,0 +1,252 @@
+/*
+
+ Copyright (c) 2012, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "dcodec.h"
+#include "fountain.h"
+#include "frame.h"
+#include "globals.h"
+#include "saratoga.h"
+#include "sarflags.h"
+#include "screen.h"
+#include "symbol.h"
+
+using namespace std;
+
+namespace saratoga {
+
+// Flags, session, block offset, then block length and symbol number
+static size_t
+symhdrlen(const dcodecs* dc)
+{
+  return sizeof(flag_t) + sizeof(session_t) + dc->length +
+         2 * sizeof(uint32_t);
+}
+
+// Create a symbol frame from scratch, encoding it straight into the frame
+symbol::symbol(const enum f_descriptor des, const session_t session,
+               const offset_t offset, ltencoder& enc, const uint32_t esi)
+{
+  uint32_t tmp_32;
+
+  _badframe = false;
+  _payload = nullptr;
+  _paylen = 0;
+  _session = session;
+  _offset = offset;
+  _blocklen = (uint32_t)enc.blen();
+  _esi = esi;
+  _symoff = 0;
+
+  const dcodecs* dc = dcodecs::lookup(des);
+  if (dc == nullptr) {
+    scr.error("symbol(): Descriptor 128 Bit Size Not Supported\n");
+    _badframe = true;
+    return;
+  }
+  if (enc.blen() == 0 || enc.symlen() > maxsymlen) {
+    scr.error("symbol(): No block to encode from");
+    _badframe = true;
+    return;
+  }
+
+  // Work out how big our frame has to be and allocate it
+  _symoff = symhdrlen(dc);
+  size_t fsize = _symoff + enc.symlen();
+
+  _payload = new char[fsize];
+  _paylen = fsize;
+  char* sbufp = _payload;
+
+  // Set and copy flags
+  _flags = hdr::symbolflags(des);
+
+  tmp_32 = htonl(_flags.get());
+  memcpy(sbufp, &tmp_32, sizeof(flag_t));
+  sbufp += sizeof(flag_t);
+
+  // Set and copy session
+  tmp_32 = htonl(session);
+  memcpy(sbufp, &tmp_32, sizeof(session_t));
+  sbufp += sizeof(session_t);
+
+  sbufp = dc->put(sbufp, _offset);
+
+  tmp_32 = htonl(_blocklen);
+  memcpy(sbufp, &tmp_32, sizeof(uint32_t));
+  sbufp += sizeof(uint32_t);
+  tmp_32 = htonl(_esi);
+  memcpy(sbufp, &tmp_32, sizeof(uint32_t));
+  sbufp += sizeof(uint32_t);
+
+  enc.encode(_esi, sbufp);
+}
+
+/*
+ * Given a buffer and length, assemble the symbol
+ */
+symbol::symbol(char* payload, const size_t pl)
+{
+  size_t paylen = pl;
+  uint32_t tmp_32;
+
+  // Copy the frame info
+  _badframe = false;
+  _paylen = paylen;
+  _payload = new char[_paylen];
+  memcpy(_payload, payload, paylen);
+
+  _session = 0;
+  _offset = 0;
+  _blocklen = 0;
+  _esi = 0;
+  _symoff = 0;
+
+  if (paylen < sizeof(flag_t) + sizeof(session_t)) {
+    scr.error("symbol(frame): Frame too short");
+    _badframe = true;
+    return;
+  }
+
+  // Assemble the flags info
+  _flags = (flag_t)ntohl(*(uint32_t*)payload);
+  payload += sizeof(flag_t);
+  paylen -= sizeof(flag_t);
+
+  Fversion version = _flags.get();
+  Fframetype frametype = _flags.get();
+  Fdescriptor descriptor = _flags.get();
+
+  if (version.get() != F_VERSION_1) {
+    scr.error("Symbol: Bad Saratoga Version");
+    _badframe = true;
+    return;
+  }
+  if (frametype.get() != F_FRAMETYPE_SYMBOL) {
+    scr.error("Symbol: Not a SYMBOL frame");
+    _badframe = true;
+    return;
+  }
+  const dcodecs* dc = dcodecs::lookup(descriptor.get());
+  if (dc == nullptr) {
+    scr.error("symbol(frame): Descriptor 128 Bit Size Not Supported\n");
+    _badframe = true;
+    return;
+  }
+  _symoff = symhdrlen(dc);
+  if (pl <= _symoff) {
+    scr.error("symbol(frame): Frame too short");
+    _badframe = true;
+    return;
+  }
+
+  // Session ID
+  _session = (session_t)ntohl(*(uint32_t*)payload);
+  payload += sizeof(session_t);
+
+  _offset = dc->get(payload);
+  payload += dc->length;
+
+  memcpy(&tmp_32, payload, sizeof(uint32_t));
+  _blocklen = ntohl(tmp_32);
+  payload += sizeof(uint32_t);
+  memcpy(&tmp_32, payload, sizeof(uint32_t));
+  _esi = ntohl(tmp_32);
+
+  // No more than maxk symbols to a block
+  size_t symlen = pl - _symoff;
+  size_t most = ltencoder::maxk;
+  if (symlen > maxsymlen || _blocklen == 0 ||
+      _blocklen > most * symlen) {
+    scr.error("symbol(frame): Bad block length %" PRIu32 " for %zu byte "
+              "symbols",
+              _blocklen, symlen);
+    _badframe = true;
+    return;
+  }
+}
+
+enum f_descriptor
+symbol::descriptor()
+{
+  Fdescriptor t = _flags.get();
+  return t.get();
+}
+
+/*
+ * Print out the symbol flags & where it belongs
+ */
+string
+symbol::print()
+{
+  char tmp[128];
+  string s;
+
+  if (_badframe) {
+    s = "symbol::print(): Bad SYMBOL Frame";
+    scr.error(s);
+    return (s);
+  }
+  Fversion version = _flags.get();
+  Fframetype frametype = _flags.get();
+  Fdescriptor descriptor = _flags.get();
+
+  s = frametype.print();
+  s += printflags("SYMBOL FLAGS", this->flags());
+  s += "    ";
+  s += version.print();
+  s += "\n    ";
+  s += descriptor.print();
+  s += "\n    ";
+  sprintf(tmp, "Session: %" PRIu32 "", (uint32_t)_session);
+  s += tmp;
+  s += "\n    ";
+  sprintf(tmp, "Symbol %" PRIu32 " of the %" PRIu32
+               " byte block at offset %" PRIu64 "",
+          _esi, _blocklen, (uint64_t)_offset);
+  s += tmp;
+  s += "\n    ";
+  sprintf(tmp, "Symbol Length: %zu", this->symlen());
+  s += tmp;
+  return (s);
+}
+
+}; // Namespace saratoga
@@ -0,0 +1,186 @@
+/*
+
+ Copyright (c) 2011, Charles Smith
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification,
+ are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+ this
+      list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+ this
+      list of conditions and the following disclaimer in the documentation
+ and/or
+      other materials provided with the distribution.
+    * Neither the name of Vallona Networks nor the names of its contributors
+      may be used to endorse or promote products derived from this software
+ without
+      specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED.
+ IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY
+ DIRECT,
+ INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+ LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ ADVISED
+ OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ */
+
+#ifndef _SYMBOL_H
+#define _SYMBOL_H
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include "fountain.h"
+#include "frame.h"
+#include "ip.h"
+#include "saratoga.h"
+#include "sarflags.h"
+#include "screen.h"
+
+using namespace std;
+
+namespace saratoga {
+/*
+ **********************************************************************
+ * SYMBOL
+ **********************************************************************
+ */
+
+/*
+ * One fountain coded symbol of a block of a multicast put, see
+ * fountain.h. After the flags and session come the offset of the block
+ * in the file (descriptor sized), the length of the block and the
+ * symbol number, both 32 bit, then the symbol. Every symbol of a block
+ * is the same length, the last one of the file being padded with zeros
+ */
+class symbol : public frame
+{
+private:
+  Fflag _flags;        // symbol's Flags
+  session_t _session;  // The session ID
+  offset_t _offset;    // Where the block starts in the file
+  uint32_t _blocklen;  // How long the block is
+  uint32_t _esi;       // Which encoding symbol this is
+  size_t _symoff;      // Where the symbol starts in the payload
+protected:
+  bool _badframe; // Are we a good or bad symbol frame
+  char* _payload; // Complete payload of frame
+  size_t _paylen; // Length of payload
+public:
+  // The block length and symbol number take the room a DATA frame
+  // keeps for its timestamp, so a SYMBOL is never longer than a DATA
+  static const size_t maxsymlen = MAXDATA - 2 * sizeof(uint32_t);
+
+  // Biggest block, maxk symbols
+  static const size_t maxblock = ltencoder::maxk * maxsymlen;
+
+  // This is how we assemble a local symbol frame from the encoder
+  symbol(const enum f_descriptor, // Flags
+         const session_t,         // Session
+         const offset_t,          // Offset of the block
+         ltencoder&,              // Block read in
+         const uint32_t);         // Symbol number
+
+  // We have received a remote frame that is SYMBOL
+  symbol(char*,         // Pointer to buffer received
+         const size_t); // Total length of buffer
+
+  ~symbol() { this->clear(); };
+
+  void clear()
+  {
+    if (_paylen > 0)
+      delete[] _payload;
+    _paylen = 0;
+    _flags = 0;
+    _session = 0;
+    _offset = 0;
+    _blocklen = 0;
+    _esi = 0;
+    _symoff = 0;
+  };
+
+  // Copy Constructor
+  symbol(const symbol& old)
+  {
+    if (old._paylen > 0) {
+      _payload = new char[old._paylen];
+      memcpy(_payload, old._payload, old._paylen);
+    } else
+      _payload = nullptr;
+    _paylen = old._paylen;
+    _flags = old._flags;
+    _session = old._session;
+    _offset = old._offset;
+    _blocklen = old._blocklen;
+    _esi = old._esi;
+    _symoff = old._symoff;
+    _badframe = old._badframe;
+  }
+
+  symbol& operator=(const symbol& old)
+  {
+    if (old._paylen > 0) {
+      _payload = new char[old._paylen];
+      memcpy(_payload, old._payload, old._paylen);
+    } else
+      _payload = nullptr;
+    _paylen = old._paylen;
+    _flags = old._flags;
+    _session = old._session;
+    _offset = old._offset;
+    _blocklen = old._blocklen;
+    _esi = old._esi;
+    _symoff = old._symoff;
+    _badframe = old._badframe;
+    return (*this);
+  };
+
+  bool badframe() { return _badframe; };
+  size_t paylen() { return _paylen; };
+  char* payload() { return _payload; };
+
+  enum f_descriptor descriptor();
+
+  session_t session() { return _session; };
+  offset_t offset() { return _offset; };
+  uint32_t blocklen() { return _blocklen; };
+  uint32_t esi() { return _esi; };
+  const char* sym() { return _payload + _symoff; };
+  size_t symlen() { return _paylen - _symoff; };
+
+  // The symbol frames flags
+  flag_t flags() { return _flags.get(); };
+
+  // Yes I am a symbol frame
+  f_frametype type() { return F_FRAMETYPE_SYMBOL; };
+
+  ssize_t tx(sarnet::udp* sock) { return (sock->tx(_payload, _paylen)); };
+
+  ssize_t rx()
+  {
+    string s = "SYMBOL RX: ";
+    s += this->print();
+    cout << s << endl;
+    return (-1);
+  };
+
+  string print();
+};
+
+} // Namespace saratoga
+
+#endif // _SYMBOL_H
@@ -139,6 +139,16 @@ testchecksum(string fname1, string fname2)
   else
     scr.msg("!= String MD5 false");
 
+  scr.msg("Doing MD5 batch");
+  std::list<string> names;
+  names.push_back(fname1);
+  names.push_back(fname2);
+  std::list<checksums::md5> mb = checksums::md5batch(names);
+  if (mb.front() == m1 && mb.back() == m2)
+    scr.msg("MD5 batch matches single");
+  else
+    scr.msg("MD5 batch differs from single");
+
   scr.msg("Doing SHA1");
   checksums::sha1 s1(fname1);
   checksums::sha1 s2(fname2);
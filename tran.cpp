@@ -39,9 +39,13 @@
 #include "tran.h"
 #include "beacon.h"
 #include "checksum.h"
+#include "compress.h"
 #include "data.h"
+#include "dcodec.h"
+#include "delta.h"
 #include "dirent.h"
 #include "frame.h"
+#include "frameview.h"
 #include "globals.h"
 #include "holes.h"
 #include "ip.h"
@@ -50,11 +54,13 @@
 #include "saratoga.h"
 #include "sarflags.h"
 #include "screen.h"
+#include "signature.h"
 #include "timer.h"
 #include "timestamp.h"
 #include <cstring>
 #include <iostream>
 #include <limits>
+#include <random>
 #include <string>
 #include <sys/statvfs.h>
 
@@ -62,6 +68,31 @@ using namespace std;
 
 namespace saratoga {
 
+// Most holes a delta asks for in one STATUS, 64 bit pairs in a datagram
+static const size_t maxdeltaholes = 4000;
+
+// Compressing and expanding DATA for every transfer, the streams are
+// only set up once
+static zblock zblocks;
+
+// Receiving a multicast put, the most we hold back our STATUS and how
+// long a range we asked for is not asked for again, nor one sent again
+// when sending. How often we look for something to ask for in between.
+// In ms as the timers are
+static const offset_t nakbackoff = 2000;
+static const offset_t nakholdoff = 3000;
+static const offset_t nakcheck = 1000;
+
+// STATUS that can't say how a path MTU probe went before it counts lost
+static const int probestatusmax = 3;
+
+// Frames on a link smaller than this carry no timestamps
+static const size_t narrowframe = 512;
+
+// Each receiver draws its own backoff
+static std::random_device nakseed;
+static std::minstd_rand nakrand(nakseed());
+
 // We have a request. Create the transfer
 tran::tran(saratoga::requestor inorout, saratoga::direction dir,
            saratoga::request* req, sarnet::udp* sock, string localfname)
@@ -97,6 +128,10 @@ tran::tran(saratoga::requestor inorout, saratoga::direction dir,
   // Do we want to transmit timestamps for this transfer
   _reqtstamp = c_timestamp.flag();
   _timetype = c_timestamp.ttype();
+  // On a narrow link such as AX.25 they cost too much of every frame,
+  // the other end is on the same link and leaves them out as well
+  if (_peer->framesize() > 0 && (size_t)_peer->framesize() < narrowframe)
+    _reqtstamp = F_TIMESTAMP_NO;
   // Set these to now for the moment
   _timestamp = timestamp();    // Last timestmap transmitted in DATA or STATUS
   _lastrxtstamp = timestamp(); // Last rx timestamp in DATA or STATUS
@@ -105,10 +140,53 @@ tran::tran(saratoga::requestor inorout, saratoga::direction dir,
   _holes.clear();
   _completed.clear();
   _done = false;
+  _deltawait = false;
+  _delta = false;
+  _basis = -1;
+  _finalname = "";
+  _compress = F_COMPRESS_NO;
+  _zdata = false;
+  _probeoff = 0;
+  _probelen = 0;
+  _probesize = 0;
+  _probestatus = 0;
+  _paths.clear();
+  _fountain = false;
+  _extra = 0;
+  _ltat = 0;
+  _multicast = false;
+  _sentto = 0;
+  _holdoff = timer_group::timer(nakholdoff);
+  _heard = timer_group::timer(nakholdoff);
+  _nakwait = false;
+
+  // The descriptor is fixed for the life of the transfer so make sure
+  // once here that we can encode it rather than finding out per frame
+  if (dcodecs::lookup(_descriptor.get()) == nullptr) {
+    scr.error("Cannot Initiate Transfer. %s not supported",
+              _descriptor.print().c_str());
+    _errcode = F_ERRCODE_BADDESC;
+    goto badtran;
+  }
 
   _dir = dir;
   switch (dir) {
     case TO_SOCKET:
+      // Doing deltas no DATA goes until the receiver says what it needs
+      _deltawait = c_delta.state();
+      // Offered in our METADATA, DATA is compressed if it is taken up
+      if (c_compress.state())
+        _compress = F_COMPRESS_YES;
+      if (c_fec.state()) {
+        _fecout.setup(c_fec.n(), c_fec.k(), c_fec.isauto());
+        // The REPAIRs have to fit the link's frames as the DATA does
+        if (_peer->framesize() > 0)
+          _fecout.fit(((size_t)_peer->framesize() > this->dataheader())
+                        ? _peer->framesize() - this->dataheader()
+                        : 0);
+        scr.debug(2, "tran::tran(): %s", _fecout.print().c_str());
+      }
+      this->openpaths();
       // We are opening a local file and SENDING it out the socket
       // to a remote peer. Make sure it exists first
       if (sarfile::fexists(localfname)) {
@@ -135,10 +213,21 @@ tran::tran(saratoga::requestor inorout, saratoga::direction dir,
       // from a remote peer
       // Create the local file for writing to
       if (sarfile::fexists(localfname)) {
-        scr.error("Local file %s already exists cannot create",
+        // Doing deltas we build the new one beside the old one, which is
+        // left alone until the new one is complete
+        if (c_delta.state() &&
+            (_basis = open(localfname.c_str(), O_RDONLY | O_LARGEFILE)) >=
+              0) {
+          scr.msg("Have %s already, receiving the changes to it",
                   localfname.c_str());
-        _errcode = F_ERRCODE_INUSE;
-        goto badtran;
+          _finalname = localfname;
+          localfname += ".part";
+        } else {
+          scr.error("Local file %s already exists cannot create",
+                    localfname.c_str());
+          _errcode = F_ERRCODE_INUSE;
+          goto badtran;
+        }
       }
       _local = new sarfile::fileio(localfname, sarfile::FILE_WRITE);
       if (_local->ok() && _local->isfile()) {
@@ -154,6 +243,26 @@ tran::tran(saratoga::requestor inorout, saratoga::direction dir,
       _errcode = F_ERRCODE_INUSE;
       goto badtran;
   }
+  // Start hashing with our own checksum setting. A receiver switches
+  // type if the METADATA says the sender is using something else
+  _csumstream = checksums::csumstream(tocsumtype(c_checksum.flag()));
+  _csumdone = false;
+  // Sending a file we have hashed before means the first METADATA
+  // can carry the checksum
+  if (_dir == TO_SOCKET && _local->csumcached(_csumstream.csumtype())) {
+    _csumtype = tocsumflag(_csumstream.csumtype());
+    _csumlen = tocsumlen(_csumstream.csumtype());
+    _csumdone = true;
+  } else if (_dir == TO_SOCKET &&
+             _csumstream.csumtype() != checksums::CSUM_NONE &&
+             sarcsumfd >= 0 &&
+             CSUMPOOL_Submit(localfname.c_str(), (int)_csumstream.csumtype(),
+                             (unsigned long)_session) == 0) {
+    // The checksum threads have it, so no need to hash as we send
+    scr.debug(3, "tran::tran(): Checksumming %s in the background",
+              localfname.c_str());
+    _csumstream.reset(checksums::CSUM_NONE);
+  }
   // We are a good transfer as we can open/create local file
   scr.debug(3, "tran::tran(): Adding Local File to sarfiles");
   sarfiles.add(_local);
@@ -176,6 +285,10 @@ badtran:
   _metadatarecvd = F_METADATARECVD_NO;
   _ready = false;
   _done = true;
+  _csumdone = true;
+  if (_basis >= 0)
+    close(_basis);
+  _basis = -1;
   return;
 }
 
@@ -229,8 +342,39 @@ tran::tran(const tran& t)
   _freespaced = t._freespaced;
   _csumtype = t._csumtype;
   _csumlen = t._csumlen;
+  _compress = t._compress;
   _errcode = t._errcode;
   _done = t._done;
+  _csumstream = t._csumstream;
+  _csumdone = t._csumdone;
+  _sigs = t._sigs;
+  _deltawait = t._deltawait;
+  _delta = t._delta;
+  _basis = t._basis;
+  _finalname = t._finalname;
+  _zdata = t._zdata;
+  _fecout = t._fecout;
+  _fecin = t._fecin;
+  _probeoff = t._probeoff;
+  _probelen = t._probelen;
+  _probesize = t._probesize;
+  _probestatus = t._probestatus;
+  _paths = t._paths;
+  _fountain = t._fountain;
+  _extra = t._extra;
+  _ltout = t._ltout;
+  _ltat = t._ltat;
+  _ltowed = t._ltowed;
+  _ltesi = t._ltesi;
+  _ltin = t._ltin;
+  _ltdone = t._ltdone;
+  _multicast = t._multicast;
+  _sentto = t._sentto;
+  _mrecent = t._mrecent;
+  _holdoff = t._holdoff;
+  _backoff = t._backoff;
+  _heard = t._heard;
+  _nakwait = t._nakwait;
 }
 
 tran&
@@ -283,8 +427,39 @@ tran::operator=(const tran& t)
   _freespaced = t._freespaced;
   _csumtype = t._csumtype;
   _csumlen = t._csumlen;
+  _compress = t._compress;
   _errcode = t._errcode;
   _done = t._done;
+  _csumstream = t._csumstream;
+  _csumdone = t._csumdone;
+  _sigs = t._sigs;
+  _deltawait = t._deltawait;
+  _delta = t._delta;
+  _basis = t._basis;
+  _finalname = t._finalname;
+  _zdata = t._zdata;
+  _fecout = t._fecout;
+  _fecin = t._fecin;
+  _probeoff = t._probeoff;
+  _probelen = t._probelen;
+  _probesize = t._probesize;
+  _probestatus = t._probestatus;
+  _paths = t._paths;
+  _fountain = t._fountain;
+  _extra = t._extra;
+  _ltout = t._ltout;
+  _ltat = t._ltat;
+  _ltowed = t._ltowed;
+  _ltesi = t._ltesi;
+  _ltin = t._ltin;
+  _ltdone = t._ltdone;
+  _multicast = t._multicast;
+  _sentto = t._sentto;
+  _mrecent = t._mrecent;
+  _holdoff = t._holdoff;
+  _backoff = t._backoff;
+  _heard = t._heard;
+  _nakwait = t._nakwait;
   return (*this);
 }
 
@@ -297,6 +472,13 @@ tran::zap()
   if (_local && _local->fd() > 2) {
     delete _local;
   }
+  if (_basis >= 0)
+    close(_basis);
+  _basis = -1;
+  _fecin.clear();
+  _ltowed.clear();
+  _ltin.clear();
+  _mrecent.clear();
   // Remove the remaining holes
   _holes.clear();
   _completed.clear();
@@ -329,29 +511,115 @@ tran::print()
   sprintf(tmp, "session %" PRIu32 " from %s to %s\n", _session, from.c_str(),
           to.c_str());
   s += tmp;
+  for (size_t i = 0; i < _paths.size(); i++)
+    s += " also to " + _paths[i]->print() + "\n";
   return s;
 }
 
+// Time for our STATUS. Receiving from a group that is once there is
+// something to ask for, looked for every so often, and after a random
+// backoff
+bool
+tran::status_due()
+{
+  if (!_multicast || _dir != FROM_SOCKET || _done)
+    return this->status_expired();
+  if (!_backoff.elapsed())
+    return false;
+  if (_nakwait)
+    return true;
+  bool want = _holdoff.elapsed();
+  if (this->metadatarecvd() == F_METADATARECVD_YES) {
+    holes h;
+    this->naklist(h);
+    want = (h.count() > 0);
+  }
+  if (!want) {
+    _backoff = timer_group::timer(nakcheck);
+    return false;
+  }
+  _backoff = timer_group::timer((offset_t)(nakrand() % (nakbackoff + 1)));
+  _nakwait = true;
+  return _backoff.elapsed();
+}
+
+// Receiving from a group, the holes our STATUS asks for. Those we asked
+// for lately are left out, as is what lies past the last DATA in until
+// the DATA stops coming, it may be on its way
+void
+tran::naklist(holes& h)
+{
+  h = _holes;
+  if (_holdoff.elapsed())
+    _mrecent.clear();
+  h -= _mrecent;
+  if (!_heard.elapsed()) {
+    offset_t from = 0;
+    offset_t size = _local->filesize();
+    if (_completed.count() > 0) {
+      std::list<hole>::iterator last = _completed.last();
+      from = (--last)->ends() + 1;
+    }
+    if (from < size) {
+      hole ahead(from, size - from);
+      h -= ahead;
+    }
+  }
+}
+
 bool
-tran::sendstatus()
+tran::sendstatus(sarnet::udp* to)
 {
   saratoga::status* s;
+  holes* hl = this->holelist();
+  holes nak;
 
   scr.debug(2, "Assembling STATUS for transfer");
+  // Saying we have the METADATA without having built anything from our
+  // old copy means the sender sends us the lot
+  if (_dir == FROM_SOCKET && _basis >= 0 && !_delta &&
+      this->metadatarecvd() == F_METADATARECVD_YES) {
+    scr.msg("No signatures for %s, receiving all of it",
+            _finalname.c_str());
+    close(_basis);
+    _basis = -1;
+  }
+  // Receiving from a group ask only for what has not come meanwhile or
+  // been asked for lately, and if that is nothing say nothing
+  if (_multicast && _dir == FROM_SOCKET) {
+    _nakwait = false;
+    _holdoff.reset();
+    if (!_done && this->metadatarecvd() == F_METADATARECVD_YES) {
+      this->naklist(nak);
+      if (nak.count() == 0) {
+        scr.debug(3, "Nothing to ask for in session %" PRIu32 ", no STATUS",
+                  this->session());
+        _statustimer.reset();
+        return (true);
+      }
+      _mrecent += nak;
+      hl = &nak;
+    }
+  }
   // Se current timestamp if we have enabled it in command line
   // the timestamp type we are using.
-  if (c_timestamp.flag() == F_TIMESTAMP_YES) {
-    timestamp ts(c_timestamp.ttype());
+  if (this->reqtstamp() == F_TIMESTAMP_YES) {
+    timestamp ts(_timetype);
 
     s = new status(this->descriptor(), this->metadatarecvd(), this->allholes(),
                    this->reqholes(), this->errcode(), this->session(), ts,
-                   this->curprogress(), this->inresponseto(), this->holelist());
+                   this->curprogress(), this->inresponseto(), hl);
   } else {
     s = new status(this->descriptor(), this->metadatarecvd(), this->allholes(),
                    this->reqholes(), this->errcode(), this->session(),
-                   this->curprogress(), this->inresponseto(), this->holelist());
+                   this->curprogress(), this->inresponseto(), hl);
   }
-  if (s->badframe() || (s->tx(this->peer()) != (ssize_t)s->paylen())) {
+  // Take up the senders offer to compress
+  if (_dir == FROM_SOCKET)
+    s->compress(this->compress());
+  if (to == nullptr)
+    to = this->peer();
+  if (s->badframe() || (s->tx(to) != (ssize_t)s->paylen())) {
     scr.error("tran::sendstatus(): Bad STATUS frame", s->paylen());
     delete s;
     return (false);
@@ -372,6 +640,9 @@ tran::sendmetadata()
             this->localfname().c_str());
   m = new metadata(this->descriptor(), this->transfer(), this->progress(),
                    this->session(), this->local());
+  m->compress(this->compress());
+  if (_multicast)
+    m->mcast(F_MCAST_YES);
   scr.debug(7, "Assembled METADATA is %s", m->print().c_str());
   if (m->badframe() || (m->tx(this->peer()) != (ssize_t)m->paylen())) {
     scr.error("tran::sendmetadata(): Bad METADATA frame");
@@ -383,59 +654,634 @@ tran::sendmetadata()
   return true;
 }
 
+// Send the signatures of our blocks so a receiver with an old copy can
+// tell us what it is missing. Reading the file for them feeds the
+// running checksum as well. They are only advice, if any are lost the
+// receiver has the whole file sent
+void
+tran::sendsignatures()
+{
+  offset_t size = _local->filesize();
+  checksums::csumbuf cbuf;
+
+  _deltawait = false;
+  if (size == 0 || !cbuf.ok())
+    return;
+  _sigs.start(size);
+  size_t step = checksums::csum_buflen / _sigs.blocksize() * _sigs.blocksize();
+  for (offset_t at = 0; at < size;) {
+    ssize_t got =
+      _local->pread(cbuf.buf(), (size_t)min((offset_t)step, size - at), at);
+    if (got <= 0) {
+      scr.error("tran::sendsignatures(): Cannot read %s",
+                this->localfname().c_str());
+      _sigs.clear();
+      return;
+    }
+    _sigs.update(cbuf.buf(), got);
+    this->csumadvance(cbuf.buf(), got, at);
+    at += got;
+  }
+
+  uint32_t maxn = signature::maxentries;
+  for (uint32_t first = 0; first < _sigs.nblocks(); first += maxn) {
+    uint32_t n = min(maxn, _sigs.nblocks() - first);
+    saratoga::signature* g =
+      new signature(this->descriptor(), this->session(), _sigs, first, n);
+    if (g->badframe() || (g->tx(this->peer()) != (ssize_t)g->paylen())) {
+      scr.error("tran::sendsignatures(): Bad SIGNATURE frame");
+      delete g;
+      return;
+    }
+    delete g;
+  }
+  scr.msgout("tran::sendsignatures(): %s", _sigs.print().c_str());
+  _deltawait = true;
+}
+
+// Sending a delta or a multicast put, read and send the next part of the
+// first hole asked for. False once there are none left
+bool
+tran::sendholes(size_t maxbuff)
+{
+  if (_holes.count() == 0)
+    return false;
+  hole h = *_holes.first();
+  size_t len = (size_t)min((offset_t)maxbuff, h.length());
+  if (_local->read(len, h.starts()) <= 0)
+    return false;
+  hole sent(h.starts(), len);
+  _holes -= sent;
+  if (_multicast) {
+    _mrecent += sent;
+    _holdoff.reset();
+  }
+  this->senddata(_local->buffers());
+  return true;
+}
+
 // We have a buffer, convert it into data frames(s) and send
-// Send multiple frames if the len > data::maxframesize
+// Send multiple frames if the len > framesize()
 void
 tran::senddata(std::list<saratoga::buffer>* bufs)
 {
-  size_t framesize = data::maxframesize;
 bufloop:
   while (!bufs->empty()) {
     saratoga::buffer* b = &(bufs->front());
-    ssize_t remainder = b->len();
-    offset_t offset = b->offset();
-    size_t framecount = b->len() / framesize;
-    char* buf = b->buf();
-    while (framecount) {
-      saratoga::data* d = new data(
-        this->descriptor(), this->transfer(), this->reqstatus(), this->eod(),
-        this->reqtstamp(), this->session(), offset, buf, framesize);
-      if (d->badframe() || d->tx(this->peer()) != (ssize_t)d->paylen()) {
-        scr.error("tran::senddata(): Bad DATA frame");
-        delete d;
-        bufs->pop_front();
-        goto bufloop;
-      } else
-        scr.msgout("Sent DATA Frame: Length=%d Offset=%" PRIu64 " Frame# %d",
-                   framesize, offset, framecount);
-      scr.debug(7, "tran::senddata(): Full Frame %s", d->print().c_str());
-      delete d;
-      framecount--;
-      buf += data::maxframesize;
-      remainder -= data::maxframesize;
-      // Increment the file offset
-      offset += framesize;
+    if (b->offset() + (offset_t)b->len() > _sentto)
+      _sentto = b->offset() + (offset_t)b->len();
+    if (_zdata) {
+      this->sendcompressed(b);
+      bufs->pop_front();
+      continue;
     }
-    if (remainder) {
+    // A probe takes the start of the buffer
+    size_t probed = this->sendprobe(b);
+    ssize_t remainder = b->len() - probed;
+    offset_t offset = b->offset() + probed;
+    char* buf = b->buf() + probed;
+    while (remainder > 0) {
+      sarnet::udp* path = this->pathfor();
+      size_t len = this->framesize(path);
+      if ((size_t)remainder < len)
+        len = remainder;
       saratoga::data* d = new data(
         this->descriptor(), this->transfer(), this->reqstatus(), this->eod(),
-        this->reqtstamp(), this->session(), offset, buf, remainder);
-      if (d->badframe() || d->tx(this->peer()) != (ssize_t)d->paylen()) {
+        this->reqtstamp(), this->session(), offset, buf, len);
+      if (d->badframe() || d->tx(path) != (ssize_t)d->paylen()) {
         scr.error("tran::senddata(): Bad DATA frame");
         delete d;
         bufs->pop_front();
         goto bufloop;
       } else
-        scr.msgout("Sent Remaining DATA Frame: Length=%d Offset=%" PRIu64 "",
-                   remainder, offset);
-      scr.debug(7, "tran::senddata(): Remainder Frame %s", d->print().c_str());
-      scr.debug(7, "Sleeping for 10 Seconds");
+        scr.msgout("Sent DATA Frame: Length=%zu Offset=%" PRIu64 "", len,
+                   offset);
+      scr.debug(7, "tran::senddata(): Frame to %s %s",
+                path->straddr().c_str(), d->print().c_str());
+      this->fecadd(d, len);
       delete d;
-      offset += remainder;
+      buf += len;
+      remainder -= len;
+      // Increment the file offset
+      offset += len;
     }
     _offset = offset;
+    this->csumadvance(b->buf(), b->len(), b->offset());
     bufs->pop_front();
   }
+  // Repairs are not held back waiting for DATA that will not follow
+  if (_delta || _offset >= _local->filesize())
+    this->sendrepairs();
+}
+
+// Largest DATA payload, less what a REPAIR needs to describe its group.
+// That is what fits in one frame on the wire to the peer after the DATA
+// header, so jumbo frames on a LAN that has them and no fragmenting on
+// a narrow link such as AX.25, a DATA split into fragments is lost if
+// any one of them is. The default is only for a link that can't say
+size_t
+tran::framesize(sarnet::udp* path)
+{
+  size_t size = data::defframesize;
+  sarnet::udp* p = (path != nullptr) ? path : _peer;
+  ssize_t wire = (p != nullptr) ? p->framesize() : 0;
+  size_t header = this->dataheader();
+
+  if (wire > 0) {
+    size = ((size_t)wire > header) ? wire - header : 0;
+    if (size > data::maxframesize)
+      size = data::maxframesize;
+  }
+  // The FEC was cut down to fit in the constructor, at least a byte
+  // each frame so the sending goes on whatever the link
+  if (size <= _fecout.overhead())
+    return (1);
+  return (size - _fecout.overhead());
+}
+
+// Sending to a peer that has more than the one address, each of the
+// others is a peer of its own for select() to send to
+void
+tran::openpaths()
+{
+  sarnet::ip me(_peer->straddr());
+  std::vector<string> addrs = c_multipath.paths(me.straddr());
+
+  for (size_t i = 0; i < addrs.size(); i++) {
+    if (addrs[i] == me.straddr())
+      continue;
+    sarnet::ip a(addrs[i]);
+    sarnet::udp* p = sarpeers.match(&a);
+    if (p == nullptr) {
+      sarpeers.add(&a, (a.family() == AF_AX25) ? 0 : sarport);
+      p = sarpeers.match(&a);
+    }
+    if (p == nullptr || p == _peer) {
+      scr.error("tran::openpaths(): Cannot reach %s by %s",
+                me.straddr().c_str(), addrs[i].c_str());
+      continue;
+    }
+    _paths.push_back(p);
+    scr.msg("Session %" PRIu32 " to %s also by %s", _session,
+            me.straddr().c_str(), addrs[i].c_str());
+  }
+}
+
+// Which way to the peer the next DATA goes, the one with the least time
+// until what it has waiting is gone. A link whose rate is not known yet
+// is taken to be as fast as the fastest that is, so each gets tried.
+// Multicast, compressed and FEC DATA keep to _peer, they are sized for
+// it
+sarnet::udp*
+tran::pathfor()
+{
+  if (_paths.empty() || _multicast || _zdata || _fecout.on())
+    return (_peer);
+
+  double fastest = 0;
+  for (size_t i = 0; i <= _paths.size(); i++) {
+    sarnet::udp* p = (i == 0) ? _peer : _paths[i - 1];
+    if (p->link() != nullptr && p->link()->rate() > fastest)
+      fastest = p->link()->rate();
+  }
+  sarnet::udp* best = _peer;
+  double soonest = -1;
+  for (size_t i = 0; i <= _paths.size(); i++) {
+    sarnet::udp* p = (i == 0) ? _peer : _paths[i - 1];
+    if (p->link() == nullptr)
+      continue;
+    double rate = p->link()->rate();
+    if (rate == 0)
+      rate = fastest;
+    double waiting = (double)(p->queued() + this->framesize(p));
+    double when = (rate > 0) ? waiting / rate : waiting;
+    if (soonest < 0 || when < soonest) {
+      soonest = when;
+      best = p;
+    }
+  }
+  return (best);
+}
+
+// Flags, session, offset and timestamp ahead of the payload in a DATA
+size_t
+tran::dataheader()
+{
+  Fdescriptor d = this->descriptor();
+  size_t len = sizeof(flag_t) + sizeof(session_t) + d.length();
+
+  if (this->reqtstamp() == F_TIMESTAMP_YES) {
+    timestamp t(_timetype);
+    len += t.length();
+  }
+  return len;
+}
+
+// If the link wants a path MTU probe send the start of the buffer in a
+// DATA that size, return how much of the buffer it took. Not when the
+// frames are compressed or have REPAIRs, they are sized for those
+size_t
+tran::sendprobe(saratoga::buffer* b)
+{
+  if (_probelen > 0 || _multicast || _fecout.on() || _peer == nullptr ||
+      _peer->link() == nullptr)
+    return 0;
+  size_t header = this->dataheader();
+  size_t size = _peer->link()->probesize();
+  if (size <= header)
+    return 0;
+  size_t len = size - header;
+  // Not enough here to make one, try the next buffer
+  if (b->len() < len)
+    return 0;
+
+  saratoga::data* d = new data(this->descriptor(), this->transfer(),
+                               F_REQSTATUS_YES, this->eod(), this->reqtstamp(),
+                               this->session(), b->offset(), b->buf(), len);
+  if (d->badframe() || d->tx(this->peer()) != (ssize_t)d->paylen()) {
+    scr.error("tran::sendprobe(): Bad DATA frame");
+    delete d;
+    _peer->link()->probed(size, false);
+    return 0;
+  }
+  scr.msgout("Sent DATA Probe: Length=%zu Offset=%" PRIu64 "", len,
+             b->offset());
+  delete d;
+  _peer->link()->probesent(size);
+  _probeoff = b->offset();
+  _probelen = len;
+  _probesize = size;
+  _probestatus = 0;
+  return len;
+}
+
+// Did the probe get there. It did if what the receiver has runs past it
+// and it is not in a hole, not if it is in one. Otherwise try again
+// with the next STATUS, after a few the link counts it lost
+void
+tran::probestatus(const saratoga::statusview& sta)
+{
+  if (_probelen == 0)
+    return;
+  offset_t first = _probeoff;
+  offset_t last = _probeoff + _probelen - 1;
+  bool beyond = (sta.progress() >= last);
+  bool ok = false;
+  bool lost = false;
+
+  for (size_t i = 0; i < sta.holecount(); i++) {
+    if (sta.holestart(i) <= last && sta.holeend(i) >= first)
+      lost = true;
+    if (sta.holestart(i) > last)
+      beyond = true;
+  }
+  if (!lost && beyond)
+    ok = true;
+  else if (!lost && ++_probestatus < probestatusmax)
+    return;
+  _peer->link()->probed(_probesize, ok);
+  _probelen = 0;
+}
+
+// A DATA frame has gone, add it to the FEC group and send the repairs
+// when the group is full or the next frame does not follow on from it
+void
+tran::fecadd(saratoga::data* d, size_t span)
+{
+  if (!_fecout.on())
+    return;
+  if (!_fecout.fits(d->offset()))
+    this->sendrepairs();
+  _fecout.add(d->offset(), d->dbuf(), d->dbuflen(), span,
+              d->compress() == F_COMPRESS_YES);
+  if (_fecout.full())
+    this->sendrepairs();
+}
+
+void
+tran::sendrepairs()
+{
+  if (!_fecout.on() || _fecout.empty())
+    return;
+  for (uint8_t r = 0; r < _fecout.k() && _fecout.group().maxlen() > 0; r++) {
+    saratoga::repair* p =
+      new repair(this->descriptor(), this->session(), _fecout, r);
+    if (p->badframe() || p->tx(this->peer()) != (ssize_t)p->paylen()) {
+      scr.error("tran::sendrepairs(): Bad REPAIR frame");
+      delete p;
+      break;
+    }
+    scr.msgout("Sent REPAIR Frame %d of %d for Offset=%" PRIu64 "", r + 1,
+               (int)_fecout.k(), (uint64_t)_fecout.group().first);
+    scr.debug(7, "tran::sendrepairs(): %s", p->print().c_str());
+    delete p;
+  }
+  _fecout.next();
+}
+
+// Multicast puts, see fountain.h. Blocks are as many whole symbols as
+// the code takes
+size_t
+tran::ltblock()
+{
+  return symbol::maxblock;
+}
+
+// Symbols in a run of the block at offset. The first run is k and the
+// extra, those asked for after are the extra alone, never too few to
+// make up for a handful of lost symbols
+uint32_t
+tran::ltrun(offset_t at, bool first)
+{
+  offset_t len = min((offset_t)this->ltblock(), _local->filesize() - at);
+  uint32_t k = (uint32_t)((len + symbol::maxsymlen - 1) / symbol::maxsymlen);
+  uint32_t more = (k * _extra + 99) / 100;
+
+  if (first)
+    return k + more;
+  return max(more, 2 + k / 32);
+}
+
+void
+tran::fountainput(int extra)
+{
+  offset_t size = _local->filesize();
+
+  _fountain = true;
+  _multicast = true;
+  _extra = extra;
+  _ltowed.clear();
+  _ltesi.clear();
+  for (offset_t at = 0; at < size; at += this->ltblock())
+    _ltowed[at] = this->ltrun(at, true);
+  scr.msg("Multicasting %s as %zu fountain coded blocks, %d%% extra",
+          this->localfname().c_str(), _ltowed.size(), extra);
+}
+
+// The file goes to the group once and after that the holes the
+// receivers ask for. DATA is compressed from the start if we offer it,
+// any receiver can expand it
+void
+tran::nakput()
+{
+  _multicast = true;
+  _deltawait = false;
+  if (this->compress() == F_COMPRESS_YES)
+    _zdata = true;
+  scr.msg("Multicasting %s, receivers ask for what they lose",
+          this->localfname().c_str());
+}
+
+// Read in the block at offset to encode from
+bool
+tran::ltload(offset_t at)
+{
+  size_t len =
+    (size_t)min((offset_t)this->ltblock(), _local->filesize() - at);
+  char* buf = _ltout.setup(len, symbol::maxsymlen);
+
+  if (_local->pread(buf, len, at) != (ssize_t)len) {
+    scr.error("tran::ltload(): Cannot read %s at %" PRIu64 "",
+              this->localfname().c_str(), (uint64_t)at);
+    _ltout.setup(0, 1);
+    return false;
+  }
+  _ltat = at;
+  this->csumadvance(buf, len, at);
+  return true;
+}
+
+// Send up to maxbuff bytes of the symbols owed the lowest block. Each
+// run of a block carries on from the symbols sent before, so every one
+// is new to every receiver
+bool
+tran::sendsymbols(size_t maxbuff)
+{
+  if (_ltowed.empty())
+    return false;
+  std::map<offset_t, uint32_t>::iterator b = _ltowed.begin();
+  if ((_ltat != b->first || _ltout.blen() == 0) && !this->ltload(b->first)) {
+    _ltowed.erase(b);
+    return (!_ltowed.empty());
+  }
+  for (size_t sent = 0; b->second > 0 && sent < maxbuff; b->second--) {
+    uint32_t esi = _ltesi[b->first]++;
+    saratoga::symbol* y =
+      new symbol(this->descriptor(), this->session(), b->first, _ltout, esi);
+    if (y->badframe() || y->tx(this->peer()) != (ssize_t)y->paylen()) {
+      scr.error("tran::sendsymbols(): Bad SYMBOL frame");
+      delete y;
+      return false;
+    }
+    scr.debug(7, "tran::sendsymbols(): %s", y->print().c_str());
+    sent += y->paylen();
+    delete y;
+  }
+  if (b->second == 0) {
+    scr.msgout("Sent SYMBOL Frames to #%" PRIu32 " for Offset=%" PRIu64 "",
+               _ltesi[b->first], (uint64_t)b->first);
+    _ltowed.erase(b);
+  }
+  _transfertimer.reset();
+  return true;
+}
+
+// Send a buffer as compressed DATA. Each frame is as much of the buffer
+// as deflates into one frame, tried whole and then scaled down to fit
+// by how well that went. What will not shrink goes uncompressed
+void
+tran::sendcompressed(saratoga::buffer* b)
+{
+  size_t framesize = this->framesize();
+  char zbuf[data::maxframesize];
+  const char* buf = b->buf();
+  size_t left = b->len();
+  offset_t offset = b->offset();
+
+  size_t maxblock = zblock::maxblock;
+
+  while (left > 0) {
+    size_t len = min(left, maxblock);
+    size_t zlen = 0;
+    for (int tries = 0; tries < 3 && len > 0; tries++) {
+      zlen = zblocks.compress(buf, len, zbuf, framesize);
+      if (zlen == 0 || zlen <= framesize)
+        break;
+      len = (size_t)((uint64_t)len * framesize / zlen * 7 / 8);
+    }
+    bool z = (zlen > 0 && zlen <= framesize && zlen < len);
+    if (!z)
+      len = min(left, framesize);
+    saratoga::data* d = new data(
+      this->descriptor(), this->transfer(), this->reqstatus(), this->eod(),
+      this->reqtstamp(), this->session(), offset, z ? zbuf : buf,
+      z ? zlen : len);
+    if (z)
+      d->compress(F_COMPRESS_YES);
+    if (d->badframe() || d->tx(this->peer()) != (ssize_t)d->paylen()) {
+      scr.error("tran::sendcompressed(): Bad DATA frame");
+      delete d;
+      return;
+    }
+    scr.msgout("Sent DATA Frame: Length=%zu of %zu Offset=%" PRIu64 "",
+               z ? zlen : len, len, offset);
+    scr.debug(7, "tran::sendcompressed(): Frame %s", d->print().c_str());
+    this->fecadd(d, len);
+    delete d;
+    buf += len;
+    left -= len;
+    offset += len;
+  }
+  _offset = offset;
+  this->csumadvance(b->buf(), b->len(), b->offset());
+}
+
+// Carry the running checksum on with a buffer at offset off. Sending,
+// that is the buffer just read for DATA and once the whole file has
+// gone by the checksum goes out in a fresh METADATA. Receiving, the
+// buffer is the DATA just written and anything that was already on disk
+// beyond it is read back so the hash keeps up with the completed prefix
+void
+tran::csumadvance(const char* buf, size_t len, offset_t off)
+{
+  if (_csumdone || _csumstream.csumtype() == checksums::CSUM_NONE)
+    return;
+  if (len > 0)
+    _csumstream.update(buf, len, off);
+
+  if (_dir == TO_SOCKET) {
+    if ((offset_t)_csumstream.fed() < _local->filesize())
+      return;
+    this->csumready(_csumstream.result());
+    _local->csumcache();
+    return;
+  }
+
+  // How far from 0 is written with no gaps
+  if (_completed.count() == 0)
+    return;
+  std::list<hole>::iterator first = _completed.first();
+  if (first->starts() != 0)
+    return;
+  offset_t prefix = first->ends() + 1;
+  if ((offset_t)_csumstream.fed() >= prefix)
+    return;
+
+  checksums::csumbuf cbuf;
+  if (!cbuf.ok()) {
+    scr.error("tran::csumadvance(): No memory to read back %s",
+              this->localfname().c_str());
+    return;
+  }
+  while ((offset_t)_csumstream.fed() < prefix) {
+    offset_t at = _csumstream.fed();
+    size_t n = (size_t)min((offset_t)checksums::csum_buflen, prefix - at);
+    ssize_t got = _local->pread(cbuf.buf(), n, at);
+    if (got <= 0)
+      return;
+    _csumstream.update(cbuf.buf(), got, at);
+  }
+}
+
+// We are sending and now know the checksum of the file
+void
+tran::csumready(const checksums::checksum& c)
+{
+  if (_csumdone || _dir != TO_SOCKET)
+    return;
+  _local->setcsum(c);
+  checksums::checksum csum = c;
+  _csumtype = tocsumflag(csum.csumtype());
+  _csumlen = tocsumlen(csum.csumtype());
+  scr.debug(3, "tran::csumready(): %s checksum is %s",
+            this->localfname().c_str(), csum.print().c_str());
+  _csumdone = true;
+  this->sendmetadata();
+}
+
+// When the METADATA names a file we already hold under another name,
+// same size and same checksum, take it from there rather than over the
+// link. The whole file is then complete and the STATUS sent in reply
+// to the METADATA tells the sender so
+bool
+tran::dedup()
+{
+  offset_t size = _local->filesize();
+
+  if (size == 0)
+    return false;
+  string same = sarfile::fsame(c_home.dir(), size, _local->csum());
+  if (same == "" || same == this->localfname())
+    return false;
+  if (!_local->clonefrom(same))
+    return false;
+  scr.msg("Already have %s as %s, not transferring it",
+          this->localfname().c_str(), same.c_str());
+  hole whole(0, size);
+  _holes.clear();
+  _completed.clear();
+  _completed += whole;
+  _offset = size;
+  _curprogress = size;
+  _csumdone = true;
+  _done = true;
+  _errcode = F_ERRCODE_SUCCESS;
+  _local->csumcache();
+  this->partdone();
+  return true;
+}
+
+// Once the whole file has been hashed and the METADATA has told us what
+// the checksum should be, check it
+void
+tran::csumverify()
+{
+  if (_csumdone || _dir != FROM_SOCKET ||
+      this->metadatarecvd() != F_METADATARECVD_YES)
+    return;
+  checksums::checksum want = _local->csum();
+  if (want.csumtype() == checksums::CSUM_NONE ||
+      want.csumtype() != _csumstream.csumtype() ||
+      (offset_t)_csumstream.fed() != _local->filesize())
+    return;
+  _csumdone = true;
+  checksums::checksum got = _csumstream.result();
+  if (got.strval() != want.strval()) {
+    scr.error("Checksum mismatch on %s received %s expected %s",
+              this->localfname().c_str(), got.print().c_str(),
+              want.print().c_str());
+    _errcode = F_ERRCODE_UNSPEC;
+    return;
+  }
+  scr.msg("Checksum verified for %s %s", this->localfname().c_str(),
+          got.print().c_str());
+  // We may well send it on
+  _local->csumcache();
+}
+
+// Collect whatever the checksum threads have finished. Each is cached
+// and given to the transfer sending that file, if it is still going
+void
+transfers::csumready()
+{
+  CSUMPOOL_Result r;
+
+  while (CSUMPOOL_Collect(&r)) {
+    string fname = r.fname;
+    free(r.fname);
+    if (r.error != 0) {
+      scr.perror(r.error, "Cannot checksum %s", fname.c_str());
+      continue;
+    }
+    checksums::checksum c((enum checksums::csum_type)r.type, r.value);
+    sarcsums.add(r, c);
+    for (std::list<saratoga::tran>::iterator t = _transfers.begin();
+         t != _transfers.end(); t++) {
+      if (t->dir() == TO_SOCKET && t->session() == (session_t)r.tag &&
+          t->localfname() == fname)
+        t->csumready(c);
+    }
+  }
 }
 
 // We have received a request. Add the transfer to the list
@@ -491,7 +1337,10 @@ transfers::match(session_t sess, sarnet::udp* addr, direction dir)
     sarnet::ip paip(peer->straddr());
     sarnet::ip adip(addr->straddr());
 
-    if ((t->session() == sess) && (paip == adip)) {
+    // Any of a multipath peer's addresses is the peer
+    if ((t->session() == sess) &&
+        (paip == adip ||
+         c_multipath.same(peer->straddr(), addr->straddr()))) {
       scr.debug(7,
                 "transfers::match(): Found Transfer %s Session %" PRIu32 "  %s",
                 dirprint.c_str(), (uint32_t)sess, addr->straddr().c_str());
@@ -516,6 +1365,17 @@ transfers::match(sarfile::fileio* localfile)
   return (nullptr);
 }
 
+// Return pointer to the multicast put we are sending for the session
+saratoga::tran*
+transfers::mmatch(session_t sess)
+{
+  for (std::list<saratoga::tran>::iterator t = sartransfers.begin();
+       t != sartransfers.end(); t++)
+    if (t->session() == sess && t->multicast() && t->dir() == TO_SOCKET)
+      return (&(*t));
+  return (nullptr);
+}
+
 // Handle received REQUEST frames
 saratoga::tran*
 transfers::rxrequest(saratoga::request* req, sarnet::udp* sock)
@@ -605,8 +1465,30 @@ tran::applymetadata(saratoga::metadata* met)
   }
   // Set the local files metadata equivalent to the received METADATA
   _local->setdir(met->dir());
+  // We can always expand it so take up any offer to compress
+  _compress = met->compress();
+  if (met->mcast() == F_MCAST_YES && !_multicast) {
+    scr.msg("Session %" PRIu32 " is multicast, asking only for what is lost",
+            this->session());
+    _multicast = true;
+  }
   _errcode = F_ERRCODE_SUCCESS;
   _metadatarecvd = F_METADATARECVD_YES; // We have received a valid METADATA
+  if (met->csumtype() != F_CSUM_NONE) {
+    // Keep what it should be and hash with the senders type
+    _local->setcsum(met->checksum());
+    // Nothing to transfer if we have the file already
+    if (!_done && this->dedup())
+      return;
+    if (_csumstream.csumtype() != met->checksum().csumtype()) {
+      scr.debug(3, "applymetadata: Restarting checksum as %s",
+                Fcsumtype(met->csumtype()).print().c_str());
+      _csumstream.reset(met->checksum().csumtype());
+      this->csumadvance(nullptr, 0, 0);
+    }
+    this->csumverify();
+  }
+  this->groupholes();
   return;
 }
 
@@ -650,64 +1532,112 @@ transfers::rxmetadata(saratoga::metadata* met, sarnet::udp* sock)
         char		*payload
  */
 void
-tran::applydata(saratoga::data* dat)
+tran::applydata(const saratoga::dataview& dat)
 {
 
-  if (dat->descriptor() != this->descriptor()) {
+  if (dat.descriptor() != this->descriptor()) {
     scr.error("applydata:: Transfer Descriptor mismatch");
     _errcode = F_ERRCODE_BADDESC;
     return;
   }
-  if (dat->transfer() != this->transfer()) {
+  if (dat.transfer() != this->transfer()) {
     scr.error("applydata:: Transfer Type mismatch");
     _errcode = F_ERRCODE_BADFLAG;
     return;
   }
-  if (dat->reqtstamp() != this->reqtstamp()) {
+  if (dat.reqtstamp() != this->reqtstamp()) {
     scr.error("applydata:: Timestamps not enabled mismatch");
     _errcode = F_ERRCODE_BADFLAG;
     return;
   }
-  _reqstatus = dat->reqstatus();
-  _eod = dat->eod();
+  _reqstatus = dat.reqstatus();
+  _eod = dat.eod();
   // Check the session number
-  if (dat->session() != this->session()) {
+  if (dat.session() != this->session()) {
     scr.error("applydata: Session Number mismatch %" PRIu32 " != %" PRIu32 "",
-              dat->session(), _session);
+              dat.session(), _session);
     _errcode = F_ERRCODE_NOID;
     return;
   }
 
+  // Already complete, the frame is a late duplicate
+  if (_done)
+    return;
+
+  // Kept in case a REPAIR needs it to rebuild a lost neighbour, once the
+  // sender is sending them
+  bool z = (dat.compress() == F_COMPRESS_YES);
+  if (_fecin.active())
+    _fecin.keep(dat.offset(), dat.dbuf(), dat.dbuflen(), z);
+  this->applypayload(dat.offset(), dat.dbuf(), dat.dbuflen(), z);
+}
+
+// Write a DATA payload at offset, as received or rebuilt from REPAIR
+// frames, and account for it
+void
+tran::applypayload(offset_t offset, const char* dbuf, size_t dbuflen, bool z)
+{
+  // A compressed block is expanded first, one that will not is dropped
+  // and stays a hole to be sent again
+  static char zbuf[zblock::maxblock];
+  if (z) {
+    ssize_t n = zblocks.expand(dbuf, dbuflen, zbuf, sizeof(zbuf));
+    if (n < 0) {
+      scr.error("applydata: Bad compressed DATA at offset %" PRIu64 "",
+                (uint64_t)offset);
+      return;
+    }
+    dbuf = zbuf;
+    dbuflen = (size_t)n;
+  }
+
   // Seek to the local file offset position to write to
-  //	scr.debug(2, "applydata:: Will Seek to %" PRIu64 " and write %" PRIu64 "
-  //bytes to %s",
-  //		dat->offset(),
-  //		dat->dbuflen(),
-  //		_local->fname().c_str());
-  _local->fwrite(dat->dbuf(), dat->dbuflen(), dat->offset());
-  hole databuf(dat->offset(), dat->dbuflen());
+  // Write it straight out of the receive buffer, no copy queued
+  if (_local->pwrite(dbuf, dbuflen, offset) != (ssize_t)dbuflen) {
+    _errcode = F_ERRCODE_NORECEIVE;
+    return;
+  }
+  hole databuf(offset, dbuflen);
   // Remove the hole if it is within our current list of holes
   _holes -= databuf;
   // Add the buffer to our list of completed holes
   _completed += databuf;
+  this->csumadvance(dbuf, dbuflen, offset);
+  this->csumverify();
+
+  // Receiving from a group every byte not written yet has been a hole
+  // since the METADATA came, so they are right as they are
+  if (_multicast) {
+    _heard.reset();
+    if (this->metadatarecvd() == F_METADATARECVD_YES) {
+      if (!this->complete()) {
+        std::list<hole>::iterator first = _completed.first();
+        _curprogress = (first->starts() == 0) ? first->ends() : 0;
+      }
+      _errcode = F_ERRCODE_SUCCESS;
+      return;
+    }
+  }
+
+  // Every gap ahead of the last of what we have is a hole, one at the
+  // start too. Past that nothing is, it may be on its way
+  offset_t next = 0;
+  for (std::list<hole>::iterator i = _completed.first(); i != _completed.last();
+       i++) {
+    if (i->starts() > next) {
+      hole gap(next, i->starts() - next);
+      _holes += gap;
+    }
+    next = i->ends() + 1;
+  }
 
   std::list<hole>::iterator firstcompleted = _completed.first();
   if (_holes.count() == 0) {
     // We have no holes, have received our METADATA
     // and the remaining completed is the size of our file
     // We are done
-    if (_completed.count() == 1 &&
-        this->metadatarecvd() == F_METADATARECVD_YES &&
-        firstcompleted->starts() == 0 &&
-        firstcompleted->ends() == _local->filesize()) {
-      scr.msg("Successfully completed transfer of session %" PRIu32 "",
-              this->session());
-      _offset = _local->filesize();
-      _curprogress = _local->filesize();
-      _done = true;
-      _errcode = F_ERRCODE_SUCCESS;
+    if (this->complete())
       return;
-    }
     // Our offset is at the end of our first completed buffer
     _curprogress = firstcompleted->ends();
   } else // We have multiple holes (holes.count() > 0)
@@ -717,45 +1647,309 @@ tran::applydata(saratoga::data* dat)
                                                       firstcompleted->ends();
   }
 
-  // Add a hole from the current offset to the beginning of the next completed -
-  // 1
-  // We dont add a hole to the end
-  for (std::list<hole>::iterator i = _completed.first(); i != _completed.last();
-       i++) {
-    offset_t startofhole = dat->offset() + dat->dbuflen();
-    offset_t endofhole = 0;
-    if (i->starts() > startofhole) {
-      endofhole = i->starts() - 1;
-      hole newhole(startofhole, endofhole);
-      _holes += newhole;
-    }
-  }
   _errcode = F_ERRCODE_SUCCESS;
   return;
 }
 
+// Receiving, we are done once the METADATA is in and the file is
+// written from 0 to the end with no holes
+bool
+tran::complete()
+{
+  if (_holes.count() != 0 || _completed.count() != 1 ||
+      this->metadatarecvd() != F_METADATARECVD_YES)
+    return false;
+  std::list<hole>::iterator first = _completed.first();
+  if (first->starts() != 0 || first->ends() + 1 != _local->filesize())
+    return false;
+  scr.msg("Successfully completed transfer of session %" PRIu32 "",
+          this->session());
+  _offset = _local->filesize();
+  _curprogress = _local->filesize();
+  _done = true;
+  this->partdone();
+  return true;
+}
+
+// A file built beside an old copy replaces it, unless the checksum
+// says it went wrong in which case the old one stays
+void
+tran::partdone()
+{
+  if (_finalname == "")
+    return;
+  if (_basis >= 0)
+    close(_basis);
+  _basis = -1;
+  if (_errcode.get() == F_ERRCODE_SUCCESS)
+    _local->frename(_finalname);
+  else
+    scr.error("Keeping the old %s, the new one did not arrive intact",
+              _finalname.c_str());
+  _finalname = "";
+}
+
 // Handle received DATA frames
 saratoga::tran*
-transfers::rxdata(saratoga::data* dat, sarnet::udp* sock)
+transfers::rxdata(const saratoga::dataview& dat, sarnet::udp* sock)
 {
   saratoga::tran* t;
   string sockinfo = sock->print();
 
   scr.debug(5, "transfers::rxdata(): RX DATA from %s", sockinfo.c_str());
   // Find what transfer this data is applicable to
-  if ((t = this->match(dat->session(), sock, FROM_SOCKET)) == nullptr) {
+  if ((t = this->match(dat.session(), sock, FROM_SOCKET)) == nullptr) {
     scr.error("Transfer session %" PRIu32 " for %s does not exist",
-              (uint32_t)dat->session(), sockinfo.c_str());
+              (uint32_t)dat.session(), sockinfo.c_str());
     return (nullptr);
   }
   // Apply all of the appropriate flags to the transfer class
   scr.debug(9, "transfers::rxdata(): Found transfer session %" PRIu32 " for %s",
-            (uint32_t)dat->session(), sockinfo.c_str());
-  scr.debug(7, dat->print());
+            (uint32_t)dat.session(), sockinfo.c_str());
+  scr.debug(7, dat.print());
   t->applydata(dat);
   return (t);
 }
 
+// Collect the signatures of the new file and once they are all here
+// build what we can of it from our old copy
+void
+tran::applysignature(saratoga::signature* sig)
+{
+  if (_dir != FROM_SOCKET || _basis < 0 || _delta || _done)
+    return;
+  if (sig->session() != this->session()) {
+    scr.error("applysignature: Session Number mismatch %" PRIu32
+              " != %" PRIu32 "",
+              sig->session(), this->session());
+    return;
+  }
+  // The signatures are of the file the METADATA told us of, anything else
+  // and we receive all of it
+  if (this->metadatarecvd() != F_METADATARECVD_YES ||
+      sig->filesize() != _local->filesize()) {
+    scr.error("applysignature: Signatures for %" PRIu64
+              " bytes not the %" PRIu64 " of %s",
+              (uint64_t)sig->filesize(), (uint64_t)_local->filesize(),
+              _finalname.c_str());
+    return;
+  }
+  if (!_sigs.expect(sig->filesize(), sig->blocksize(), sig->nblocks()))
+    return;
+  for (uint32_t i = 0; i < sig->count(); i++)
+    _sigs.add(sig->first() + i, sig->weak(i), sig->strong(i));
+  if (_sigs.complete())
+    this->applydelta();
+}
+
+// Copy every block we found in the old copy into place and tell the
+// sender the holes that are left
+void
+tran::applydelta()
+{
+  std::vector<blockmatch> found;
+  std::list<hole> done;
+  std::list<hole> missing;
+  offset_t size = _sigs.filesize();
+  offset_t copied = 0;
+
+  size_t nmatched = _sigs.match(_basis, found);
+  for (std::vector<blockmatch>::iterator i = found.begin(); i != found.end();
+       i++) {
+    if (_local->copyfrom(_basis, i->from, i->len, i->to) != (ssize_t)i->len)
+      break;
+    done.push_back(hole(i->to, i->len));
+    copied += i->len;
+  }
+  close(_basis);
+  _basis = -1;
+  _delta = true;
+  _completed.add(done);
+
+  // What is left the sender has to send
+  offset_t at = 0;
+  for (std::list<hole>::iterator i = _completed.first();
+       i != _completed.last(); i++) {
+    if (i->starts() > at)
+      missing.push_back(hole(at, i->starts() - at));
+    at = i->ends() + 1;
+  }
+  if (at < size)
+    missing.push_back(hole(at, size - at));
+  // Too many to fit in a STATUS then ask for everything from the first
+  if (missing.size() > maxdeltaholes) {
+    offset_t from = missing.front().starts();
+    missing.clear();
+    missing.push_back(hole(from, size - from));
+  }
+  _holes.clear();
+  _holes.add(missing);
+  scr.msg("Built %" PRIu64 " of %" PRIu64 " bytes of %s from %zu of %" PRIu32
+          " blocks of the old copy",
+          (uint64_t)copied, (uint64_t)size, _finalname.c_str(), nmatched,
+          _sigs.nblocks());
+  _sigs.clear();
+
+  this->csumadvance(nullptr, 0, 0);
+  this->csumverify();
+  if (!this->complete())
+    _curprogress = missing.empty() ? size : missing.front().starts();
+  this->sendstatus();
+}
+
+// Handle received SIGNATURE frames
+saratoga::tran*
+transfers::rxsignature(saratoga::signature* sig, sarnet::udp* sock)
+{
+  saratoga::tran* t;
+  string sockinfo = sock->print();
+
+  scr.debug(5, "transfers::rxsignature(): RX SIGNATURE from %s",
+            sockinfo.c_str());
+  if ((t = this->match(sig->session(), sock, FROM_SOCKET)) == nullptr) {
+    scr.error("Transfer session %" PRIu32
+              " for %s does not exist, discarding frame",
+              (uint32_t)sig->session(), sockinfo.c_str());
+    return (nullptr);
+  }
+  t->applysignature(sig);
+  return (t);
+}
+
+// Rebuild any DATA of the group the REPAIR covers that has not arrived
+void
+tran::applyrepair(saratoga::repair* rep)
+{
+  std::vector<fecblock> rebuilt;
+
+  if (rep->descriptor() != this->descriptor()) {
+    scr.error("applyrepair:: Transfer Descriptor mismatch");
+    return;
+  }
+  if (_done || !_fecin.add(*rep, rebuilt))
+    return;
+  scr.msg("Rebuilt %zu lost DATA frames of session %" PRIu32
+          " from REPAIR frames",
+          rebuilt.size(), this->session());
+  for (size_t i = 0; i < rebuilt.size() && !_done; i++)
+    if (!rebuilt[i].payload.empty())
+      this->applypayload(rebuilt[i].offset, &rebuilt[i].payload[0],
+                         rebuilt[i].payload.size(), rebuilt[i].z);
+}
+
+saratoga::tran*
+transfers::rxrepair(saratoga::repair* rep, sarnet::udp* sock)
+{
+  saratoga::tran* t;
+  string sockinfo = sock->print();
+
+  scr.debug(5, "transfers::rxrepair(): RX REPAIR from %s", sockinfo.c_str());
+  if ((t = this->match(rep->session(), sock, FROM_SOCKET)) == nullptr) {
+    scr.error("Transfer session %" PRIu32
+              " for %s does not exist, discarding frame",
+              (uint32_t)rep->session(), sockinfo.c_str());
+    return (nullptr);
+  }
+  t->applyrepair(rep);
+  return (t);
+}
+
+// Receiving a multicast put, whatever is not written or decoded yet is
+// a hole so our STATUS tells the sender what we still need
+void
+tran::groupholes()
+{
+  if (!_multicast || _dir != FROM_SOCKET || _done ||
+      this->metadatarecvd() != F_METADATARECVD_YES)
+    return;
+  offset_t size = _local->filesize();
+  _holes.clear();
+  if (size > 0) {
+    hole whole(0, size);
+    _holes += whole;
+  }
+  for (std::list<hole>::iterator i = _completed.first(); i != _completed.last();
+       i++) {
+    hole got = *i;
+    _holes -= got;
+  }
+  this->complete();
+}
+
+// Add a symbol to the decoder for its block and write the block out
+// once it is decoded. Blocks can finish in any order
+void
+tran::applysymbol(saratoga::symbol* sym)
+{
+  if (sym->descriptor() != this->descriptor()) {
+    scr.error("applysymbol:: Transfer Descriptor mismatch");
+    _errcode = F_ERRCODE_BADDESC;
+    return;
+  }
+  if (_done || _dir != FROM_SOCKET)
+    return;
+  if (!_fountain) {
+    _fountain = true;
+    _multicast = true;
+    this->groupholes();
+  }
+  offset_t at = sym->offset();
+  if (_ltdone.find(at) != _ltdone.end())
+    return;
+  std::map<offset_t, ltdecoder>::iterator d = _ltin.find(at);
+  if (d == _ltin.end()) {
+    d = _ltin.insert(std::make_pair(at, ltdecoder())).first;
+    d->second.setup(sym->blocklen(), sym->symlen());
+  } else if (d->second.blen() != sym->blocklen() ||
+             d->second.symlen() != sym->symlen()) {
+    scr.error("applysymbol: SYMBOL does not fit the block at offset %" PRIu64
+              "",
+              (uint64_t)at);
+    return;
+  }
+  if (!d->second.add(sym->esi(), sym->sym()))
+    return;
+  scr.msg("Decoded the block at offset %" PRIu64 " of session %" PRIu32
+          " from %" PRIu32 " symbols",
+          (uint64_t)at, this->session(), d->second.received());
+  _ltdone.insert(at);
+  size_t len = d->second.blen();
+  if (_local->pwrite(d->second.block(), len, at) != (ssize_t)len) {
+    _errcode = F_ERRCODE_NORECEIVE;
+    _ltin.erase(d);
+    return;
+  }
+  hole got(at, len);
+  _holes -= got;
+  _completed += got;
+  _heard.reset();
+  this->csumadvance(d->second.block(), len, at);
+  _ltin.erase(d);
+  this->csumverify();
+  if (this->complete())
+    return;
+  std::list<hole>::iterator first = _completed.first();
+  _curprogress = (first->starts() == 0) ? first->ends() : 0;
+  _errcode = F_ERRCODE_SUCCESS;
+}
+
+saratoga::tran*
+transfers::rxsymbol(saratoga::symbol* sym, sarnet::udp* sock)
+{
+  saratoga::tran* t;
+  string sockinfo = sock->print();
+
+  scr.debug(9, "transfers::rxsymbol(): RX SYMBOL from %s", sockinfo.c_str());
+  if ((t = this->match(sym->session(), sock, FROM_SOCKET)) == nullptr) {
+    scr.error("Transfer session %" PRIu32
+              " for %s does not exist, discarding frame",
+              (uint32_t)sym->session(), sockinfo.c_str());
+    return (nullptr);
+  }
+  t->applysymbol(sym);
+  return (t);
+}
+
 // These are what we check & apply to a transfer when recieve a STATUS
 /*
  sarflags:
@@ -775,10 +1969,17 @@ transfers::rxdata(saratoga::data* dat, sarnet::udp* sock)
  */
 // Apply the STATUS to the transfer
 void
-tran::applystatus(saratoga::status* sta)
+tran::applystatus(const saratoga::statusview& sta)
 {
+  if (_multicast && _dir == TO_SOCKET) {
+    if (_fountain)
+      this->fountainstatus(sta);
+    else
+      this->nakstatus(sta);
+    return;
+  }
   // If we have received an error code then return it jump back and rx it
-  _errcode = sta->errcode();
+  _errcode = sta.errcode();
   if (_errcode.get() != F_ERRCODE_SUCCESS) {
     scr.error("rxstatus: Status Error code received");
     _rxstatus = false;
@@ -787,7 +1988,7 @@ tran::applystatus(saratoga::status* sta)
   }
 
   // Descriptor mismatch
-  if (sta->descriptor() != this->descriptor()) {
+  if (sta.descriptor() != this->descriptor()) {
     scr.error("transfers::rxstatus(): Transfer Descriptor mismatch");
     _rxstatus = false;
     _ready = false;
@@ -795,10 +1996,10 @@ tran::applystatus(saratoga::status* sta)
     return;
   }
   // Session # mismatch
-  if (sta->session() != this->session()) {
+  if (sta.session() != this->session()) {
     scr.error("transfers::rxstatus(): Session Number mismatch %" PRIu32
               " != %" PRIu32 "",
-              sta->session(), this->session());
+              sta.session(), this->session());
     _rxstatus = false;
     _ready = false;
     _errcode = F_ERRCODE_NOID;
@@ -808,26 +2009,55 @@ tran::applystatus(saratoga::status* sta)
   // If the remote end has not received a METADATA and
   // we are the end sending the local file then send the METADATA
   // for the local file
-  _metadatarecvd = sta->metadatarecvd();
+  _metadatarecvd = sta.metadatarecvd();
   if ((_metadatarecvd.get() == F_METADATARECVD_NO) &&
       (_local->rorw() == sarfile::FILE_READ)) {
     scr.debug(5, "transfers::rxstatus(): Send a METADATA");
     this->sendmetadata();
+    if (_deltawait && _sigs.empty())
+      this->sendsignatures();
   }
 
-  _allholes = sta->allholes();
-  _reqholes = sta->reqholes();
-  _curprogress = sta->progress();
-  _inresponseto = sta->inresponseto();
+  _allholes = sta.allholes();
+  _reqholes = sta.reqholes();
+  _curprogress = sta.progress();
+  _inresponseto = sta.inresponseto();
 
   // Copy the timestmap if we have one
-  if (sta->reqtstamp() == F_TIMESTAMP_YES) {
+  if (sta.reqtstamp() == F_TIMESTAMP_YES) {
     scr.debug(2, "removing lastrxtstamp %s", _lastrxtstamp.asctime().c_str());
-    _lastrxtstamp = sta->tstamp();
+    _lastrxtstamp = sta.tstamp();
   }
   // Add the holes from this status into the transfer holes
-  if (sta->holesptr() != nullptr)
-    _holes += *(sta->holesptr());
+  if (sta.holecount() > 0)
+    sta.getholes(&_holes);
+  this->probestatus(sta);
+  // The first STATUS to have our METADATA after the signatures went
+  // says what to send. Holes if the receiver built from an old copy,
+  // none if it wants the whole file
+  if (_deltawait && _metadatarecvd.get() == F_METADATARECVD_YES) {
+    _deltawait = false;
+    _delta = (sta.holecount() > 0);
+    if (_delta)
+      scr.msg("Sending only the changes to %s", this->localfname().c_str());
+    _local->ready(true);
+  }
+  // More holes to send
+  if (_delta && sta.holecount() > 0)
+    _local->ready(true);
+  // Repairs follow the loss, the holes outstanding are what got past them
+  if (_fecout.on()) {
+    offset_t lost = 0;
+    for (size_t i = 0; i < sta.holecount(); i++)
+      lost += sta.holeend(i) - sta.holestart(i) + 1;
+    _fecout.observe(lost);
+  }
+  // The receiver has taken up our offer to compress
+  if (!_zdata && this->compress() == F_COMPRESS_YES &&
+      sta.compress() == F_COMPRESS_YES) {
+    scr.msg("Compressing the data of %s", this->localfname().c_str());
+    _zdata = true;
+  }
   // All is good there are no errors here
   _rxstatus = true;     // We have received a valid status frame
   _ready = true;        // We are a good status so ready to receive data
@@ -835,26 +2065,113 @@ tran::applystatus(saratoga::status* sta)
   _errcode = F_ERRCODE_SUCCESS;
 }
 
+// A STATUS from one of the receivers of our multicast put. A block it
+// is still missing gets one more run of symbols unless one is on its
+// way already, so however many receivers lost symbols of a block one
+// run serves them all. A receiver with an error is left out, the rest
+// carry on
+void
+tran::fountainstatus(const saratoga::statusview& sta)
+{
+  if (sta.errcode() != F_ERRCODE_SUCCESS)
+    return;
+  if (sta.descriptor() != this->descriptor()) {
+    scr.error("transfers::rxstatus(): Transfer Descriptor mismatch");
+    return;
+  }
+  _metadatarecvd = sta.metadatarecvd();
+  if (_metadatarecvd.get() == F_METADATARECVD_NO) {
+    scr.debug(5, "transfers::rxstatus(): Send a METADATA");
+    this->sendmetadata();
+  }
+  _curprogress = sta.progress();
+  _inresponseto = sta.inresponseto();
+
+  offset_t size = _local->filesize();
+  offset_t bs = this->ltblock();
+  size_t was = _ltowed.size();
+  for (size_t i = 0; i < sta.holecount(); i++)
+    for (offset_t at = sta.holestart(i) / bs * bs;
+         at <= sta.holeend(i) && at < size; at += bs)
+      if (_ltowed.find(at) == _ltowed.end())
+        _ltowed[at] = this->ltrun(at, false);
+  if (_ltowed.size() > was) {
+    scr.msg("Sending %zu more runs of symbols for session %" PRIu32 "",
+            _ltowed.size() - was, this->session());
+    _local->ready(true);
+  }
+  _rxstatus = true;
+  _transfertimer.reset();
+  _statustimer.reset();
+}
+
+// A STATUS from one of the receivers of our NAK put. Its holes join
+// those the others asked for, so a range lost by many goes again once.
+// What has not gone out yet is still to come and what was sent lately
+// may have crossed the STATUS, neither is sent again for it
+void
+tran::nakstatus(const saratoga::statusview& sta)
+{
+  if (sta.errcode() != F_ERRCODE_SUCCESS)
+    return;
+  if (sta.descriptor() != this->descriptor()) {
+    scr.error("transfers::rxstatus(): Transfer Descriptor mismatch");
+    return;
+  }
+  bool lately = !_holdoff.elapsed();
+  if (!lately)
+    _mrecent.clear();
+  _metadatarecvd = sta.metadatarecvd();
+  if (_metadatarecvd.get() == F_METADATARECVD_NO && !lately) {
+    scr.debug(5, "transfers::rxstatus(): Send a METADATA");
+    this->sendmetadata();
+    _holdoff.reset();
+  }
+  _curprogress = sta.progress();
+  _inresponseto = sta.inresponseto();
+
+  holes h;
+  offset_t size = _local->filesize();
+  sta.getholes(&h);
+  if (_sentto < size) {
+    hole ahead(_sentto, size - _sentto);
+    h -= ahead;
+  }
+  h -= _mrecent;
+  h -= _holes;
+  if (h.count() > 0) {
+    _holes += h;
+    scr.msg("Repairing %zu more holes of session %" PRIu32 "", h.count(),
+            this->session());
+    _local->ready(true);
+  }
+  _rxstatus = true;
+  _transfertimer.reset();
+  _statustimer.reset();
+}
+
 // Handle received STATUS frames and update the transfer variables
 // Return back poiner to tran or nullptr if can't find one
 saratoga::tran*
-transfers::rxstatus(saratoga::status* sta, sarnet::udp* sock)
+transfers::rxstatus(const saratoga::statusview& sta, sarnet::udp* sock)
 {
   saratoga::tran* t;
   string sockinfo = sock->print();
 
   scr.debug(5, "transfers::rxstatus(): RX STATUS from %s", sockinfo.c_str());
-  // Find what transfer this status is applicable to
-  if ((t = this->match(sta->session(), sock, FROM_SOCKET)) == nullptr) {
+  // Find what transfer this status is applicable to, any receiver of a
+  // multicast put we are sending can send us one
+  if ((t = this->mmatch(sta.session())) == nullptr &&
+      (t = this->match(sta.session(), sock, FROM_SOCKET)) == nullptr) {
     scr.error("Transfer session %" PRIu32 " for %s does not exist",
-              (uint32_t)sta->session(), sockinfo.c_str());
+              (uint32_t)sta.session(), sockinfo.c_str());
     return (nullptr);
   }
   // Apply all of the appropriate flags to the transfer class
   scr.debug(3,
             "transfers::rxstatus(): Found transfer session %" PRIu32 " for %s",
-            (uint32_t)sta->session(), sockinfo.c_str());
-  // scr.debug(6, sta->print());
+            (uint32_t)sta.session(), sockinfo.c_str());
+  // scr.debug(6, sta.print());
   t->applystatus(sta);
   return t;
 }
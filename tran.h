@@ -41,21 +41,30 @@
 
 #include <cstring>
 #include <iostream>
+#include <map>
+#include <set>
 #include <string>
 using namespace std;
 
 #include "data.h"
+#include "delta.h"
+#include "fec.h"
 #include "fileio.h"
+#include "fountain.h"
 #include "frame.h"
+#include "frameview.h"
 #include "holes.h"
 #include "ip.h"
 #include "metadata.h"
 #include "metadata.h"
+#include "repair.h"
 #include "request.h"
 #include "saratoga.h"
 #include "sarflags.h"
 #include "screen.h"
+#include "signature.h"
 #include "status.h"
+#include "symbol.h"
 #include "sysinfo.h"
 #include "timer.h"
 #include "timestamp.h"
@@ -145,8 +154,103 @@ private:
   Ffreespaced _freespaced;             // What is the freespace descriptor
   Fcsumtype _csumtype;                 // Checksums
   Fcsumlen _csumlen;                   // Checksum type
+  Fcompress _compress;                 // Compression offered or accepted
   Ferrcode _errcode;                   // Current error code
   enum t_timestamp _timetype;          // What is the timestamp format
+
+  // Checksum of the file built as the data streams through, fed by the
+  // DATA read buffers when sending and by the contiguous completed prefix
+  // when receiving
+  checksums::csumstream _csumstream;
+  bool _csumdone; // Sent our checksum or verified the received one
+
+  // Delta transfers against an old copy the receiver has, see delta.h.
+  // The sender sends the signatures of its blocks after the METADATA and
+  // holds DATA until the STATUS that says what the receiver is missing.
+  // The receiver builds what it can from the old copy into a .part file
+  // which takes the old one's name when it is complete
+  blocksigs _sigs;   // Signatures of the file
+  bool _deltawait;   // Sending, holding DATA for the reply to our signatures
+  bool _delta;       // Sending only holes or built from the old copy
+  int _basis;        // Receiving, the old copy or -1
+  string _finalname; // Receiving, the name of the old copy
+
+  // Compressed DATA, see compress.h. The sender offers it in METADATA
+  // and only compresses once a STATUS from the receiver takes it up
+  bool _zdata; // Sending, the receiver takes compressed DATA
+
+  // Forward error correction, see fec.h. Sending, REPAIR frames follow
+  // each group of DATA. Receiving, the recent DATA is kept to rebuild
+  // any of it that is lost from them
+  fecencoder _fecout;
+  fecdecoder _fecin;
+
+  // Path MTU probing, see udplink. Sending, one DATA at a time goes out
+  // at the size the link wants tried and the STATUS that follow say if
+  // it got there. A probe that is lost is a hole like any other
+  offset_t _probeoff; // Where the probe DATA is
+  size_t _probelen;   // Its payload, 0 if there is no probe out
+  size_t _probesize;  // The size of frame it was for the link
+  int _probestatus;   // STATUS since it went that couldn't tell
+
+  // Multipath, see cli_multipath. Sending, each DATA goes the way to the
+  // peer that gets it there soonest by what each has waiting and how fast
+  // its link goes. The STATUS fill the one hole map, so whatever is lost
+  // goes again by any of them
+  std::vector<sarnet::udp*> _paths; // Ways to the peer besides _peer
+
+  // Multicast put, see fountain.h. Sending, each block of the file goes
+  // out as a run of SYMBOL frames to the group and a STATUS from any
+  // receiver still missing a block buys one more run of it for all of
+  // them. Receiving, the symbols of each block are decoded into it
+  bool _fountain;                       // A multicast put
+  int _extra;                           // Sending, % more than k per run
+  ltencoder _ltout;                     // Sending, the block read in
+  offset_t _ltat;                       // Where that block starts
+  std::map<offset_t, uint32_t> _ltowed; // Sending, symbols to go per block
+  std::map<offset_t, uint32_t> _ltesi;  // Sending, next symbol per block
+  std::map<offset_t, ltdecoder> _ltin;  // Receiving, blocks being decoded
+  std::set<offset_t> _ltdone;           // Receiving, blocks decoded
+
+  // Either multicast put, its METADATA says so. A NAK put sends the file
+  // once to the group and then the union of the holes the receivers ask
+  // for, each range once however many lost it. A receiver holds back its
+  // STATUS for a random backoff so those that lost the same DATA do not
+  // all send at once, and leaves out what was repaired meanwhile or what
+  // it asked for lately, so it may send none at all
+  bool _multicast;             // To or from a group
+  offset_t _sentto;            // Sending, how far the first pass has got
+  holes _mrecent;              // Sending repaired, receiving asked for
+  timer_group::timer _holdoff; // How long _mrecent holds
+  timer_group::timer _backoff; // Receiving, when our STATUS may go
+  timer_group::timer _heard;   // Receiving, since DATA last came in
+  bool _nakwait;               // Receiving, a STATUS waits on _backoff
+
+  void csumadvance(const char*, size_t, offset_t);
+  void csumverify();
+  bool dedup();
+  void sendsignatures();
+  void applydelta();
+  bool complete();
+  void partdone();
+  void sendcompressed(saratoga::buffer*);
+  size_t framesize(sarnet::udp* = nullptr);
+  void openpaths();
+  sarnet::udp* pathfor();
+  size_t dataheader();
+  size_t sendprobe(saratoga::buffer*);
+  void probestatus(const saratoga::statusview&);
+  void fecadd(saratoga::data*, size_t);
+  void sendrepairs();
+  void applypayload(offset_t, const char*, size_t, bool);
+  size_t ltblock();
+  uint32_t ltrun(offset_t, bool);
+  bool ltload(offset_t);
+  void groupholes();
+  void fountainstatus(const saratoga::statusview&);
+  void nakstatus(const saratoga::statusview&);
+  void naklist(holes&);
+
 public:
   inline direction dir() { return (_dir); };
   inline requestor req() { return (_requestor); };
@@ -165,6 +269,25 @@ public:
   inline void inresponseto(offset_t i) { _inresponseto = i; };
   inline holes* holelist() { return &_holes; };
   inline holes* completedlist() { return &_completed; };
+  inline bool delta() { return (_delta); };
+  inline bool deltawait() { return (_deltawait); };
+  inline bool fountain() { return (_fountain); };
+  inline bool multicast() { return (_multicast); };
+  // Sending a multicast put with nothing left to send
+  inline bool mcastidle()
+  {
+    if (!_multicast || _dir != TO_SOCKET)
+      return false;
+    if (_fountain)
+      return (_ltowed.empty());
+    return (_holes.count() == 0 && _sentto >= _local->filesize());
+  };
+  // Receiving, hold our reply to the METADATA until the signatures are in
+  inline bool sigwait()
+  {
+    return (_dir == FROM_SOCKET && _basis >= 0 && !_delta && !_done &&
+            _metadatarecvd.get() == F_METADATARECVD_YES);
+  };
 
   // What values are set for the transfer flags
   inline enum f_version version() { return _version.get(); };
@@ -188,6 +311,7 @@ public:
   inline enum f_freespaced freespaced() { return _freespaced.get(); };
   inline enum f_csumtype csumtype() { return _csumtype.get(); };
   inline enum f_csumlen csumlen() { return _csumlen.get(); };
+  inline enum f_compress compress() { return _compress.get(); };
   inline enum f_errcode errcode() { return _errcode.get(); };
 
   // Reset the value of the transfer flags and return them
@@ -212,12 +336,15 @@ public:
   inline void freespaced(enum f_freespaced x) { _freespaced = x; };
   inline void csumtype(enum f_csumtype x) { _csumtype = x; };
   inline void csumlen(enum f_csumlen x) { _csumlen = x; };
+  inline void compress(enum f_compress x) { _compress = x; };
   inline void errcode(enum f_errcode x) { _errcode = x; };
 
   // Has our timer elapsed
   inline bool transfer_expired() { return _transfertimer.elapsed(); };
   inline bool request_expired() { return _requesttimer.elapsed(); };
   inline bool status_expired() { return _statustimer.elapsed(); };
+  // Time for our STATUS, after the backoff when receiving from a group
+  bool status_due();
 
   // Reset the timer
   inline void transfer_reset() { _transfertimer.reset(); };
@@ -227,6 +354,7 @@ public:
   // Hole handlers
   inline void holes_clear() { _holes.clear(); };
   inline void holes_add(holes* h) { _holes += *h; };
+  inline void holes_add(const statusview& s) { s.getholes(&_holes); };
 
   // Create a transfer from a received request
   tran(requestor, direction, saratoga::request*, sarnet::udp*, string);
@@ -267,14 +395,29 @@ public:
 
   bool senddata(const char*, const ssize_t&);
   void senddata(std::list<saratoga::buffer>*);
-  bool sendstatus();
+  // To our peer, or to one receiver of a multicast put
+  bool sendstatus(sarnet::udp* = nullptr);
   bool sendmetadata();
+  // Send the next part of the holes the receiver asked for
+  bool sendholes(size_t);
+  // Make this a multicast put sending k and extra % symbols per block
+  void fountainput(int);
+  // Make this a multicast put that repairs what the receivers NAK
+  void nakput();
+  // Send the next of the symbols owed, false once there are none
+  bool sendsymbols(size_t);
+  // Our checksum is known, send it in METADATA
+  void csumready(const checksums::checksum&);
 
   // Apply all of the information contained in the received
   // frame to the transfer instance
-  void applystatus(saratoga::status*);
+  // DATA and STATUS are applied straight from the receive buffer
+  void applystatus(const saratoga::statusview&);
   void applymetadata(saratoga::metadata*);
-  void applydata(saratoga::data*);
+  void applydata(const saratoga::dataview&);
+  void applysignature(saratoga::signature*);
+  void applyrepair(saratoga::repair*);
+  void applysymbol(saratoga::symbol*);
 
   string print();
   string holes_print() { return _holes.print(); };
@@ -313,12 +456,21 @@ public:
   // Return ptr to matching transfer with local fd or NULL
   saratoga::tran* match(sarfile::fileio*);
 
+  // Return ptr to the multicast put we are sending for the session or NULL
+  saratoga::tran* mmatch(session_t);
+
   // Handle inbound traffic for a transfer and return a pointer
   // to the applicable transfer or NULL if it doesn't exist
   saratoga::tran* rxrequest(saratoga::request*, sarnet::udp*);
   saratoga::tran* rxmetadata(saratoga::metadata*, sarnet::udp*);
-  saratoga::tran* rxdata(saratoga::data*, sarnet::udp*);
-  saratoga::tran* rxstatus(saratoga::status*, sarnet::udp*);
+  saratoga::tran* rxdata(const saratoga::dataview&, sarnet::udp*);
+  saratoga::tran* rxstatus(const saratoga::statusview&, sarnet::udp*);
+  saratoga::tran* rxsignature(saratoga::signature*, sarnet::udp*);
+  saratoga::tran* rxrepair(saratoga::repair*, sarnet::udp*);
+  saratoga::tran* rxsymbol(saratoga::symbol*, sarnet::udp*);
+
+  // Hand checksums finished by the checksum threads to their transfers
+  void csumready();
 
   string print();
 };